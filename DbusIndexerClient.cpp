@@ -297,6 +297,24 @@ QDBusPendingCall DbusIndexerClient::searchAsync(const QString& query,
                           options);
 }
 
+QDBusPendingCall DbusIndexerClient::searchPackedAsync(const QString& query,
+                                                      const QStringList& deviceIds,
+                                                      const QString& sortKey,
+                                                      const QString& sortDir,
+                                                      quint32 offset,
+                                                      quint32 limit,
+                                                      const QVariantMap& options) const {
+    QDBusInterface iface(m_service, m_path, m_iface, QDBusConnection::systemBus());
+    return iface.asyncCall(QStringLiteral("SearchPacked"),
+                          query,
+                          deviceIds,
+                          sortKey,
+                          sortDir,
+                          offset,
+                          limit,
+                          options);
+}
+
 std::optional<QVariantList> DbusIndexerClient::resolveDirectories(const QString& deviceId,
                                                                   const QList<quint32>& dirIds,
                                                                   QString* errorOut) const {
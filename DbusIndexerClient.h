@@ -60,6 +60,15 @@ public:
                                  quint32 limit,
                                  const QVariantMap& options = {}) const;
 
+    // Like searchAsync, but the reply is (t, ay): totalHits + a packed page (see SearchProtocol.h)
+    QDBusPendingCall searchPackedAsync(const QString& query,
+                                       const QStringList& deviceIds,
+                                       const QString& sortKey,
+                                       const QString& sortDir,
+                                       quint32 offset,
+                                       quint32 limit,
+                                       const QVariantMap& options = {}) const;
+
     std::optional<QVariantList> resolveDirectories(const QString& deviceId,
                                                    const QList<quint32>& dirIds,
                                                    QString* errorOut = nullptr) const;
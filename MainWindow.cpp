@@ -24,6 +24,7 @@
 #include <QLocale>
 #include <QSettings>
 #include <QScreen>
+#include <QScrollBar>
 #include <QtDBus/QDBusConnection>
 #include <QtDBus/QDBusPendingCallWatcher>
 #include <QtDBus/QDBusPendingReply>
@@ -443,6 +444,21 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
     remoteModel = new RemoteFileModel(m_dbus.get(), this);
     tableView->setModel(remoteModel);
 
+    // Tell the model which rows are on screen (it pages ahead in the scroll direction and
+    // drops requests for rows already scrolled past)
+    auto reportViewport = [this]() {
+        if (tableView->model() != remoteModel) return;
+
+        const int first = tableView->rowAt(0);
+        if (first < 0) return;
+
+        int last = tableView->rowAt(tableView->viewport()->height() - 1);
+        if (last < 0) last = remoteModel->rowCount() - 1;
+        remoteModel->setViewportRows(first, last);
+    };
+    connect(tableView->verticalScrollBar(), &QScrollBar::valueChanged, this, reportViewport);
+    connect(tableView->verticalScrollBar(), &QScrollBar::rangeChanged, this, reportViewport);
+
     // Surface daemon paging failures to the user (without making the UI noisy).
     connect(remoteModel, &RemoteFileModel::transientError, this, [this](const QString& msg) {
         statusBar()->showMessage(msg, 5000);
@@ -8,19 +8,34 @@
 #include <QMimeData>
 #include <QTimer>
 #include <QUrl>
+#include <cmath>
+#include <cstring>
 #include <limits>
 #include <QtDBus/QDBusArgument>
+#include <QtDBus/QDBusError>
 #include <QtDBus/QDBusVariant>
 #include <QtDBus/QDBusPendingCallWatcher>
 #include <QtDBus/QDBusPendingReply>
 #include "RemoteFileModel.h"
 #include "DbusIndexerClient.h"
 #include "GuiUtils.h"
+#include "SearchProtocol.h"
 
 static constexpr quint32 kFlagIsDir = 1u << 0;
 
+static qint64 steadyNowNs() {
+    return static_cast<qint64>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count()
+    );
+}
+
 RemoteFileModel::RemoteFileModel(DbusIndexerClient* client, QObject* parent)
-    : QAbstractTableModel(parent), m_client(client) {}
+    : QAbstractTableModel(parent), m_client(client) {
+    m_scrollIdleTimer = new QTimer(this);
+    m_scrollIdleTimer->setSingleShot(true);
+    m_scrollIdleTimer->setInterval(kScrollIdleMs);
+    connect(m_scrollIdleTimer, &QTimer::timeout, this, &RemoteFileModel::onScrollIdle);
+}
 
 std::optional<quint64> RemoteFileModel::entryIdAtRow(int row) const {
     if (row < 0) return std::nullopt;
@@ -31,13 +46,58 @@ std::optional<quint64> RemoteFileModel::entryIdAtRow(int row) const {
 
     ensurePageLoaded(pageIndex);
 
-    const auto pit = m_pages.find(pageIndex);
-    if (pit == m_pages.end()) return std::nullopt;
+    const QVector<Row>* page = m_pages.object(pageIndex);
+    if (!page) return std::nullopt;
+
+    if (inPage >= static_cast<quint32>(page->size())) return std::nullopt;
+
+    return (*page)[static_cast<int>(inPage)].entryId;
+}
+
+void RemoteFileModel::setViewportRows(int firstRow, int lastRow) {
+    if (firstRow < 0) return;
+    if (lastRow < firstRow) lastRow = firstRow;
+
+    const qint64 nowNs = steadyNowNs();
+
+    // Scroll speed in pages/s, smoothed over the last few updates. A long gap means the
+    // scroll (re)started from rest.
+    const double dt = static_cast<double>(nowNs - m_viewUpdatedNs) / 1e9;
+    if (m_haveViewport && dt > 0.0 && dt < 0.5) {
+        const double instant = static_cast<double>(firstRow - m_viewFirstRow) / kPageSize / dt;
+        m_pagesPerSec = 0.5 * m_pagesPerSec + 0.5 * instant;
+    } else {
+        m_pagesPerSec = 0.0;
+    }
 
-    const auto& page = pit.value();
-    if (inPage >= static_cast<quint32>(page.size())) return std::nullopt;
+    m_haveViewport = true;
+    m_viewFirstRow = firstRow;
+    m_viewFirstPage = static_cast<quint32>(firstRow) / kPageSize;
+    m_viewLastPage = static_cast<quint32>(lastRow) / kPageSize;
+    m_viewUpdatedNs = nowNs;
 
-    return page[static_cast<int>(inPage)].entryId;
+    m_scrollIdle = false;
+    m_scrollIdleTimer->start();
+}
+
+void RemoteFileModel::onScrollIdle() {
+    m_scrollIdle = true;
+    m_pagesPerSec = 0.0;
+
+    if (m_offline || !m_client || !m_haveViewport) return;
+
+    // The view has settled: fill in a few pages around it (fetched as larger spans, see dispatch)
+    const quint32 pages = pageCount();
+    const quint32 lo = m_viewFirstPage > kIdlePrefetchPages ? m_viewFirstPage - kIdlePrefetchPages : 0;
+    const quint32 hi = std::min(m_viewLastPage + kIdlePrefetchPages, pages == 0 ? 0 : pages - 1);
+
+    const bool cacheValidForQuery = (m_pagesSerial == m_querySerial);
+    for (quint32 p = lo; p <= hi && pages > 0; ++p) {
+        if (cacheValidForQuery && m_pages.contains(p)) continue;
+        if (m_pagesLoading.contains(p)) continue;
+        m_pagesWanted.insert(p);
+    }
+    if (!m_pagesWanted.isEmpty()) scheduleDispatch();
 }
 
 int RemoteFileModel::rowCount(const QModelIndex& parent) const {
@@ -334,6 +394,105 @@ std::optional<RemoteFileModel::Row> RemoteFileModel::parseRow(const QVariant& in
     return r;
 }
 
+bool RemoteFileModel::decodePackedPage(const QByteArray& packed, QVector<Row>& rowsOut, QVector<PageDir>& dirsOut,
+                                       QString* errorOut) {
+    rowsOut.clear();
+    dirsOut.clear();
+
+    auto fail = [&](const QString& msg) {
+        if (errorOut) *errorOut = msg;
+        rowsOut.clear();
+        dirsOut.clear();
+        return false;
+    };
+
+    const char* base = packed.constData();
+    const size_t size = static_cast<size_t>(packed.size());
+
+    SearchProtocol::PageHeader hdr{};
+    if (size < sizeof(hdr)) return fail(QStringLiteral("Packed page is truncated"));
+    std::memcpy(&hdr, base, sizeof(hdr));
+
+    if (hdr.magic != SearchProtocol::kMagic || hdr.version != SearchProtocol::kVersion) {
+        return fail(QStringLiteral("Packed page has unexpected magic/version"));
+    }
+    if (hdr.rowSize != sizeof(SearchProtocol::Row)) {
+        return fail(QStringLiteral("Packed page has unexpected row size %1").arg(hdr.rowSize));
+    }
+
+    // Device table (decoded once; every row shares the QString)
+    QVector<QString> devices;
+    devices.reserve(hdr.deviceCount);
+
+    size_t pos = sizeof(hdr);
+    for (quint32 d = 0; d < hdr.deviceCount; ++d) {
+        quint16 len = 0;
+        if (size - pos < sizeof(len)) return fail(QStringLiteral("Packed page device table is truncated"));
+        std::memcpy(&len, base + pos, sizeof(len));
+        pos += sizeof(len);
+
+        if (size - pos < len) return fail(QStringLiteral("Packed page device table is truncated"));
+        devices.push_back(QString::fromUtf8(base + pos, len));
+        pos += len;
+    }
+
+    const size_t rowsAt = SearchProtocol::align8(pos);
+    const size_t rowsBytes = static_cast<size_t>(hdr.rowCount) * sizeof(SearchProtocol::Row);
+    if (rowsAt > size || size - rowsAt < rowsBytes || size - rowsAt - rowsBytes < hdr.nameBytes) {
+        return fail(QStringLiteral("Packed page is truncated"));
+    }
+
+    const char* names = base + rowsAt + rowsBytes;
+
+    rowsOut.reserve(static_cast<qsizetype>(hdr.rowCount));
+    for (quint32 i = 0; i < hdr.rowCount; ++i) {
+        SearchProtocol::Row pr{};
+        std::memcpy(&pr, base + rowsAt + static_cast<size_t>(i) * sizeof(pr), sizeof(pr));
+
+        if (pr.deviceOrdinal >= devices.size() ||
+            static_cast<quint64>(pr.nameOffset) + pr.nameLen > hdr.nameBytes) {
+            return fail(QStringLiteral("Packed page row %1 is out of bounds").arg(i));
+        }
+
+        Row r;
+        r.entryId = pr.entryId;
+        r.deviceId = devices[pr.deviceOrdinal];
+        r.name = QString::fromUtf8(names + pr.nameOffset, pr.nameLen);
+        r.dirId = pr.dirId;
+        r.size = pr.size;
+        r.mtime = pr.mtime;
+        r.flags = pr.flags;
+        rowsOut.push_back(std::move(r));
+    }
+
+    // Inline directory paths ("includePaths"; none from an older daemon)
+    if (hdr.dirCount == 0) return true;
+
+    const size_t dirsAt = SearchProtocol::align8(rowsAt + rowsBytes + hdr.nameBytes);
+    const size_t dirsBytes = static_cast<size_t>(hdr.dirCount) * sizeof(SearchProtocol::DirEntry);
+    if (dirsAt > size || size - dirsAt < dirsBytes) {
+        return fail(QStringLiteral("Packed page directory table is truncated"));
+    }
+
+    const char* paths = base + dirsAt + dirsBytes;
+    const size_t pathBytes = size - dirsAt - dirsBytes;
+
+    dirsOut.reserve(static_cast<qsizetype>(hdr.dirCount));
+    for (quint32 i = 0; i < hdr.dirCount; ++i) {
+        SearchProtocol::DirEntry de{};
+        std::memcpy(&de, base + dirsAt + static_cast<size_t>(i) * sizeof(de), sizeof(de));
+
+        if (de.deviceOrdinal >= devices.size() || static_cast<quint64>(de.pathOffset) + de.pathLen > pathBytes) {
+            return fail(QStringLiteral("Packed page directory %1 is out of bounds").arg(i));
+        }
+
+        dirsOut.push_back(PageDir{devices[de.deviceOrdinal], de.dirId,
+                                  QString::fromUtf8(paths + de.pathOffset, static_cast<qsizetype>(de.pathLen))});
+    }
+
+    return true;
+}
+
 bool RemoteFileModel::rowsEqual(const Row& a, const Row& b) const {
     return a.entryId == b.entryId &&
            a.deviceId == b.deviceId &&
@@ -362,15 +521,46 @@ void RemoteFileModel::ensurePageLoaded(quint32 pageIndex) const {
     if (m_pagesLoading.contains(pageIndex)) return;
 
     // Coalesce: record intent, let dispatcher decide when to actually fire requests.
-    // Also prefetch neighbors for a more “Everything-like” feel during fast scroll/jumps.
     m_pagesWanted.insert(pageIndex);
-    if (pageIndex > 0) m_pagesWanted.insert(pageIndex - 1);
-    m_pagesWanted.insert(pageIndex + 1);
+
+    // Prefetch in the scroll direction, further the faster it goes (nothing while flying past),
+    // plus one page behind for a more “Everything-like” feel when the user reverses.
+    auto want = [&](quint32 p) {
+        if (cacheValidForQuery && m_pages.contains(p)) return;
+        if (m_pagesLoading.contains(p)) return;
+        m_pagesWanted.insert(p);
+    };
+
+    const quint32 ahead = prefetchDepth();
+    const quint32 pages = pageCount();
+    if (ahead > 0 && pages > 0) {
+        const bool up = m_pagesPerSec < 0.0;
+        for (quint32 k = 1; k <= ahead; ++k) {
+            if (up ? pageIndex < k : pageIndex + k >= pages) break;
+            want(up ? pageIndex - k : pageIndex + k);
+        }
+        if (up ? pageIndex + 1 < pages : pageIndex > 0) {
+            want(up ? pageIndex + 1 : pageIndex - 1);
+        }
+    }
 
     m_lastWantedPage = pageIndex;
     scheduleDispatch();
 }
 
+quint32 RemoteFileModel::pageCount() const {
+    const quint64 rows = static_cast<quint64>(rowCount());
+    return static_cast<quint32>((rows + kPageSize - 1) / kPageSize);
+}
+
+quint32 RemoteFileModel::prefetchDepth() const {
+    const double speed = std::abs(m_pagesPerSec);
+    if (speed > kFlyPastPagesPerSec) return 0;
+
+    const double reach = std::ceil(speed * kPrefetchLookaheadSeconds);
+    return 1 + static_cast<quint32>(std::min(reach, static_cast<double>(kMaxPrefetchPages - 1)));
+}
+
 void RemoteFileModel::scheduleDispatch() const {
     if (m_dispatchScheduled) return;
 
@@ -388,14 +578,30 @@ void RemoteFileModel::dispatchPendingLoads() const {
     if (m_offline) return;
     if (!m_client) return;
 
+    // Drop queued pages the view has already left (dragging the scrollbar across a large
+    // result would otherwise load every page it passed on the way).
+    if (m_haveViewport) {
+        const quint32 lo = m_viewFirstPage > kKeepWantedMarginPages ? m_viewFirstPage - kKeepWantedMarginPages : 0;
+        const quint32 hi = m_viewLastPage + kKeepWantedMarginPages;
+        for (auto it = m_pagesWanted.begin(); it != m_pagesWanted.end();) {
+            if (*it != 0 && (*it < lo || *it > hi)) { // page 0 carries totalHits
+                it = m_pagesWanted.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    // Prefer pages nearest to the view (or to the most recently requested page, before one is known).
+    const quint32 focus = m_haveViewport ? m_viewFirstPage + (m_viewLastPage - m_viewFirstPage) / 2 : m_lastWantedPage;
+
     auto pickClosestWanted = [&]() -> quint32 {
-        // Prefer the page nearest to the most recently requested page.
         quint32 best = *m_pagesWanted.constBegin();
-        quint32 bestDist = (best > m_lastWantedPage) ? (best - m_lastWantedPage) : (m_lastWantedPage - best);
+        quint32 bestDist = (best > focus) ? (best - focus) : (focus - best);
 
         for (auto it = m_pagesWanted.constBegin(); it != m_pagesWanted.constEnd(); ++it) {
             const quint32 p = *it;
-            const quint32 d = (p > m_lastWantedPage) ? (p - m_lastWantedPage) : (m_lastWantedPage - p);
+            const quint32 d = (p > focus) ? (p - focus) : (focus - p);
             if (d < bestDist) {
                 bestDist = d;
                 best = p;
@@ -405,52 +611,88 @@ void RemoteFileModel::dispatchPendingLoads() const {
         return best;
     };
 
-    // Start up to N concurrent page loads.
+    // Start up to N concurrent loads. Once scrolling has stopped, adjacent wanted pages go out
+    // as one larger request (fewer round trips); while scrolling, one page at a time keeps
+    // each reply small and quick.
     while (m_inFlightPageLoads < kMaxInFlightPageLoads && !m_pagesWanted.isEmpty()) {
         const quint32 pick = pickClosestWanted();
         m_pagesWanted.remove(pick);
-        startLoadPage(pick);
+
+        quint32 first = pick;
+        quint32 count = 1;
+        if (m_scrollIdle) {
+            while (count < kMaxIdleSpanPages && first > 0 && m_pagesWanted.remove(first - 1)) {
+                --first;
+                ++count;
+            }
+            while (count < kMaxIdleSpanPages && m_pagesWanted.remove(first + count)) {
+                ++count;
+            }
+        }
+        startLoadPages(first, count);
     }
 }
 
-void RemoteFileModel::startLoadPage(quint32 pageIndex) const {
+void RemoteFileModel::startLoadPages(quint32 firstPage, quint32 count) const {
     if (m_offline) return;
     if (!m_client) return;
 
+    // Trim ends that are already cached or on their way (pages inside a span are simply refetched)
     const bool cacheValidForQuery = (m_pagesSerial == m_querySerial);
-    if (cacheValidForQuery && m_pages.contains(pageIndex)) return;
-    if (m_pagesLoading.contains(pageIndex)) return;
+    auto skip = [&](quint32 p) {
+        return (cacheValidForQuery && m_pages.contains(p)) || m_pagesLoading.contains(p);
+    };
+    while (count > 0 && skip(firstPage)) {
+        ++firstPage;
+        --count;
+    }
+    while (count > 0 && skip(firstPage + count - 1)) {
+        --count;
+    }
+    if (count == 0) return;
 
     auto* self = const_cast<RemoteFileModel*>(this);
 
-    m_pagesLoading.insert(pageIndex);
+    for (quint32 p = firstPage; p < firstPage + count; ++p) {
+        m_pagesLoading.insert(p);
+    }
     ++m_inFlightPageLoads;
 
-    const quint32 offset = pageIndex * kPageSize;
-    const quint32 limit  = kPageSize;
+    const quint32 offset = firstPage * kPageSize;
+    const quint32 limit  = count * kPageSize;
 
     const quint64 serial = m_querySerial;
 
-    if (pageIndex == 0 && !m_searchStartNsBySerial.contains(serial)) {
-        const auto now = std::chrono::steady_clock::now().time_since_epoch();
-        const qint64 nowNs = static_cast<qint64>(
-            std::chrono::duration_cast<std::chrono::nanoseconds>(now).count()
-        );
-        m_searchStartNsBySerial.insert(serial, nowNs);
+    if (firstPage == 0 && !m_searchStartNsBySerial.contains(serial)) {
+        m_searchStartNsBySerial.insert(serial, steadyNowNs());
     }
 
+    const bool packed = m_usePackedSearch;
+
+    // Lets the daemon cancel work for queries we've already moved past
+    QVariantMap options;
+    options.insert(QStringLiteral("querySerial"), static_cast<qulonglong>(serial));
+
+    // Directory paths inline in the packed page (an older daemon ignores it; its pages carry none,
+    // and those paths are resolved separately as before)
+    if (packed) options.insert(QStringLiteral("includePaths"), true);
+
     auto* watcher = new QDBusPendingCallWatcher(
-        m_client->searchAsync(m_query, m_deviceIds, m_sortKey, m_sortDir, offset, limit, {}),
+        packed
+            ? m_client->searchPackedAsync(m_query, m_deviceIds, m_sortKey, m_sortDir, offset, limit, options)
+            : m_client->searchAsync(m_query, m_deviceIds, m_sortKey, m_sortDir, offset, limit, options),
         self
     );
 
     connect(watcher, &QDBusPendingCallWatcher::finished,
             self,
-            [this, self, watcher, pageIndex, serial]() {
+            [this, self, watcher, firstPage, count, serial, packed]() {
         watcher->deleteLater();
 
         // Always account for concurrency on completion.
-        m_pagesLoading.remove(pageIndex);
+        for (quint32 p = firstPage; p < firstPage + count; ++p) {
+            m_pagesLoading.remove(p);
+        }
         m_inFlightPageLoads = std::max(0, m_inFlightPageLoads - 1);
 
         // Drop stale replies (query changed while call was in-flight)
@@ -460,34 +702,74 @@ void RemoteFileModel::startLoadPage(quint32 pageIndex) const {
             return;
         }
 
-        // Search reply is (t, av) => <qulonglong, QVariantList>
-        QDBusPendingReply<qulonglong, QVariantList> reply = *watcher;
-        if (!reply.isValid()) {
-            if (!m_pagesFailed.contains(pageIndex)) {
-                m_pagesFailed.insert(pageIndex);
-                Q_EMIT self->transientError(QStringLiteral("Daemon error: ") + reply.error().message());
+        quint64 newTotalHits = 0;
+        QVector<Row> parsed;
+        QVector<PageDir> pageDirs;
+
+        if (packed) {
+            // SearchPacked reply is (t, ay) => <qulonglong, QByteArray>
+            QDBusPendingReply<qulonglong, QByteArray> reply = *watcher;
+            if (!reply.isValid()) {
+                if (reply.error().type() == QDBusError::UnknownMethod) {
+                    // Older daemon: retry these pages with the variant-based Search
+                    m_usePackedSearch = false;
+                    for (quint32 p = firstPage; p < firstPage + count; ++p) {
+                        m_pagesWanted.insert(p);
+                    }
+                    scheduleDispatch();
+                    return;
+                }
+                if (!m_pagesFailed.contains(firstPage)) {
+                    m_pagesFailed.insert(firstPage);
+                    Q_EMIT self->transientError(QStringLiteral("Daemon error: ") + reply.error().message());
+                }
+                scheduleDispatch();
+                return;
             }
-            scheduleDispatch();
-            return;
-        }
 
-        const quint64 newTotalHits = static_cast<quint64>(reply.argumentAt<0>());
-        const QVariantList rowsList = reply.argumentAt<1>();
+            newTotalHits = static_cast<quint64>(reply.argumentAt<0>());
 
-        QVector<Row> parsed;
-        parsed.reserve(rowsList.size());
+            QString decodeErr;
+            if (!decodePackedPage(reply.argumentAt<1>(), parsed, pageDirs, &decodeErr)) {
+                if (!m_pagesFailed.contains(firstPage)) {
+                    m_pagesFailed.insert(firstPage);
+                    Q_EMIT self->transientError(QStringLiteral("Daemon error: ") + decodeErr);
+                }
+                scheduleDispatch();
+                return;
+            }
+        } else {
+            // Search reply is (t, av) => <qulonglong, QVariantList>
+            QDBusPendingReply<qulonglong, QVariantList> reply = *watcher;
+            if (!reply.isValid()) {
+                if (!m_pagesFailed.contains(firstPage)) {
+                    m_pagesFailed.insert(firstPage);
+                    Q_EMIT self->transientError(QStringLiteral("Daemon error: ") + reply.error().message());
+                }
+                scheduleDispatch();
+                return;
+            }
 
-        QHash<QString, QSet<quint32>> toResolve;
+            newTotalHits = static_cast<quint64>(reply.argumentAt<0>());
+            const QVariantList rowsList = reply.argumentAt<1>();
 
-        for (const auto& item : rowsList) {
-            QString parseErr;
-            auto rowOpt = parseRow(item, &parseErr);
-            if (!rowOpt) continue;
+            parsed.reserve(rowsList.size());
+            for (const auto& item : rowsList) {
+                QString parseErr;
+                auto rowOpt = parseRow(item, &parseErr);
+                if (!rowOpt) continue;
+                parsed.push_back(*rowOpt);
+            }
+        }
 
-            Row r = *rowOpt;
-            parsed.push_back(r);
+        // Paths that came with the page are shown straight away with its rows (no second repaint)
+        for (const PageDir& d : pageDirs) {
+            cacheDirPath(d.deviceId, d.dirId, d.path);
+        }
 
-            if (!m_dirCache[r.deviceId].contains(r.dirId)) {
+        QHash<QString, QSet<quint32>> toResolve;
+        for (const Row& r : parsed) {
+            if (!m_dirCache.contains(DirKey(r.deviceId, r.dirId))) {
                 toResolve[r.deviceId].insert(r.dirId);
             }
         }
@@ -500,7 +782,7 @@ void RemoteFileModel::startLoadPage(quint32 pageIndex) const {
         }
 
         // Update row count changes using insert/remove rows (less repaint than layoutChanged()).
-        if (pageIndex == 0) {
+        if (firstPage == 0) {
             const int oldCount = self->rowCount(); // uses updated m_totalHits
 
             m_totalHits = newTotalHits;
@@ -515,36 +797,32 @@ void RemoteFileModel::startLoadPage(quint32 pageIndex) const {
             }
         }
 
-        // Update cached page and notify only if it actually changed.
-        const bool hadPage = m_pages.contains(pageIndex);
-        const QVector<Row> oldPage = hadPage ? m_pages.value(pageIndex) : QVector<Row>{};
+        // Split the reply into its pages; cache each and notify only if it actually changed.
+        for (quint32 i = 0; i < count; ++i) {
+            const quint32 pageIndex = firstPage + i;
+            const qsizetype from = static_cast<qsizetype>(i) * kPageSize;
+            auto* newPage = new QVector<Row>(from < parsed.size() ? parsed.mid(from, kPageSize) : QVector<Row>{});
 
-        m_pages.insert(pageIndex, parsed);
+            const QVector<Row>* oldPage = m_pages.object(pageIndex);
+            const bool changed = !oldPage || !pageEqual(*oldPage, *newPage);
+            const int rows = newPage->size();
 
-        const QVector<Row>& newPage = m_pages.value(pageIndex);
-        const bool changed = !hadPage || !pageEqual(oldPage, newPage);
+            m_pages.insert(pageIndex, newPage, std::max<qsizetype>(1, rows));
 
-        if (changed) {
-            const int startRow = static_cast<int>(pageIndex * kPageSize);
-            const int count = newPage.size();
-            if (count > 0) {
+            if (changed && rows > 0) {
+                const int startRow = static_cast<int>(pageIndex * kPageSize);
                 const QModelIndex topLeft = self->index(startRow, 0);
-                const QModelIndex bottomRight = self->index(startRow + count - 1, 3);
+                const QModelIndex bottomRight = self->index(startRow + rows - 1, 3);
                 Q_EMIT self->dataChanged(topLeft, bottomRight, {Qt::DisplayRole});
             }
         }
 
         // Emit status update when page 0 arrives
-        if (pageIndex == 0) {
-            const auto now = std::chrono::steady_clock::now().time_since_epoch();
-            const qint64 nowNs = static_cast<qint64>(
-                std::chrono::duration_cast<std::chrono::nanoseconds>(now).count()
-            );
-
+        if (firstPage == 0) {
             double elapsed = 0.0;
             const auto it = m_searchStartNsBySerial.find(serial);
             if (it != m_searchStartNsBySerial.end()) {
-                elapsed = static_cast<double>(nowNs - it.value()) / 1e9;
+                elapsed = static_cast<double>(steadyNowNs() - it.value()) / 1e9;
                 m_searchStartNsBySerial.erase(it);
             }
 
@@ -570,7 +848,7 @@ void RemoteFileModel::startLoadPage(quint32 pageIndex) const {
 
             QObject::connect(w2, &QDBusPendingCallWatcher::finished,
                              self,
-                             [this, self, w2, deviceId, pageIndex, serial, pending]() {
+                             [this, self, w2, deviceId, firstPage, count, serial, pending]() {
                 w2->deleteLater();
 
                 if (serial != m_querySerial) {
@@ -592,14 +870,14 @@ void RemoteFileModel::startLoadPage(quint32 pageIndex) const {
                             quint32 dirId = 0;
                             QString path;
                             if (decodeDirPairFromDbusArgument(qvariant_cast<QDBusArgument>(pv), dirId, path)) {
-                                m_dirCache[deviceId].insert(dirId, path);
+                                cacheDirPath(deviceId, dirId, path);
                             }
                         } else {
                             const QVariantList pair = pv.toList();
                             if (pair.size() == 2) {
                                 const quint32 dirId = pair[0].toUInt();
                                 const QString path = pair[1].toString();
-                                m_dirCache[deviceId].insert(dirId, path);
+                                cacheDirPath(deviceId, dirId, path);
                             }
                         }
                     }
@@ -607,15 +885,17 @@ void RemoteFileModel::startLoadPage(quint32 pageIndex) const {
 
                 (*pending)--;
 
-                // Update only the Path column for this page
+                // Update only the Path column for these pages (those still cached)
                 if (*pending <= 0) {
-                    const int startRow = static_cast<int>(pageIndex * kPageSize);
-                    const auto pit = m_pages.find(pageIndex);
-                    const int count = (pit == m_pages.end()) ? 0 : pit.value().size();
-                    if (count > 0) {
-                        const QModelIndex topLeft = self->index(startRow, 1);
-                        const QModelIndex bottomRight = self->index(startRow + count - 1, 1);
-                        Q_EMIT self->dataChanged(topLeft, bottomRight, {Qt::DisplayRole});
+                    for (quint32 p = firstPage; p < firstPage + count; ++p) {
+                        const QVector<Row>* page = m_pages.object(p);
+                        const int rows = page ? page->size() : 0;
+                        if (rows > 0) {
+                            const int startRow = static_cast<int>(p * kPageSize);
+                            const QModelIndex topLeft = self->index(startRow, 1);
+                            const QModelIndex bottomRight = self->index(startRow + rows - 1, 1);
+                            Q_EMIT self->dataChanged(topLeft, bottomRight, {Qt::DisplayRole});
+                        }
                     }
                 }
             });
@@ -623,6 +903,16 @@ void RemoteFileModel::startLoadPage(quint32 pageIndex) const {
     });
 }
 
+qsizetype RemoteFileModel::dirCacheCost(const QString& path) {
+    // Path characters plus node/key overhead, roughly
+    return path.size() * static_cast<qsizetype>(sizeof(QChar)) + 96;
+}
+
+void RemoteFileModel::cacheDirPath(const QString& deviceId, quint32 dirId, const QString& path) const {
+    // Least recently shown paths are evicted once the budget is exceeded
+    m_dirCache.insert(DirKey(deviceId, dirId), new QString(path), dirCacheCost(path));
+}
+
 QVariant RemoteFileModel::data(const QModelIndex& index, int role) const {
     if (!index.isValid() || role != Qt::DisplayRole) return {};
     if (m_offline) return {};
@@ -637,27 +927,24 @@ QVariant RemoteFileModel::data(const QModelIndex& index, int role) const {
 
     ensurePageLoaded(pageIndex);
 
-    const auto pit = m_pages.find(pageIndex);
-    if (pit == m_pages.end()) {
+    const QVector<Row>* page = m_pages.object(pageIndex);
+    if (!page) {
         return placeholder();
     }
 
-    const auto& page = pit.value();
-    if (inPage >= static_cast<quint32>(page.size())) {
+    if (inPage >= static_cast<quint32>(page->size())) {
         return placeholder();
     }
 
-    const Row& r = page[static_cast<int>(inPage)];
+    const Row& r = (*page)[static_cast<int>(inPage)];
 
     switch (index.column()) {
         case 0:
             return r.name;
         case 1: {
-            const auto devIt = m_dirCache.find(r.deviceId);
-            if (devIt == m_dirCache.end()) return placeholder();
-            const auto pathIt = devIt->find(r.dirId);
-            if (pathIt == devIt->end()) return placeholder();
-            return *pathIt;
+            const QString* path = m_dirCache.object(DirKey(r.deviceId, r.dirId));
+            if (!path) return placeholder();
+            return *path;
         }
         case 2:
             if (r.flags & kFlagIsDir) return QStringLiteral("<DIR>");
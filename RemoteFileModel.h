@@ -5,7 +5,9 @@
 #define KERYTHING_REMOTEFILEMODEL_H
 
 #include <QAbstractTableModel>
+#include <QCache>
 #include <QHash>
+#include <QPair>
 #include <QSet>
 #include <QString>
 #include <QStringList>
@@ -13,6 +15,7 @@
 #include <memory>
 
 class DbusIndexerClient;
+class QTimer;
 
 class RemoteFileModel final : public QAbstractTableModel {
     Q_OBJECT
@@ -32,6 +35,10 @@ public:
 
     [[nodiscard]] std::optional<quint64> entryIdAtRow(int row) const;
 
+    // Rows currently visible in the view (call on scroll/resize). Drives prefetch direction and depth,
+    // and lets queued requests for pages scrolled past be dropped.
+    void setViewportRows(int firstRow, int lastRow);
+
     int rowCount(const QModelIndex& parent = QModelIndex()) const override;
     int columnCount(const QModelIndex& parent = QModelIndex()) const override;
 
@@ -61,21 +68,33 @@ private:
         quint32 flags = 0; // bitmask
     };
 
+    // Display path of one dirId, carried inline by a packed page ("includePaths")
+    struct PageDir {
+        QString deviceId;
+        quint32 dirId = 0;
+        QString path;
+    };
+
     void clearAll();
     bool rowsEqual(const Row& a, const Row& b) const;
     bool pageEqual(const QVector<Row>& a, const QVector<Row>& b) const;
 
     void ensurePageLoaded(quint32 pageIndex) const;
+    [[nodiscard]] quint32 pageCount() const;
+    [[nodiscard]] quint32 prefetchDepth() const;
+    void onScrollIdle();
 
     // Coalesced async dispatch
     void scheduleDispatch() const;
     void dispatchPendingLoads() const;
-    void startLoadPage(quint32 pageIndex) const;
+    void startLoadPages(quint32 firstPage, quint32 count) const;
 
     [[nodiscard]] QString sortKeyForColumn(int column) const;
     [[nodiscard]] QString sortDirForOrder(Qt::SortOrder order) const;
 
     static std::optional<Row> parseRow(const QVariant& v, QString* errorOut);
+    static bool decodePackedPage(const QByteArray& packed, QVector<Row>& rowsOut, QVector<PageDir>& dirsOut,
+                                 QString* errorOut);
 
     DbusIndexerClient* m_client = nullptr;
 
@@ -88,7 +107,9 @@ private:
 
     static constexpr quint32 kPageSize = 256;
 
-    mutable QHash<quint32, QVector<Row>> m_pages; // pageIndex -> rows
+    // Page cache: pageIndex -> rows; LRU, cost = rows (empty pages past the end cost 1)
+    static constexpr qsizetype kPageCacheRows = 64 * 1024;
+    mutable QCache<quint32, QVector<Row>> m_pages{kPageCacheRows};
     mutable QSet<quint32> m_pagesLoading;         // avoid re-entrancy
     mutable QSet<quint32> m_pagesFailed;          // avoid spamming the same error
 
@@ -99,11 +120,35 @@ private:
     mutable bool m_dispatchScheduled = false;
     mutable quint32 m_lastWantedPage = 0;
 
-    // Path cache: deviceId -> (dirId -> pathString)
-    mutable QHash<QString, QHash<quint32, QString>> m_dirCache;
+    // Viewport tracking (fed by setViewportRows)
+    static constexpr quint32 kMaxPrefetchPages = 8;         // ahead, in the scroll direction
+    static constexpr double kPrefetchLookaheadSeconds = 0.5; // prefetch what the current speed reaches in this time
+    static constexpr double kFlyPastPagesPerSec = 60.0;      // faster (scrollbar drag): load only what is visible
+    static constexpr quint32 kKeepWantedMarginPages = 8;    // queued pages further than this from the view are dropped
+    static constexpr int kScrollIdleMs = 250;
+    static constexpr quint32 kIdlePrefetchPages = 4;        // each side of the view, once scrolling stops
+    static constexpr quint32 kMaxIdleSpanPages = 8;         // while idle, adjacent pages are fetched in one request
+    bool m_haveViewport = false;
+    quint32 m_viewFirstPage = 0;
+    quint32 m_viewLastPage = 0;
+    int m_viewFirstRow = 0;
+    qint64 m_viewUpdatedNs = 0;
+    double m_pagesPerSec = 0.0; // smoothed; negative = scrolling up
+    bool m_scrollIdle = true;
+    QTimer* m_scrollIdleTimer = nullptr;
+
+    // Path cache: (deviceId, dirId) -> pathString; LRU, cost = approximate bytes
+    using DirKey = QPair<QString, quint32>;
+    static constexpr qsizetype kDirCacheBytes = 8 * 1024 * 1024;
+    static qsizetype dirCacheCost(const QString& path);
+    void cacheDirPath(const QString& deviceId, quint32 dirId, const QString& path) const;
+    mutable QCache<DirKey, QString> m_dirCache{kDirCacheBytes};
 
     mutable quint64 m_totalHits = 0;
 
+    // Cleared if the daemon doesn't know SearchPacked (older kerythingd); falls back to Search
+    mutable bool m_usePackedSearch = true;
+
     // Timing for async searches (serial -> start time in nanoseconds since steady epoch)
     mutable QHash<quint64, qint64> m_searchStartNsBySerial;
 
@@ -0,0 +1,127 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026  Reikooters <https://github.com/Reikooters>
+
+#ifndef KERYTHING_SCANPROTOCOL_H
+#define KERYTHING_SCANPROTOCOL_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Framed ("streaming") scan output used between kerything-scanner-helper and kerythingd.
+ *
+ * The legacy helper output is a single blob (recordCount, FileRecord[], poolSize, pool) which
+ * the reader has to buffer completely before it can do anything with it. In streaming mode
+ * (helper invoked with --stream) the helper instead writes a sequence of small frames while
+ * the scan is still running, so the daemon can decode record batches directly into their final
+ * storage and start generating trigrams before the scan has finished.
+ *
+ * Every frame is a FrameHeader followed by payloadBytes of payload:
+ *
+ *   Hello   : HelloPayload (always the first frame)
+ *   Pool    : raw string pool bytes, appended to the pool received so far
+ *   Records : FileRecord[], appended to the records received so far
+ *             (all name ranges must already be covered by previously sent Pool frames;
+ *              parentRecordIdx may be provisional until a Parents frame overrides it)
+ *   Parents : uint32 firstRecordIdx, then uint32 parentRecordIdx[] for consecutive records
+ *   FileIds : uint32 firstRecordIdx, then uint64 fileId[] for consecutive records
+ *             (the record's file system id: its NTFS MFT record number or EXT4 inode number)
+ *   Checkpoint : CheckpointPayload (where the next delta starts: change journal position or change time)
+ *   End     : EndPayload (always the last frame)
+ *
+ * A delta stream (Hello flag kHelloDelta, helper invoked with --usn-since or --changed-since) only
+ * describes what changed since an earlier checkpoint. Its records are the current links of the
+ * changed files, and instead of Parents frames it carries:
+ *
+ *   ParentFileIds : uint32 firstRecordIdx, then uint64 parentFileId[] for consecutive records
+ *                   (0 = top level, i.e. parentRecordIdx 0xFFFFFFFF)
+ *   Changed       : uint64 fileId[] of every changed file; the receiver replaces the records it
+ *                   has for these ids with the ones in the delta (none = the file was deleted)
+ *   ChangedDirs   : uint64 fileId[] of directories whose entries were all re-read (0 = top level);
+ *                   every entry the receiver has in them counts as changed too
+ *   Stats         : StatsEntry[] of files whose links didn't change; updated in place
+ *
+ * All integers are little-endian.
+ */
+namespace ScanProtocol {
+    static constexpr uint32_t kMagic = 0x4D54534Bu; // "KSTM"
+    static constexpr uint16_t kVersion = 3;
+
+    // Upper bound for a single frame payload; keeps decoder buffers small and rejects garbage early.
+    static constexpr uint32_t kMaxPayloadBytes = 16u * 1024u * 1024u;
+
+    // Records per Records frame (27 bytes each => ~1.7 MiB per frame)
+    static constexpr size_t kRecordsPerFrame = 64 * 1024;
+
+    // Hello flags
+    static constexpr uint32_t kHelloDelta = 1u << 0;
+
+    // Helper exit code for "a delta can't bring this index up to date, do a full scan"
+    static constexpr int kExitNeedsFullScan = 75; // EX_TEMPFAIL
+
+    enum class FrameType : uint8_t {
+        Hello = 1,
+        Pool = 2,
+        Records = 3,
+        Parents = 4,
+        End = 5,
+        FileIds = 6,
+        ParentFileIds = 7,
+        Changed = 8,
+        Checkpoint = 9,
+        ChangedDirs = 10,
+        Stats = 11,
+    };
+
+    // StatsEntry::flags
+    static constexpr uint8_t kStatsIsDir = 1u << 0;
+    static constexpr uint8_t kStatsIsSymlink = 1u << 1;
+
+    #pragma pack(push, 1)
+
+    struct FrameHeader {
+        uint8_t type;
+        uint8_t reserved[3];
+        uint32_t payloadBytes;
+    };
+
+    struct HelloPayload {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t recordSize;   // sizeof(FileRecord) on the helper side
+        uint64_t recordsHint;  // Best-effort estimate of the final record count (0 = unknown)
+        uint32_t flags;        // kHelloDelta
+        uint32_t reserved;
+    };
+
+    // NTFS: position in $Extend\$UsnJrnl:$J
+    // EXT4: journalId = volume id (from the superblock UUID), nextUsn = inode change time (unix
+    //       seconds) the next delta starts at, journalFileId = 0
+    struct CheckpointPayload {
+        uint64_t journalId;     // UsnJournalID from $UsnJrnl:$Max; changes when the journal is recreated
+        uint64_t nextUsn;       // first USN not covered by the scan
+        uint64_t journalFileId; // MFT record number of $UsnJrnl
+    };
+
+    struct StatsEntry {
+        uint64_t fileId;
+        uint64_t size;
+        uint64_t modificationTime;
+        uint8_t flags;          // kStatsIsDir / kStatsIsSymlink
+    };
+
+    struct EndPayload {
+        uint64_t recordCount;
+        uint64_t poolSize;
+    };
+
+    #pragma pack(pop)
+
+    static_assert(sizeof(FrameHeader) == 8);
+    static_assert(sizeof(HelloPayload) == 24);
+    static_assert(sizeof(CheckpointPayload) == 24);
+    static_assert(sizeof(StatsEntry) == 25);
+    static_assert(sizeof(EndPayload) == 16);
+}
+
+#endif //KERYTHING_SCANPROTOCOL_H
@@ -4,6 +4,10 @@
 #include "ScannerUtils.h"
 #include "lib/utf8.h"
 
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
 namespace ScannerUtils {
     std::string utf16ToUtf8(const char16_t* utf16_ptr, size_t length) {
         if (!utf16_ptr || length == 0) {
@@ -21,4 +25,36 @@ namespace ScannerUtils {
 
         return out;
     }
+
+    bool isRotational(const std::string& devicePath) {
+        namespace fs = std::filesystem;
+
+        const std::string name = fs::path(devicePath).filename().string();
+        if (name.empty()) {
+            return false;
+        }
+
+        // Partitions don't have a queue directory of their own; their parent disk does
+        std::error_code ec;
+        const fs::path sysDev = fs::canonical(fs::path("/sys/class/block") / name, ec);
+        if (ec) {
+            return false;
+        }
+
+        for (const fs::path& dir : {sysDev, sysDev.parent_path()}) {
+            std::ifstream in(dir / "queue" / "rotational");
+            char c = 0;
+            if (in.get(c)) {
+                return c == '1';
+            }
+        }
+
+        return false;
+    }
+
+    void reportPhase(const char* name, std::chrono::steady_clock::duration elapsed) {
+        const auto us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+        std::cerr << "KERYTHING_PHASE " << name << " " << us << "\n";
+        std::cerr.flush();
+    }
 }
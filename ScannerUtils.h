@@ -4,6 +4,7 @@
 #ifndef KERYTHING_SCANNERUTILS_H
 #define KERYTHING_SCANNERUTILS_H
 
+#include <chrono>
 #include <string>
 #include <cstddef>
 
@@ -22,6 +23,40 @@ namespace ScannerUtils {
      *         returns "Invalid UTF-16 Data".
      */
     std::string utf16ToUtf8(const char16_t* utf16_ptr, size_t length);
+
+    /**
+     * Checks whether a block device (or the disk a partition is on) is a spinning disk,
+     * using /sys/class/block/<name>/queue/rotational.
+     *
+     * @param devicePath Resolved device path, e.g. /dev/sda1.
+     * @return true for rotational devices; false for SSDs/NVMe or if it can't be determined.
+     */
+    bool isRotational(const std::string& devicePath);
+
+    /**
+     * Reports how long one phase of a scan took, as a "KERYTHING_PHASE <name> <microseconds>" line on
+     * stderr (next to the KERYTHING_PROGRESS lines). kerythingd records them per job and sums a name
+     * reported more than once. Phases may overlap: "emit" is the helper's own write time, including
+     * the batches written while the others are still running.
+     *
+     * @param name Phase name without whitespace, e.g. "read" or "resolveParents".
+     * @param elapsed Wall time of the phase.
+     */
+    void reportPhase(const char* name, std::chrono::steady_clock::duration elapsed);
+
+    // Reports the time from construction to destruction as phase `name`
+    class PhaseTimer {
+    public:
+        explicit PhaseTimer(const char* name) : m_name(name) {}
+        ~PhaseTimer() { reportPhase(m_name, std::chrono::steady_clock::now() - m_start); }
+
+        PhaseTimer(const PhaseTimer&) = delete;
+        PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+    private:
+        const char* m_name;
+        std::chrono::steady_clock::time_point m_start = std::chrono::steady_clock::now();
+    };
 }
 
 #endif //KERYTHING_SCANNERUTILS_H
\ No newline at end of file
@@ -0,0 +1,78 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026  Reikooters <https://github.com/Reikooters>
+
+#ifndef KERYTHING_SEARCHPROTOCOL_H
+#define KERYTHING_SEARCHPROTOCOL_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Packed search page returned by kerythingd's SearchPacked (one D-Bus "ay" blob).
+ *
+ * Search returns every row as a variant list of 7 variants (with the deviceId string repeated per
+ * row), which costs a marshalling step and an allocation per field on both sides. The packed page
+ * is a single byte array instead:
+ *
+ *   PageHeader
+ *   device table : deviceCount x (uint16 byteLen, UTF-8 deviceId bytes)
+ *   padding      : zero bytes up to a multiple of 8
+ *   rows         : rowCount x Row
+ *   names        : nameBytes of UTF-8 names, referenced by Row::nameOffset/nameLen
+ *
+ * With the "includePaths" search option, the page also carries the display path of every distinct
+ * Row::dirId in it, so the client needs no ResolveDirectories round trip:
+ *
+ *   padding      : zero bytes up to a multiple of 8
+ *   dirs         : dirCount x DirEntry
+ *   paths        : UTF-8 display paths, referenced by DirEntry::pathOffset/pathLen (to the end of the page)
+ *
+ * Without it (or from an older daemon) dirCount is 0 and the page ends after the names.
+ *
+ * All integers are little-endian.
+ */
+namespace SearchProtocol {
+    static constexpr uint32_t kMagic = 0x5053524Bu; // "KRSP"
+    static constexpr uint16_t kVersion = 1;
+
+    #pragma pack(push, 1)
+
+    struct PageHeader {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t deviceCount;
+        uint32_t rowCount;
+        uint32_t rowSize;     // sizeof(Row) on the daemon side
+        uint32_t nameBytes;
+        uint32_t dirCount;    // 0 unless "includePaths" was requested
+    };
+
+    struct Row {
+        uint64_t entryId;
+        uint64_t size;
+        int64_t mtime;        // unix seconds
+        uint32_t dirId;       // parentRecordIdx
+        uint32_t flags;       // kFlagIsDir / kFlagIsSymlink
+        uint32_t nameOffset;  // into the names blob
+        uint16_t nameLen;
+        uint16_t deviceOrdinal; // index into the device table
+    };
+
+    struct DirEntry {
+        uint32_t dirId;
+        uint32_t pathOffset;  // into the paths blob
+        uint32_t pathLen;
+        uint16_t deviceOrdinal;
+        uint16_t reserved;
+    };
+
+    #pragma pack(pop)
+
+    static_assert(sizeof(PageHeader) == 24);
+    static_assert(sizeof(Row) == 40);
+    static_assert(sizeof(DirEntry) == 16);
+
+    static constexpr size_t align8(size_t n) { return (n + 7) & ~static_cast<size_t>(7); }
+}
+
+#endif //KERYTHING_SEARCHPROTOCOL_H
@@ -0,0 +1,451 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026  Reikooters <https://github.com/Reikooters>
+
+#include "IndexerBench.h"
+
+#include "../kerythingd/IndexerService.h"
+#include "../kerythingd/NameMatcher.h"
+#include "../ScanProtocol.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <set>
+
+#include <tbb/parallel_for.h>
+
+#include <QBuffer>
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QThreadPool>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // Snapshots go to <Options::indexRoot>/<uid> (a temporary directory, see main.cpp)
+    constexpr quint32 kBenchUid = 4242;
+    const QString kBenchDeviceId = QStringLiteral("bench:synthetic");
+
+    // Same page size as RemoteFileModel
+    constexpr quint32 kPageLimit = 256;
+
+    double secondsSince(Clock::time_point start) {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    // One timed stage: peak RSS is reset when it starts
+    class Stage {
+    public:
+        explicit Stage(QString name) : m_name(std::move(name)) {
+            IndexerBench::resetPeakRss();
+            m_start = Clock::now();
+        }
+
+        QJsonObject finish(quint64 items, quint64 bytes = 0) const {
+            const double s = secondsSince(m_start);
+
+            QJsonObject o;
+            o.insert(QStringLiteral("name"), m_name);
+            o.insert(QStringLiteral("seconds"), s);
+            o.insert(QStringLiteral("items"), static_cast<double>(items));
+            o.insert(QStringLiteral("itemsPerSecond"), s > 0 ? static_cast<double>(items) / s : 0.0);
+            if (bytes != 0) {
+                o.insert(QStringLiteral("bytes"), static_cast<double>(bytes));
+                o.insert(QStringLiteral("bytesPerSecond"), s > 0 ? static_cast<double>(bytes) / s : 0.0);
+            }
+            o.insert(QStringLiteral("peakRssBytes"), static_cast<double>(IndexerBench::peakRssBytes()));
+
+            qInfo().noquote() << QStringLiteral("[bench] %1: %2 s, %3 items/s")
+                                     .arg(m_name)
+                                     .arg(s, 0, 'f', 3)
+                                     .arg(s > 0 ? static_cast<double>(items) / s : 0.0, 0, 'f', 0);
+            return o;
+        }
+
+    private:
+        QString m_name;
+        Clock::time_point m_start;
+    };
+
+    // One line of a query log: "query", "query<TAB>sortKey" or "query<TAB>sortKey<TAB>sortDir"
+    struct LoggedQuery {
+        QString query;
+        QString sortKey = QStringLiteral("name");
+        QString sortDir = QStringLiteral("asc");
+    };
+
+    LoggedQuery parseLogLine(const std::string& line) {
+        const QStringList parts = QString::fromStdString(line).split(QLatin1Char('\t'));
+
+        LoggedQuery q;
+        q.query = parts.value(0);
+        if (parts.size() > 1 && !parts[1].isEmpty()) q.sortKey = parts[1];
+        if (parts.size() > 2 && !parts[2].isEmpty()) q.sortDir = parts[2];
+        return q;
+    }
+
+    // Nearest-rank percentile of sorted values
+    double percentile(const std::vector<double>& sorted, double p) {
+        if (sorted.empty()) return 0.0;
+        const size_t rank = static_cast<size_t>(std::ceil(p * static_cast<double>(sorted.size())));
+        return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+    }
+
+    // The dataset as the helper writes it with --stream: each Records frame preceded by the pool it needs
+    QByteArray encodeHelperStream(const ScannerEngine::SearchDatabase& db) {
+        using ScanProtocol::FrameType;
+
+        QByteArray out;
+        out.reserve(static_cast<qsizetype>(db.records.size() * sizeof(ScannerEngine::FileRecord) +
+                                           db.stringPool.size() + 4096));
+
+        auto frame = [&](FrameType type, const char* data, size_t n) {
+            ScanProtocol::FrameHeader h{};
+            h.type = static_cast<uint8_t>(type);
+            h.payloadBytes = static_cast<uint32_t>(n);
+            out.append(reinterpret_cast<const char*>(&h), sizeof(h));
+            if (n > 0) out.append(data, static_cast<qsizetype>(n));
+        };
+
+        ScanProtocol::HelloPayload hello{};
+        hello.magic = ScanProtocol::kMagic;
+        hello.version = ScanProtocol::kVersion;
+        hello.recordSize = sizeof(ScannerEngine::FileRecord);
+        hello.recordsHint = db.records.size();
+        frame(FrameType::Hello, reinterpret_cast<const char*>(&hello), sizeof(hello));
+
+        size_t poolSent = 0;
+        for (size_t first = 0; first < db.records.size(); first += ScanProtocol::kRecordsPerFrame) {
+            const size_t n = std::min(ScanProtocol::kRecordsPerFrame, db.records.size() - first);
+
+            size_t poolNeeded = poolSent;
+            for (size_t i = first; i < first + n; ++i) {
+                poolNeeded = std::max<size_t>(poolNeeded, db.records[i].nameOffset + db.records[i].nameLen);
+            }
+            while (poolSent < poolNeeded) {
+                const size_t chunk = std::min<size_t>(poolNeeded - poolSent, ScanProtocol::kMaxPayloadBytes);
+                frame(FrameType::Pool, db.stringPool.data() + poolSent, chunk);
+                poolSent += chunk;
+            }
+
+            frame(FrameType::Records, reinterpret_cast<const char*>(db.records.data() + first),
+                  n * sizeof(ScannerEngine::FileRecord));
+        }
+
+        if (poolSent < db.stringPool.size()) {
+            frame(FrameType::Pool, db.stringPool.data() + poolSent, db.stringPool.size() - poolSent);
+        }
+
+        ScanProtocol::EndPayload end{};
+        end.recordCount = db.records.size();
+        end.poolSize = db.stringPool.size();
+        frame(FrameType::End, reinterpret_cast<const char*>(&end), sizeof(end));
+        return out;
+    }
+}
+
+IndexerBench::IndexerBench(Options options)
+    : m_options(std::move(options)),
+      m_svc(std::make_unique<IndexerService>(nullptr, m_options.indexRoot)) {}
+
+IndexerBench::~IndexerBench() = default;
+
+bool IndexerBench::wants(const QString& stage) const {
+    return m_options.only.isEmpty() || m_options.only.contains(stage);
+}
+
+quint64 IndexerBench::peakRssBytes() {
+    QFile f(QStringLiteral("/proc/self/status"));
+    if (!f.open(QIODevice::ReadOnly)) return 0;
+
+    for (const QByteArray& line : f.readAll().split('\n')) {
+        if (!line.startsWith("VmHWM:")) continue;
+        const QByteArray kb = line.mid(6).trimmed().split(' ').value(0);
+        return kb.toULongLong() * 1024;
+    }
+    return 0;
+}
+
+void IndexerBench::resetPeakRss() {
+    QFile f(QStringLiteral("/proc/self/clear_refs"));
+    if (f.open(QIODevice::WriteOnly)) f.write("5");
+}
+
+bool IndexerBench::loadDataset(const QString& path, ScannerEngine::SearchDatabase& dbOut, QString* errorOut) {
+    QString deviceId;
+    auto idxOpt = m_svc->loadSnapshotFile(path, &deviceId, errorOut);
+    if (!idxOpt) return false;
+
+    const IndexerService::DeviceIndex& idx = *idxOpt;
+    const size_t n = idx.records.size();
+
+    // Interned snapshots share one pool copy per name; a scan sends one per record
+    dbOut.records.clear();
+    dbOut.stringPool.clear();
+    dbOut.records.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        if (idx.isDead(static_cast<quint32>(i))) continue;
+
+        ScannerEngine::FileRecord r = idx.records[i];
+        const char* name = idx.stringPool.data() + r.nameOffset;
+        r.nameOffset = static_cast<uint32_t>(dbOut.stringPool.size());
+        dbOut.stringPool.insert(dbOut.stringPool.end(), name, name + r.nameLen);
+        dbOut.records.push_back(r);
+    }
+    return true;
+}
+
+QJsonObject IndexerBench::run(ScannerEngine::SearchDatabase db, const QString& label,
+                              const std::vector<std::string>& queries) {
+    using DeviceIndex = IndexerService::DeviceIndex;
+
+    QJsonObject report;
+    report.insert(QStringLiteral("source"), label);
+    report.insert(QStringLiteral("entries"), static_cast<double>(db.records.size()));
+    report.insert(QStringLiteral("poolBytes"), static_cast<double>(db.stringPool.size()));
+
+    QJsonArray results;
+    const quint64 recordCount = db.records.size();
+
+    // ---- Helper stdout decoding ----
+    if (wants(QStringLiteral("parseHelperStdout"))) {
+        QByteArray wire = encodeHelperStream(db);
+        QBuffer buffer(&wire);
+        buffer.open(QIODevice::ReadOnly);
+
+        IndexerService::ScanStream st;
+        Stage stage(QStringLiteral("parseHelperStdout"));
+        const bool ok = IndexerService::consumeScanStream(st, &buffer) && IndexerService::finishScanStream(st);
+        QJsonObject r = stage.finish(recordCount, static_cast<quint64>(wire.size()));
+        if (!ok) r.insert(QStringLiteral("error"), st.error);
+        results.append(r);
+    }
+
+    // ---- Acceleration structures (what a full scan builds; always run, timed if selected) ----
+    auto idxPtr = std::make_shared<DeviceIndex>();
+    DeviceIndex& idx = *idxPtr;
+    idx.fsType = QStringLiteral("ext4");
+    idx.records.assign(db.records);
+    idx.stringPool = std::move(db.stringPool);
+    db = {};
+
+    auto build = [&](const QString& name, quint64 items, quint64 bytes, auto&& fn) {
+        if (!wants(name)) {
+            fn();
+            return;
+        }
+        Stage stage(name);
+        fn();
+        results.append(stage.finish(items, bytes));
+    };
+
+    const quint64 poolBytes = idx.stringPool.size();
+    build(QStringLiteral("buildFoldedPool"), poolBytes, poolBytes, [&]() { IndexerService::buildFoldedPool(idx); });
+    build(QStringLiteral("buildNameTable"), recordCount, 0, [&]() { IndexerService::buildNameTable(idx); });
+    build(QStringLiteral("buildTrigramIndex"), idx.names.nameCount(), 0, [&]() { IndexerService::buildTrigramIndex(idx); });
+    build(QStringLiteral("buildSortOrders"), recordCount, 0, [&]() { IndexerService::buildSortOrders(idx); });
+    build(QStringLiteral("buildExtensionIndex"), recordCount, 0, [&]() { IndexerService::buildExtensionIndex(idx); });
+    build(QStringLiteral("buildNameSignatures"), idx.names.nameCount(), 0, [&]() { IndexerService::buildNameSignatures(idx); });
+
+    report.insert(QStringLiteral("distinctNames"), static_cast<double>(idx.names.nameCount()));
+    report.insert(QStringLiteral("trigramIndexBytes"), static_cast<double>(idx.trigrams.byteSize()));
+
+    // ---- Candidates and refine, per distinct non-empty query of the log ----
+    struct TokenQuery {
+        QStringList tokens;
+        std::vector<QByteArray> bytes;
+    };
+    std::vector<TokenQuery> tokenQueries;
+    {
+        std::set<QString> seen;
+        for (const std::string& line : queries) {
+            if (static_cast<int>(tokenQueries.size()) >= m_options.refineQueries) break;
+
+            const QStringList tokens = IndexerService::tokenizeQuery(parseLogLine(line).query);
+            if (tokens.isEmpty() || !seen.insert(tokens.join(QLatin1Char(' '))).second) continue;
+
+            TokenQuery tq;
+            tq.tokens = tokens;
+            for (const QString& t : tokens) tq.bytes.push_back(t.toUtf8());
+            tokenQueries.push_back(std::move(tq));
+        }
+    }
+
+    auto matcherFor = [](const TokenQuery& tq) {
+        std::vector<std::string_view> needles;
+        needles.reserve(tq.bytes.size());
+        for (const QByteArray& b : tq.bytes) needles.emplace_back(b.constData(), static_cast<size_t>(b.size()));
+        return NameMatcher(needles);
+    };
+
+    if (wants(QStringLiteral("deviceCandidatesForQuery")) && !tokenQueries.empty()) {
+        quint64 hits = 0;
+        Stage stage(QStringLiteral("deviceCandidatesForQuery"));
+        for (const TokenQuery& tq : tokenQueries) {
+            hits += IndexerService::deviceMatchesForQuery(idx, tq.tokens, matcherFor(tq), IndexerService::SearchCancel{})
+                        .size();
+        }
+        QJsonObject r = stage.finish(tokenQueries.size());
+        r.insert(QStringLiteral("hits"), static_cast<double>(hits));
+        results.append(r);
+    }
+
+    if (wants(QStringLiteral("refine")) && !tokenQueries.empty()) {
+        static constexpr size_t kChunkNames = 16 * 1024;
+
+        const size_t names = idx.names.nameCount();
+        const char* folded = idx.foldedPool.data();
+
+        quint64 nameBytes = 0;
+        for (size_t id = 0; id < names; ++id) nameBytes += idx.names.nameLens[id];
+
+        // Every distinct name against each query, chunked across threads like deviceMatchesForQuery
+        std::atomic<quint64> matched{0};
+        Stage stage(QStringLiteral("refine"));
+        for (const TokenQuery& tq : tokenQueries) {
+            const NameMatcher matcher = matcherFor(tq);
+            tbb::parallel_for(size_t(0), (names + kChunkNames - 1) / kChunkNames, [&](size_t c) {
+                const size_t end = std::min(names, (c + 1) * kChunkNames);
+                quint64 local = 0;
+                for (size_t id = c * kChunkNames; id < end; ++id) {
+                    if (matcher.matchesFolded(idx.names.name(static_cast<quint32>(id), folded))) ++local;
+                }
+                matched.fetch_add(local, std::memory_order_relaxed);
+            });
+        }
+        QJsonObject r = stage.finish(static_cast<quint64>(names) * tokenQueries.size(), nameBytes * tokenQueries.size());
+        r.insert(QStringLiteral("matches"), static_cast<double>(matched.load()));
+        r.insert(QStringLiteral("kernel"), QString::fromLatin1(NameMatch::kernelName()));
+        results.append(r);
+    }
+
+    // ---- Search end to end: session cache, ordering, paging and packing, per logged query ----
+    if (wants(QStringLiteral("search")) && !queries.empty()) {
+        m_svc->m_indexesByUid[kBenchUid][kBenchDeviceId] = idxPtr;
+        m_svc->m_loadedUids.insert(kBenchUid);
+
+        std::vector<double> latenciesMs;
+        latenciesMs.reserve(queries.size() * static_cast<size_t>(m_options.searchPasses));
+        double totalSeconds = 0;
+        quint64 pageBytes = 0;
+        IndexerService::SearchTrace stages; // summed over every query
+        const IndexerService::SearchCacheStats statsBefore = m_svc->m_searchCacheStats;
+
+        resetPeakRss();
+        for (int pass = 0; pass < m_options.searchPasses; ++pass) {
+            // Every pass starts cold, like the first search after a rescan
+            m_svc->bumpUidEpoch(kBenchUid);
+
+            for (const std::string& line : queries) {
+                const LoggedQuery q = parseLogLine(line);
+                const IndexerService::SearchSnapshot snap = m_svc->searchSnapshotForUid(kBenchUid);
+
+                const Clock::time_point start = Clock::now();
+                quint64 totalHits = 0;
+                std::vector<IndexerService::PageHit> hits;
+                IndexerService::SearchTrace trace;
+                m_svc->collectSearchPage(snap, IndexerService::SearchCancel{}, IndexerService::SearchFilter{}, q.query,
+                                         {}, q.sortKey, q.sortDir, 0, kPageLimit, totalHits, hits, &trace);
+                const Clock::time_point marshalStart = Clock::now();
+                pageBytes += static_cast<quint64>(IndexerService::packedPageForHits(hits).size());
+                const double s = secondsSince(start);
+
+                stages.candidatesNs += trace.candidatesNs;
+                stages.refineNs += trace.refineNs;
+                stages.orderNs += trace.orderNs;
+                stages.mergeNs += trace.mergeNs;
+                stages.marshalNs += static_cast<quint64>(secondsSince(marshalStart) * 1e9);
+                stages.trigramRanges += trace.trigramRanges;
+                stages.candidates += trace.candidates;
+
+                latenciesMs.push_back(s * 1000.0);
+                totalSeconds += s;
+
+                // Background warm-ups (empty-query global order) finish before the next keystroke
+                m_svc->m_searchPool->waitForDone();
+            }
+        }
+
+        std::vector<double> sorted = latenciesMs;
+        std::sort(sorted.begin(), sorted.end());
+
+        double sum = 0;
+        for (const double v : sorted) sum += v;
+
+        const IndexerService::SearchCacheStats& stats = m_svc->m_searchCacheStats;
+
+        QJsonObject r;
+        r.insert(QStringLiteral("name"), QStringLiteral("search"));
+        r.insert(QStringLiteral("queries"), static_cast<double>(sorted.size()));
+        r.insert(QStringLiteral("seconds"), totalSeconds);
+        r.insert(QStringLiteral("queriesPerSecond"), totalSeconds > 0 ? static_cast<double>(sorted.size()) / totalSeconds : 0.0);
+        r.insert(QStringLiteral("p50Ms"), percentile(sorted, 0.50));
+        r.insert(QStringLiteral("p90Ms"), percentile(sorted, 0.90));
+        r.insert(QStringLiteral("p99Ms"), percentile(sorted, 0.99));
+        r.insert(QStringLiteral("maxMs"), sorted.empty() ? 0.0 : sorted.back());
+        r.insert(QStringLiteral("meanMs"), sorted.empty() ? 0.0 : sum / static_cast<double>(sorted.size()));
+        r.insert(QStringLiteral("packedPageBytes"), static_cast<double>(pageBytes));
+        r.insert(QStringLiteral("sessionHits"), static_cast<double>(stats.hits - statsBefore.hits));
+        r.insert(QStringLiteral("sessionMisses"), static_cast<double>(stats.misses - statsBefore.misses));
+        r.insert(QStringLiteral("sessionsNarrowed"), static_cast<double>(stats.narrowed - statsBefore.narrowed));
+
+        // Where the time went (SearchTrace, summed over all queries)
+        QJsonObject stageSeconds;
+        stageSeconds.insert(QStringLiteral("candidates"), static_cast<double>(stages.candidatesNs) / 1e9);
+        stageSeconds.insert(QStringLiteral("refine"), static_cast<double>(stages.refineNs) / 1e9);
+        stageSeconds.insert(QStringLiteral("order"), static_cast<double>(stages.orderNs) / 1e9);
+        stageSeconds.insert(QStringLiteral("merge"), static_cast<double>(stages.mergeNs) / 1e9);
+        stageSeconds.insert(QStringLiteral("marshal"), static_cast<double>(stages.marshalNs) / 1e9);
+        r.insert(QStringLiteral("stageSeconds"), stageSeconds);
+        r.insert(QStringLiteral("trigramRanges"), static_cast<double>(stages.trigramRanges));
+        r.insert(QStringLiteral("candidates"), static_cast<double>(stages.candidates));
+        r.insert(QStringLiteral("peakRssBytes"), static_cast<double>(peakRssBytes()));
+        results.append(r);
+
+        qInfo().noquote() << QStringLiteral("[bench] search: %1 queries, p50 %2 ms, p99 %3 ms")
+                                 .arg(sorted.size())
+                                 .arg(percentile(sorted, 0.50), 0, 'f', 3)
+                                 .arg(percentile(sorted, 0.99), 0, 'f', 3);
+
+        // Drop the sessions (and the service's reference) before the snapshot stages
+        m_svc->m_indexesByUid.erase(kBenchUid);
+        m_svc->m_loadedUids.erase(kBenchUid);
+        m_svc->bumpUidEpoch(kBenchUid);
+    }
+
+    // ---- Snapshot persistence ----
+    const bool wantLoad = wants(QStringLiteral("loadSnapshotFile"));
+    if (wants(QStringLiteral("saveSnapshot")) || wantLoad) {
+        const QString path = m_svc->snapshotPathFor(kBenchUid, kBenchDeviceId);
+
+        QString err;
+        bool ok = true;
+        if (wants(QStringLiteral("saveSnapshot"))) {
+            Stage stage(QStringLiteral("saveSnapshot"));
+            ok = m_svc->saveSnapshot(kBenchUid, kBenchDeviceId, idx, 0, &err);
+            QJsonObject r = stage.finish(recordCount, static_cast<quint64>(QFileInfo(path).size()));
+            if (!ok) r.insert(QStringLiteral("error"), err);
+            results.append(r);
+        } else {
+            ok = m_svc->saveSnapshot(kBenchUid, kBenchDeviceId, idx, 0, &err);
+        }
+
+        if (ok && wantLoad) {
+            // The index is mapped, not read: this is the daemon's startup cost per device
+            QString deviceId;
+            Stage stage(QStringLiteral("loadSnapshotFile"));
+            const bool loaded = m_svc->loadSnapshotFile(path, &deviceId, &err).has_value();
+            QJsonObject r = stage.finish(recordCount, static_cast<quint64>(QFileInfo(path).size()));
+            if (!loaded) r.insert(QStringLiteral("error"), err);
+            results.append(r);
+        }
+
+        QFile::remove(path);
+    }
+
+    report.insert(QStringLiteral("results"), results);
+    return report;
+}
@@ -0,0 +1,69 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026  Reikooters <https://github.com/Reikooters>
+
+#ifndef KERYTHING_BENCH_INDEXERBENCH_H
+#define KERYTHING_BENCH_INDEXERBENCH_H
+
+#include <QJsonObject>
+#include <QString>
+#include <QStringList>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../ScannerEngine.h"
+
+class IndexerService;
+
+/**
+ * Runs the daemon's hot paths over one dataset and reports each as a JSON object.
+ *
+ * Friend of IndexerService: the stages are called directly (no D-Bus), on the same code the
+ * daemon runs. Per dataset, in order:
+ *
+ *   parseHelperStdout   : the dataset encoded as a helper stream, decoded by consumeScanStream + finishScanStream
+ *   buildFoldedPool, buildNameTable, buildTrigramIndex, buildSortOrders, buildExtensionIndex,
+ *   buildNameSignatures : the acceleration structures, as after a full scan
+ *   deviceCandidatesForQuery : trigram candidates + refine per distinct query (deviceMatchesForQuery)
+ *   refine              : NameMatcher over every distinct name, per distinct query
+ *   search              : the query log through collectSearchPage + packedPageForHits (latency percentiles,
+ *                         time per SearchTrace stage)
+ *   saveSnapshot, loadSnapshotFile
+ *
+ * Each result carries seconds, items (and bytes) per second and the peak RSS during the stage.
+ */
+class IndexerBench {
+public:
+    struct Options {
+        QStringList only;       // stage names to time (empty = all)
+        int searchPasses = 1;   // passes over the query log, each from cold caches
+        int refineQueries = 16; // distinct queries used by deviceCandidatesForQuery / refine
+        QString indexRoot;      // where saveSnapshot writes (a throwaway directory)
+    };
+
+    explicit IndexerBench(Options options);
+    ~IndexerBench();
+
+    /**
+     * Benchmarks one dataset (consumed: its arrays become the index).
+     *
+     * @param label Shown in the report (the synthetic volume or the snapshot path).
+     * @param queries Query log lines (see kerything-bench --help).
+     */
+    QJsonObject run(ScannerEngine::SearchDatabase db, const QString& label, const std::vector<std::string>& queries);
+
+    // Records + pool of a snapshot file, one name copy per record like a fresh scan; false on error
+    bool loadDataset(const QString& path, ScannerEngine::SearchDatabase& dbOut, QString* errorOut);
+
+    // VmHWM of this process (bytes), and resetting it (Linux 4.0+; otherwise it just keeps growing)
+    static quint64 peakRssBytes();
+    static void resetPeakRss();
+
+private:
+    bool wants(const QString& stage) const;
+
+    Options m_options;
+    std::unique_ptr<IndexerService> m_svc;
+};
+
+#endif //KERYTHING_BENCH_INDEXERBENCH_H
@@ -0,0 +1,308 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026  Reikooters <https://github.com/Reikooters>
+
+#include "SyntheticVolume.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <random>
+#include <string_view>
+#include <unordered_set>
+
+namespace {
+    constexpr uint32_t kNoParent = 0xFFFFFFFFu;
+    constexpr int kMaxDepth = 24;
+
+    // Fixed "now" (2026-01-01) so mtimes don't depend on when the benchmark runs
+    constexpr uint64_t kNow = 1'767'225'600ULL;
+
+    // Most common first: picked with a Zipf-like weight
+    constexpr std::array kCommonFileNames = {
+        "index.js", "package.json", "README.md", "__init__.py", "LICENSE", ".gitignore", "Makefile",
+        "index.d.ts", "CMakeLists.txt", "Thumbs.db", "desktop.ini", "config.json", "main.cpp", "style.css",
+        "index.html", "icon.png", "favicon.ico", "setup.py", "utils.py", "test.js", "CHANGELOG.md",
+        "tsconfig.json", ".DS_Store", "Cargo.toml", "mod.rs", "lib.rs", "build.gradle", "pom.xml",
+        "AndroidManifest.xml", "strings.xml", "metadata.json", "manifest.json", "types.ts", "logo.svg",
+        "folder.jpg", "cover.jpg", "info.plist", "default.conf", "settings.ini", "data.bin",
+    };
+
+    constexpr std::array kCommonDirNames = {
+        "node_modules", "src", ".git", "lib", "test", "tests", "include", "docs", "build", "assets",
+        "images", "bin", "share", "dist", "res", "objects", "refs", "cache", "tmp", "config", "Documents",
+        "Pictures", "Music", "Downloads", "Photos", "2019", "2020", "2021", "2022", "2023", "2024", "2025",
+        "__pycache__", "vendor", "site-packages", "locale", "icons", "fonts", "scripts", "examples",
+    };
+
+    constexpr std::array kWords = {
+        "report", "invoice", "photo", "image", "backup", "project", "draft", "final", "notes", "summary",
+        "budget", "meeting", "holiday", "family", "wedding", "birthday", "screenshot", "recording", "video",
+        "music", "album", "track", "mix", "demo", "sample", "template", "resume", "letter", "contract",
+        "scan", "receipt", "statement", "tax", "return", "presentation", "slides", "lecture", "chapter",
+        "book", "manual", "guide", "readme", "setup", "install", "update", "patch", "release", "build",
+        "debug", "test", "spec", "config", "settings", "profile", "user", "account", "export", "import",
+        "data", "dataset", "model", "train", "eval", "results", "log", "trace", "dump", "core", "kernel",
+        "driver", "module", "plugin", "theme", "icon", "font", "cache", "index", "search", "query", "server",
+        "client", "api", "service", "worker", "handler", "controller", "view", "widget", "dialog", "window",
+        "parser", "lexer", "compiler", "runtime", "engine", "render", "shader", "texture", "mesh", "scene",
+        "level", "map", "world", "player", "enemy", "sound", "effect", "sprite", "animation", "camera",
+        "network", "socket", "stream", "buffer", "queue", "table", "record", "entry", "field", "column",
+        "schema", "migration", "seed", "fixture", "mock", "stub", "helper", "util", "common", "shared",
+        "public", "private", "internal", "legacy", "old", "new", "copy", "temp", "archive", "misc",
+        "january", "february", "march", "april", "summer", "winter", "weekend", "trip", "beach", "mountain",
+        "garden", "kitchen", "house", "car", "bike", "dog", "cat", "baby", "school", "work",
+    };
+
+    // A small share of words is non-ASCII (exercises Unicode folding)
+    constexpr std::array kNonAsciiWords = {
+        "Übersicht", "résumé", "Straße", "Фото", "Документы", "写真", "資料", "Ñandú", "café", "Ελλάδα",
+        "Größe", "naïve", "Äpfel", "Øresund", "Łódź", "Çalışma",
+    };
+
+    struct Extension {
+        const char* ext;
+        int weight;
+    };
+
+    constexpr std::array kExtensions = {
+        Extension{"jpg", 14}, Extension{"png", 10}, Extension{"txt", 6},  Extension{"pdf", 6},
+        Extension{"js", 8},   Extension{"py", 5},   Extension{"h", 5},    Extension{"cpp", 4},
+        Extension{"c", 3},    Extension{"json", 5}, Extension{"xml", 3},  Extension{"html", 3},
+        Extension{"css", 2},  Extension{"mp3", 4},  Extension{"flac", 1}, Extension{"mp4", 2},
+        Extension{"mkv", 1},  Extension{"docx", 2}, Extension{"xlsx", 1}, Extension{"zip", 1},
+        Extension{"gz", 1},   Extension{"so", 2},   Extension{"o", 2},    Extension{"dll", 1},
+        Extension{"log", 2},  Extension{"md", 2},   Extension{"svg", 1},  Extension{"ts", 2},
+        Extension{"rs", 1},   Extension{"go", 1},   Extension{"java", 1}, Extension{"class", 1},
+        Extension{"JPG", 3},  Extension{"PNG", 1},  Extension{"heic", 1}, Extension{"mov", 1},
+    };
+
+    class Generator {
+    public:
+        explicit Generator(uint64_t seed)
+            : m_rng(seed),
+              m_depth(5.0),
+              m_fileSize(8.5, 2.5),
+              m_age(1.0 / (2.0 * 365.0 * 86'400.0)) {
+            int total = 0;
+            for (const Extension& e : kExtensions) total += e.weight;
+            m_extensionTotal = total;
+        }
+
+        double uniform() { return m_unit(m_rng); }
+        uint64_t below(uint64_t n) { return n == 0 ? 0 : m_rng() % n; }
+
+        // 1-based directory depth
+        int directoryDepth() { return std::clamp(1 + m_depth(m_rng), 1, kMaxDepth); }
+
+        // Zipf-like pick among n candidates ordered by popularity (log-uniform rank)
+        size_t zipf(size_t n) {
+            return std::min(n - 1, static_cast<size_t>(std::pow(static_cast<double>(n), uniform())) - 1);
+        }
+
+        uint64_t fileSize() {
+            if (uniform() < 0.02) return 0;
+            return static_cast<uint64_t>(std::min(std::exp(m_fileSize(m_rng)), 1e12));
+        }
+
+        uint64_t mtime() {
+            const double age = std::min(m_age(m_rng), 20.0 * 365.0 * 86'400.0);
+            return kNow - static_cast<uint64_t>(age);
+        }
+
+        std::string_view word() {
+            if (uniform() < 0.03) return kNonAsciiWords[below(kNonAsciiWords.size())];
+            // Half popular, half any word: keeps any one word from dominating the volume
+            return kWords[uniform() < 0.5 ? zipf(kWords.size()) : below(kWords.size())];
+        }
+
+        const char* extension() {
+            int pick = static_cast<int>(below(static_cast<uint64_t>(m_extensionTotal)));
+            for (const Extension& e : kExtensions) {
+                if (pick < e.weight) return e.ext;
+                pick -= e.weight;
+            }
+            return kExtensions[0].ext;
+        }
+
+        // 1-3 words in one of the usual naming styles, maybe with a number or date
+        void stem(std::string& out) {
+            const int words = 1 + static_cast<int>(below(3));
+            const uint64_t style = below(4);
+
+            for (int w = 0; w < words; ++w) {
+                std::string_view wd = word();
+                if (w > 0) {
+                    if (style == 0) out += '_';
+                    else if (style == 1) out += '-';
+                    else if (style == 2) out += ' ';
+                }
+                const size_t at = out.size();
+                out.append(wd);
+                if (style == 3 || (w == 0 && uniform() < 0.3)) {
+                    // camelCase / Capitalized (ASCII only; the other words stay as they are)
+                    if (out[at] >= 'a' && out[at] <= 'z') out[at] = static_cast<char>(out[at] - 'a' + 'A');
+                }
+            }
+
+            const double r = uniform();
+            if (r < 0.25) {
+                out += '_';
+                out += std::to_string(below(1000));
+            } else if (r < 0.35) {
+                out += ' ';
+                out += std::to_string(2005 + below(21));
+                out += '-';
+                const uint64_t month = 1 + below(12);
+                if (month < 10) out += '0';
+                out += std::to_string(month);
+            } else if (r < 0.40) {
+                out += " (";
+                out += std::to_string(1 + below(5));
+                out += ')';
+            }
+        }
+
+        void fileName(std::string& out) {
+            const double r = uniform();
+            if (r < 0.25) {
+                out += kCommonFileNames[zipf(kCommonFileNames.size())];
+                return;
+            }
+            if (r < 0.30) {
+                // Camera roll
+                const uint64_t n = below(10'000);
+                out += (n & 1) ? "IMG_" : "DSC";
+                const std::string digits = std::to_string(n);
+                out.append(4 - std::min<size_t>(4, digits.size()), '0');
+                out += digits;
+                out += (n & 2) ? ".JPG" : ".jpg";
+                return;
+            }
+
+            stem(out);
+            out += '.';
+            out += extension();
+        }
+
+        void dirName(std::string& out) {
+            if (uniform() < 0.4) {
+                out += kCommonDirNames[zipf(kCommonDirNames.size())];
+                return;
+            }
+            stem(out);
+        }
+
+    private:
+        std::mt19937_64 m_rng;
+        std::uniform_real_distribution<double> m_unit{0.0, 1.0};
+        std::poisson_distribution<int> m_depth;
+        std::lognormal_distribution<double> m_fileSize;
+        std::exponential_distribution<double> m_age;
+        int m_extensionTotal = 0;
+    };
+}
+
+namespace SyntheticVolume {
+    ScannerEngine::SearchDatabase generate(const Params& params) {
+        ScannerEngine::SearchDatabase db;
+        Generator gen(params.seed);
+
+        const uint64_t n = params.entries;
+        db.records.reserve(n);
+        db.stringPool.reserve(n * 16);
+
+        // dirsByDepth[d]: directories at depth d + 1 (depth 1 = top level)
+        std::vector<std::vector<uint32_t>> dirsByDepth(kMaxDepth);
+        std::vector<uint32_t> allDirs;
+        allDirs.reserve(static_cast<size_t>(static_cast<double>(n) * params.dirFraction) + 64);
+
+        // Recently created directories are the likeliest to get more entries
+        auto pickRecent = [&](const std::vector<uint32_t>& from) -> uint32_t {
+            const double u = gen.uniform();
+            const size_t back = static_cast<size_t>(static_cast<double>(from.size()) * u * u * u);
+            return from[from.size() - 1 - std::min(back, from.size() - 1)];
+        };
+
+        std::string name;
+        for (uint64_t i = 0; i < n; ++i) {
+            const bool isDir = allDirs.size() < 16 || gen.uniform() < params.dirFraction;
+
+            ScannerEngine::FileRecord r{};
+            name.clear();
+
+            if (isDir) {
+                int depth = gen.directoryDepth();
+                while (depth > 1 && dirsByDepth[depth - 2].empty()) --depth;
+
+                r.parentRecordIdx = depth == 1 ? kNoParent : pickRecent(dirsByDepth[depth - 2]);
+                r.size = 4096;
+                gen.dirName(name);
+
+                dirsByDepth[depth - 1].push_back(static_cast<uint32_t>(i));
+                allDirs.push_back(static_cast<uint32_t>(i));
+            } else {
+                r.parentRecordIdx = gen.uniform() < 0.5 ? pickRecent(allDirs)
+                                                        : allDirs[gen.below(allDirs.size())];
+                r.size = gen.fileSize();
+                r.isSymlink = gen.uniform() < 0.005 ? 1 : 0;
+                gen.fileName(name);
+            }
+
+            r.isDir = isDir ? 1 : 0;
+            r.modificationTime = gen.mtime();
+            r.nameOffset = static_cast<uint32_t>(db.stringPool.size());
+            r.nameLen = static_cast<uint16_t>(std::min<size_t>(name.size(), 0xFFFF));
+            db.stringPool.insert(db.stringPool.end(), name.data(), name.data() + r.nameLen);
+            db.records.push_back(r);
+        }
+
+        return db;
+    }
+
+    std::vector<std::string> sampleQueries(const ScannerEngine::SearchDatabase& db, uint64_t seed, size_t words) {
+        std::vector<std::string> out;
+        if (db.records.empty()) return out;
+
+        std::mt19937_64 rng(seed ^ 0x9E3779B97F4A7C15ULL);
+
+        // Words (runs of ASCII letters, 3+ bytes) of randomly picked names, lower-cased like typed queries
+        std::vector<std::string> picked;
+        std::unordered_set<std::string> seen;
+        for (size_t attempt = 0; picked.size() < words && attempt < words * 50; ++attempt) {
+            const ScannerEngine::FileRecord& r = db.records[rng() % db.records.size()];
+            const std::string_view nm(db.stringPool.data() + r.nameOffset, r.nameLen);
+
+            // The first word, up to a separator or the next camelCase capital
+            std::string w;
+            for (const char c : nm) {
+                const bool upper = c >= 'A' && c <= 'Z';
+                if (!upper && !(c >= 'a' && c <= 'z')) break;
+                if (upper && !w.empty()) break;
+                w += static_cast<char>(upper ? c - 'A' + 'a' : c);
+            }
+            if (w.size() >= 3 && seen.insert(w).second) picked.push_back(std::move(w));
+        }
+
+        // Typing each word, one key at a time
+        for (const std::string& w : picked) {
+            for (size_t len = 1; len <= w.size(); ++len) out.push_back(w.substr(0, len));
+        }
+
+        // Two words at once, and words with an extension
+        for (size_t i = 0; i + 1 < picked.size(); i += 2) {
+            out.push_back(picked[i] + " " + picked[i + 1]);
+        }
+        for (size_t i = 0; i < picked.size(); i += 3) {
+            out.push_back(picked[i] + " ext:jpg");
+        }
+        out.push_back("ext:pdf");
+        out.push_back("*.mp3");
+
+        // Browsing everything (empty query) by each sort key
+        out.push_back("\tname");
+        out.push_back("\tpath");
+        out.push_back("\tsize\tdesc");
+        out.push_back("\tmtime\tdesc");
+        return out;
+    }
+}
@@ -0,0 +1,45 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026  Reikooters <https://github.com/Reikooters>
+
+#ifndef KERYTHING_BENCH_SYNTHETICVOLUME_H
+#define KERYTHING_BENCH_SYNTHETICVOLUME_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../ScannerEngine.h"
+
+/**
+ * Synthetic file system indexes for kerything-bench, in the helper's output format
+ * (ScannerEngine::FileRecord + string pool).
+ *
+ * The shape follows what real volumes look like to the indexer rather than uniform noise:
+ *  - Directory depth is drawn around 6 levels (up to 24), and records arrive roughly parent-first,
+ *    like an EXT4 inode scan. Files cluster in recently created directories.
+ *  - About a quarter of all names come from a small, Zipf-weighted set of very common names
+ *    ("index.js", "__init__.py", "Thumbs.db", ...), the rest are word stems in mixed styles with
+ *    numbers, dates and weighted extensions; a few percent are non-ASCII.
+ *  - Sizes are log-normal, modification times skew recent.
+ *
+ * Everything is derived from the seed, so the same (entries, seed) is the same volume everywhere.
+ */
+namespace SyntheticVolume {
+    struct Params {
+        uint64_t entries = 1'000'000;
+        uint64_t seed = 1;
+        double dirFraction = 0.08; // share of records that are directories
+    };
+
+    [[nodiscard]] ScannerEngine::SearchDatabase generate(const Params& params);
+
+    /**
+     * A query log for the volume: as-you-type prefixes of words that occur in it, multi-token and
+     * extension queries, and empty queries. One query per entry, in the format of a query log file
+     * (see kerything-bench --help).
+     */
+    [[nodiscard]] std::vector<std::string> sampleQueries(const ScannerEngine::SearchDatabase& db, uint64_t seed,
+                                                         size_t words);
+}
+
+#endif //KERYTHING_BENCH_SYNTHETICVOLUME_H
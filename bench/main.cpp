@@ -0,0 +1,179 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026  Reikooters <https://github.com/Reikooters>
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <QTextStream>
+
+#include <chrono>
+#include <fstream>
+#include <thread>
+
+#include <sys/resource.h>
+
+#include "IndexerBench.h"
+#include "SyntheticVolume.h"
+#include "../kerythingd/NameMatcher.h"
+#include "../Version.h"
+
+// "1M", "250k", "2G" or a plain number; 0 if malformed
+static quint64 parseCount(QString s) {
+    s = s.trimmed();
+    quint64 scale = 1;
+    if (s.endsWith(QLatin1Char('k'), Qt::CaseInsensitive)) scale = 1'000;
+    else if (s.endsWith(QLatin1Char('m'), Qt::CaseInsensitive)) scale = 1'000'000;
+    else if (s.endsWith(QLatin1Char('g'), Qt::CaseInsensitive)) scale = 1'000'000'000;
+    if (scale != 1) s.chop(1);
+
+    bool ok = false;
+    const quint64 n = s.toULongLong(&ok);
+    return ok ? n * scale : 0;
+}
+
+static bool readQueryLog(const QString& path, std::vector<std::string>& out) {
+    std::ifstream in(path.toStdString());
+    if (!in) return false;
+
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty() || line.front() == '#') continue;
+        out.push_back(line);
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("kerything-bench"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral(
+        "Benchmarks kerythingd's indexing, search and snapshot paths on synthetic volumes or a snapshot file.\n"
+        "Prints one JSON report to stdout (progress goes to stderr).\n\n"
+        "Query log: one query per line, optionally followed by <TAB>sortKey and <TAB>sortDir\n"
+        "(name/path/size/mtime, asc/desc). An empty query is written as <TAB>sortKey. Lines starting\n"
+        "with # are skipped."));
+    parser.addHelpOption();
+
+    const QCommandLineOption entriesOpt(
+        QStringLiteral("entries"),
+        QStringLiteral("Comma-separated synthetic volume sizes (k/M/G suffixes), default 1M."),
+        QStringLiteral("sizes"), QStringLiteral("1M"));
+    const QCommandLineOption seedOpt(QStringLiteral("seed"), QStringLiteral("Synthetic volume seed, default 1."),
+                                     QStringLiteral("n"), QStringLiteral("1"));
+    const QCommandLineOption snapshotOpt(QStringLiteral("snapshot"),
+                                         QStringLiteral("Benchmark the records of this .kix snapshot instead."),
+                                         QStringLiteral("path"));
+    const QCommandLineOption queriesOpt(
+        QStringLiteral("queries"),
+        QStringLiteral("Query log for the search stages (default: sampled from the volume)."),
+        QStringLiteral("path"));
+    const QCommandLineOption passesOpt(QStringLiteral("passes"),
+                                       QStringLiteral("Passes over the query log, each from cold caches, default 3."),
+                                       QStringLiteral("n"), QStringLiteral("3"));
+    const QCommandLineOption onlyOpt(
+        QStringLiteral("only"),
+        QStringLiteral("Comma-separated stages to time: parseHelperStdout, buildFoldedPool, buildNameTable, "
+                       "buildTrigramIndex, buildSortOrders, buildExtensionIndex, buildNameSignatures, "
+                       "deviceCandidatesForQuery, refine, search, saveSnapshot, loadSnapshotFile."),
+        QStringLiteral("stages"));
+    const QCommandLineOption outputOpt(QStringLiteral("output"),
+                                       QStringLiteral("Write the JSON report to this file instead of stdout."),
+                                       QStringLiteral("path"));
+    parser.addOptions({entriesOpt, seedOpt, snapshotOpt, queriesOpt, passesOpt, onlyOpt, outputOpt});
+    parser.process(app);
+
+    // Snapshots are written below a throwaway directory
+    QTemporaryDir indexDir;
+    if (!indexDir.isValid()) {
+        qCritical() << "Failed to create a temporary index directory";
+        return 1;
+    }
+
+    IndexerBench::Options options;
+    options.indexRoot = indexDir.path();
+    if (parser.isSet(onlyOpt)) {
+        options.only = parser.value(onlyOpt).split(QLatin1Char(','), Qt::SkipEmptyParts);
+    }
+    options.searchPasses = std::max(1, parser.value(passesOpt).toInt());
+
+    std::vector<std::string> loggedQueries;
+    if (parser.isSet(queriesOpt) && !readQueryLog(parser.value(queriesOpt), loggedQueries)) {
+        qCritical().noquote() << "Failed to read query log" << parser.value(queriesOpt);
+        return 1;
+    }
+
+    const quint64 seed = parser.value(seedOpt).toULongLong();
+
+    QJsonArray datasets;
+    IndexerBench bench(options);
+
+    auto runOne = [&](ScannerEngine::SearchDatabase db, const QString& label) {
+        std::vector<std::string> queries =
+            loggedQueries.empty() ? SyntheticVolume::sampleQueries(db, seed, 32) : loggedQueries;
+        datasets.append(bench.run(std::move(db), label, queries));
+    };
+
+    if (parser.isSet(snapshotOpt)) {
+        const QString path = parser.value(snapshotOpt);
+        ScannerEngine::SearchDatabase db;
+        QString err;
+        if (!bench.loadDataset(path, db, &err)) {
+            qCritical().noquote() << "Failed to load snapshot:" << err;
+            return 1;
+        }
+        runOne(std::move(db), path);
+    } else {
+        for (const QString& s : parser.value(entriesOpt).split(QLatin1Char(','), Qt::SkipEmptyParts)) {
+            const quint64 n = parseCount(s);
+            if (n == 0 || n > 0xFFFFFFF0ULL) {
+                qCritical().noquote() << "Invalid entry count:" << s;
+                return 1;
+            }
+
+            qInfo().noquote() << QStringLiteral("[bench] generating %1 entries (seed %2)").arg(n).arg(seed);
+            SyntheticVolume::Params params;
+            params.entries = n;
+            params.seed = seed;
+
+            const auto start = std::chrono::steady_clock::now();
+            ScannerEngine::SearchDatabase db = SyntheticVolume::generate(params);
+            qInfo().noquote() << QStringLiteral("[bench] generated in %1 s")
+                                     .arg(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(),
+                                          0, 'f', 2);
+
+            runOne(std::move(db), QStringLiteral("synthetic:%1:seed%2").arg(n).arg(seed));
+        }
+    }
+
+    rusage ru{};
+    getrusage(RUSAGE_SELF, &ru);
+
+    QJsonObject report;
+    report.insert(QStringLiteral("tool"), QStringLiteral("kerything-bench"));
+    report.insert(QStringLiteral("version"),
+                  QString::fromLatin1(Version::VERSION.data(), static_cast<qsizetype>(Version::VERSION.size())));
+    report.insert(QStringLiteral("hardwareThreads"), static_cast<int>(std::thread::hardware_concurrency()));
+    report.insert(QStringLiteral("matchKernel"), QString::fromLatin1(NameMatch::kernelName()));
+    report.insert(QStringLiteral("datasets"), datasets);
+    report.insert(QStringLiteral("peakRssBytes"), static_cast<double>(ru.ru_maxrss) * 1024.0);
+
+    const QByteArray json = QJsonDocument(report).toJson(QJsonDocument::Indented);
+    if (parser.isSet(outputOpt)) {
+        QFile f(parser.value(outputOpt));
+        if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate) || f.write(json) != json.size()) {
+            qCritical().noquote() << "Failed to write" << parser.value(outputOpt);
+            return 1;
+        }
+    } else {
+        QTextStream(stdout) << json;
+    }
+    return 0;
+}
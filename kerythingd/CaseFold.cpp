@@ -0,0 +1,139 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026  Reikooters <https://github.com/Reikooters>
+
+#include "CaseFold.h"
+#include "NameMatcher.h"
+
+#include "../lib/utf8.h"
+
+// Upper case at even code points, lower case at the following odd one
+static bool isEvenUpperPair(uint32_t c, uint32_t first, uint32_t last) {
+    return c >= first && c <= last && (c & 1) == 0;
+}
+
+// Upper case at odd code points, lower case at the following even one
+static bool isOddUpperPair(uint32_t c, uint32_t first, uint32_t last) {
+    return c >= first && c <= last && (c & 1) == 1;
+}
+
+uint32_t CaseFold::simpleFold(uint32_t c) {
+    if (c < 0x80) {
+        return (c >= 'A' && c <= 'Z') ? c + 0x20 : c;
+    }
+
+    // Latin-1 Supplement
+    if (c < 0x100) {
+        if (c >= 0xC0 && c <= 0xDE && c != 0xD7) return c + 0x20;
+        if (c == 0xB5) return 0x3BC; // MICRO SIGN -> GREEK SMALL LETTER MU
+        return c;
+    }
+
+    // Latin Extended-A
+    if (c < 0x180) {
+        if (c == 0x130 || c == 0x131 || c == 0x138 || c == 0x149) return c; // no simple fold
+        if (c == 0x178) return 0xFF;
+        if (c == 0x17F) return 's';
+        if (isOddUpperPair(c, 0x139, 0x148) || isOddUpperPair(c, 0x179, 0x17E)) return c + 1;
+        if (c >= 0x139 && c <= 0x148) return c;
+        if (c >= 0x179) return c;
+        return (c & 1) == 0 ? c + 1 : c;
+    }
+
+    // Latin Extended-B (regular runs only)
+    if (c < 0x250) {
+        if (isOddUpperPair(c, 0x1CD, 0x1DC)) return c + 1;
+        if (isEvenUpperPair(c, 0x1DE, 0x1EF) || isEvenUpperPair(c, 0x1F8, 0x21F) ||
+            isEvenUpperPair(c, 0x222, 0x233) || isEvenUpperPair(c, 0x246, 0x24F)) {
+            return c + 1;
+        }
+        return c;
+    }
+
+    // Greek
+    if (c >= 0x370 && c < 0x400) {
+        if (c == 0x386) return 0x3AC;
+        if (c >= 0x388 && c <= 0x38A) return c + 0x25;
+        if (c == 0x38C) return 0x3CC;
+        if (c == 0x38E || c == 0x38F) return c + 0x3F;
+        if ((c >= 0x391 && c <= 0x3A1) || (c >= 0x3A3 && c <= 0x3AB)) return c + 0x20;
+        if (c == 0x3C2) return 0x3C3; // final sigma
+        if (isEvenUpperPair(c, 0x3D8, 0x3EF)) return c + 1;
+        return c;
+    }
+
+    // Cyrillic (+ Supplement)
+    if (c >= 0x400 && c < 0x530) {
+        if (c <= 0x40F) return c + 0x50;
+        if (c <= 0x42F) return c + 0x20;
+        if (isEvenUpperPair(c, 0x460, 0x481) || isEvenUpperPair(c, 0x48A, 0x4BF) || isEvenUpperPair(c, 0x4D0, 0x52F)) {
+            return c + 1;
+        }
+        if (c == 0x4C0) return 0x4CF;
+        if (isOddUpperPair(c, 0x4C1, 0x4CE)) return c + 1;
+        return c;
+    }
+
+    // Armenian
+    if (c >= 0x531 && c <= 0x556) return c + 0x30;
+
+    // Georgian
+    if ((c >= 0x10A0 && c <= 0x10C5) || c == 0x10C7 || c == 0x10CD) return c + 0x1C60;
+
+    // Latin Extended Additional
+    if (c >= 0x1E00 && c < 0x1F00) {
+        if (isEvenUpperPair(c, 0x1E00, 0x1E95) || isEvenUpperPair(c, 0x1EA0, 0x1EFF)) return c + 1;
+        if (c == 0x1E9E) return 0xDF; // CAPITAL SHARP S
+        return c;
+    }
+
+    // Roman numerals, circled Latin letters
+    if (c >= 0x2160 && c <= 0x216F) return c + 0x10;
+    if (c >= 0x24B6 && c <= 0x24CF) return c + 0x1A;
+
+    // Fullwidth Latin
+    if (c >= 0xFF21 && c <= 0xFF3A) return c + 0x20;
+
+    // Deseret
+    if (c >= 0x10400 && c <= 0x10427) return c + 0x28;
+
+    return c;
+}
+
+static size_t utf8Length(uint32_t cp) {
+    if (cp < 0x80) return 1;
+    if (cp < 0x800) return 2;
+    if (cp < 0x10000) return 3;
+    return 4;
+}
+
+void CaseFold::foldUtf8(const char* src, size_t n, char* dst) {
+    size_t i = 0;
+    while (i < n) {
+        // ASCII runs are the common case; fold them with the vectorized kernel
+        size_t j = i;
+        while (j < n && static_cast<unsigned char>(src[j]) < 0x80) ++j;
+        if (j > i) {
+            NameMatch::foldAscii(src + i, j - i, dst + i);
+            i = j;
+            continue;
+        }
+
+        const char* it = src + i;
+        utf8::utfchar32_t cp = 0;
+        if (utf8::internal::validate_next(it, src + n, cp) != utf8::internal::UTF8_OK) {
+            dst[i] = src[i];
+            ++i;
+            continue;
+        }
+
+        const size_t len = static_cast<size_t>(it - (src + i));
+        const uint32_t folded = simpleFold(static_cast<uint32_t>(cp));
+
+        if (folded != cp && utf8Length(folded) == len) {
+            utf8::unchecked::append(static_cast<utf8::utfchar32_t>(folded), dst + i);
+        } else if (dst != src) {
+            for (size_t k = 0; k < len; ++k) dst[i + k] = src[i + k];
+        }
+        i += len;
+    }
+}
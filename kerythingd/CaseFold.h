@@ -0,0 +1,28 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026  Reikooters <https://github.com/Reikooters>
+
+#ifndef KERYTHING_KERYTHINGD_CASEFOLD_H
+#define KERYTHING_KERYTHINGD_CASEFOLD_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Length-preserving Unicode simple case folding for file names.
+ *
+ * The daemon keeps a folded copy of each string pool that shares the original's record offsets,
+ * so a code point is only folded when its folded form has the same UTF-8 length (e.g. KELVIN SIGN
+ * or LATIN SMALL LETTER LONG S are left alone). Invalid UTF-8 bytes are copied through unchanged.
+ *
+ * Covers ASCII, Latin-1, Latin Extended-A/B/Additional, Greek, Cyrillic, Armenian, Georgian,
+ * enclosed/fullwidth Latin, Roman numerals and Deseret.
+ */
+namespace CaseFold {
+    // Simple case folding of one code point (identity if there is no mapping)
+    [[nodiscard]] uint32_t simpleFold(uint32_t cp);
+
+    // Writes the folded copy of src[0, n) to dst[0, n) (dst may equal src)
+    void foldUtf8(const char* src, size_t n, char* dst);
+}
+
+#endif //KERYTHING_KERYTHINGD_CASEFOLD_H
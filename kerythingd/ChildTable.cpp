@@ -0,0 +1,108 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026  Reikooters <https://github.com/Reikooters>
+
+#include "ChildTable.h"
+
+#include <algorithm>
+#include <bit>
+#include <functional>
+
+static constexpr size_t kMinCapacity = 64;
+
+static size_t capacityFor(size_t entries) {
+    return std::bit_ceil(std::max(kMinCapacity, entries * 2));
+}
+
+void ChildTable::clear() {
+    m_slots.clear();
+    m_slots.shrink_to_fit();
+    m_size = 0;
+    m_erased = 0;
+}
+
+void ChildTable::reserve(size_t records) {
+    if (m_size != 0 || m_erased != 0) return; // only sizes an empty table (nothing to rehash)
+    m_slots.assign(capacityFor(records), kEmpty);
+}
+
+uint64_t ChildTable::hashOf(uint32_t parent, std::string_view name) {
+    const uint64_t h = std::hash<std::string_view>{}(name) ^ (static_cast<uint64_t>(parent) * 0x9E3779B97F4A7C15ULL);
+    return h ^ (h >> 31);
+}
+
+uint32_t ChildTable::find(const Tree& tree, uint32_t parent, std::string_view name) const {
+    if (m_slots.empty()) return kNone;
+
+    const size_t mask = m_slots.size() - 1;
+    for (size_t i = hashOf(parent, name) & mask;; i = (i + 1) & mask) {
+        const uint32_t id = m_slots[i];
+        if (id == kEmpty) return kNone;
+        if (id == kErased) continue;
+
+        if (tree.parents[id] == parent && nameOf(tree, id) == name) return id;
+    }
+}
+
+bool ChildTable::insert(const Tree& tree, uint32_t recIdx) {
+    // Grow (or drop tombstones) before the table is over half full
+    if ((m_size + m_erased + 1) * 2 > m_slots.size()) {
+        rehash(tree, capacityFor(m_size + 1));
+    }
+
+    const uint32_t parent = tree.parents[recIdx];
+    const std::string_view name = nameOf(tree, recIdx);
+
+    const size_t mask = m_slots.size() - 1;
+    size_t reuse = m_slots.size(); // first tombstone on the probe path
+    for (size_t i = hashOf(parent, name) & mask;; i = (i + 1) & mask) {
+        const uint32_t id = m_slots[i];
+        if (id == kEmpty) {
+            if (reuse != m_slots.size()) {
+                i = reuse;
+                --m_erased;
+            }
+            m_slots[i] = recIdx;
+            ++m_size;
+            return true;
+        }
+        if (id == kErased) {
+            if (reuse == m_slots.size()) reuse = i;
+            continue;
+        }
+        if (tree.parents[id] == parent && nameOf(tree, id) == name) return false;
+    }
+}
+
+void ChildTable::erase(const Tree& tree, uint32_t recIdx) {
+    if (m_slots.empty()) return;
+
+    const uint32_t parent = tree.parents[recIdx];
+    const std::string_view name = nameOf(tree, recIdx);
+
+    const size_t mask = m_slots.size() - 1;
+    for (size_t i = hashOf(parent, name) & mask;; i = (i + 1) & mask) {
+        const uint32_t id = m_slots[i];
+        if (id == kEmpty) return;
+        if (id == recIdx) {
+            m_slots[i] = kErased;
+            --m_size;
+            ++m_erased;
+            return;
+        }
+    }
+}
+
+void ChildTable::rehash(const Tree& tree, size_t capacity) {
+    std::vector<uint32_t> old = std::move(m_slots);
+    m_slots.assign(capacity, kEmpty);
+    m_erased = 0;
+
+    const size_t mask = capacity - 1;
+    for (const uint32_t id : old) {
+        if (id == kEmpty || id == kErased) continue;
+
+        size_t i = hashOf(tree.parents[id], nameOf(tree, id)) & mask;
+        while (m_slots[i] != kEmpty) i = (i + 1) & mask;
+        m_slots[i] = id;
+    }
+}
@@ -0,0 +1,66 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026  Reikooters <https://github.com/Reikooters>
+
+#ifndef KERYTHING_KERYTHINGD_CHILDTABLE_H
+#define KERYTHING_KERYTHINGD_CHILDTABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "DirPathResolver.h"
+
+/**
+ * (parent dirId, name) -> recordIdx for one device index, as an open-addressing table of record ids.
+ *
+ * Slots hold nothing but 32-bit record ids: a key is hashed and compared straight out of the
+ * record columns and the string pool, so the table costs 8 bytes per record (load factor <= 1/2)
+ * instead of a heap-allocated key string per file. Linear probing; erased slots become
+ * tombstones until the next rehash.
+ *
+ * The tree is passed to every call, since watch updates append records (and grow the pool)
+ * between them.
+ */
+class ChildTable {
+public:
+    static constexpr uint32_t kNone = 0xFFFFFFFFu;
+
+    using Tree = DirPathResolver::Tree;
+
+    void clear();
+
+    // Sizes the table for this many records (avoids rehashing while building)
+    void reserve(size_t records);
+
+    /**
+     * @return The record named name under parent (kRootDirId for top-level entries), or kNone.
+     */
+    [[nodiscard]] uint32_t find(const Tree& tree, uint32_t parent, std::string_view name) const;
+
+    // Adds recIdx under its own (parent, name); false if another record already has that key
+    bool insert(const Tree& tree, uint32_t recIdx);
+
+    // Removes recIdx (looked up by its own key), if present
+    void erase(const Tree& tree, uint32_t recIdx);
+
+    [[nodiscard]] size_t size() const { return m_size; }
+    [[nodiscard]] size_t byteSize() const { return m_slots.size() * sizeof(uint32_t); }
+
+private:
+    static constexpr uint32_t kEmpty = 0xFFFFFFFFu;
+    static constexpr uint32_t kErased = 0xFFFFFFFEu;
+
+    static uint64_t hashOf(uint32_t parent, std::string_view name);
+    static std::string_view nameOf(const Tree& tree, uint32_t recIdx) {
+        return {tree.stringPool + tree.nameOffsets[recIdx], tree.nameLens[recIdx]};
+    }
+
+    void rehash(const Tree& tree, size_t capacity);
+
+    std::vector<uint32_t> m_slots; // power-of-two size; kEmpty, kErased or a record id
+    size_t m_size = 0;
+    size_t m_erased = 0;
+};
+
+#endif //KERYTHING_KERYTHINGD_CHILDTABLE_H
@@ -0,0 +1,62 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026  Reikooters <https://github.com/Reikooters>
+
+#include "DirHandleCache.h"
+
+DirHandleCache::DirHandleCache(size_t capacity)
+    : m_capacity(capacity) {}
+
+void DirHandleCache::reset(uint64_t generation, const QByteArray& mountPoint) {
+    if (generation == m_generation && mountPoint == m_mountPoint) return;
+
+    clear();
+    m_generation = generation;
+    m_mountPoint = mountPoint;
+}
+
+void DirHandleCache::clear() {
+    m_lru.clear();
+    m_byKey.clear();
+}
+
+QByteArray DirHandleCache::keyOf(uint64_t fsid, const QByteArray& handle) {
+    QByteArray key;
+    key.reserve(static_cast<qsizetype>(sizeof(fsid)) + handle.size());
+    key.append(reinterpret_cast<const char*>(&fsid), sizeof(fsid));
+    key.append(handle);
+    return key;
+}
+
+std::optional<uint32_t> DirHandleCache::find(uint64_t fsid, const QByteArray& handle) {
+    const auto it = m_byKey.find(keyOf(fsid, handle));
+    if (it == m_byKey.end()) return std::nullopt;
+
+    m_lru.splice(m_lru.begin(), m_lru, it->second);
+    return it->second->dirId;
+}
+
+void DirHandleCache::insert(uint64_t fsid, const QByteArray& handle, uint32_t dirId) {
+    QByteArray key = keyOf(fsid, handle);
+
+    if (const auto it = m_byKey.find(key); it != m_byKey.end()) {
+        it->second->dirId = dirId;
+        m_lru.splice(m_lru.begin(), m_lru, it->second);
+        return;
+    }
+
+    m_lru.push_front(Entry{key, dirId});
+    m_byKey.emplace(std::move(key), m_lru.begin());
+
+    while (m_lru.size() > m_capacity) {
+        m_byKey.erase(m_lru.back().key);
+        m_lru.pop_back();
+    }
+}
+
+void DirHandleCache::erase(uint64_t fsid, const QByteArray& handle) {
+    const auto it = m_byKey.find(keyOf(fsid, handle));
+    if (it == m_byKey.end()) return;
+
+    m_lru.erase(it->second);
+    m_byKey.erase(it);
+}
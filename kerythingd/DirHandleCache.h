@@ -0,0 +1,62 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026  Reikooters <https://github.com/Reikooters>
+
+#ifndef KERYTHING_KERYTHINGD_DIRHANDLECACHE_H
+#define KERYTHING_KERYTHINGD_DIRHANDLECACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <optional>
+#include <unordered_map>
+
+#include <QByteArray>
+
+/**
+ * (fsid, file handle) -> dirId for one watched device, with a count-budgeted LRU.
+ *
+ * fanotify reports every directory-entry change as the parent's file handle plus a name. Turning
+ * that handle into a dirId takes open_by_handle_at(), a readlink of /proc/self/fd and a path
+ * lookup; events cluster in few directories (a build tree, a download folder), so remembering
+ * the answer skips all three for most of a batch.
+ *
+ * Only ids are cached, never fds: an open directory fd would keep the filesystem busy and
+ * block unmounting it. dirIds are only valid for one index generation, so the cache is dropped
+ * whenever the generation (or the mount point) moves on.
+ */
+class DirHandleCache {
+public:
+    static constexpr size_t kDefaultCapacity = 4096;
+
+    explicit DirHandleCache(size_t capacity = kDefaultCapacity);
+
+    // Drops every entry unless the cache already belongs to this generation and mount
+    void reset(uint64_t generation, const QByteArray& mountPoint);
+
+    [[nodiscard]] std::optional<uint32_t> find(uint64_t fsid, const QByteArray& handle);
+    void insert(uint64_t fsid, const QByteArray& handle, uint32_t dirId);
+
+    // Forgets a handle whose cached directory turned out to be stale
+    void erase(uint64_t fsid, const QByteArray& handle);
+
+    void clear();
+
+    [[nodiscard]] size_t size() const { return m_lru.size(); }
+
+private:
+    struct Entry {
+        QByteArray key;
+        uint32_t dirId = 0;
+    };
+
+    static QByteArray keyOf(uint64_t fsid, const QByteArray& handle);
+
+    size_t m_capacity = kDefaultCapacity;
+    uint64_t m_generation = 0;
+    QByteArray m_mountPoint;
+
+    std::list<Entry> m_lru; // most recently used first
+    std::unordered_map<QByteArray, std::list<Entry>::iterator> m_byKey;
+};
+
+#endif //KERYTHING_KERYTHINGD_DIRHANDLECACHE_H
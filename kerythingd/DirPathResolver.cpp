@@ -0,0 +1,116 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026  Reikooters <https://github.com/Reikooters>
+
+#include "DirPathResolver.h"
+
+#include <string_view>
+
+// Parent walks stop here (corrupt parent cycles)
+static constexpr size_t kMaxDepth = 4096;
+
+DirPathResolver::DirPathResolver(size_t byteBudget)
+    : m_budget(byteBudget) {}
+
+DirPathResolver::DirPathResolver(const DirPathResolver& other)
+    : m_budget(other.m_budget) {}
+
+DirPathResolver& DirPathResolver::operator=(const DirPathResolver& other) {
+    if (this != &other) {
+        clear();
+        m_budget = other.m_budget;
+    }
+    return *this;
+}
+
+void DirPathResolver::clear() {
+    m_lru.clear();
+    m_byId.clear();
+    m_bytes = 0;
+}
+
+size_t DirPathResolver::entryBytes(const QString& path) {
+    // Path characters plus list node, hash node and QString header, roughly
+    return static_cast<size_t>(path.size()) * sizeof(QChar) + sizeof(Entry) + 64;
+}
+
+const QString* DirPathResolver::find(uint32_t dirId) {
+    const auto it = m_byId.find(dirId);
+    if (it == m_byId.end()) return nullptr;
+
+    m_lru.splice(m_lru.begin(), m_lru, it->second);
+    return &it->second->path;
+}
+
+const QString& DirPathResolver::insert(uint32_t dirId, QString path) {
+    m_bytes += entryBytes(path);
+    m_lru.push_front(Entry{dirId, std::move(path)});
+    m_byId[dirId] = m_lru.begin();
+
+    // Never evict the entry just added; the caller still extends it
+    while (m_bytes > m_budget && m_lru.size() > 1) {
+        const Entry& victim = m_lru.back();
+        m_bytes -= entryBytes(victim.path);
+        m_byId.erase(victim.dirId);
+        m_lru.pop_back();
+    }
+
+    return m_lru.front().path;
+}
+
+QString DirPathResolver::resolve(const Tree& tree, uint32_t dirId) {
+    if (dirId == kRootDirId) {
+        return QStringLiteral("/");
+    }
+
+    if (const QString* hit = find(dirId)) {
+        return *hit;
+    }
+
+    if (dirId >= tree.recordCount) {
+        return QStringLiteral("…");
+    }
+
+    // Walk up to the nearest resolved ancestor (or the root)
+    m_chain.clear();
+    QString base = QStringLiteral("/");
+
+    uint32_t cur = dirId;
+    while (cur != kRootDirId && cur < tree.recordCount && m_chain.size() < kMaxDepth) {
+        if (const QString* known = find(cur)) {
+            base = *known;
+            break;
+        }
+
+        m_chain.push_back(cur);
+
+        const uint32_t next = tree.parents[cur];
+        if (next == cur) break; // self-loop safety
+        cur = next;
+    }
+
+    // Then build each missing path from its parent's
+    for (auto it = m_chain.rbegin(); it != m_chain.rend(); ++it) {
+        const std::string_view name(tree.stringPool + tree.nameOffsets[*it], tree.nameLens[*it]);
+
+        // Dot entries and empty names (root-like) don't add a component
+        QString path = base;
+        if (!(name == "." || name == ".." || name.empty())) {
+            if (path.size() > 1) path += QStringLiteral("/");
+            path += QString::fromUtf8(name.data(), static_cast<qsizetype>(name.size()));
+        }
+
+        base = insert(*it, std::move(path));
+    }
+
+    return base;
+}
+
+void DirPathResolver::resolveMany(const Tree& tree, const std::vector<uint32_t>& dirIds, std::vector<QString>& out) {
+    out.clear();
+    out.reserve(dirIds.size());
+
+    // Ancestors resolved for one id are cached for the rest of the batch
+    for (uint32_t id : dirIds) {
+        out.push_back(resolve(tree, id));
+    }
+}
@@ -0,0 +1,79 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026  Reikooters <https://github.com/Reikooters>
+
+#ifndef KERYTHING_KERYTHINGD_DIRPATHRESOLVER_H
+#define KERYTHING_KERYTHINGD_DIRPATHRESOLVER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include <QString>
+
+/**
+ * dirId -> internal directory path ("/foo/bar") for one device index, with a byte-budgeted LRU.
+ *
+ * A lookup walks up the parent chain only until it reaches a directory that is already cached,
+ * then builds the missing paths downwards from that prefix, caching each one. Siblings and
+ * children of a resolved directory therefore cost a single append, and a batch
+ * (ResolveDirectories, one result page) walks every shared ancestor at most once.
+ *
+ * Copies start out empty (a copy-on-write clone of the index can't share the LRU links).
+ * Not thread-safe; DeviceIndex only uses it on the main thread.
+ */
+class DirPathResolver {
+public:
+    static constexpr uint32_t kRootDirId = 0xFFFFFFFFu;
+    static constexpr size_t kDefaultByteBudget = 16u << 20;
+
+    // The index the paths are resolved against (its record columns)
+    struct Tree {
+        const uint32_t* parents = nullptr;
+        const uint32_t* nameOffsets = nullptr;
+        const uint16_t* nameLens = nullptr;
+        size_t recordCount = 0;
+        const char* stringPool = nullptr;
+    };
+
+    explicit DirPathResolver(size_t byteBudget = kDefaultByteBudget);
+    DirPathResolver(const DirPathResolver& other);
+    DirPathResolver& operator=(const DirPathResolver& other);
+    DirPathResolver(DirPathResolver&&) noexcept = default;
+    DirPathResolver& operator=(DirPathResolver&&) noexcept = default;
+
+    /**
+     * @return The internal path of dirId ("/" for kRootDirId), or "…" if dirId is out of range.
+     */
+    QString resolve(const Tree& tree, uint32_t dirId);
+
+    // Resolves every id in dirIds (same order) in one pass.
+    void resolveMany(const Tree& tree, const std::vector<uint32_t>& dirIds, std::vector<QString>& out);
+
+    void clear();
+
+    [[nodiscard]] size_t size() const { return m_lru.size(); }
+    [[nodiscard]] size_t byteSize() const { return m_bytes; }
+
+private:
+    struct Entry {
+        uint32_t dirId = 0;
+        QString path;
+    };
+
+    static size_t entryBytes(const QString& path);
+
+    const QString* find(uint32_t dirId);
+    const QString& insert(uint32_t dirId, QString path);
+
+    size_t m_budget = kDefaultByteBudget;
+    size_t m_bytes = 0;
+
+    std::list<Entry> m_lru; // most recently used first
+    std::unordered_map<uint32_t, std::list<Entry>::iterator> m_byId;
+
+    std::vector<uint32_t> m_chain; // scratch: unresolved ancestors of the current lookup
+};
+
+#endif //KERYTHING_KERYTHINGD_DIRPATHRESOLVER_H
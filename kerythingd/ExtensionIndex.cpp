@@ -0,0 +1,122 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026  Reikooters <https://github.com/Reikooters>
+
+#include "ExtensionIndex.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+std::string_view ExtensionIndex::extensionOf(std::string_view name) {
+    const size_t dot = name.rfind('.');
+    if (dot == std::string_view::npos) return {};
+
+    const size_t len = name.size() - dot - 1;
+    if (len == 0 || len > kMaxExtensionBytes) return {};
+    return name.substr(dot + 1);
+}
+
+ExtensionIndex ExtensionIndex::build(const RecordColumns& records, const char* foldedPool, size_t count) {
+    static constexpr uint32_t kNone = 0xFFFFFFFFu;
+
+    ExtensionIndex out;
+    out.recordCount = static_cast<uint32_t>(count);
+
+    // 1) Distinct extensions (views into the pool) and each record's extension id
+    std::unordered_map<std::string_view, uint32_t> idByName;
+    std::vector<std::string_view> distinct;
+    std::vector<uint32_t> counts;
+    std::vector<uint32_t> idOf(count, kNone);
+
+    for (size_t i = 0; i < count; ++i) {
+        const std::string_view ext = extensionOf(records.name(i, foldedPool));
+        if (ext.empty()) continue;
+
+        const auto [it, inserted] = idByName.try_emplace(ext, static_cast<uint32_t>(distinct.size()));
+        if (inserted) {
+            distinct.push_back(ext);
+            counts.push_back(0);
+        }
+        idOf[i] = it->second;
+        ++counts[it->second];
+    }
+
+    // 2) Entries in name order, with their posting ranges
+    std::vector<uint32_t> byName(distinct.size());
+    for (uint32_t d = 0; d < byName.size(); ++d) byName[d] = d;
+    std::sort(byName.begin(), byName.end(), [&](uint32_t a, uint32_t b) { return distinct[a] < distinct[b]; });
+
+    std::vector<char>& names = out.names.mut();
+    std::vector<Entry>& entries = out.entries.mut();
+    entries.reserve(distinct.size());
+
+    std::vector<uint32_t> cursor(distinct.size(), 0); // next posting slot per extension id
+    uint32_t first = 0;
+    for (const uint32_t d : byName) {
+        Entry e{};
+        e.nameOffset = static_cast<uint32_t>(names.size());
+        e.nameLen = static_cast<uint16_t>(distinct[d].size());
+        e.first = first;
+        e.count = counts[d];
+        entries.push_back(e);
+
+        names.insert(names.end(), distinct[d].begin(), distinct[d].end());
+        cursor[d] = first;
+        first += counts[d];
+    }
+
+    // 3) Postings; records are visited in order, so every list comes out ascending
+    std::vector<uint32_t>& postings = out.postings.mut();
+    postings.resize(first);
+    for (size_t i = 0; i < count; ++i) {
+        if (idOf[i] != kNone) postings[cursor[idOf[i]]++] = static_cast<uint32_t>(i);
+    }
+
+    return out;
+}
+
+const ExtensionIndex::Entry* ExtensionIndex::find(std::string_view folded) const {
+    const Entry* first = entries.data();
+    const Entry* last = first + entries.size();
+
+    auto nameOf = [&](const Entry& e) { return std::string_view(names.data() + e.nameOffset, e.nameLen); };
+
+    const Entry* it = std::lower_bound(first, last, folded, [&](const Entry& e, std::string_view v) {
+        return nameOf(e) < v;
+    });
+    return (it != last && nameOf(*it) == folded) ? it : nullptr;
+}
+
+bool ExtensionIndex::validate(size_t expectedRecordCount) const {
+    if (entries.empty()) {
+        return names.empty() && postings.empty();
+    }
+
+    uint64_t next = 0;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const Entry& e = entries[i];
+
+        if (e.nameLen == 0 || e.nameLen > kMaxExtensionBytes || e.count == 0) return false;
+        if (static_cast<uint64_t>(e.nameOffset) + e.nameLen > names.size()) return false;
+        if (e.first != next) return false;
+        next += e.count;
+
+        if (i > 0) {
+            const Entry& p = entries[i - 1];
+            if (std::string_view(names.data() + p.nameOffset, p.nameLen) >=
+                std::string_view(names.data() + e.nameOffset, e.nameLen)) {
+                return false;
+            }
+        }
+    }
+    if (next != postings.size()) return false;
+
+    // Lists are ascending, so checking their last element bounds them all
+    for (const Entry& e : entries) {
+        if (postings[e.first + e.count - 1] >= expectedRecordCount) return false;
+    }
+    return true;
+}
+
+size_t ExtensionIndex::byteSize() const {
+    return names.size() + entries.size() * sizeof(Entry) + postings.size() * sizeof(uint32_t);
+}
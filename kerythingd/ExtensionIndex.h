@@ -0,0 +1,91 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026  Reikooters <https://github.com/Reikooters>
+
+#ifndef KERYTHING_KERYTHINGD_EXTENSIONINDEX_H
+#define KERYTHING_KERYTHINGD_EXTENSIONINDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "MappedArray.h"
+#include "RecordColumns.h"
+
+/**
+ * Folded file extension -> recordIdx posting lists, for "ext:pdf" and "*.mkv" queries.
+ *
+ * Extensions are made of very common trigrams ("mkv" is in every video name, ".pd" in half the
+ * documents), so the trigram path ends up refining a large share of the index. Here an extension
+ * query is a single binary search plus a slice of postings.
+ *
+ * Layout (all three arrays are persisted as snapshot sections and can be mmap'd as-is):
+ *  - names:    the distinct folded extensions, concatenated in entry order.
+ *  - entries:  one Entry per distinct extension, sorted by name.
+ *  - postings: each entry's records, ascending, back to back.
+ *
+ * Only records below recordCount are covered; later (watch delta) records are checked by the caller.
+ */
+class ExtensionIndex {
+public:
+    // Longer suffixes are not treated as extensions (and aren't indexed)
+    static constexpr size_t kMaxExtensionBytes = 16;
+
+    struct Entry {
+        uint32_t nameOffset; // into names
+        uint16_t nameLen;
+        uint16_t reserved;
+        uint32_t first;      // into postings
+        uint32_t count;
+    };
+
+    static_assert(sizeof(Entry) == 16, "Entry must be 16 bytes for snapshot IO.");
+
+    MappedArray<char> names;
+    MappedArray<Entry> entries;
+    MappedArray<uint32_t> postings;
+
+    // Records covered by this index
+    uint32_t recordCount = 0;
+
+    [[nodiscard]] bool empty() const { return entries.empty(); }
+
+    /**
+     * The extension of a file name: what follows its last '.', if that is 1..kMaxExtensionBytes bytes.
+     * A leading dot counts (".bashrc" has extension "bashrc").
+     *
+     * @return A view into name, or an empty view if there is no extension.
+     */
+    [[nodiscard]] static std::string_view extensionOf(std::string_view name);
+
+    /**
+     * Builds the index over records [0, count).
+     *
+     * @param foldedPool The device's CaseFold'ed string pool (DeviceIndex::foldedPool).
+     */
+    static ExtensionIndex build(const RecordColumns& records, const char* foldedPool, size_t count);
+
+    /**
+     * @param folded A folded extension (without the dot).
+     * @return Its entry, or nullptr if no covered record has that extension.
+     */
+    [[nodiscard]] const Entry* find(std::string_view folded) const;
+
+    [[nodiscard]] std::span<const uint32_t> postingsOf(const Entry& entry) const {
+        return {postings.data() + entry.first, entry.count};
+    }
+
+    /**
+     * Structural checks for a freshly loaded (possibly mmap'd) index.
+     *
+     * @return true if all offsets are in-bounds, the entries are sorted and the postings cover
+     *         exactly the postings array.
+     */
+    [[nodiscard]] bool validate(size_t expectedRecordCount) const;
+
+    // Total bytes of the three arrays (owned or mapped)
+    [[nodiscard]] size_t byteSize() const;
+};
+
+#endif //KERYTHING_KERYTHINGD_EXTENSIONINDEX_H
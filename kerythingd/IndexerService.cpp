@@ -3,15 +3,22 @@
 
 #include "IndexerService.h"
 #include "WatchManager.h"
+#include "NameMatcher.h"
+#include "CaseFold.h"
+#include "NameSignature.h"
+#include "../SearchProtocol.h"
 
 #include <algorithm>
+#include <bit>
 #include <cctype>
+#include <chrono>
 #include <execution>
 #include <filesystem>
 #include <fstream>
 #include <optional>
 #include <queue>
 #include <sstream>
+#include <type_traits>
 #include <unordered_map>
 #include <vector>
 
@@ -30,15 +37,21 @@
 #include <QDateTime>
 #include <QTimer>
 #include <QDebug>
+#include <QThreadPool>
+#include <QRandomGenerator>
 
 #include <QtDBus/QDBusConnection>
 #include <QtDBus/QDBusConnectionInterface>
 #include <QtDBus/QDBusError>
+#include <QtDBus/QDBusMessage>
+#include <QtDBus/QDBusServiceWatcher>
 
 #include <cstdlib>
 #include <cerrno>
 #include <cstring>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <dirent.h>
 #include <fcntl.h>
 #include <unistd.h>
 
@@ -47,9 +60,70 @@
 static constexpr quint32 kFlagIsDir = 1u << 0;
 static constexpr quint32 kFlagIsSymlink = 1u << 1;
 
-static constexpr quint32 kSnapshotVersion = 5;
+static constexpr quint32 kSnapshotVersion = 16; // v16: name signatures by name id
 static constexpr quint64 kSnapshotMagic   = 0x4B4552595448494EULL; // "KERYTHIN" (8 bytes)
 
+// v6+: fixed header, metadata block, section table, then page-aligned sections (mmap'd on load)
+static constexpr quint32 kSnapshotPageSize = 4096;
+
+enum class SnapshotSection : quint32 {
+    Records = 1, // v6-v10; transposed into RecordColumns on load
+    StringPool = 2,
+    FlatIndex = 3, // v6 only; converted to TrigramIndex on load
+    OrderByName = 4,
+    OrderByPath = 5,
+    OrderBySize = 6,
+    OrderByMtime = 7,
+    RankByName = 8,
+    RankByPath = 9,
+    RankBySize = 10,
+    RankByMtime = 11,
+    TrigramBuckets = 12,   // v7+
+    TrigramDirectory = 13, // v7+
+    TrigramSkips = 14,     // v7+
+    TrigramData = 15,      // v7+
+    FoldedPool = 16,       // v8+
+    FileIds = 17,          // v10+ (optional)
+    RecordParents = 18,    // v11+
+    RecordSizes = 19,      // v11+
+    RecordMtimes = 20,     // v11+
+    RecordNameOffsets = 21, // v11+
+    RecordNameLens = 22,   // v11+
+    RecordFlags = 23,      // v11+
+    ExtensionNames = 24,   // v12+ (optional)
+    ExtensionEntries = 25, // v12+ (optional)
+    ExtensionPostings = 26, // v12+ (optional)
+    NameSignatures = 27,   // v13+ (optional)
+    NameOffsets = 28,      // v14+
+    NameLens = 29,         // v14+
+    NameRecordFirst = 30,  // v14+
+    NameRecordIds = 31,    // v14+
+};
+
+#pragma pack(push, 1)
+
+struct SnapshotFileHeader {
+    quint64 magic;          // kSnapshotMagic (same prefix as v1-v5)
+    quint32 version;        // kSnapshotVersion
+    quint32 metaBytes;      // size of the metadata block that follows
+    quint32 sectionCount;   // number of SnapshotSectionEntry after the metadata block
+    quint32 reserved;
+    quint64 headerChecksum; // snapshotChecksum(metadata block + section table)
+};
+
+struct SnapshotSectionEntry {
+    quint32 id;       // SnapshotSection
+    quint32 elemSize; // sizeof(element), checked against the in-memory type
+    quint64 offset;   // from start of file, multiple of kSnapshotPageSize
+    quint64 count;    // number of elements
+    quint64 checksum; // snapshotChecksum(section bytes)
+};
+
+#pragma pack(pop)
+
+static_assert(sizeof(SnapshotFileHeader) == 32);
+static_assert(sizeof(SnapshotSectionEntry) == 32);
+
 static QString lower(QString s) {
     for (QChar& c : s) c = c.toLower();
     return s;
@@ -173,27 +247,51 @@ static std::vector<MountInfoEntry> readMountInfo() {
     return out;
 }
 
-QStringList IndexerService::tokenizeQuery(const QString& query) {
+QStringList IndexerService::tokenizeQuery(const QString& query, QList<QByteArray>* extensionsOut) {
     QString q = query;
     q = q.trimmed();
 
     // Split on whitespace, drop empties
     const QStringList parts = q.split(QRegularExpression(QStringLiteral("\\s+")),
                                       Qt::SkipEmptyParts);
-    return parts;
-}
+    if (!extensionsOut) return parts;
+
+    QStringList tokens;
+    for (const QString& part : parts) {
+        QString ext;
+        if (part.startsWith(QStringLiteral("ext:"), Qt::CaseInsensitive)) {
+            ext = part.mid(4);
+        } else if (part.startsWith(QStringLiteral("*."))) {
+            ext = part.mid(2);
+        }
 
-void IndexerService::buildTrigramIndex(DeviceIndex& idx) {
-    idx.flatIndex.clear();
-    idx.flatIndex.reserve(idx.records.size() * 4); // rough heuristic
+        // Anything that can't be an extension (wildcards, dots, too long) stays a name token
+        QByteArray extBytes = ext.toUtf8();
+        if (ext.isEmpty() || ext.contains(QStringLiteral(".")) || ext.contains(QStringLiteral("*")) ||
+            static_cast<size_t>(extBytes.size()) > ExtensionIndex::kMaxExtensionBytes) {
+            tokens.push_back(part);
+            continue;
+        }
+
+        CaseFold::foldUtf8(extBytes.constData(), static_cast<size_t>(extBytes.size()), extBytes.data());
+        if (!extensionsOut->contains(extBytes)) extensionsOut->push_back(extBytes);
+    }
+    return tokens;
+}
 
+void IndexerService::appendTrigramsForNames(const uint32_t* nameOffsets,
+                                            const uint16_t* nameLens,
+                                            const char* foldedPool,
+                                            size_t begin,
+                                            size_t end,
+                                            std::vector<ScannerEngine::TrigramEntry>& out) {
     std::vector<quint32> tris;
     tris.reserve(64);
 
-    for (quint32 recordIdx = 0; recordIdx < idx.records.size(); ++recordIdx) {
-        const auto& r = idx.records[recordIdx];
-        const char* base = idx.stringPool.data() + r.nameOffset;
-        const size_t len = static_cast<size_t>(r.nameLen);
+    for (size_t i = begin; i < end; ++i) {
+        const quint32 id = static_cast<quint32>(i);
+        const char* base = foldedPool + nameOffsets[i];
+        const size_t len = static_cast<size_t>(nameLens[i]);
 
         if (len < 3) {
             continue;
@@ -202,15 +300,11 @@ void IndexerService::buildTrigramIndex(DeviceIndex& idx) {
         tris.clear();
         tris.reserve(len - 2);
 
-        auto lower = [](unsigned char c) -> unsigned char {
-            return static_cast<unsigned char>(std::tolower(c));
-        };
-
-        for (size_t i = 0; i + 2 < len; ++i) {
+        for (size_t k = 0; k + 2 < len; ++k) {
             const quint32 tri =
-                (static_cast<quint32>(lower(static_cast<unsigned char>(base[i]))) << 16) |
-                (static_cast<quint32>(lower(static_cast<unsigned char>(base[i + 1]))) << 8) |
-                (static_cast<quint32>(lower(static_cast<unsigned char>(base[i + 2]))));
+                (static_cast<quint32>(static_cast<unsigned char>(base[k])) << 16) |
+                (static_cast<quint32>(static_cast<unsigned char>(base[k + 1])) << 8) |
+                (static_cast<quint32>(static_cast<unsigned char>(base[k + 2])));
             tris.push_back(tri);
         }
 
@@ -218,54 +312,260 @@ void IndexerService::buildTrigramIndex(DeviceIndex& idx) {
         tris.erase(std::unique(tris.begin(), tris.end()), tris.end());
 
         for (quint32 tri : tris) {
-            idx.flatIndex.push_back(ScannerEngine::TrigramEntry{tri, recordIdx});
+            out.push_back(ScannerEngine::TrigramEntry{tri, id});
+        }
+    }
+}
+
+namespace {
+    struct TrigramSpan {
+        const ScannerEngine::TrigramEntry* data = nullptr;
+        size_t size = 0;
+    };
+}
+
+// Splits [data, data + n) into roughly equal spans for parallel radix passes.
+static std::vector<TrigramSpan> splitTrigramSpans(const ScannerEngine::TrigramEntry* data, size_t n) {
+    static constexpr size_t kMinSpan = 256 * 1024;
+    static constexpr size_t kMaxSpans = 256;
+
+    const size_t spans = std::clamp<size_t>(n / kMinSpan, 1, kMaxSpans);
+    const size_t per = (n + spans - 1) / spans;
+
+    std::vector<TrigramSpan> out;
+    out.reserve(spans);
+    for (size_t begin = 0; begin < n; begin += per) {
+        out.push_back(TrigramSpan{data + begin, std::min(per, n - begin)});
+    }
+    return out;
+}
+
+/**
+ * One stable counting-sort pass over 12 bits of the trigram, from ordered source spans into dst.
+ *
+ * Each span gets its own histogram, and span p's slice of every bucket is placed after spans 0..p-1,
+ * so equal keys keep their source order. dst must have room for the sum of all span sizes.
+ */
+static void radixScatterTrigrams(const std::vector<TrigramSpan>& src, ScannerEngine::TrigramEntry* dst, int shift) {
+    static constexpr size_t kRadixBuckets = 1u << 12;
+
+    const size_t parts = src.size();
+    std::vector<size_t> offsets(parts * kRadixBuckets, 0);
+
+    tbb::parallel_for(size_t(0), parts, [&](size_t p) {
+        size_t* hist = offsets.data() + p * kRadixBuckets;
+        const auto* e = src[p].data;
+        for (size_t i = 0; i < src[p].size; ++i) {
+            ++hist[(e[i].trigram >> shift) & (kRadixBuckets - 1)];
+        }
+    });
+
+    // Exclusive prefix sum in (bucket, span) order
+    size_t running = 0;
+    for (size_t bucket = 0; bucket < kRadixBuckets; ++bucket) {
+        for (size_t p = 0; p < parts; ++p) {
+            size_t& slot = offsets[p * kRadixBuckets + bucket];
+            const size_t count = slot;
+            slot = running;
+            running += count;
         }
     }
 
-    std::sort(idx.flatIndex.begin(), idx.flatIndex.end(),
-              [](const auto& a, const auto& b) {
-                  if (a.trigram != b.trigram) return a.trigram < b.trigram;
-                  return a.recordIdx < b.recordIdx;
-              });
+    tbb::parallel_for(size_t(0), parts, [&](size_t p) {
+        size_t* off = offsets.data() + p * kRadixBuckets;
+        const auto* e = src[p].data;
+        for (size_t i = 0; i < src[p].size; ++i) {
+            dst[off[(e[i].trigram >> shift) & (kRadixBuckets - 1)]++] = e[i];
+        }
+    });
+}
+
+void IndexerService::sortTrigramIndex(std::vector<ScannerEngine::TrigramEntry>& flatIndex) {
+    auto comp = [](const auto& a, const auto& b) {
+        if (a.trigram != b.trigram) return a.trigram < b.trigram;
+        return a.recordIdx < b.recordIdx;
+    };
+
+    // Parallel sort has overhead; only worth it for large N
+    if (flatIndex.size() < 200'000) {
+        std::sort(flatIndex.begin(), flatIndex.end(), comp);
+        return;
+    }
+
+    // Trigrams are generated record by record, so the input is normally already ordered by
+    // recordIdx. Then two stable 12-bit radix passes on the trigram give (trigram, recordIdx) order.
+    const bool byRecord = std::is_sorted(std::execution::par, flatIndex.begin(), flatIndex.end(),
+                                         [](const auto& a, const auto& b) { return a.recordIdx < b.recordIdx; });
+    if (!byRecord) {
+        std::sort(std::execution::par, flatIndex.begin(), flatIndex.end(), comp);
+        return;
+    }
+
+    const size_t n = flatIndex.size();
+    std::unique_ptr<ScannerEngine::TrigramEntry[]> tmp(new ScannerEngine::TrigramEntry[n]);
+
+    radixScatterTrigrams(splitTrigramSpans(flatIndex.data(), n), tmp.get(), 0);
+    radixScatterTrigrams(splitTrigramSpans(tmp.get(), n), flatIndex.data(), 12);
+}
+
+void IndexerService::buildFoldedPool(DeviceIndex& idx) {
+    static constexpr size_t kChunkBytes = 4 * 1024 * 1024;
+
+    const size_t n = idx.stringPool.size();
+    const char* src = idx.stringPool.data();
+    std::vector<char> folded(n);
+
+    // Chunk boundaries moved forward to the next UTF-8 lead byte, so no sequence is split
+    std::vector<size_t> bounds{0};
+    for (size_t pos = kChunkBytes; pos < n; pos += kChunkBytes) {
+        size_t b = std::max(pos, bounds.back());
+        while (b < n && (static_cast<unsigned char>(src[b]) & 0xC0) == 0x80) ++b;
+        if (b < n && b > bounds.back()) bounds.push_back(b);
+    }
+    bounds.push_back(n);
+
+    tbb::parallel_for(size_t(0), bounds.size() - 1, [&](size_t c) {
+        CaseFold::foldUtf8(src + bounds[c], bounds[c + 1] - bounds[c], folded.data() + bounds[c]);
+    });
+
+    idx.foldedPool = std::move(folded);
+}
+
+void IndexerService::buildNameTable(DeviceIndex& idx) {
+    if (idx.foldedPool.size() != idx.stringPool.size()) {
+        buildFoldedPool(idx);
+    }
+
+    idx.names = NameTable::build(idx.records, idx.stringPool.mut(), idx.foldedPool.mut());
+}
+
+void IndexerService::buildTrigramIndex(DeviceIndex& idx) {
+    static constexpr size_t kChunkNames = 64 * 1024;
+
+    // Postings are name ids
+    if (idx.names.recordCount != idx.records.size()) {
+        buildNameTable(idx);
+    }
+
+    const size_t n = idx.names.nameCount();
+    const size_t chunks = (n + kChunkNames - 1) / kChunkNames;
+
+    // 1) Generate per-name deduped trigrams into one buffer per chunk (chunks are in name id order)
+    std::vector<std::vector<ScannerEngine::TrigramEntry>> local(chunks);
+
+    tbb::parallel_for(size_t(0), chunks, [&](size_t c) {
+        const size_t begin = c * kChunkNames;
+        const size_t end = std::min(n, begin + kChunkNames);
+        appendTrigramsForNames(idx.names.nameOffsets.data(), idx.names.nameLens.data(), idx.foldedPool.data(),
+                               begin, end, local[c]);
+    });
+
+    // 2) Exact output size from the chunk sizes
+    std::vector<TrigramSpan> spans;
+    spans.reserve(chunks);
+    size_t total = 0;
+    for (const auto& v : local) {
+        if (v.empty()) continue;
+        spans.push_back(TrigramSpan{v.data(), v.size()});
+        total += v.size();
+    }
+
+    // 3) Radix sort on the 24-bit trigram: low 12 bits straight out of the chunk buffers, then high 12 bits
+    std::unique_ptr<ScannerEngine::TrigramEntry[]> tmp(new ScannerEngine::TrigramEntry[total]);
+    radixScatterTrigrams(spans, tmp.get(), 0);
+    local = {};
+
+    std::unique_ptr<ScannerEngine::TrigramEntry[]> sorted(new ScannerEngine::TrigramEntry[total]);
+    radixScatterTrigrams(splitTrigramSpans(tmp.get(), total), sorted.get(), 12);
+    tmp.reset();
+
+    idx.trigrams = TrigramIndex::build(sorted.get(), total, n);
+}
+
+void IndexerService::buildExtensionIndex(DeviceIndex& idx) {
+    if (idx.foldedPool.size() != idx.stringPool.size()) {
+        buildFoldedPool(idx);
+    }
+
+    // Same coverage as the trigram index; later records are the watch delta
+    idx.extensions = ExtensionIndex::build(idx.records, idx.foldedPool.data(), idx.deltaBegin());
+}
+
+void IndexerService::buildNameSignatures(DeviceIndex& idx) {
+    if (idx.foldedPool.size() != idx.stringPool.size()) {
+        buildFoldedPool(idx);
+    }
+
+    // One per distinct name (offsets into the folded pool are the string pool's)
+    const size_t n = idx.names.nameCount();
+    idx.nameSignatures.clear();
+    std::vector<quint64>& sigs = idx.nameSignatures.mut();
+    sigs.resize(n);
+
+    const uint32_t* nameOffsets = idx.names.nameOffsets.data();
+    const uint16_t* nameLens = idx.names.nameLens.data();
+    const char* folded = idx.foldedPool.data();
+
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, n, 64 * 1024), [&](const tbb::blocked_range<size_t>& r) {
+        for (size_t i = r.begin(); i != r.end(); ++i) {
+            sigs[i] = NameSignature::of(folded + nameOffsets[i], nameLens[i]);
+        }
+    });
 }
 
 /**
- * Compares two sequences of bytes case-insensitively.
+ * Compares two names case-insensitively.
+ *
+ * Both views must come from DeviceIndex::foldedPool, so this is a plain byte comparison.
  *
- * @param a The first sequence of bytes represented as a std::string_view.
- * @param b The second sequence of bytes represented as a std::string_view.
+ * @param a The first (case-folded) name.
+ * @param b The second (case-folded) name.
  * @return Returns -1 if the first sequence is lexicographically less than the second,
  *         1 if the first sequence is greater than the second, or 0 if they are equal.
  */
 static int ciCompareBytes(std::string_view a, std::string_view b) {
     const size_t n = std::min(a.size(), b.size());
-    for (size_t i = 0; i < n; ++i) {
-        const unsigned char ac = static_cast<unsigned char>(std::tolower(static_cast<unsigned char>(a[i])));
-        const unsigned char bc = static_cast<unsigned char>(std::tolower(static_cast<unsigned char>(b[i])));
-        if (ac < bc) return -1;
-        if (ac > bc) return 1;
+    if (n > 0) {
+        const int c = std::memcmp(a.data(), b.data(), n);
+        if (c != 0) return c < 0 ? -1 : 1;
     }
     if (a.size() < b.size()) return -1;
     if (a.size() > b.size()) return 1;
     return 0;
 }
 
+// Search stage timings (SearchTrace)
+static quint64 nsBetween(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to) {
+    return static_cast<quint64>(std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count());
+}
+
+static quint64 nsSince(std::chrono::steady_clock::time_point from) {
+    return nsBetween(from, std::chrono::steady_clock::now());
+}
+
 void IndexerService::buildSortOrders(DeviceIndex& idx) {
     const quint32 n = static_cast<quint32>(idx.records.size());
 
-    auto initOrder = [&](std::vector<quint32>& v) {
+    if (idx.foldedPool.size() != idx.stringPool.size()) {
+        buildFoldedPool(idx);
+    }
+
+    // Rebuilt from scratch, so drop any mapped view instead of copying it first
+    auto initOrder = [&](MappedArray<quint32>& arr) -> std::vector<quint32>& {
+        arr.clear();
+        std::vector<quint32>& v = arr.mut();
         v.resize(n);
         for (quint32 i = 0; i < n; ++i) v[i] = i;
+        return v;
     };
 
-    initOrder(idx.orderByName);
-    initOrder(idx.orderByPath);
-    initOrder(idx.orderBySize);
-    initOrder(idx.orderByMtime);
+    std::vector<quint32>& orderByName = initOrder(idx.orderByName);
+    std::vector<quint32>& orderBySize = initOrder(idx.orderBySize);
+    std::vector<quint32>& orderByMtime = initOrder(idx.orderByMtime);
 
+    const RecordColumns& records = idx.records;
     auto nameView = [&](quint32 i) -> std::string_view {
-        const auto& r = idx.records[i];
-        return std::string_view(idx.stringPool.data() + r.nameOffset, r.nameLen);
+        return records.name(i, idx.foldedPool.data());
     };
 
     auto sortMaybePar = [&](auto& vec, auto&& comp) {
@@ -277,313 +577,1365 @@ void IndexerService::buildSortOrders(DeviceIndex& idx) {
         }
     };
 
-    sortMaybePar(idx.orderByName, [&](quint32 a, quint32 b) {
+    sortMaybePar(orderByName, [&](quint32 a, quint32 b) {
         const int c = ciCompareBytes(nameView(a), nameView(b));
         if (c != 0) return c < 0;
         return a < b;
     });
 
-    sortMaybePar(idx.orderBySize, [&](quint32 a, quint32 b) {
-        const auto sa = idx.records[a].size;
-        const auto sb = idx.records[b].size;
+    sortMaybePar(orderBySize, [&](quint32 a, quint32 b) {
+        const auto sa = records.sizes[a];
+        const auto sb = records.sizes[b];
         if (sa != sb) return sa < sb;
         const int c = ciCompareBytes(nameView(a), nameView(b));
         if (c != 0) return c < 0;
         return a < b;
     });
 
-    sortMaybePar(idx.orderByMtime, [&](quint32 a, quint32 b) {
-        const auto ta = idx.records[a].modificationTime;
-        const auto tb = idx.records[b].modificationTime;
+    sortMaybePar(orderByMtime, [&](quint32 a, quint32 b) {
+        const auto ta = records.mtimes[a];
+        const auto tb = records.mtimes[b];
         if (ta != tb) return ta < tb;
         const int c = ciCompareBytes(nameView(a), nameView(b));
         if (c != 0) return c < 0;
         return a < b;
     });
 
-    // “Path” approximation for now: (parentRecordIdx, name, recordIdx)
-    sortMaybePar(idx.orderByPath, [&](quint32 a, quint32 b) {
-        const auto pa = idx.records[a].parentRecordIdx;
-        const auto pb = idx.records[b].parentRecordIdx;
-        if (pa != pb) return pa < pb;
-        const int c = ciCompareBytes(nameView(a), nameView(b));
-        if (c != 0) return c < 0;
-        return a < b;
-    });
-
     // Build rank arrays (inverse mapping)
-    auto buildRank = [&](const std::vector<quint32>& order, std::vector<quint32>& rank) {
+    auto buildRank = [&](const std::vector<quint32>& order, MappedArray<quint32>& rankArr) {
+        rankArr.clear();
+        std::vector<quint32>& rank = rankArr.mut();
         rank.resize(n);
         for (quint32 pos = 0; pos < n; ++pos) {
             rank[order[pos]] = pos;
         }
     };
 
-    buildRank(idx.orderByName, idx.rankByName);
-    buildRank(idx.orderByPath, idx.rankByPath);
-    buildRank(idx.orderBySize, idx.rankBySize);
-    buildRank(idx.orderByMtime, idx.rankByMtime);
-}
+    buildRank(orderByName, idx.rankByName);
+    buildRank(orderBySize, idx.rankBySize);
+    buildRank(orderByMtime, idx.rankByMtime);
 
-std::vector<quint32> IndexerService::deviceCandidatesForQuery(const DeviceIndex& idx, const QStringList& tokens) {
-    // If we have any >=3 tokens, use trigram filtering.
-    // Otherwise fall back to "all records" (short tokens will be refined by substring check).
-    bool usedIndex = false;
-    std::vector<quint32> candidates;
+    buildPathOrder(idx);
+}
 
-    for (const QString& tokQ : tokens) {
-        const QByteArray tokBytes = tokQ.toUtf8();
-        if (tokBytes.size() < 3) {
-            continue;
-        }
+/**
+ * Sorts records by (directory path, name) without building any path strings.
+ *
+ * Directories are ranked by a preorder DFS of the tree with each directory's subdirectories
+ * visited in folded-name order, so comparing two directories' ranks is comparing their paths
+ * component by component. Records are then bucketed by their parent's rank (counting sort) and
+ * each bucket is sorted by name; only directory siblings and bucket members are ever compared.
+ */
+void IndexerService::buildPathOrder(DeviceIndex& idx) {
+    const quint32 n = static_cast<quint32>(idx.records.size());
+    static constexpr quint32 kNone = 0xFFFFFFFFu;
 
-        usedIndex = true;
+    if (idx.foldedPool.size() != idx.stringPool.size()) {
+        buildFoldedPool(idx);
+    }
 
-        for (int i = 0; i + 2 < tokBytes.size(); ++i) {
-            const quint32 tri =
-                (static_cast<quint32>(std::tolower(static_cast<unsigned char>(tokBytes[i]))) << 16) |
-                (static_cast<quint32>(std::tolower(static_cast<unsigned char>(tokBytes[i + 1]))) << 8) |
-                (static_cast<quint32>(std::tolower(static_cast<unsigned char>(tokBytes[i + 2]))));
-
-            const auto range = std::equal_range(
-                idx.flatIndex.begin(), idx.flatIndex.end(),
-                ScannerEngine::TrigramEntry{tri, 0},
-                [](const auto& a, const auto& b) { return a.trigram < b.trigram; }
-            );
+    const RecordColumns& records = idx.records;
+    auto nameView = [&](quint32 i) -> std::string_view {
+        return records.name(i, idx.foldedPool.data());
+    };
 
-            if (range.first == range.second) {
-                return {}; // no hits for this trigram
-            }
+    // Parent, with out-of-range and self-referencing parents treated as top level
+    auto parentOf = [&](quint32 i) -> quint32 {
+        const quint32 p = records.parents[i];
+        return (p < n && p != i) ? p : kNone;
+    };
 
-            if (candidates.empty()) {
-                candidates.reserve(static_cast<size_t>(std::distance(range.first, range.second)));
-                for (auto it = range.first; it != range.second; ++it) {
-                    candidates.push_back(it->recordIdx);
-                }
-            } else {
-                std::vector<quint32> next;
-                next.reserve(std::min(candidates.size(),
-                                      static_cast<size_t>(std::distance(range.first, range.second))));
-
-                auto aIt = candidates.begin();
-                auto bIt = range.first;
-                while (aIt != candidates.end() && bIt != range.second) {
-                    if (*aIt < bIt->recordIdx) {
-                        ++aIt;
-                    } else if (bIt->recordIdx < *aIt) {
-                        ++bIt;
-                    } else {
-                        next.push_back(*aIt);
-                        ++aIt;
-                        ++bIt;
-                    }
-                }
+    // Directories grouped by parent (top level last), each group in name order
+    std::vector<quint32> dirs;
+    for (quint32 i = 0; i < n; ++i) {
+        if (records.isDir(i)) dirs.push_back(i);
+    }
 
-                candidates = std::move(next);
-                if (candidates.empty()) {
-                    return {};
-                }
-            }
-        }
+    auto dirLess = [&](quint32 a, quint32 b) {
+        const quint32 pa = parentOf(a);
+        const quint32 pb = parentOf(b);
+        if (pa != pb) return pa < pb;
+        const int c = ciCompareBytes(nameView(a), nameView(b));
+        if (c != 0) return c < 0;
+        return a < b;
+    };
+    if (dirs.size() >= 200'000) {
+        std::sort(std::execution::par, dirs.begin(), dirs.end(), dirLess);
+    } else {
+        std::sort(dirs.begin(), dirs.end(), dirLess);
     }
 
-    if (!usedIndex) {
-        candidates.resize(idx.records.size());
-        for (quint32 i = 0; i < idx.records.size(); ++i) candidates[i] = i;
+    // childBegin[p]..childBegin[p + 1]: subdirectories of p within dirs (p == n: top level)
+    std::vector<quint32> childBegin(static_cast<size_t>(n) + 2, 0);
+    for (quint32 d : dirs) {
+        const quint32 p = parentOf(d);
+        ++childBegin[(p == kNone ? n : p) + 1];
     }
+    for (size_t k = 1; k < childBegin.size(); ++k) childBegin[k] += childBegin[k - 1];
+
+    // Preorder ranks; 0 is the root ("/"). Directories only reachable through a cycle come last.
+    std::vector<quint32> dirRank(n, kNone);
+    quint32 nextRank = 1;
+
+    std::vector<std::pair<quint32, quint32>> stack; // remaining child range per open directory
+    auto visitFrom = [&](quint32 begin, quint32 end) {
+        stack.emplace_back(begin, end);
+        while (!stack.empty()) {
+            auto& top = stack.back();
+            if (top.first == top.second) {
+                stack.pop_back();
+                continue;
+            }
 
-    return candidates;
-}
+            const quint32 d = dirs[top.first++];
+            if (dirRank[d] != kNone) continue;
 
-IndexerService::IndexerService(QObject* parent)
-    : QObject(parent) {
-    m_watchMgr = std::make_unique<WatchManager>(this, this);
+            dirRank[d] = nextRank++;
+            stack.emplace_back(childBegin[d], childBegin[d + 1]);
+        }
+    };
 
-    // Keep watch status/arming in sync with mount/unmount changes even if GUI isn't polling.
-    m_watchRefreshTimer = new QTimer(this);
-    m_watchRefreshTimer->setInterval(5000);
-    connect(m_watchRefreshTimer, &QTimer::timeout, this, [this]() {
-        if (!m_watchMgr) return;
+    visitFrom(childBegin[n], childBegin[n + 1]);
+    for (quint32 k = 0; k < dirs.size(); ++k) {
+        if (dirRank[dirs[k]] == kNone) visitFrom(k, k + 1);
+    }
 
-        // Refresh only for uids we’ve actually loaded, and only if they have any watch-enabled indexes.
-        for (const auto& uidKv : m_indexesByUid) {
-            const quint32 uid = uidKv.first;
+    // Bucket key: the parent's rank; children of non-directories (corrupt) share the last bucket
+    const quint32 buckets = nextRank + 1;
+    auto bucketOf = [&](quint32 i) -> quint32 {
+        const quint32 p = parentOf(i);
+        if (p == kNone) return 0;
+        return dirRank[p] != kNone ? dirRank[p] : nextRank;
+    };
 
-            bool anyWatchEnabled = false;
-            for (const auto& devKv : uidKv.second) {
-                if (devKv.second.watchEnabled) {
-                    anyWatchEnabled = true;
-                    break;
-                }
-            }
-            if (!anyWatchEnabled) continue;
+    std::vector<quint32> bucketBegin(static_cast<size_t>(buckets) + 1, 0);
+    for (quint32 i = 0; i < n; ++i) ++bucketBegin[bucketOf(i) + 1];
+    for (size_t k = 1; k < bucketBegin.size(); ++k) bucketBegin[k] += bucketBegin[k - 1];
 
-            qInfo().noquote() << QStringLiteral("[watch] periodic refresh uid=%1").arg(uid);
-            m_watchMgr->refreshWatchesForUid(uid);
+    idx.orderByPath.clear();
+    std::vector<quint32>& order = idx.orderByPath.mut();
+    order.resize(n);
+    {
+        std::vector<quint32> fill(bucketBegin.begin(), bucketBegin.end() - 1);
+        for (quint32 i = 0; i < n; ++i) order[fill[bucketOf(i)]++] = i;
+    }
+
+    tbb::parallel_for(tbb::blocked_range<quint32>(0, buckets, 1024), [&](const tbb::blocked_range<quint32>& r) {
+        for (quint32 b = r.begin(); b != r.end(); ++b) {
+            const auto first = order.begin() + bucketBegin[b];
+            const auto last = order.begin() + bucketBegin[b + 1];
+            if (last - first < 2) continue;
+
+            std::sort(first, last, [&](quint32 a, quint32 c) {
+                const quint32 pa = parentOf(a);
+                const quint32 pc = parentOf(c);
+                if (pa != pc) return pa < pc; // only in the corrupt-parent bucket
+                const int cmp = ciCompareBytes(nameView(a), nameView(c));
+                if (cmp != 0) return cmp < 0;
+                return a < c;
+            });
         }
     });
-    m_watchRefreshTimer->start();
+
+    idx.rankByPath.clear();
+    std::vector<quint32>& rank = idx.rankByPath.mut();
+    rank.resize(n);
+    for (quint32 pos = 0; pos < n; ++pos) {
+        rank[order[pos]] = pos;
+    }
 }
 
-IndexerService::~IndexerService() {
-    // Ensure we don't destroy QProcess while helper is still running.
-    for (auto& kv : m_jobs) {
-        if (!kv.second) continue;
+std::vector<quint32> IndexerService::deviceMatchesForQuery(const DeviceIndex& idx, const QStringList& tokens,
+                                                          const NameMatcher& matcher, const SearchCancel& cancel,
+                                                          SearchTrace* trace) {
+    // Once this few candidates are left, the substring refinement below is cheaper
+    // than intersecting any further posting lists.
+    static constexpr size_t kRefineCutoff = 256;
 
-        Job& j = *kv.second;
-        if (!j.proc) continue;
+    // Chunks for the parallel refine passes
+    static constexpr size_t kChunkNames = 16 * 1024;
 
-        // Best-effort shutdown: ask nicely, then kill, then give it a moment.
-        j.proc->terminate();
-        if (!j.proc->waitForFinished(500)) {
-            j.proc->kill();
-            j.proc->waitForFinished(1000);
+    const char* folded = idx.foldedPool.data();
+
+    // Collect every distinct trigram across all >=3 byte tokens.
+    // Short tokens (and trigrams we skip) are refined by substring check later.
+    std::vector<quint32> tris;
+    for (const QString& tokQ : tokens) {
+        QByteArray tokBytes = tokQ.toUtf8();
+        CaseFold::foldUtf8(tokBytes.constData(), static_cast<size_t>(tokBytes.size()), tokBytes.data());
+
+        for (int i = 0; i + 2 < tokBytes.size(); ++i) {
+            tris.push_back(
+                (static_cast<quint32>(static_cast<unsigned char>(tokBytes[i])) << 16) |
+                (static_cast<quint32>(static_cast<unsigned char>(tokBytes[i + 1])) << 8) |
+                (static_cast<quint32>(static_cast<unsigned char>(tokBytes[i + 2]))));
         }
-        j.proc->deleteLater();
-        j.proc = nullptr;
     }
-    m_jobs.clear();
-}
 
-// --- Begin: Empty-query global-order cache ---
+    auto concat = [](std::vector<std::vector<quint32>>& local) {
+        size_t total = 0;
+        for (const auto& v : local) total += v.size();
 
-void IndexerService::bumpUidEpoch(quint32 uid) const {
-    m_uidEpoch[uid] = m_uidEpoch[uid] + 1;
-    m_globalOrderByUid.erase(uid); // drop caches; they'll be rebuilt lazily
+        std::vector<quint32> out;
+        out.reserve(total);
+        for (const auto& v : local) out.insert(out.end(), v.begin(), v.end());
+        return out;
+    };
 
-    // Also drop any queued warm-ups for this uid (epoch changed, so they’re stale anyway).
-    // Keep it simple: linear scan is fine (small set).
-    for (auto it = m_globalWarmScheduled.begin(); it != m_globalWarmScheduled.end(); ) {
-        if (it->startsWith(QStringLiteral("%1:").arg(uid))) {
-            it = m_globalWarmScheduled.erase(it);
-        } else {
-            ++it;
+    if (tris.empty()) {
+        // Only 1-2 byte tokens: match the names whose signature has every bit of the tokens'
+        quint64 mask = 0;
+        for (const QString& tokQ : tokens) {
+            QByteArray tokBytes = tokQ.toUtf8();
+            CaseFold::foldUtf8(tokBytes.constData(), static_cast<size_t>(tokBytes.size()), tokBytes.data());
+            mask |= NameSignature::of(tokBytes.constData(), static_cast<size_t>(tokBytes.size()));
         }
-    }
-}
 
-const IndexerService::GlobalOrderCache* IndexerService::globalOrderForUid(quint32 uid, const QString& sortKey) const {
-    const quint64 epoch = m_uidEpoch.contains(uid) ? m_uidEpoch.at(uid) : 0;
+        // Base index: every distinct name once (without signatures each is matched), expanded to
+        // its live records like the trigram path below
+        const size_t names = idx.names.nameCount();
+        const quint64* sigs = (idx.nameSignatures.size() == names) ? idx.nameSignatures.data() : nullptr;
+        const auto refineStart = std::chrono::steady_clock::now();
 
-    auto uIt = m_globalOrderByUid.find(uid);
-    if (uIt == m_globalOrderByUid.end()) return nullptr;
+        const size_t chunks = (names + kChunkNames - 1) / kChunkNames;
+        std::vector<std::vector<quint32>> local(chunks);
 
-    auto cIt = uIt->second.find(sortKey);
-    if (cIt == uIt->second.end()) return nullptr;
+        tbb::parallel_for(size_t(0), chunks, [&](size_t c) {
+            if (cancel.cancelled()) return;
 
-    const GlobalOrderCache& c = cIt->second;
-    if (c.epoch != epoch) return nullptr;
-    if (c.asc.empty()) return nullptr;
-    return &c;
-}
+            const size_t begin = c * kChunkNames;
+            const size_t end = std::min(names, begin + kChunkNames);
+            std::vector<quint32>& out = local[c];
+            for (size_t i = begin; i < end; ++i) {
+                const quint32 id = static_cast<quint32>(i);
+                if (sigs && (sigs[i] & mask) != mask) continue;
+                if (!matcher.matchesFolded(idx.names.name(id, folded))) continue;
 
-void IndexerService::rebuildGlobalOrderForUid(quint32 uid, const QString& sortKey) const {
-    auto uidIt = m_indexesByUid.find(uid);
-    if (uidIt == m_indexesByUid.end()) return;
+                for (const quint32 rec : idx.names.recordsOf(id)) {
+                    if (!idx.isDead(rec)) out.push_back(rec);
+                }
+            }
+        });
+        if (cancel.cancelled()) return {};
 
-    const auto& indexes = uidIt->second;
-    const quint64 epoch = m_uidEpoch.contains(uid) ? m_uidEpoch.at(uid) : 0;
+        std::vector<quint32> matches = concat(local);
 
-    auto pickOrder = [&](const DeviceIndex& idx) -> const std::vector<quint32>* {
-        if (sortKey.compare(QStringLiteral("size"), Qt::CaseInsensitive) == 0) return &idx.orderBySize;
-        if (sortKey.compare(QStringLiteral("mtime"), Qt::CaseInsensitive) == 0) return &idx.orderByMtime;
-        if (sortKey.compare(QStringLiteral("path"), Qt::CaseInsensitive) == 0) return &idx.orderByPath;
-        return &idx.orderByName;
-    };
+        // Delta records (created by watch updates since the last compaction) are few; sign them here
+        const quint32 n = static_cast<quint32>(idx.records.size());
+        for (quint32 rec = idx.deltaBegin(); rec < n; ++rec) {
+            if (idx.isDead(rec)) continue;
 
-    struct Cursor {
-        const QString* deviceId = nullptr;
-        const DeviceIndex* idx = nullptr;
-        const std::vector<quint32>* order = nullptr;
-        quint32 pos = 0;
-    };
+            const std::string_view name = idx.records.name(rec, folded);
+            if ((NameSignature::of(name.data(), name.size()) & mask) != mask) continue;
+            if (matcher.matchesFolded(name)) matches.push_back(rec);
+        }
+
+        if (trace) {
+            trace->candidates += names + (n - idx.deltaBegin());
+            trace->refineNs += nsSince(refineStart);
+        }
+        return matches;
+    }
 
-    std::vector<Cursor> cursors;
-    cursors.reserve(indexes.size());
+    std::sort(tris.begin(), tris.end());
+    tris.erase(std::unique(tris.begin(), tris.end()), tris.end());
 
-    quint64 total = 0;
-    for (const auto& kv : indexes) {
-        const auto* ord = pickOrder(kv.second);
-        if (!ord || ord->empty()) continue;
+    // Base index: candidate name ids. Resolve postings up front; a single missing trigram means no hits there at all
+    const auto candidatesStart = std::chrono::steady_clock::now();
+    quint64 rangesTouched = 0;
+    std::vector<quint32> nameCandidates;
+    [&]() {
+        std::vector<const TrigramIndex::DirEntry*> postings;
+        postings.reserve(tris.size());
+        for (quint32 tri : tris) {
+            const TrigramIndex::DirEntry* posting = idx.trigrams.find(tri);
+            if (!posting) {
+                return;
+            }
+            postings.push_back(posting);
+        }
 
-        total += static_cast<quint64>(ord->size());
+        // Most selective first: the candidate set only ever shrinks
+        std::sort(postings.begin(), postings.end(), [](const auto* a, const auto* b) {
+            return a->count < b->count;
+        });
 
-        Cursor c;
-        c.deviceId = &kv.first;
-        c.idx = &kv.second;
-        c.order = ord;
-        c.pos = 0;
-        cursors.push_back(c);
-    }
+        idx.trigrams.decode(*postings.front(), nameCandidates);
+        rangesTouched = 1;
 
-    if (total == 0 || cursors.empty()) return;
+        for (size_t i = 1; i < postings.size(); ++i) {
+            if (nameCandidates.size() <= kRefineCutoff || cancel.cancelled()) {
+                break;
+            }
 
-    auto nameView = [&](const DeviceIndex& idx, quint32 recIdx) -> std::string_view {
-        const auto& r = idx.records[recIdx];
-        return std::string_view(idx.stringPool.data() + r.nameOffset, r.nameLen);
-    };
+            idx.trigrams.intersectInPlace(*postings[i], nameCandidates);
+            ++rangesTouched;
+            if (nameCandidates.empty()) {
+                break;
+            }
+        }
+    }();
 
-    // NOTE: priority_queue is max-heap; comparator returns "a is worse than b" for min-heap behavior.
-    auto lessNode = [&](const Cursor& a, const Cursor& b) {
-        const quint32 ai = (*a.order)[a.pos];
-        const quint32 bi = (*b.order)[b.pos];
-
-        if (sortKey.compare(QStringLiteral("size"), Qt::CaseInsensitive) == 0) {
-            const auto sa = a.idx->records[ai].size;
-            const auto sb = b.idx->records[bi].size;
-            if (sa != sb) return sa > sb;
-        } else if (sortKey.compare(QStringLiteral("mtime"), Qt::CaseInsensitive) == 0) {
-            const auto ta = a.idx->records[ai].modificationTime;
-            const auto tb = b.idx->records[bi].modificationTime;
-            if (ta != tb) return ta > tb;
-        } else if (sortKey.compare(QStringLiteral("path"), Qt::CaseInsensitive) == 0) {
-            const auto pa = a.idx->records[ai].parentRecordIdx;
-            const auto pb = b.idx->records[bi].parentRecordIdx;
-            if (pa != pb) return pa > pb;
-        }
-
-        const int c = ciCompareBytes(nameView(*a.idx, ai), nameView(*b.idx, bi));
-        if (c != 0) return c > 0;
-
-        if (*a.deviceId != *b.deviceId) return *a.deviceId > *b.deviceId;
-        return ai > bi;
-    };
+    if (cancel.cancelled()) {
+        return {};
+    }
 
-    std::priority_queue<Cursor, std::vector<Cursor>, decltype(lessNode)> pq(lessNode);
-    for (const auto& c : cursors) pq.push(c);
+    const auto refineStart = std::chrono::steady_clock::now();
+    if (trace) {
+        trace->trigramRanges += rangesTouched;
+        trace->candidates += nameCandidates.size();
+        trace->candidatesNs += nsBetween(candidatesStart, refineStart);
+    }
 
-    GlobalOrderCache cache;
-    cache.epoch = epoch;
-    cache.sortKey = sortKey;
-    cache.asc.reserve(static_cast<size_t>(total));
+    // Refine every distinct name once, then expand the matching names to their live records
+    const size_t chunks = (nameCandidates.size() + kChunkNames - 1) / kChunkNames;
+    std::vector<std::vector<quint32>> local(chunks);
 
-    while (!pq.empty()) {
-        Cursor cur = pq.top();
-        pq.pop();
+    tbb::parallel_for(size_t(0), chunks, [&](size_t c) {
+        if (cancel.cancelled()) return;
 
-        const quint32 recIdx = (*cur.order)[cur.pos];
-        cache.asc.push_back(GlobalOrderEntry{*cur.deviceId, recIdx});
+        const size_t begin = c * kChunkNames;
+        const size_t end = std::min(nameCandidates.size(), begin + kChunkNames);
+        std::vector<quint32>& out = local[c];
+        for (size_t i = begin; i < end; ++i) {
+            const quint32 id = nameCandidates[i];
+            if (!matcher.matchesFolded(idx.names.name(id, folded))) continue;
+
+            for (const quint32 rec : idx.names.recordsOf(id)) {
+                if (!idx.isDead(rec)) out.push_back(rec);
+            }
+        }
+    });
+    if (cancel.cancelled()) return {};
+
+    std::vector<quint32> matches = concat(local);
+
+    // Delta records (created by watch updates since the last compaction) have their own trigram list
+    if (!idx.deltaTrigrams.empty()) {
+        std::vector<quint32> delta;
+        std::vector<quint32> next;
+        for (size_t t = 0; t < tris.size(); ++t) {
+            const auto range = std::equal_range(idx.deltaTrigrams.begin(), idx.deltaTrigrams.end(),
+                                                ScannerEngine::TrigramEntry{tris[t], 0},
+                                                [](const auto& a, const auto& b) { return a.trigram < b.trigram; });
+
+            next.clear();
+            for (auto it = range.first; it != range.second; ++it) {
+                if (t == 0 || std::binary_search(delta.begin(), delta.end(), it->recordIdx)) {
+                    next.push_back(it->recordIdx);
+                }
+            }
+            delta.swap(next);
+            if (delta.empty()) break;
+        }
 
-        ++cur.pos;
-        if (cur.pos < cur.order->size()) {
-            pq.push(cur);
+        for (const quint32 rec : delta) {
+            if (!idx.isDead(rec) && matcher.matchesFolded(idx.records.name(rec, folded))) matches.push_back(rec);
         }
+        if (trace) trace->candidates += delta.size();
     }
 
-    m_globalOrderByUid[uid][sortKey] = std::move(cache);
+    if (trace) trace->refineNs += nsSince(refineStart);
+    return matches;
 }
 
-QString IndexerService::warmKey(quint32 uid, quint64 epoch, const QString& sortKey) {
-    return QStringLiteral("%1:%2:%3").arg(uid).arg(epoch).arg(sortKey);
-}
+std::vector<quint32> IndexerService::deviceCandidatesForExtension(const DeviceIndex& idx, const QByteArray& extension) {
+    const std::string_view want(extension.constData(), static_cast<size_t>(extension.size()));
 
-// --- End: Empty-query global-order cache ---
+    std::vector<quint32> candidates;
+    if (const ExtensionIndex::Entry* e = idx.extensions.find(want)) {
+        const auto postings = idx.extensions.postingsOf(*e);
+        candidates.assign(postings.begin(), postings.end());
+    }
 
-// --- Begin: DeviceIndexUpdated batching scaffold ---
+    // Records past the extension index (watch delta) are few; check them directly
+    for (quint32 i = idx.extensions.recordCount; i < idx.records.size(); ++i) {
+        if (ExtensionIndex::extensionOf(idx.records.name(i, idx.foldedPool.data())) == want) candidates.push_back(i);
+    }
 
-void IndexerService::queueDeviceIndexUpdated(quint32 uid,
-                                             const QString& deviceId,
-                                             quint64 generation,
+    if (idx.deadCount > 0) {
+        std::erase_if(candidates, [&](quint32 rec) { return idx.isDead(rec); });
+    }
+
+    return candidates;
+}
+
+// --- Begin: Search filters ---
+
+QString IndexerService::SearchFilter::key() const {
+    if (!active()) return {};
+
+    QStringList exts;
+    for (const QByteArray& e : extensions) exts.push_back(QString::fromUtf8(e));
+    exts.sort();
+    return QStringLiteral("%1-%2:%3-%4:%5%6:%7")
+        .arg(minSize).arg(maxSize).arg(mtimeFrom).arg(mtimeTo)
+        .arg(dirsOnly ? QStringLiteral("d") : QString())
+        .arg(filesOnly ? QStringLiteral("f") : QString())
+        .arg(exts.join(QChar(0x1F)));
+}
+
+IndexerService::SearchFilter IndexerService::searchFilterFor(const QVariantMap& options) {
+    SearchFilter f;
+
+    // Negative bounds (mtimes before 1970 aren't indexed) clamp to 0
+    auto readBound = [&](const QString& name, quint64& out) {
+        const QVariant v = options.value(name);
+        if (!v.isValid()) return;
+
+        bool ok = false;
+        const qlonglong signedValue = v.toLongLong(&ok);
+        if (ok && signedValue < 0) {
+            out = 0;
+            return;
+        }
+        const qulonglong value = v.toULongLong(&ok);
+        if (ok) out = static_cast<quint64>(value);
+    };
+
+    readBound(QStringLiteral("minSize"), f.minSize);
+    readBound(QStringLiteral("maxSize"), f.maxSize);
+    readBound(QStringLiteral("mtimeFrom"), f.mtimeFrom);
+    readBound(QStringLiteral("mtimeTo"), f.mtimeTo);
+    f.dirsOnly = options.value(QStringLiteral("dirsOnly")).toBool();
+    f.filesOnly = options.value(QStringLiteral("filesOnly")).toBool();
+    return f;
+}
+
+IndexerService::FilterBounds IndexerService::filterBoundsFor(const DeviceIndex& idx, const SearchFilter& filter) {
+    // orderBySize is sorted by size first (then name), so a size range is one contiguous slice; same for mtime
+    auto slice = [](const MappedArray<quint32>& order, const MappedArray<uint64_t>& column, quint64 lo, quint64 hi,
+                    quint32& outLo, quint32& outHi) {
+        const quint32* first = order.data();
+        const quint32* last = first + order.size();
+        if (lo > hi) {
+            outLo = outHi = 0;
+            return;
+        }
+        const quint32* b = std::lower_bound(first, last, lo, [&](quint32 rec, quint64 v) { return column[rec] < v; });
+        const quint32* e = std::upper_bound(b, last, hi, [&](quint64 v, quint32 rec) { return v < column[rec]; });
+        outLo = static_cast<quint32>(b - first);
+        outHi = static_cast<quint32>(e - first);
+    };
+
+    FilterBounds b;
+    slice(idx.orderBySize, idx.records.sizes, filter.minSize, filter.maxSize, b.sizeLo, b.sizeHi);
+    slice(idx.orderByMtime, idx.records.mtimes, filter.mtimeFrom, filter.mtimeTo, b.mtimeLo, b.mtimeHi);
+    return b;
+}
+
+bool IndexerService::filterAdmits(const DeviceIndex& idx, const SearchFilter& filter, const FilterBounds& bounds,
+                                  quint32 recIdx) {
+    if (filter.sizeActive()) {
+        if (recIdx >= idx.rankBySize.size()) return false;
+        const quint32 r = idx.rankBySize[recIdx];
+        if (r < bounds.sizeLo || r >= bounds.sizeHi) return false;
+    }
+    if (filter.mtimeActive()) {
+        if (recIdx >= idx.rankByMtime.size()) return false;
+        const quint32 r = idx.rankByMtime[recIdx];
+        if (r < bounds.mtimeLo || r >= bounds.mtimeHi) return false;
+    }
+    if (filter.dirsOnly && !idx.records.isDir(recIdx)) return false;
+    if (filter.filesOnly && idx.records.isDir(recIdx)) return false;
+    return true;
+}
+
+bool IndexerService::extensionMatches(const DeviceIndex& idx, const SearchFilter& filter, quint32 recIdx) {
+    const std::string_view ext = ExtensionIndex::extensionOf(idx.records.name(recIdx, idx.foldedPool.data()));
+    for (const QByteArray& want : filter.extensions) {
+        if (ext != std::string_view(want.constData(), static_cast<size_t>(want.size()))) return false;
+    }
+    return true;
+}
+
+std::vector<quint32> IndexerService::deviceCandidatesForFilter(const DeviceIndex& idx, const SearchFilter& filter,
+                                                              const FilterBounds& bounds) {
+    std::vector<quint32> out;
+    if (filter.dirsOnly && filter.filesOnly) return out;
+
+    const quint32 sizeCount = bounds.sizeHi - bounds.sizeLo;
+    const quint32 mtimeCount = bounds.mtimeHi - bounds.mtimeLo;
+
+    // Walk the narrower range slice; only its records need checking against the other bounds
+    const quint32* first = nullptr;
+    const quint32* last = nullptr;
+    if (filter.sizeActive() && (!filter.mtimeActive() || sizeCount <= mtimeCount)) {
+        first = idx.orderBySize.data() + bounds.sizeLo;
+        last = idx.orderBySize.data() + bounds.sizeHi;
+    } else if (filter.mtimeActive()) {
+        first = idx.orderByMtime.data() + bounds.mtimeLo;
+        last = idx.orderByMtime.data() + bounds.mtimeHi;
+    } else {
+        // Only a type filter: every live record is a candidate
+        for (quint32 i = 0; i < idx.records.size(); ++i) {
+            if (!idx.isDead(i) && filterAdmits(idx, filter, bounds, i)) out.push_back(i);
+        }
+        return out;
+    }
+
+    out.reserve(static_cast<size_t>(last - first));
+    for (const quint32* it = first; it != last; ++it) {
+        if (filterAdmits(idx, filter, bounds, *it)) out.push_back(*it);
+    }
+    return out;
+}
+
+// --- End: Search filters ---
+
+IndexerService::IndexerService(QObject* parent, QString indexRoot)
+    : QObject(parent),
+      m_indexRoot(std::move(indexRoot)) {
+    m_watchMgr = std::make_unique<WatchManager>(this, this);
+
+    m_searchPool = new QThreadPool(this);
+    m_searchPool->setMaxThreadCount(kSearchWorkerThreads);
+
+    m_snapshotPool = new QThreadPool(this);
+    m_snapshotPool->setMaxThreadCount(1);
+
+    // Keep watch status/arming in sync with mount/unmount changes even if GUI isn't polling.
+    m_watchRefreshTimer = new QTimer(this);
+    m_watchRefreshTimer->setInterval(5000);
+    connect(m_watchRefreshTimer, &QTimer::timeout, this, [this]() {
+        if (!m_watchMgr) return;
+
+        // Refresh only for uids we’ve actually loaded, and only if they have any watch-enabled indexes.
+        for (const auto& uidKv : m_indexesByUid) {
+            const quint32 uid = uidKv.first;
+
+            bool anyWatchEnabled = false;
+            for (const auto& devKv : uidKv.second) {
+                if (devKv.second->watchEnabled) {
+                    anyWatchEnabled = true;
+                    break;
+                }
+            }
+            if (!anyWatchEnabled) continue;
+
+            qInfo().noquote() << QStringLiteral("[watch] periodic refresh uid=%1").arg(uid);
+            m_watchMgr->refreshWatchesForUid(uid);
+        }
+    });
+    m_watchRefreshTimer->start();
+}
+
+IndexerService::~IndexerService() {
+    // In-flight searches reference this object (and reply on its connection)
+    m_searchPool->waitForDone();
+
+    // Let the running snapshot write commit, then write the queued ones here (their journals already
+    // started, so dropping them would orphan every batch journaled since)
+    m_snapshotPool->waitForDone();
+    for (const auto& kv : m_persistStates) {
+        const SnapshotPersistState& st = kv.second;
+        if (!st.queued) continue;
+
+        QString err;
+        if (!saveSnapshot(st.uid, st.deviceId, *st.queued, st.queuedToken, &err)) {
+            qWarning().noquote() << QStringLiteral("[snapshot] final write failed uid=%1 device=%2: %3")
+                                    .arg(st.uid).arg(st.deviceId, err);
+        }
+    }
+
+    // Ensure we don't destroy QProcess while helper is still running.
+    for (auto& kv : m_jobs) {
+        if (!kv.second) continue;
+
+        Job& j = *kv.second;
+        if (!j.proc) continue;
+
+        // Best-effort shutdown: ask nicely, then kill, then give it a moment.
+        j.proc->terminate();
+        if (!j.proc->waitForFinished(500)) {
+            j.proc->kill();
+            j.proc->waitForFinished(1000);
+        }
+        j.proc->deleteLater();
+        j.proc = nullptr;
+    }
+    m_jobs.clear();
+}
+
+// --- Begin: Concurrent search ---
+
+IndexerService::SearchSnapshot IndexerService::searchSnapshotForUid(quint32 uid) const {
+    SearchSnapshot snap;
+    snap.uid = uid;
+    {
+        std::lock_guard lock(m_searchCacheMutex);
+        snap.epoch = uidEpoch(uid);
+    }
+
+    auto uidIt = m_indexesByUid.find(uid);
+    if (uidIt != m_indexesByUid.end()) {
+        snap.indexes.reserve(uidIt->second.size());
+        for (const auto& kv : uidIt->second) {
+            snap.indexes.emplace(kv.first, pinDeviceIndex(kv.second));
+        }
+    }
+    return snap;
+}
+
+IndexerService::DeviceIndex& IndexerService::mutableDeviceIndex(std::shared_ptr<DeviceIndex>& slot) const {
+    // Only the main thread pins, so an unpinned index can't become pinned behind our back
+    if (slot->pins.count.load(std::memory_order_acquire) > 0) {
+        std::shared_ptr<DeviceIndex> clone = shareDeviceIndex(slot);
+
+        // The caches are main-thread state, so the version left to its readers can do without them
+        DeviceIndex& old = *slot;
+        clone->dirPaths = std::move(old.dirPaths);
+        clone->childTable = std::move(old.childTable);
+        clone->childTableBuilt = old.childTableBuilt;
+        clone->childCountCache = std::move(old.childCountCache);
+        old.dirPaths.clear();
+        old.childTable.clear();
+        old.childTableBuilt = false;
+        old.childCountCache.clear();
+
+        slot = std::move(clone);
+    }
+    return *slot;
+}
+
+std::shared_ptr<const IndexerService::DeviceIndex> IndexerService::pinDeviceIndex(std::shared_ptr<const DeviceIndex> idx) {
+    if (!idx) return idx;
+
+    idx->pins.count.fetch_add(1, std::memory_order_relaxed);
+    const DeviceIndex* raw = idx.get();
+    return std::shared_ptr<const DeviceIndex>(raw, [idx = std::move(idx)](const DeviceIndex*) mutable {
+        idx->pins.count.fetch_sub(1, std::memory_order_release);
+        idx.reset();
+    });
+}
+
+std::shared_ptr<IndexerService::DeviceIndex> IndexerService::shareDeviceIndex(const std::shared_ptr<const DeviceIndex>& src) {
+    const DeviceIndex& s = *src;
+    const std::shared_ptr<const DeviceIndex> backing = pinDeviceIndex(src);
+    auto out = std::make_shared<DeviceIndex>();
+    DeviceIndex& d = *out;
+
+    d.fsType = s.fsType;
+    d.generation = s.generation;
+    d.lastIndexedTime = s.lastIndexedTime;
+    d.labelLastKnown = s.labelLastKnown;
+    d.uuidLastKnown = s.uuidLastKnown;
+    d.watchEnabled = s.watchEnabled;
+    d.journal = s.journal;
+
+    auto share = [&](auto& dst, const auto& arr) { dst = arr.viewSharing(backing); };
+
+    share(d.records.parents, s.records.parents);
+    share(d.records.sizes, s.records.sizes);
+    share(d.records.mtimes, s.records.mtimes);
+    share(d.records.nameOffsets, s.records.nameOffsets);
+    share(d.records.nameLens, s.records.nameLens);
+    share(d.records.flags, s.records.flags);
+    share(d.stringPool, s.stringPool);
+    share(d.foldedPool, s.foldedPool);
+
+    share(d.names.nameOffsets, s.names.nameOffsets);
+    share(d.names.nameLens, s.names.nameLens);
+    share(d.names.recordFirst, s.names.recordFirst);
+    share(d.names.recordIds, s.names.recordIds);
+    d.names.recordCount = s.names.recordCount;
+
+    share(d.trigrams.buckets, s.trigrams.buckets);
+    share(d.trigrams.directory, s.trigrams.directory);
+    share(d.trigrams.skips, s.trigrams.skips);
+    share(d.trigrams.data, s.trigrams.data);
+    d.trigrams.recordCount = s.trigrams.recordCount;
+
+    share(d.extensions.names, s.extensions.names);
+    share(d.extensions.entries, s.extensions.entries);
+    share(d.extensions.postings, s.extensions.postings);
+    d.extensions.recordCount = s.extensions.recordCount;
+
+    share(d.nameSignatures, s.nameSignatures);
+    share(d.fileIds, s.fileIds);
+
+    share(d.orderByName, s.orderByName);
+    share(d.orderByPath, s.orderByPath);
+    share(d.orderBySize, s.orderBySize);
+    share(d.orderByMtime, s.orderByMtime);
+    share(d.rankByName, s.rankByName);
+    share(d.rankByPath, s.rankByPath);
+    share(d.rankBySize, s.rankBySize);
+    share(d.rankByMtime, s.rankByMtime);
+
+    // The watch delta is small; copy it. The lookup caches are rebuilt on demand (or handed over,
+    // see mutableDeviceIndex).
+    d.deltaTrigrams = s.deltaTrigrams;
+    d.deadBits = s.deadBits;
+    d.deadCount = s.deadCount;
+    d.rootDirId = s.rootDirId;
+
+    return out;
+}
+
+IndexerService::SearchCancel IndexerService::searchCancelFor(const QVariantMap& options) const {
+    SearchCancel cancel;
+
+    const QVariant serialV = options.value(QStringLiteral("querySerial"));
+    if (!serialV.isValid()) {
+        return cancel;
+    }
+
+    const auto watermark = searchWatermarkForCaller();
+
+    // Implicit cancel: a newer query from the same client supersedes all of its older ones
+    cancel.serial = serialV.toULongLong();
+    if (watermark->load() < cancel.serial) {
+        watermark->store(cancel.serial);
+    }
+    cancel.watermark = watermark;
+    return cancel;
+}
+
+QDBusMessage IndexerService::searchCancelledReply(const QDBusMessage& request) const {
+    {
+        std::lock_guard lock(m_searchCacheMutex);
+        ++m_searchCacheStats.cancelled;
+    }
+    return request.createErrorReply(QStringLiteral("net.reikooters.Kerything1.Error.Cancelled"),
+                                    QStringLiteral("Search was superseded by a newer query."));
+}
+
+std::shared_ptr<std::atomic<quint64>> IndexerService::searchWatermarkForCaller() const {
+    const QString sender = message().service();
+
+    auto [it, added] = m_searchWatermarkBySender.try_emplace(sender);
+    if (!added) return it->second;
+
+    it->second = std::make_shared<std::atomic<quint64>>(0);
+
+    auto* self = const_cast<IndexerService*>(this);
+    if (!m_searchSenderWatcher) {
+        m_searchSenderWatcher = new QDBusServiceWatcher(self);
+        m_searchSenderWatcher->setConnection(connection());
+        m_searchSenderWatcher->setWatchMode(QDBusServiceWatcher::WatchForUnregistration);
+        connect(m_searchSenderWatcher, &QDBusServiceWatcher::serviceUnregistered, self, [self](const QString& name) {
+            self->m_searchWatermarkBySender.erase(name);
+            self->m_searchSenderWatcher->removeWatchedService(name);
+        });
+    }
+    m_searchSenderWatcher->addWatchedService(sender);
+
+    // Unique names are never reused: one that is already gone won't be reported any more
+    if (auto* iface = connection().interface(); iface && !iface->isServiceRegistered(sender).value()) {
+        std::shared_ptr<std::atomic<quint64>> watermark = std::move(it->second);
+        m_searchSenderWatcher->removeWatchedService(sender);
+        m_searchWatermarkBySender.erase(it);
+        return watermark;
+    }
+    return it->second;
+}
+
+void IndexerService::CancelSearch(quint64 serial) {
+    // Searches with a serial created the caller's watermark before they were queued
+    const auto it = m_searchWatermarkBySender.find(message().service());
+    if (it == m_searchWatermarkBySender.end()) return;
+
+    if (it->second->load() <= serial) {
+        it->second->store(serial + 1);
+    }
+}
+
+// --- End: Concurrent search ---
+
+// --- Begin: Empty-query global-order cache ---
+
+void IndexerService::bumpUidEpoch(quint32 uid) const {
+    std::lock_guard lock(m_searchCacheMutex);
+
+    m_uidEpoch[uid] = m_uidEpoch[uid] + 1;
+    m_globalOrderByUid.erase(uid); // drop caches; they'll be rebuilt lazily
+    m_searchSessionsByUid.erase(uid); // cached hit lists reference the old indexes
+
+    // Also drop any queued warm-ups for this uid (epoch changed, so they’re stale anyway).
+    // Keep it simple: linear scan is fine (small set).
+    for (auto it = m_globalWarmScheduled.begin(); it != m_globalWarmScheduled.end(); ) {
+        if (it->startsWith(QStringLiteral("%1:").arg(uid))) {
+            it = m_globalWarmScheduled.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+quint64 IndexerService::uidEpoch(quint32 uid) const {
+    auto it = m_uidEpoch.find(uid);
+    return it != m_uidEpoch.end() ? it->second : 0;
+}
+
+std::shared_ptr<const IndexerService::GlobalOrderCache> IndexerService::globalOrderForUid(quint32 uid,
+                                                                                       quint64 epoch,
+                                                                                       const QString& sortKey) const {
+    std::lock_guard lock(m_searchCacheMutex);
+
+    auto uIt = m_globalOrderByUid.find(uid);
+    if (uIt == m_globalOrderByUid.end()) return nullptr;
+
+    auto cIt = uIt->second.find(sortKey);
+    if (cIt == uIt->second.end()) return nullptr;
+
+    const auto& c = cIt->second;
+    if (!c || c->epoch != epoch) return nullptr;
+    if (c->asc.empty()) return nullptr;
+    return c;
+}
+
+IndexerService::OrderKey IndexerService::orderKeyFor(const QString& sortKey) {
+    if (sortKey.compare(QStringLiteral("size"), Qt::CaseInsensitive) == 0) return OrderKey::Size;
+    if (sortKey.compare(QStringLiteral("mtime"), Qt::CaseInsensitive) == 0) return OrderKey::Mtime;
+    if (sortKey.compare(QStringLiteral("path"), Qt::CaseInsensitive) == 0) return OrderKey::Path;
+    return OrderKey::Name;
+}
+
+std::vector<IndexerService::OrderRun> IndexerService::orderRunsFor(const SearchSnapshot& snap,
+                                                                   const QStringList& deviceIds,
+                                                                   OrderKey key) {
+    std::vector<OrderRun> runs;
+    runs.reserve(snap.indexes.size());
+
+    for (const auto& kv : snap.indexes) {
+        if (!deviceIds.isEmpty() && !deviceIds.contains(kv.first)) continue;
+
+        const DeviceIndex& idx = *kv.second;
+        const MappedArray<quint32>* ord = &idx.orderByName;
+        switch (key) {
+            case OrderKey::Size:  ord = &idx.orderBySize; break;
+            case OrderKey::Mtime: ord = &idx.orderByMtime; break;
+            case OrderKey::Path:  ord = &idx.orderByPath; break;
+            case OrderKey::Name:  break;
+        }
+        if (ord->empty()) continue;
+
+        runs.push_back(OrderRun{&kv.first, &idx, std::span<const quint32>(ord->data(), ord->size())});
+    }
+
+    // Deterministic run order (the map's isn't), so cache ordinals and merges are reproducible
+    std::sort(runs.begin(), runs.end(), [](const OrderRun& a, const OrderRun& b) {
+        return *a.deviceId < *b.deviceId;
+    });
+    return runs;
+}
+
+bool IndexerService::orderLess(OrderKey key, const OrderRun& a, quint32 ai, const OrderRun& b, quint32 bi) {
+    const RecordColumns& ra = a.idx->records;
+    const RecordColumns& rb = b.idx->records;
+
+    switch (key) {
+        case OrderKey::Size:
+            if (ra.sizes[ai] != rb.sizes[bi]) return ra.sizes[ai] < rb.sizes[bi];
+            break;
+        case OrderKey::Mtime:
+            if (ra.mtimes[ai] != rb.mtimes[bi]) return ra.mtimes[ai] < rb.mtimes[bi];
+            break;
+        case OrderKey::Path:
+            // Path ranks are positions in each device's own tree order
+            if (a.idx->rankByPath[ai] != b.idx->rankByPath[bi]) return a.idx->rankByPath[ai] < b.idx->rankByPath[bi];
+            break;
+        case OrderKey::Name:
+            break;
+    }
+
+    const int c = ciCompareBytes(ra.name(ai, a.idx->foldedPool.data()), rb.name(bi, b.idx->foldedPool.data()));
+    if (c != 0) return c < 0;
+
+    if (a.idx != b.idx) return *a.deviceId < *b.deviceId;
+    return ai < bi;
+}
+
+std::vector<quint32> IndexerService::globalRankSplit(const std::vector<OrderRun>& runs, OrderKey key, quint64 rank) {
+    const size_t k = runs.size();
+
+    // The answer's position in run j lies within [lo[j], hi[j]]; every step halves the widest range
+    std::vector<quint32> lo(k, 0);
+    std::vector<quint32> hi(k, 0);
+    quint64 total = 0;
+    for (size_t j = 0; j < k; ++j) {
+        hi[j] = static_cast<quint32>(runs[j].order.size());
+        total += hi[j];
+    }
+
+    if (rank >= total) return hi;
+    if (rank == 0) return lo;
+
+    while (true) {
+        size_t d = k;
+        quint32 widest = 0;
+        for (size_t j = 0; j < k; ++j) {
+            if (hi[j] - lo[j] > widest) {
+                widest = hi[j] - lo[j];
+                d = j;
+            }
+        }
+        if (d == k) break;
+
+        const quint32 mid = lo[d] + widest / 2;
+        const OrderRun& pivotRun = runs[d];
+        const quint32 pivot = pivotRun.order[mid];
+
+        // Number of entries (over all runs) that sort before the pivot
+        quint64 before = 0;
+        std::vector<quint32> below(k, 0);
+        for (size_t j = 0; j < k; ++j) {
+            if (j == d) {
+                below[j] = mid;
+            } else {
+                const OrderRun& run = runs[j];
+                const quint32* first = run.order.data();
+                const quint32* last = first + run.order.size();
+                below[j] = static_cast<quint32>(std::lower_bound(first, last, pivot, [&](quint32 rec, quint32 p) {
+                    return orderLess(key, run, rec, pivotRun, p);
+                }) - first);
+            }
+            before += below[j];
+        }
+
+        if (before < rank) {
+            // The pivot is among the first `rank` entries, and so is everything before it
+            for (size_t j = 0; j < k; ++j) lo[j] = std::max(lo[j], below[j]);
+            lo[d] = mid + 1;
+        } else {
+            for (size_t j = 0; j < k; ++j) hi[j] = std::min(hi[j], below[j]);
+            hi[d] = mid;
+        }
+    }
+
+    return lo;
+}
+
+template<typename Emit>
+bool IndexerService::mergeOrderRuns(const std::vector<OrderRun>& runs, OrderKey key, std::vector<quint32> pos,
+                                    quint64 count, const SearchCancel& cancel, Emit&& emit) {
+    // NOTE: priority_queue is max-heap; comparator returns "a is worse than b" for min-heap behavior.
+    auto worse = [&](quint32 a, quint32 b) {
+        return orderLess(key, runs[b], runs[b].order[pos[b]], runs[a], runs[a].order[pos[a]]);
+    };
+
+    std::priority_queue<quint32, std::vector<quint32>, decltype(worse)> pq(worse);
+    for (quint32 r = 0; r < runs.size(); ++r) {
+        if (pos[r] < runs[r].order.size()) pq.push(r);
+    }
+
+    for (quint64 emitted = 0; emitted < count && !pq.empty(); ++emitted) {
+        if ((emitted & 0xFFFF) == 0xFFFF && cancel.cancelled()) return false;
+
+        const quint32 r = pq.top();
+        pq.pop();
+
+        emit(r, runs[r].order[pos[r]]);
+
+        if (++pos[r] < runs[r].order.size()) {
+            pq.push(r);
+        }
+    }
+    return true;
+}
+
+std::shared_ptr<const IndexerService::GlobalOrderCache> IndexerService::rebuildGlobalOrderForUid(const SearchSnapshot& snap,
+                                                                                              const QString& sortKey,
+                                                                                              const SearchCancel& cancel) const {
+    const OrderKey key = orderKeyFor(sortKey);
+    const std::vector<OrderRun> runs = orderRunsFor(snap, QStringList{}, key);
+
+    quint64 total = 0;
+    for (const auto& run : runs) total += static_cast<quint64>(run.order.size());
+
+    // Ordinals are 16-bit; the paging falls back to selecting ranks directly beyond that
+    if (total == 0 || runs.size() > 0xFFFFu) return nullptr;
+
+    auto cache = std::make_shared<GlobalOrderCache>();
+    cache->epoch = snap.epoch;
+    cache->sortKey = sortKey;
+    for (const auto& run : runs) cache->deviceIds.push_back(*run.deviceId);
+    cache->asc.resize(static_cast<size_t>(total));
+
+    // Split the output into equal rank ranges and merge each one independently. Each range's start
+    // positions come from the same selection the paging uses, so the parts are disjoint and in order.
+    static constexpr quint64 kMergePartMin = 1ULL << 20;
+    const quint64 parts = std::clamp<quint64>(total / kMergePartMin, 1, 64);
+
+    std::vector<std::vector<quint32>> starts(static_cast<size_t>(parts));
+    tbb::parallel_for(size_t(0), static_cast<size_t>(parts), [&](size_t p) {
+        starts[p] = globalRankSplit(runs, key, total * p / parts);
+    });
+
+    std::atomic<bool> aborted{false};
+    tbb::parallel_for(size_t(0), static_cast<size_t>(parts), [&](size_t p) {
+        const quint64 begin = total * p / parts;
+        const quint64 end = total * (p + 1) / parts;
+
+        GlobalOrderEntry* out = cache->asc.data() + begin;
+        const bool ok = mergeOrderRuns(runs, key, std::move(starts[p]), end - begin, cancel,
+                                       [&](quint32 run, quint32 recIdx) {
+                                           *out++ = GlobalOrderEntry{recIdx, static_cast<quint16>(run)};
+                                       });
+        if (!ok) aborted.store(true, std::memory_order_relaxed);
+    });
+
+    if (aborted.load() || cancel.cancelled()) return nullptr;
+
+    // Only publish if the indexes didn't change while we were merging
+    std::lock_guard lock(m_searchCacheMutex);
+    if (uidEpoch(snap.uid) == snap.epoch) {
+        m_globalOrderByUid[snap.uid][sortKey] = cache;
+    }
+    return cache;
+}
+
+QString IndexerService::warmKey(quint32 uid, quint64 epoch, const QString& sortKey) {
+    return QStringLiteral("%1:%2:%3").arg(uid).arg(epoch).arg(sortKey);
+}
+
+// --- End: Empty-query global-order cache ---
+
+// --- Begin: Search session cache ---
+
+size_t IndexerService::SearchSession::bytes() const {
+    size_t n = sizeof(SearchSession) + (ordered ? ordered->hits.capacity() * sizeof(SessionHit) : 0);
+    for (const auto& v : hitsByDevice) n += v.capacity() * sizeof(quint32);
+    return n;
+}
+
+QStringList IndexerService::normalizeSearchTokens(const QStringList& tokens) {
+    QStringList out;
+    out.reserve(tokens.size());
+    for (const QString& t : tokens) {
+        QByteArray b = t.toUtf8();
+        CaseFold::foldUtf8(b.constData(), static_cast<size_t>(b.size()), b.data());
+        out.push_back(QString::fromUtf8(b));
+    }
+
+    // Tokens are AND-ed, so order and duplicates don't matter
+    out.sort();
+    out.removeDuplicates();
+    return out;
+}
+
+QString IndexerService::searchDeviceKey(const QStringList& deviceIds) {
+    QStringList devs = deviceIds;
+    devs.sort();
+    devs.removeDuplicates();
+    return devs.join(QChar(0x1F));
+}
+
+QString IndexerService::searchSessionKey(const QStringList& normTokens, const QString& deviceKey,
+                                         const QString& filterKey) {
+    return normTokens.join(QChar(0x1F)) + QChar(0x1E) + deviceKey + QChar(0x1E) + filterKey;
+}
+
+bool IndexerService::tokensNarrow(const QStringList& prevTokens, const QStringList& normTokens) {
+    // Every hit of the new query must be a hit of the previous one: each previous token has to
+    // occur inside some new token ("rep" -> "report", or "foo" -> "foo bar").
+    for (const QString& prev : prevTokens) {
+        bool covered = false;
+        for (const QString& t : normTokens) {
+            if (t.contains(prev)) {
+                covered = true;
+                break;
+            }
+        }
+        if (!covered) return false;
+    }
+    return true;
+}
+
+std::shared_ptr<const IndexerService::SearchSession> IndexerService::findNarrowableSession(quint32 uid,
+                                                                                       quint64 epoch,
+                                                                                       const QString& deviceKey,
+                                                                                       const QString& filterKey,
+                                                                                       const QStringList& normTokens) const {
+    auto uIt = m_searchSessionsByUid.find(uid);
+    if (uIt == m_searchSessionsByUid.end()) return nullptr;
+
+    // Prefer the narrowest cached parent (usually the previous keystroke)
+    std::shared_ptr<const SearchSession> best;
+    for (const auto& s : uIt->second) {
+        // An unfiltered parent still holds every hit of a filtered query (the filter is applied on refine)
+        if (s->epoch != epoch || s->deviceKey != deviceKey) continue;
+        if (!s->filterKey.isEmpty() && s->filterKey != filterKey) continue;
+        if (!tokensNarrow(s->tokens, normTokens)) continue;
+        if (!best || s->totalHits < best->totalHits) best = s;
+    }
+    return best;
+}
+
+std::shared_ptr<IndexerService::SearchSession> IndexerService::findSearchSession(quint32 uid,
+                                                                               quint64 epoch,
+                                                                               const QString& key) const {
+    auto uIt = m_searchSessionsByUid.find(uid);
+    if (uIt != m_searchSessionsByUid.end()) {
+        auto& sessions = uIt->second;
+        for (auto it = sessions.begin(); it != sessions.end(); ++it) {
+            if ((*it)->key != key || (*it)->epoch != epoch) continue;
+
+            // Move to front (most recently used)
+            sessions.splice(sessions.begin(), sessions, it);
+            sessions.front()->lastUsed = ++m_searchCacheTick;
+            ++m_searchCacheStats.hits;
+            return sessions.front();
+        }
+    }
+
+    ++m_searchCacheStats.misses;
+    return nullptr;
+}
+
+void IndexerService::storeSearchSession(quint32 uid, const std::shared_ptr<SearchSession>& session) const {
+    // The indexes changed while this session was being built
+    if (session->epoch != uidEpoch(uid)) return;
+
+    auto& sessions = m_searchSessionsByUid[uid];
+
+    // Drop stale sessions (older epoch) and any previous one with the same key
+    sessions.remove_if([&](const std::shared_ptr<SearchSession>& s) {
+        return s->epoch != session->epoch || s->key == session->key;
+    });
+
+    session->lastUsed = ++m_searchCacheTick;
+    sessions.push_front(session);
+
+    trimSearchSessions(session.get());
+}
+
+void IndexerService::trimSearchSessions(const SearchSession* keep) const {
+    // Per-uid entry cap (LRU at the back)
+    for (auto& kv : m_searchSessionsByUid) {
+        auto& sessions = kv.second;
+        while (sessions.size() > kSearchSessionsPerUid && sessions.back().get() != keep) {
+            sessions.pop_back();
+            ++m_searchCacheStats.evictions;
+        }
+    }
+
+    // Global byte cap: evict the least recently used session of any uid.
+    // (A search still using an evicted session keeps it alive until it is done.)
+    while (true) {
+        size_t total = 0;
+        std::list<std::shared_ptr<SearchSession>>* lruList = nullptr;
+        std::list<std::shared_ptr<SearchSession>>::iterator lruIt;
+
+        for (auto& kv : m_searchSessionsByUid) {
+            for (auto it = kv.second.begin(); it != kv.second.end(); ++it) {
+                total += (*it)->bytes();
+                if (it->get() == keep) continue;
+                if (!lruList || (*it)->lastUsed < (*lruIt)->lastUsed) {
+                    lruList = &kv.second;
+                    lruIt = it;
+                }
+            }
+        }
+
+        m_searchCacheBytes = total;
+        if (total <= kSearchCacheMaxBytes || !lruList) break;
+
+        lruList->erase(lruIt);
+        ++m_searchCacheStats.evictions;
+    }
+}
+
+void IndexerService::GetSearchCacheStats(QVariantMap& statsOut) const {
+    std::lock_guard lock(m_searchCacheMutex);
+
+    size_t sessions = 0;
+    for (const auto& kv : m_searchSessionsByUid) sessions += kv.second.size();
+
+    statsOut.clear();
+    statsOut.insert(QStringLiteral("hits"), static_cast<qulonglong>(m_searchCacheStats.hits));
+    statsOut.insert(QStringLiteral("misses"), static_cast<qulonglong>(m_searchCacheStats.misses));
+    statsOut.insert(QStringLiteral("evictions"), static_cast<qulonglong>(m_searchCacheStats.evictions));
+    statsOut.insert(QStringLiteral("narrowed"), static_cast<qulonglong>(m_searchCacheStats.narrowed));
+    statsOut.insert(QStringLiteral("cancelled"), static_cast<qulonglong>(m_searchCacheStats.cancelled));
+    statsOut.insert(QStringLiteral("sessions"), static_cast<qulonglong>(sessions));
+    statsOut.insert(QStringLiteral("bytes"), static_cast<qulonglong>(m_searchCacheBytes));
+    statsOut.insert(QStringLiteral("maxBytes"), static_cast<qulonglong>(kSearchCacheMaxBytes));
+}
+
+// --- End: Search session cache ---
+
+// --- Begin: Diagnostics (GetStats) ---
+
+void IndexerService::GetStats(QVariantMap& statsOut) const {
+    const quint32 uid = callerUidOr0();
+    ensureLoadedForUid(uid);
+
+    statsOut.clear();
+
+    QVariantMap cache;
+    GetSearchCacheStats(cache);
+    {
+        const quint64 hits = cache.value(QStringLiteral("hits")).toULongLong();
+        const quint64 lookups = hits + cache.value(QStringLiteral("misses")).toULongLong();
+        cache.insert(QStringLiteral("hitRate"), lookups ? static_cast<double>(hits) / static_cast<double>(lookups) : 0.0);
+    }
+    statsOut.insert(QStringLiteral("searchCache"), cache);
+
+    {
+        std::lock_guard lock(m_searchCacheMutex);
+
+        const SearchStats& st = m_searchStats;
+        QVariantMap search = st.totals.toVariantMap();
+        search.remove(QStringLiteral("path"));
+        search.insert(QStringLiteral("searches"), static_cast<qulonglong>(st.searches));
+        search.insert(QStringLiteral("emptyQueries"), static_cast<qulonglong>(st.emptyQueries));
+        search.insert(QStringLiteral("maxTotalNs"), static_cast<qulonglong>(st.maxTotalNs));
+
+        QVariantList histogram;
+        for (const quint64 n : st.latencyHistogram) histogram.push_back(static_cast<qulonglong>(n));
+        search.insert(QStringLiteral("latencyHistogram"), histogram);
+        statsOut.insert(QStringLiteral("search"), search);
+
+        quint64 entries = 0;
+        quint64 orders = 0;
+        if (auto it = m_globalOrderByUid.find(uid); it != m_globalOrderByUid.end()) {
+            for (const auto& kv : it->second) {
+                if (!kv.second) continue;
+                entries += kv.second->asc.size();
+                ++orders;
+            }
+        }
+
+        QVariantMap globalOrder;
+        globalOrder.insert(QStringLiteral("orders"), static_cast<qulonglong>(orders));
+        globalOrder.insert(QStringLiteral("entries"), static_cast<qulonglong>(entries));
+        globalOrder.insert(QStringLiteral("bytes"), static_cast<qulonglong>(entries * sizeof(GlobalOrderEntry)));
+        statsOut.insert(QStringLiteral("globalOrder"), globalOrder);
+    }
+
+    QVariantList devices;
+    if (auto uidIt = m_indexesByUid.find(uid); uidIt != m_indexesByUid.end()) {
+        for (const auto& kv : uidIt->second) {
+            if (!kv.second) continue;
+
+            QVariantMap d = memoryBreakdownFor(*kv.second);
+            d.insert(QStringLiteral("deviceId"), kv.first);
+            devices.push_back(d);
+        }
+    }
+    statsOut.insert(QStringLiteral("devices"), devices);
+
+    QVariantList scans;
+    for (const ScanTimings& t : m_recentScans) {
+        if (t.uid != uid) continue;
+
+        QVariantMap m;
+        m.insert(QStringLiteral("jobId"), static_cast<qulonglong>(t.jobId));
+        m.insert(QStringLiteral("deviceId"), t.deviceId);
+        m.insert(QStringLiteral("fsType"), t.fsType);
+        m.insert(QStringLiteral("incremental"), t.incremental);
+        m.insert(QStringLiteral("entryCount"), static_cast<qulonglong>(t.entryCount));
+        m.insert(QStringLiteral("finishedTime"), static_cast<qlonglong>(t.finishedTime));
+        m.insert(QStringLiteral("totalUs"), static_cast<qulonglong>(t.totalUs));
+        m.insert(QStringLiteral("helperPhases"), jobPhasesMap(t.helperPhases));
+        m.insert(QStringLiteral("daemonPhases"), jobPhasesMap(t.daemonPhases));
+        scans.push_back(m);
+    }
+    statsOut.insert(QStringLiteral("scans"), scans);
+}
+
+QVariantMap IndexerService::memoryBreakdownFor(const DeviceIndex& idx) {
+    auto bytesOf = [](const auto& array) -> quint64 {
+        return static_cast<quint64>(array.size()) * sizeof(*array.data());
+    };
+
+    const RecordColumns& r = idx.records;
+    const quint64 records = bytesOf(r.parents) + bytesOf(r.sizes) + bytesOf(r.mtimes) + bytesOf(r.nameOffsets) +
+                            bytesOf(r.nameLens) + bytesOf(r.flags);
+    const quint64 orders = bytesOf(idx.orderByName) + bytesOf(idx.orderByPath) + bytesOf(idx.orderBySize) +
+                           bytesOf(idx.orderByMtime);
+    const quint64 ranks = bytesOf(idx.rankByName) + bytesOf(idx.rankByPath) + bytesOf(idx.rankBySize) +
+                          bytesOf(idx.rankByMtime);
+    const quint64 delta = bytesOf(idx.deltaTrigrams) + bytesOf(idx.deadBits);
+    const quint64 caches = idx.dirPaths.byteSize() + idx.childTable.byteSize() + bytesOf(idx.childCountCache);
+
+    const std::pair<const char*, quint64> parts[] = {
+        {"records", records},
+        {"stringPool", bytesOf(idx.stringPool)},
+        {"foldedPool", bytesOf(idx.foldedPool)},
+        {"names", idx.names.byteSize()},
+        {"trigrams", idx.trigrams.byteSize()},
+        {"extensions", idx.extensions.byteSize()},
+        {"orders", orders},
+        {"ranks", ranks},
+        {"nameSignatures", bytesOf(idx.nameSignatures)},
+        {"fileIds", bytesOf(idx.fileIds)},
+        {"delta", delta},
+        {"caches", caches},
+    };
+
+    QVariantMap m;
+    quint64 total = 0;
+    for (const auto& [name, bytes] : parts) {
+        m.insert(QString::fromLatin1(name), static_cast<qulonglong>(bytes));
+        total += bytes;
+    }
+    m.insert(QStringLiteral("bytes"), static_cast<qulonglong>(total));
+    m.insert(QStringLiteral("entryCount"), static_cast<qulonglong>(idx.liveRecordCount()));
+    m.insert(QStringLiteral("mapped"), r.parents.isMapped());
+    return m;
+}
+
+void IndexerService::addJobPhase(JobPhases& phases, const QString& name, std::chrono::steady_clock::duration elapsed) {
+    addJobPhase(phases, name,
+                static_cast<quint64>(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()));
+}
+
+void IndexerService::addJobPhase(JobPhases& phases, const QString& name, quint64 us) {
+    for (auto& [n, total] : phases) {
+        if (n == name) {
+            total += us;
+            return;
+        }
+    }
+    phases.emplace_back(name, us);
+}
+
+QVariantMap IndexerService::jobPhasesMap(const JobPhases& phases) {
+    QVariantMap m;
+    for (const auto& [name, us] : phases) m.insert(name, static_cast<qulonglong>(us));
+    return m;
+}
+
+void IndexerService::recordScanTimings(const Job& j, quint64 entryCount, QVariantMap& props) {
+    ScanTimings t;
+    t.jobId = j.jobId;
+    t.uid = j.ownerUid;
+    t.deviceId = j.deviceId;
+    t.fsType = j.fsType;
+    t.incremental = j.incremental;
+    t.entryCount = entryCount;
+    t.finishedTime = QDateTime::currentSecsSinceEpoch();
+    t.totalUs = static_cast<quint64>(
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - j.started).count());
+    t.helperPhases = j.helperPhases;
+    t.daemonPhases = j.daemonPhases;
+
+    auto describe = [](const JobPhases& phases) {
+        QStringList parts;
+        for (const auto& [name, us] : phases) parts << QStringLiteral("%1=%2ms").arg(name).arg(us / 1000);
+        return parts.join(QLatin1Char(' '));
+    };
+    qInfo().noquote() << QStringLiteral("[index] job %1: %2 ms total; helper: %3; daemon: %4")
+                         .arg(j.jobId).arg(t.totalUs / 1000).arg(describe(t.helperPhases), describe(t.daemonPhases));
+
+    props.insert(QStringLiteral("helperPhases"), jobPhasesMap(t.helperPhases));
+    props.insert(QStringLiteral("daemonPhases"), jobPhasesMap(t.daemonPhases));
+    props.insert(QStringLiteral("totalUs"), static_cast<qulonglong>(t.totalUs));
+
+    m_recentScans.push_back(std::move(t));
+    while (m_recentScans.size() > kRecentScans) m_recentScans.pop_front();
+}
+
+// --- End: Diagnostics (GetStats) ---
+
+// --- Begin: DeviceIndexUpdated batching scaffold ---
+
+void IndexerService::queueDeviceIndexUpdated(quint32 uid,
+                                             const QString& deviceId,
+                                             quint64 generation,
                                              quint64 entryCount) {
     // Correctness: empty-query global cache must be invalidated immediately.
     bumpUidEpoch(uid);
@@ -621,6 +1973,83 @@ void IndexerService::dispatchBatchedIndexUpdates() {
 
 // --- End: DeviceIndexUpdated batching scaffold ---
 
+// --- Begin: Shared device indexes ---
+
+void IndexerService::publishSharedIndex(quint32 uid, const QString& deviceId,
+                                        const std::shared_ptr<DeviceIndex>& idx) const {
+    SharedIndexEntry& entry = m_sharedIndexes[deviceId];
+    if (!entry.index.expired() && entry.indexedTime > idx->lastIndexedTime) return;
+
+    entry.index = idx;
+    entry.indexedTime = idx->lastIndexedTime;
+
+    auto* self = const_cast<IndexerService*>(this);
+    for (auto& [otherUid, devices] : m_indexesByUid) {
+        if (otherUid == uid) continue;
+
+        auto devIt = devices.find(deviceId);
+        if (devIt == devices.end() || devIt->second == idx) continue;
+        if (devIt->second->lastIndexedTime >= idx->lastIndexedTime) continue;
+
+        // A rescan of its own would replace the adopted copy anyway
+        const bool scanning = std::any_of(m_jobs.begin(), m_jobs.end(), [&](const auto& kv) {
+            const Job* j = kv.second.get();
+            return j && j->ownerUid == otherUid && j->deviceId == deviceId && j->proc &&
+                   j->proc->state() != QProcess::NotRunning;
+        });
+        if (scanning) continue;
+
+        std::shared_ptr<DeviceIndex> adopted = adoptSharedIndex(deviceId, *devIt->second);
+        if (!adopted) continue;
+
+        devIt->second = std::move(adopted);
+        qInfo().noquote() << QStringLiteral("[index] uid=%1 device=%2 now shares the scan of uid=%3")
+                             .arg(otherUid).arg(deviceId).arg(uid);
+
+        self->queueDeviceIndexUpdated(otherUid, deviceId,
+                                      static_cast<quint64>(devIt->second->generation),
+                                      static_cast<quint64>(devIt->second->liveRecordCount()));
+
+        // Its own snapshot is older now; the next load then maps the same scan
+        suspendWatchJournal(otherUid, deviceId);
+        enqueueSnapshotUpgrade(otherUid, deviceId);
+    }
+}
+
+std::shared_ptr<IndexerService::DeviceIndex> IndexerService::adoptSharedIndex(const QString& deviceId,
+                                                                              const DeviceIndex& own) const {
+    const auto it = m_sharedIndexes.find(deviceId);
+    if (it == m_sharedIndexes.end()) return nullptr;
+
+    const std::shared_ptr<const DeviceIndex> src = it->second.index.lock();
+    if (!src) {
+        m_sharedIndexes.erase(it);
+        return nullptr;
+    }
+
+    // An equal time is the same scan (adopted before and saved by both uids). Watch updates since
+    // then come from the same device, and each uid's watch keeps applying them to its own view.
+    if (src.get() == &own || src->lastIndexedTime < own.lastIndexedTime) return nullptr;
+
+    std::shared_ptr<DeviceIndex> out = shareDeviceIndex(src);
+
+    // Per-uid state: record ids differ from own's, so the generation moves on (the lookup caches
+    // start empty and are rebuilt on demand instead of being held once per uid)
+    out->generation = std::max(own.generation, src->generation) + 1;
+    out->watchEnabled = own.watchEnabled;
+    return out;
+}
+
+bool IndexerService::sharedFullScanRunning(quint32 uid, const QString& deviceId) const {
+    return std::any_of(m_jobs.begin(), m_jobs.end(), [&](const auto& kv) {
+        const Job* j = kv.second.get();
+        return j && j->ownerUid != uid && j->deviceId == deviceId && !j->incremental && j->proc &&
+               j->proc->state() != QProcess::NotRunning;
+    });
+}
+
+// --- End: Shared device indexes ---
+
 // --- Begin: Persistence helpers ---
 
 quint32 IndexerService::callerUidOr0() const {
@@ -641,11 +2070,11 @@ QString IndexerService::escapeDeviceIdForFilename(const QString& deviceId) {
     return QString::fromLatin1(h.toHex());
 }
 
-QString IndexerService::baseIndexDirForUid(quint32 uid) {
-    return QStringLiteral("/var/lib/kerything/indexes/%1").arg(uid);
+QString IndexerService::baseIndexDirForUid(quint32 uid) const {
+    return QStringLiteral("%1/%2").arg(m_indexRoot).arg(uid);
 }
 
-QString IndexerService::snapshotPathFor(quint32 uid, const QString& deviceId) {
+QString IndexerService::snapshotPathFor(quint32 uid, const QString& deviceId) const {
     const QString base = baseIndexDirForUid(uid);
     const QString name = escapeDeviceIdForFilename(deviceId) + QStringLiteral(".kix");
     return QDir(base).filePath(name);
@@ -698,11 +2127,244 @@ void IndexerService::processOneSnapshotUpgrade() const {
     auto devIt = uidIt->second.find(deviceId);
     if (devIt == uidIt->second.end()) return;
 
+    // Best-effort: failures are only logged. User can still re-index if needed.
+    scheduleSnapshotWrite(uid, deviceId, devIt->second);
+}
+
+// --- Begin: Snapshot persistence ---
+
+QString IndexerService::journalPathFor(quint32 uid, const QString& deviceId, quint64 token) const {
+    const QString name = escapeDeviceIdForFilename(deviceId) + QStringLiteral(".") +
+                         QString::number(token, 16).rightJustified(16, QChar('0')) + QStringLiteral(".kwj");
+    return QDir(baseIndexDirForUid(uid)).filePath(name);
+}
+
+void IndexerService::removeWatchJournals(quint32 uid, const QString& deviceId, const std::vector<quint64>& keep) const {
+    QDir dir(baseIndexDirForUid(uid));
+    const QString pattern = escapeDeviceIdForFilename(deviceId) + QStringLiteral(".*.kwj");
+
+    QStringList kept;
+    for (const quint64 token : keep) {
+        if (token) kept << QFileInfo(journalPathFor(uid, deviceId, token)).fileName();
+    }
+
+    for (const QString& fn : dir.entryList(QStringList() << pattern, QDir::Files)) {
+        if (!kept.contains(fn)) dir.remove(fn);
+    }
+}
+
+void IndexerService::scheduleSnapshotWrite(quint32 uid, const QString& deviceId, std::shared_ptr<const DeviceIndex> idx,
+                                           SnapshotWriteDone done) const {
+    if (idx->hasDelta()) {
+        // Snapshots are written compacted, and the compaction writes one once it is installed (done
+        // waits for that write). The delta itself is in the journal already (unless suspended).
+        const_cast<IndexerService*>(this)->startDeltaCompaction(uid, deviceId, std::move(done));
+        return;
+    }
+
+    // Written (and maybe queued) off the main thread: any further change clones it first
+    idx = pinDeviceIndex(std::move(idx));
+
+    SnapshotPersistState& st = m_persistStates[watchKey(uid, deviceId)];
+    st.uid = uid;
+    st.deviceId = deviceId;
+    st.forgotten = false;
+
+    // Replaces a queued write that never started; nothing will ever match its journal
+    if (st.writing && st.queued) {
+        QFile::remove(journalPathFor(uid, deviceId, st.queuedToken));
+        if (st.journalToken == st.queuedToken) {
+            st.journalToken = st.fallbackTokens.empty() ? 0 : st.fallbackTokens.back();
+            if (!st.fallbackTokens.empty()) st.fallbackTokens.pop_back();
+        }
+    }
+
+    // Batches applied from here on extend this version, so its journal starts now (0 = no journal).
+    // The current one keeps getting them until this write is on disk (see finishSnapshotWrite).
+    const quint64 token = QRandomGenerator::global()->generate64() | 1u;
+
+    QDir().mkpath(baseIndexDirForUid(uid));
+    QString journalErr;
+    if (WatchJournal::create(journalPathFor(uid, deviceId, token), token, &journalErr)) {
+        if (st.journalToken) st.fallbackTokens.push_back(st.journalToken);
+        st.journalToken = token;
+    } else {
+        st.journalToken = 0;
+        st.fallbackTokens.clear();
+        qWarning().noquote() << QStringLiteral("[snapshot] uid=%1 device=%2 watch journal unavailable: %3")
+                                .arg(uid).arg(deviceId, journalErr);
+    }
+
+    if (!st.writing) {
+        std::vector<SnapshotWriteDone> dones;
+        if (done) dones.push_back(std::move(done));
+        startSnapshotWrite(uid, deviceId, std::move(idx), token, std::move(dones));
+        return;
+    }
+
+    st.queued = std::move(idx);
+    st.queuedToken = token;
+    if (done) st.queuedDone.push_back(std::move(done));
+}
+
+void IndexerService::startSnapshotWrite(quint32 uid, const QString& deviceId, std::shared_ptr<const DeviceIndex> idx,
+                                        quint64 token, std::vector<SnapshotWriteDone> done) const {
+    m_persistStates[watchKey(uid, deviceId)].writing = true;
+
+    auto* self = const_cast<IndexerService*>(this);
+    m_snapshotPool->start([self, uid, deviceId, idx = std::move(idx), token, done = std::move(done)]() {
+        QString err;
+        const bool ok = self->saveSnapshot(uid, deviceId, *idx, token, &err);
+
+        QMetaObject::invokeMethod(self, [self, uid, deviceId, token, ok, err, done]() {
+            self->finishSnapshotWrite(uid, deviceId, token, ok, err, done);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void IndexerService::finishSnapshotWrite(quint32 uid, const QString& deviceId, quint64 token, bool ok,
+                                         const QString& error, std::vector<SnapshotWriteDone> done) const {
+    const QString key = watchKey(uid, deviceId);
+    SnapshotPersistState& st = m_persistStates[key];
+    st.writing = false;
+
+    if (st.forgotten) {
+        QFile::remove(snapshotPathFor(uid, deviceId));
+        removeWatchJournals(uid, deviceId);
+        m_persistStates.erase(key);
+
+        for (const SnapshotWriteDone& d : done) d(false, QStringLiteral("The index was removed."));
+        return;
+    }
+
+    std::vector<quint64>& fallback = st.fallbackTokens;
+    const auto written = std::find(fallback.begin(), fallback.end(), token);
+
+    if (ok) {
+        // Older journals extend older snapshots; keep the current one (it may belong to a queued write)
+        // and this one while a queued write may still fail back to it
+        if (token == st.journalToken) {
+            fallback.clear();
+        } else if (written != fallback.end()) {
+            fallback.erase(fallback.begin(), written);
+        }
+
+        std::vector<quint64> keep = fallback;
+        keep.push_back(token);
+        keep.push_back(st.journalToken);
+        removeWatchJournals(uid, deviceId, keep);
+    } else {
+        // The previous snapshot stays in place, and its journal (which got every batch since) takes
+        // over again; without one, batches from here on are only kept until the next snapshot
+        QFile::remove(journalPathFor(uid, deviceId, token));
+        if (token == st.journalToken) {
+            st.journalToken = fallback.empty() ? 0 : fallback.back();
+            if (!fallback.empty()) fallback.pop_back();
+        } else if (written != fallback.end()) {
+            fallback.erase(written);
+        }
+
+        qWarning().noquote() << QStringLiteral("[snapshot] write failed uid=%1 device=%2: %3%4")
+                                .arg(uid).arg(deviceId, error,
+                                     st.journalToken ? QString() : QStringLiteral(" (watch updates not journaled)"));
+    }
+
+    if (st.queued) {
+        std::shared_ptr<const DeviceIndex> next = std::move(st.queued);
+        std::vector<SnapshotWriteDone> nextDone = std::move(st.queuedDone);
+        const quint64 nextToken = st.queuedToken;
+        st.queued.reset();
+        st.queuedDone.clear();
+        st.queuedToken = 0;
+        startSnapshotWrite(uid, deviceId, std::move(next), nextToken, std::move(nextDone));
+    }
+
+    for (const SnapshotWriteDone& d : done) d(ok, error);
+}
+
+void IndexerService::suspendWatchJournal(quint32 uid, const QString& deviceId) const {
+    const auto it = m_persistStates.find(watchKey(uid, deviceId));
+    if (it == m_persistStates.end()) return;
+    it->second.journalToken = 0;
+    it->second.fallbackTokens.clear();
+}
+
+bool IndexerService::appendWatchJournal(quint32 uid, const QString& deviceId, const WatchJournal::Batch& batch) const {
+    const auto it = m_persistStates.find(watchKey(uid, deviceId));
+    if (it == m_persistStates.end() || it->second.journalToken == 0) return false;
+
+    SnapshotPersistState& st = it->second;
+
     QString err;
-    (void)saveSnapshot(uid, deviceId, devIt->second, &err);
-    // Best-effort: ignore failures here. User can still re-index if needed.
+    if (!WatchJournal::append(journalPathFor(uid, deviceId, st.journalToken), batch, &err)) {
+        // A gap would misplace every later batch; persist again with the next snapshot
+        qWarning().noquote() << QStringLiteral("[snapshot] uid=%1 device=%2 watch journal append failed: %3")
+                                .arg(uid).arg(deviceId, err);
+        st.journalToken = 0;
+        st.fallbackTokens.clear();
+        return false;
+    }
+
+    // Journals of older snapshots, in case the pending write fails. One with a gap (and everything
+    // older) can't take over again.
+    for (size_t i = st.fallbackTokens.size(); i-- > 0;) {
+        if (WatchJournal::append(journalPathFor(uid, deviceId, st.fallbackTokens[i]), batch, &err)) continue;
+
+        qWarning().noquote() << QStringLiteral("[snapshot] uid=%1 device=%2 watch journal append failed: %3")
+                                .arg(uid).arg(deviceId, err);
+        st.fallbackTokens.erase(st.fallbackTokens.begin(), st.fallbackTokens.begin() + static_cast<std::ptrdiff_t>(i) + 1);
+        break;
+    }
+    return true;
+}
+
+size_t IndexerService::replayWatchJournal(DeviceIndex& idx, const std::vector<WatchJournal::Batch>& batches) {
+    size_t applied = 0;
+
+    for (const WatchJournal::Batch& batch : batches) {
+        std::vector<quint32> added;
+        std::vector<quint32> moved;
+        bool removedAny = false;
+        bool valid = true;
+
+        // Same operations, in the same order, as applyIncrementalBatchIfSafe (so ids line up)
+        for (const WatchJournal::Op& op : batch) {
+            const size_t n = idx.records.size();
+
+            switch (op.kind) {
+                case WatchJournal::OpKind::SetStats:
+                    if (op.recIdx >= n) { valid = false; break; }
+                    idx.records.setStats(op.recIdx, op.size, op.mtime, op.isDir, op.isSymlink);
+                    moved.push_back(op.recIdx);
+                    break;
+                case WatchJournal::OpKind::Append:
+                    if (op.parentDirId != DirPathResolver::kRootDirId && op.parentDirId >= n) { valid = false; break; }
+                    added.push_back(appendDeltaRecord(idx, op.parentDirId, op.name, op.size, op.mtime,
+                                                      op.isDir, op.isSymlink, op.fileId));
+                    break;
+                case WatchJournal::OpKind::Remove:
+                    if (op.recIdx >= n || idx.isDead(op.recIdx)) { valid = false; break; }
+                    markDeadRecord(idx, op.recIdx);
+                    removedAny = true;
+                    break;
+                case WatchJournal::OpKind::SetWatchEnabled:
+                    idx.watchEnabled = op.enabled;
+                    break;
+            }
+            if (!valid) break;
+        }
+
+        if (!added.empty() || !moved.empty() || removedAny) {
+            applyDeltaToOrders(idx, std::move(added), std::move(moved), removedAny);
+        }
+        if (!valid) break;
+        ++applied;
+    }
+    return applied;
 }
 
+// --- End: Snapshot persistence ---
+
 void IndexerService::loadSnapshotsForUid(quint32 uid) const {
     const QString dirPath = baseIndexDirForUid(uid);
     QDir dir(dirPath);
@@ -732,7 +2394,9 @@ void IndexerService::loadSnapshotsForUid(quint32 uid) const {
 
         QString deviceId;
         QString err;
-        auto idxOpt = loadSnapshotFile(fullPath, &deviceId, &err);
+        quint32 fileVersion = 0;
+        quint64 snapshotToken = 0;
+        auto idxOpt = loadSnapshotFile(fullPath, &deviceId, &err, &fileVersion, &snapshotToken);
         if (!idxOpt) {
             // Ignore bad/corrupt files for now (can log later)
             ++loadedCount;
@@ -744,150 +2408,631 @@ void IndexerService::loadSnapshotsForUid(quint32 uid) const {
         }
 
         DeviceIndex idx = std::move(*idxOpt);
-        idx.dirPathCache.clear();
+        idx.dirPaths.clear();
 
         // v4 snapshots include acceleration structures; older versions need rebuild.
         const bool hasAccel =
-            !idx.flatIndex.empty() &&
+            !idx.trigrams.empty() &&
             !idx.orderByName.empty() && !idx.orderByPath.empty() && !idx.orderBySize.empty() && !idx.orderByMtime.empty() &&
             !idx.rankByName.empty()  && !idx.rankByPath.empty()  && !idx.rankBySize.empty()  && !idx.rankByMtime.empty();
 
         if (!hasAccel) {
             buildTrigramIndex(idx);
             buildSortOrders(idx);
+        } else if (fileVersion < 9) {
+            // Pre-v9 path order was (parentRecordIdx, name)
+            buildPathOrder(idx);
+        }
+
+        // Pre-v14 trigram postings are record ids: intern the names and rebuild them over name ids
+        if (hasAccel && idx.names.recordCount != idx.records.size()) {
+            buildTrigramIndex(idx);
         }
 
-        m_indexesByUid[uid][deviceId] = std::move(idx);
+        if (idx.extensions.recordCount != idx.deltaBegin()) {
+            buildExtensionIndex(idx);
+        }
+        if (idx.nameSignatures.size() != idx.names.nameCount()) {
+            buildNameSignatures(idx);
+        }
+
+        // Watch batches applied since the snapshot was written (v15+)
+        bool journalBroken = false;
+        if (snapshotToken != 0) {
+            const QString journalPath = journalPathFor(uid, deviceId, snapshotToken);
+            std::vector<WatchJournal::Batch> batches;
+            QString journalErr;
+            if (WatchJournal::read(journalPath, snapshotToken, batches, &journalErr)) {
+                const size_t replayed = replayWatchJournal(idx, batches);
+                journalBroken = replayed != batches.size();
+                if (!batches.empty()) {
+                    qInfo().noquote() << QStringLiteral("[snapshot] uid=%1 device=%2 replayed %3 of %4 journaled watch batches")
+                                         .arg(uid).arg(deviceId).arg(replayed).arg(batches.size());
+                }
+            } else {
+                // None yet (or unreadable): start an empty one
+                journalBroken = !WatchJournal::create(journalPath, snapshotToken, &journalErr);
+            }
+            if (journalBroken) snapshotToken = 0;
+        }
+        removeWatchJournals(uid, deviceId, {snapshotToken});
+
+        SnapshotPersistState& persist = m_persistStates[watchKey(uid, deviceId)];
+        persist.uid = uid;
+        persist.deviceId = deviceId;
+        persist.journalToken = snapshotToken;
+
+        // Another uid may already hold this scan (or a newer one) of the device: share it
+        auto loaded = std::make_shared<DeviceIndex>(std::move(idx));
+        if (auto adopted = adoptSharedIndex(deviceId, *loaded)) {
+            loaded = std::move(adopted);
+            persist.journalToken = 0; // our journal extends our own snapshot only
+        } else {
+            publishSharedIndex(uid, deviceId, loaded);
+        }
+        const bool replayedDelta = loaded->hasDelta();
+        m_indexesByUid[uid][deviceId] = std::move(loaded);
+
+        // If it was old, upgrade it to the latest snapshot format in the background (best-effort).
+        if (!hasAccel || fileVersion < kSnapshotVersion || journalBroken) {
+            enqueueSnapshotUpgrade(uid, deviceId);
+        } else if (replayedDelta) {
+            // Fold the replayed batches into a fresh snapshot once the device is quiet
+            self->scheduleDeltaCompaction(uid, deviceId);
+        }
+
+        ++loadedCount;
+
+        // Progress update (kept simple: one per file)
+        QVariantMap props;
+        props.insert(QStringLiteral("loaded"), loadedCount);
+        props.insert(QStringLiteral("total"), totalFiles);
+        Q_EMIT self->DaemonStateChanged(uid, QStringLiteral("loadingSnapshots"), props);
+    }
+
+    // Notify ready
+    {
+        QVariantMap props;
+        Q_EMIT self->DaemonStateChanged(uid, QStringLiteral("ready"), props);
+    }
+
+    // After loading, ensure watchers are armed (or marked notMounted) for this uid.
+    if (m_watchMgr) {
+        const_cast<WatchManager*>(m_watchMgr.get())->refreshWatchesForUid(uid);
+    }
+}
+
+/**
+ * Cheap 64-bit checksum over a byte range (not cryptographic).
+ * Only meant to catch torn writes and bit rot in snapshot files.
+ */
+static quint64 snapshotChecksum(const char* data, size_t n) {
+    static constexpr quint64 kMul = 0x100000001B3ULL;
+
+    quint64 h = 0x9E3779B97F4A7C15ULL ^ static_cast<quint64>(n);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        quint64 w = 0;
+        std::memcpy(&w, data + i, sizeof(w));
+        h = (h ^ w) * kMul;
+        h ^= h >> 29;
+    }
+    for (; i < n; ++i) {
+        h = (h ^ static_cast<unsigned char>(data[i])) * kMul;
+    }
+    return h ^ (h >> 32);
+}
+
+static quint64 alignToSnapshotPage(quint64 v) {
+    return (v + (kSnapshotPageSize - 1)) & ~static_cast<quint64>(kSnapshotPageSize - 1);
+}
+
+// Full section checksum verification on load is opt-in, since it faults in the whole file.
+static bool snapshotVerifyEnabled() {
+    const QByteArray v = qgetenv("KERYTHING_SNAPSHOT_VERIFY").trimmed().toLower();
+    return v == "1" || v == "true" || v == "yes" || v == "on";
+}
+
+bool IndexerService::saveSnapshot(quint32 uid, const QString& deviceId, const DeviceIndex& idx, quint64 snapshotToken,
+                                  QString* errorOut) const {
+    // Snapshots never carry a watch delta: persist the folded form (the live index is compacted in the background)
+    if (idx.hasDelta()) {
+        return saveSnapshot(uid, deviceId, *compactDeviceIndex(idx), snapshotToken, errorOut);
+    }
+
+    const QString dirPath = baseIndexDirForUid(uid);
+    QDir().mkpath(dirPath);
+
+    const QString path = snapshotPathFor(uid, deviceId);
+
+    QSaveFile f(path);
+    if (!f.open(QIODevice::WriteOnly)) {
+        if (errorOut) *errorOut = QStringLiteral("Failed to open snapshot for writing: %1").arg(path);
+        return false;
+    }
+
+    // Metadata block (small, QDataStream-encoded)
+    QByteArray meta;
+    {
+        QDataStream m(&meta, QIODevice::WriteOnly);
+        m.setByteOrder(QDataStream::LittleEndian);
+
+        auto writeBytes = [&](const QByteArray& b) {
+            m << static_cast<quint32>(b.size());
+            if (b.size() > 0) m.writeRawData(b.constData(), b.size());
+        };
+
+        writeBytes(deviceId.toUtf8());
+        writeBytes(idx.fsType.toUtf8());
+        writeBytes(idx.labelLastKnown.toUtf8());
+        writeBytes(idx.uuidLastKnown.toUtf8());
+        m << static_cast<quint64>(idx.generation);
+        m << static_cast<qint64>(idx.lastIndexedTime);
+        m << static_cast<quint8>(idx.watchEnabled ? 1 : 0);
+        m << static_cast<quint64>(idx.journal.journalId);
+        m << static_cast<quint64>(idx.journal.nextUsn);
+        m << static_cast<quint64>(idx.journal.journalFileId);
+        m << static_cast<quint64>(snapshotToken);
+    }
+
+    struct PendingSection {
+        SnapshotSection id;
+        quint32 elemSize;
+        const char* data;
+        quint64 count;
+    };
+
+    auto section = [](SnapshotSection id, const auto& arr) {
+        using Elem = std::remove_cvref_t<decltype(arr[0])>;
+        return PendingSection{id, static_cast<quint32>(sizeof(Elem)), reinterpret_cast<const char*>(arr.data()),
+                              static_cast<quint64>(arr.size())};
+    };
+
+    const std::vector<PendingSection> sections = {
+        section(SnapshotSection::RecordParents, idx.records.parents),
+        section(SnapshotSection::RecordSizes, idx.records.sizes),
+        section(SnapshotSection::RecordMtimes, idx.records.mtimes),
+        section(SnapshotSection::RecordNameOffsets, idx.records.nameOffsets),
+        section(SnapshotSection::RecordNameLens, idx.records.nameLens),
+        section(SnapshotSection::RecordFlags, idx.records.flags),
+        section(SnapshotSection::StringPool, idx.stringPool),
+        section(SnapshotSection::FoldedPool, idx.foldedPool),
+        section(SnapshotSection::TrigramBuckets, idx.trigrams.buckets),
+        section(SnapshotSection::TrigramDirectory, idx.trigrams.directory),
+        section(SnapshotSection::TrigramSkips, idx.trigrams.skips),
+        section(SnapshotSection::TrigramData, idx.trigrams.data),
+        section(SnapshotSection::OrderByName, idx.orderByName),
+        section(SnapshotSection::OrderByPath, idx.orderByPath),
+        section(SnapshotSection::OrderBySize, idx.orderBySize),
+        section(SnapshotSection::OrderByMtime, idx.orderByMtime),
+        section(SnapshotSection::RankByName, idx.rankByName),
+        section(SnapshotSection::RankByPath, idx.rankByPath),
+        section(SnapshotSection::RankBySize, idx.rankBySize),
+        section(SnapshotSection::RankByMtime, idx.rankByMtime),
+        section(SnapshotSection::FileIds, idx.fileIds),
+        section(SnapshotSection::ExtensionNames, idx.extensions.names),
+        section(SnapshotSection::ExtensionEntries, idx.extensions.entries),
+        section(SnapshotSection::ExtensionPostings, idx.extensions.postings),
+        section(SnapshotSection::NameSignatures, idx.nameSignatures),
+        section(SnapshotSection::NameOffsets, idx.names.nameOffsets),
+        section(SnapshotSection::NameLens, idx.names.nameLens),
+        section(SnapshotSection::NameRecordFirst, idx.names.recordFirst),
+        section(SnapshotSection::NameRecordIds, idx.names.recordIds),
+    };
+
+    // Lay out page-aligned sections after the header + section table
+    std::vector<SnapshotSectionEntry> table;
+    table.reserve(sections.size());
+
+    const quint64 headerBytes = sizeof(SnapshotFileHeader) + static_cast<quint64>(meta.size()) +
+                                sections.size() * sizeof(SnapshotSectionEntry);
+    quint64 cursor = alignToSnapshotPage(headerBytes);
+
+    for (const auto& sec : sections) {
+        SnapshotSectionEntry e{};
+        e.id = static_cast<quint32>(sec.id);
+        e.elemSize = sec.elemSize;
+        e.offset = cursor;
+        e.count = sec.count;
+        e.checksum = snapshotChecksum(sec.data, static_cast<size_t>(sec.count * sec.elemSize));
+        table.push_back(e);
+
+        cursor = alignToSnapshotPage(cursor + sec.count * sec.elemSize);
+    }
+
+    SnapshotFileHeader hdr{};
+    hdr.magic = kSnapshotMagic;
+    hdr.version = kSnapshotVersion;
+    hdr.metaBytes = static_cast<quint32>(meta.size());
+    hdr.sectionCount = static_cast<quint32>(table.size());
+    {
+        QByteArray covered = meta;
+        covered.append(reinterpret_cast<const char*>(table.data()),
+                       static_cast<qsizetype>(table.size() * sizeof(SnapshotSectionEntry)));
+        hdr.headerChecksum = snapshotChecksum(covered.constData(), static_cast<size_t>(covered.size()));
+    }
+
+    QDataStream s(&f);
+    s.setByteOrder(QDataStream::LittleEndian);
+
+    quint64 written = 0;
+    auto writeRaw = [&](const char* data, quint64 n) {
+        // QDataStream::writeRawData takes an int-sized length on some Qt builds; write in chunks.
+        static constexpr quint64 kChunk = 256ULL * 1024 * 1024;
+        while (n > 0) {
+            const quint64 part = std::min(n, kChunk);
+            s.writeRawData(data, static_cast<qint64>(part));
+            data += part;
+            n -= part;
+            written += part;
+        }
+    };
+
+    const std::vector<char> zeros(kSnapshotPageSize, 0);
+    auto padTo = [&](quint64 target) {
+        while (written < target) {
+            writeRaw(zeros.data(), std::min<quint64>(target - written, zeros.size()));
+        }
+    };
+
+    writeRaw(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+    writeRaw(meta.constData(), static_cast<quint64>(meta.size()));
+    writeRaw(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(SnapshotSectionEntry));
+
+    for (size_t i = 0; i < sections.size(); ++i) {
+        padTo(table[i].offset);
+        writeRaw(sections[i].data, sections[i].count * sections[i].elemSize);
+    }
+    padTo(alignToSnapshotPage(written));
+
+    if (s.status() != QDataStream::Ok) {
+        if (errorOut) *errorOut = QStringLiteral("Failed while writing snapshot stream.");
+        return false;
+    }
+
+    if (!f.commit()) {
+        if (errorOut) *errorOut = QStringLiteral("Failed to commit snapshot atomically.");
+        return false;
+    }
+
+    return true;
+}
+
+std::optional<IndexerService::DeviceIndex> IndexerService::loadSnapshotFile(const QString& path,
+                                                                            QString* deviceIdOut,
+                                                                            QString* errorOut,
+                                                                            quint32* versionOut,
+                                                                            quint64* tokenOut) const {
+    // Peek at the common prefix (magic + version) to pick the loader
+    quint32 ver = 0;
+    {
+        QFile f(path);
+        if (!f.open(QIODevice::ReadOnly)) {
+            if (errorOut) *errorOut = QStringLiteral("Failed to open snapshot: %1").arg(path);
+            return std::nullopt;
+        }
+
+        QDataStream s(&f);
+        s.setByteOrder(QDataStream::LittleEndian);
+
+        quint64 magic = 0;
+        s >> magic >> ver;
+
+        if (magic != kSnapshotMagic || ver < 1 || ver > kSnapshotVersion) {
+            if (errorOut) *errorOut = QStringLiteral("Snapshot header/version mismatch.");
+            return std::nullopt;
+        }
+    }
+
+    if (versionOut) *versionOut = ver;
+
+    if (tokenOut) *tokenOut = 0;
+    if (ver >= 6) {
+        return loadMappedSnapshotFile(path, deviceIdOut, errorOut, tokenOut);
+    }
+    return loadLegacySnapshotFile(path, deviceIdOut, errorOut);
+}
+
+std::optional<IndexerService::DeviceIndex> IndexerService::loadMappedSnapshotFile(const QString& path,
+                                                                                  QString* deviceIdOut,
+                                                                                  QString* errorOut,
+                                                                                  quint64* tokenOut) const {
+    const QByteArray pathBytes = QFile::encodeName(path);
+    const int fd = ::open(pathBytes.constData(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (errorOut) *errorOut = QStringLiteral("Failed to open snapshot: %1").arg(path);
+        return std::nullopt;
+    }
+
+    struct stat st {};
+    if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(SnapshotFileHeader))) {
+        ::close(fd);
+        if (errorOut) *errorOut = QStringLiteral("Truncated snapshot (header).");
+        return std::nullopt;
+    }
+
+    const size_t fileSize = static_cast<size_t>(st.st_size);
+    void* base = ::mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps the file alive (also across QSaveFile's atomic rename)
+
+    if (base == MAP_FAILED) {
+        if (errorOut) *errorOut = QStringLiteral("Failed to mmap snapshot: %1").arg(QString::fromLocal8Bit(std::strerror(errno)));
+        return std::nullopt;
+    }
 
-        // If it was old, upgrade it to the latest snapshot format in the background (best-effort).
-        if (!hasAccel) {
-            enqueueSnapshotUpgrade(uid, deviceId);
-        }
+    // Shared by every section view; unmapped once the last view is dropped.
+    const std::shared_ptr<const void> mapping(base, [fileSize](const void* p) {
+        ::munmap(const_cast<void*>(p), fileSize);
+    });
 
-        ++loadedCount;
+    const char* bytes = static_cast<const char*>(base);
 
-        // Progress update (kept simple: one per file)
-        QVariantMap props;
-        props.insert(QStringLiteral("loaded"), loadedCount);
-        props.insert(QStringLiteral("total"), totalFiles);
-        Q_EMIT self->DaemonStateChanged(uid, QStringLiteral("loadingSnapshots"), props);
+    SnapshotFileHeader hdr{};
+    std::memcpy(&hdr, bytes, sizeof(hdr));
+
+    static constexpr quint32 kMaxSections = 256;
+    if (hdr.magic != kSnapshotMagic || hdr.sectionCount > kMaxSections || hdr.metaBytes > 64u * 1024u) {
+        if (errorOut) *errorOut = QStringLiteral("Corrupt snapshot header.");
+        return std::nullopt;
     }
 
-    // Notify ready
-    {
-        QVariantMap props;
-        Q_EMIT self->DaemonStateChanged(uid, QStringLiteral("ready"), props);
+    const quint64 tableOffset = sizeof(SnapshotFileHeader) + hdr.metaBytes;
+    const quint64 headerEnd = tableOffset + static_cast<quint64>(hdr.sectionCount) * sizeof(SnapshotSectionEntry);
+    if (headerEnd > fileSize) {
+        if (errorOut) *errorOut = QStringLiteral("Truncated snapshot (section table).");
+        return std::nullopt;
     }
 
-    // After loading, ensure watchers are armed (or marked notMounted) for this uid.
-    if (m_watchMgr) {
-        const_cast<WatchManager*>(m_watchMgr.get())->refreshWatchesForUid(uid);
+    if (snapshotChecksum(bytes + sizeof(SnapshotFileHeader), static_cast<size_t>(headerEnd - sizeof(SnapshotFileHeader))) != hdr.headerChecksum) {
+        if (errorOut) *errorOut = QStringLiteral("Corrupt snapshot: header checksum mismatch.");
+        return std::nullopt;
     }
-}
 
-bool IndexerService::saveSnapshot(quint32 uid, const QString& deviceId, const DeviceIndex& idx, QString* errorOut) const {
-    const QString dirPath = baseIndexDirForUid(uid);
-    QDir().mkpath(dirPath);
+    // Metadata
+    DeviceIndex idx;
+    QString deviceId;
+    {
+        const QByteArray meta = QByteArray::fromRawData(bytes + sizeof(SnapshotFileHeader), hdr.metaBytes);
+        QDataStream m(meta);
+        m.setByteOrder(QDataStream::LittleEndian);
 
-    const QString path = snapshotPathFor(uid, deviceId);
+        auto readBytes = [&](quint32 maxBytes, QByteArray& out) -> bool {
+            quint32 n = 0;
+            m >> n;
+            if (n == 0) { out.clear(); return true; }
+            if (n > maxBytes) return false;
+            out.resize(static_cast<int>(n));
+            return m.readRawData(out.data(), static_cast<int>(n)) == static_cast<int>(n);
+        };
 
-    QSaveFile f(path);
-    if (!f.open(QIODevice::WriteOnly)) {
-        if (errorOut) *errorOut = QStringLiteral("Failed to open snapshot for writing: %1").arg(path);
-        return false;
-    }
+        QByteArray devIdBytes, fsTypeBytes, labelBytes, uuidBytes;
+        if (!readBytes(4096, devIdBytes) || !readBytes(256, fsTypeBytes) ||
+            !readBytes(4096, labelBytes) || !readBytes(4096, uuidBytes)) {
+            if (errorOut) *errorOut = QStringLiteral("Corrupt snapshot metadata.");
+            return std::nullopt;
+        }
 
-    QDataStream s(&f);
-    s.setByteOrder(QDataStream::LittleEndian);
+        quint64 generation = 0;
+        qint64 lastIndexedTime = 0;
+        quint8 watchEnabled = 1;
+        m >> generation >> lastIndexedTime >> watchEnabled;
+
+        quint64 journalId = 0;
+        quint64 nextUsn = 0;
+        quint64 journalFileId = 0;
+        if (hdr.version >= 10) {
+            m >> journalId >> nextUsn >> journalFileId;
+        }
 
-    s << static_cast<quint64>(kSnapshotMagic);
-    s << static_cast<quint32>(kSnapshotVersion);
+        quint64 snapshotToken = 0;
+        if (hdr.version >= 15) {
+            m >> snapshotToken;
+        }
 
-    const QByteArray devIdBytes = deviceId.toUtf8();
-    const QByteArray fsTypeBytes = idx.fsType.toUtf8();
+        if (m.status() != QDataStream::Ok) {
+            if (errorOut) *errorOut = QStringLiteral("Corrupt snapshot metadata.");
+            return std::nullopt;
+        }
 
-    s << static_cast<quint32>(devIdBytes.size());
-    if (devIdBytes.size() > 0) s.writeRawData(devIdBytes.constData(), devIdBytes.size());
+        deviceId = QString::fromUtf8(devIdBytes);
+        idx.fsType = QString::fromUtf8(fsTypeBytes);
+        idx.labelLastKnown = QString::fromUtf8(labelBytes);
+        idx.uuidLastKnown = QString::fromUtf8(uuidBytes);
+        idx.generation = generation;
+        idx.lastIndexedTime = lastIndexedTime;
+        idx.watchEnabled = (watchEnabled != 0);
+        idx.journal.journalId = journalId;
+        idx.journal.nextUsn = nextUsn;
+        idx.journal.journalFileId = journalFileId;
+        if (tokenOut) *tokenOut = snapshotToken;
+    }
 
-    s << static_cast<quint32>(fsTypeBytes.size());
-    if (fsTypeBytes.size() > 0) s.writeRawData(fsTypeBytes.constData(), fsTypeBytes.size());
+    const bool verify = snapshotVerifyEnabled();
 
-    // v3+: labelLastKnown + uuidLastKnown (UTF-8 blobs)
-    const QByteArray labelBytes = idx.labelLastKnown.toUtf8();
-    const QByteArray uuidBytes  = idx.uuidLastKnown.toUtf8();
+    // Sections
+    quint64 recordCount = 0;
+    MappedArray<ScannerEngine::TrigramEntry> legacyFlat;
+    MappedArray<ScannerEngine::FileRecord> legacyRecords;
+    bool sawExtensions = false;
+    bool sawNames = false;
+    quint64 poolSize = 0;
 
-    s << static_cast<quint32>(labelBytes.size());
-    if (labelBytes.size() > 0) s.writeRawData(labelBytes.constData(), labelBytes.size());
+    for (quint32 i = 0; i < hdr.sectionCount; ++i) {
+        SnapshotSectionEntry e{};
+        std::memcpy(&e, bytes + tableOffset + i * sizeof(SnapshotSectionEntry), sizeof(e));
 
-    s << static_cast<quint32>(uuidBytes.size());
-    if (uuidBytes.size() > 0) s.writeRawData(uuidBytes.constData(), uuidBytes.size());
+        const quint64 len = e.count * static_cast<quint64>(e.elemSize);
+        if (e.elemSize == 0 || (e.count != 0 && len / e.count != e.elemSize) ||
+            (e.offset % kSnapshotPageSize) != 0 || e.offset < headerEnd || e.offset > fileSize || len > fileSize - e.offset) {
+            if (errorOut) *errorOut = QStringLiteral("Corrupt snapshot: section %1 out of bounds.").arg(e.id);
+            return std::nullopt;
+        }
 
-    s << static_cast<quint64>(idx.generation);
+        if (verify && snapshotChecksum(bytes + e.offset, static_cast<size_t>(len)) != e.checksum) {
+            if (errorOut) *errorOut = QStringLiteral("Corrupt snapshot: section %1 checksum mismatch.").arg(e.id);
+            return std::nullopt;
+        }
 
-    // v2+: lastIndexedTime (unix seconds)
-    s << static_cast<qint64>(idx.lastIndexedTime);
+        auto bind = [&](auto& arr) -> bool {
+            using Elem = std::remove_cvref_t<decltype(arr[0])>;
+            if (e.elemSize != sizeof(Elem)) return false;
+            arr = std::remove_cvref_t<decltype(arr)>::view(reinterpret_cast<const Elem*>(bytes + e.offset),
+                                                          static_cast<size_t>(e.count), mapping);
+            return true;
+        };
 
-    // v5+: watchEnabled (u8)
-    s << static_cast<quint8>(idx.watchEnabled ? 1 : 0);
+        bool ok = true;
+        switch (static_cast<SnapshotSection>(e.id)) {
+            case SnapshotSection::Records:      ok = bind(legacyRecords); recordCount = e.count; break;
+            case SnapshotSection::StringPool:   ok = bind(idx.stringPool); poolSize = e.count; break;
+            case SnapshotSection::FlatIndex:    ok = bind(legacyFlat); break;
+            case SnapshotSection::OrderByName:  ok = bind(idx.orderByName); break;
+            case SnapshotSection::OrderByPath:  ok = bind(idx.orderByPath); break;
+            case SnapshotSection::OrderBySize:  ok = bind(idx.orderBySize); break;
+            case SnapshotSection::OrderByMtime: ok = bind(idx.orderByMtime); break;
+            case SnapshotSection::RankByName:   ok = bind(idx.rankByName); break;
+            case SnapshotSection::RankByPath:   ok = bind(idx.rankByPath); break;
+            case SnapshotSection::RankBySize:   ok = bind(idx.rankBySize); break;
+            case SnapshotSection::RankByMtime:  ok = bind(idx.rankByMtime); break;
+            case SnapshotSection::TrigramBuckets:   ok = bind(idx.trigrams.buckets); break;
+            case SnapshotSection::TrigramDirectory: ok = bind(idx.trigrams.directory); break;
+            case SnapshotSection::TrigramSkips:     ok = bind(idx.trigrams.skips); break;
+            case SnapshotSection::TrigramData:      ok = bind(idx.trigrams.data); break;
+            case SnapshotSection::FoldedPool:       ok = bind(idx.foldedPool); break;
+            case SnapshotSection::FileIds:          ok = bind(idx.fileIds); break;
+            case SnapshotSection::RecordParents:     ok = bind(idx.records.parents); recordCount = e.count; break;
+            case SnapshotSection::RecordSizes:       ok = bind(idx.records.sizes); break;
+            case SnapshotSection::RecordMtimes:      ok = bind(idx.records.mtimes); break;
+            case SnapshotSection::RecordNameOffsets: ok = bind(idx.records.nameOffsets); break;
+            case SnapshotSection::RecordNameLens:    ok = bind(idx.records.nameLens); break;
+            case SnapshotSection::RecordFlags:       ok = bind(idx.records.flags); break;
+            case SnapshotSection::ExtensionNames:    ok = bind(idx.extensions.names); break;
+            case SnapshotSection::ExtensionEntries:  ok = bind(idx.extensions.entries); sawExtensions = true; break;
+            case SnapshotSection::ExtensionPostings: ok = bind(idx.extensions.postings); break;
+            case SnapshotSection::NameSignatures:    ok = bind(idx.nameSignatures); break;
+            case SnapshotSection::NameOffsets:       ok = bind(idx.names.nameOffsets); break;
+            case SnapshotSection::NameLens:          ok = bind(idx.names.nameLens); break;
+            case SnapshotSection::NameRecordFirst:   ok = bind(idx.names.recordFirst); break;
+            case SnapshotSection::NameRecordIds:     ok = bind(idx.names.recordIds); sawNames = true; break;
+            default:
+                break; // unknown (newer) section: ignore
+        }
 
-    s << static_cast<quint64>(idx.records.size());
-    if (!idx.records.empty()) {
-        const auto bytes = static_cast<qint64>(idx.records.size() * sizeof(ScannerEngine::FileRecord));
-        s.writeRawData(reinterpret_cast<const char*>(idx.records.data()), bytes);
+        if (!ok) {
+            if (errorOut) *errorOut = QStringLiteral("Corrupt snapshot: section %1 element size mismatch.").arg(e.id);
+            return std::nullopt;
+        }
     }
 
-    s << static_cast<quint64>(idx.stringPool.size());
-    if (!idx.stringPool.empty()) {
-        const auto bytes = static_cast<qint64>(idx.stringPool.size());
-        s.writeRawData(idx.stringPool.data(), bytes);
+    static constexpr quint64 kMaxRecords = 500'000'000ULL;
+    if (recordCount == 0 || recordCount > kMaxRecords || poolSize == 0) {
+        if (errorOut) *errorOut = QStringLiteral("Invalid record/string pool size in snapshot.");
+        return std::nullopt;
     }
 
-    // v4+: acceleration structures (flatIndex + sort orders + ranks)
-    static_assert(sizeof(ScannerEngine::TrigramEntry) == 8, "TrigramEntry must be 8 bytes for snapshot IO.");
+    // Pre-v11 snapshots store packed records; transpose them (the upgrade then maps the columns)
+    if (!legacyRecords.empty()) {
+        idx.records.clear();
+        idx.records.reserve(legacyRecords.size());
+        idx.records.append(legacyRecords.data(), legacyRecords.size());
+        legacyRecords.clear();
+    }
 
-    auto writeU32Vec = [&](const std::vector<quint32>& v) {
-        s << static_cast<quint64>(v.size());
-        if (!v.empty()) {
-            const auto bytes = static_cast<qint64>(v.size() * sizeof(quint32));
-            s.writeRawData(reinterpret_cast<const char*>(v.data()), bytes);
-        }
+    if (!idx.records.consistent() || idx.records.size() != static_cast<size_t>(recordCount)) {
+        if (errorOut) *errorOut = QStringLiteral("Corrupt snapshot: record column size mismatch.");
+        return std::nullopt;
+    }
+
+    auto mustMatch = [&](const MappedArray<quint32>& v) -> bool {
+        return v.empty() || v.size() == static_cast<size_t>(recordCount);
     };
+    if (!mustMatch(idx.orderByName) || !mustMatch(idx.orderByPath) || !mustMatch(idx.orderBySize) || !mustMatch(idx.orderByMtime) ||
+        !mustMatch(idx.rankByName)  || !mustMatch(idx.rankByPath)  || !mustMatch(idx.rankBySize)  || !mustMatch(idx.rankByMtime))
+    {
+        if (errorOut) *errorOut = QStringLiteral("Corrupt snapshot: sort/rank vector size mismatch.");
+        return std::nullopt;
+    }
 
-    // flatIndex
-    s << static_cast<quint64>(idx.flatIndex.size());
-    if (!idx.flatIndex.empty()) {
-        const auto bytes = static_cast<qint64>(idx.flatIndex.size() * sizeof(ScannerEngine::TrigramEntry));
-        s.writeRawData(reinterpret_cast<const char*>(idx.flatIndex.data()), bytes);
+    // Optional; without a matching file id column the journal checkpoint is useless as well
+    if (idx.fileIds.size() != static_cast<size_t>(recordCount)) {
+        idx.fileIds.clear();
+        idx.journal = {};
     }
 
-    // orders
-    writeU32Vec(idx.orderByName);
-    writeU32Vec(idx.orderByPath);
-    writeU32Vec(idx.orderBySize);
-    writeU32Vec(idx.orderByMtime);
+    // Pre-v8 snapshots have no folded pool. Their trigrams and name orders used ASCII-only folding,
+    // so drop the trigrams: the caller then rebuilds both, and the snapshot is upgraded afterwards.
+    if (idx.foldedPool.size() != idx.stringPool.size()) {
+        buildFoldedPool(idx);
+        idx.trigrams = {};
+        legacyFlat.clear();
+    }
 
-    // ranks
-    writeU32Vec(idx.rankByName);
-    writeU32Vec(idx.rankByPath);
-    writeU32Vec(idx.rankBySize);
-    writeU32Vec(idx.rankByMtime);
+    // Pre-v14 snapshots have no name table; their trigram postings are record ids (rebuilt by the caller)
+    if (sawNames) {
+        idx.names.recordCount = static_cast<quint32>(recordCount);
+        if (!idx.names.validate(static_cast<size_t>(recordCount), static_cast<size_t>(poolSize))) {
+            if (errorOut) *errorOut = QStringLiteral("Corrupt snapshot: name table mismatch.");
+            return std::nullopt;
+        }
+    } else {
+        idx.names = {};
+    }
+    const size_t postingIds = sawNames ? idx.names.nameCount() : static_cast<size_t>(recordCount);
 
-    if (s.status() != QDataStream::Ok) {
-        if (errorOut) *errorOut = QStringLiteral("Failed while writing snapshot stream.");
-        return false;
+    // Optional; rebuilt by the caller. Before v16 they were per record.
+    if (hdr.version < 16 || idx.nameSignatures.size() != idx.names.nameCount()) {
+        idx.nameSignatures.clear();
     }
 
-    if (!f.commit()) {
-        if (errorOut) *errorOut = QStringLiteral("Failed to commit snapshot atomically.");
-        return false;
+    if (!legacyFlat.empty()) {
+        idx.trigrams = TrigramIndex::build(legacyFlat.data(), legacyFlat.size(), static_cast<size_t>(recordCount));
+    } else {
+        idx.trigrams.recordCount = static_cast<quint32>(postingIds);
+        if (!idx.trigrams.validate(postingIds)) {
+            if (errorOut) *errorOut = QStringLiteral("Corrupt snapshot: trigram index mismatch.");
+            return std::nullopt;
+        }
     }
 
-    return true;
+    // Optional (pre-v12 snapshots have none); the caller builds it when it doesn't cover the records
+    if (sawExtensions) {
+        idx.extensions.recordCount = static_cast<quint32>(recordCount);
+        if (!idx.extensions.validate(static_cast<size_t>(recordCount))) {
+            if (errorOut) *errorOut = QStringLiteral("Corrupt snapshot: extension index mismatch.");
+            return std::nullopt;
+        }
+    } else {
+        idx.extensions = {};
+    }
+
+    // Every later lookup trusts these, so they are checked on each load (one pass over three
+    // columns); only the section checksums, which fault in the whole file, are opt-in. Both pools
+    // have the same size by now.
+    {
+        const RecordColumns& records = idx.records;
+        const quint32 n = static_cast<quint32>(recordCount);
+        for (quint32 i = 0; i < n; ++i) {
+            const quint64 end = static_cast<quint64>(records.nameOffsets[i]) + static_cast<quint64>(records.nameLens[i]);
+            if (end > poolSize) {
+                if (errorOut) *errorOut = QStringLiteral("Corrupt snapshot: name range out of bounds.");
+                return std::nullopt;
+            }
+
+            const quint32 parent = records.parents[i];
+            if (parent >= n && parent != 0xFFFFFFFFu) {
+                if (errorOut) *errorOut = QStringLiteral("Corrupt snapshot: parent out of bounds.");
+                return std::nullopt;
+            }
+        }
+    }
+
+    if (deviceIdOut) *deviceIdOut = deviceId;
+    return idx;
 }
 
-std::optional<IndexerService::DeviceIndex> IndexerService::loadSnapshotFile(const QString& path,
-                                                                            QString* deviceIdOut,
-                                                                            QString* errorOut) const {
+std::optional<IndexerService::DeviceIndex> IndexerService::loadLegacySnapshotFile(const QString& path,
+                                                                                  QString* deviceIdOut,
+                                                                                  QString* errorOut) const {
     QFile f(path);
     if (!f.open(QIODevice::ReadOnly)) {
         if (errorOut) *errorOut = QStringLiteral("Failed to open snapshot: %1").arg(path);
@@ -966,9 +3111,9 @@ std::optional<IndexerService::DeviceIndex> IndexerService::loadSnapshotFile(cons
         idx.uuidLastKnown  = QString::fromUtf8(uuidBytes);
     }
 
-    idx.records.resize(static_cast<size_t>(recordCount));
+    std::vector<ScannerEngine::FileRecord> records(static_cast<size_t>(recordCount));
     const qint64 recordBytes = static_cast<qint64>(recordCount * sizeof(ScannerEngine::FileRecord));
-    if (s.readRawData(reinterpret_cast<char*>(idx.records.data()), recordBytes) != recordBytes) {
+    if (s.readRawData(reinterpret_cast<char*>(records.data()), recordBytes) != recordBytes) {
         if (errorOut) *errorOut = QStringLiteral("Truncated snapshot (records).");
         return std::nullopt;
     }
@@ -982,16 +3127,16 @@ std::optional<IndexerService::DeviceIndex> IndexerService::loadSnapshotFile(cons
         return std::nullopt;
     }
 
-    idx.stringPool.resize(static_cast<size_t>(poolSize));
+    std::vector<char> stringPool(static_cast<size_t>(poolSize));
     const qint64 poolBytes = static_cast<qint64>(poolSize);
-    if (s.readRawData(idx.stringPool.data(), poolBytes) != poolBytes) {
+    if (s.readRawData(stringPool.data(), poolBytes) != poolBytes) {
         if (errorOut) *errorOut = QStringLiteral("Truncated snapshot (string pool).");
         return std::nullopt;
     }
 
     // Basic sanity: ensure name ranges are in-bounds
-    for (size_t i = 0; i < idx.records.size(); ++i) {
-        const auto& r = idx.records[i];
+    for (size_t i = 0; i < records.size(); ++i) {
+        const auto& r = records[i];
         const quint64 end = static_cast<quint64>(r.nameOffset) + static_cast<quint64>(r.nameLen);
         if (end > poolSize) {
             if (errorOut) *errorOut = QStringLiteral("Corrupt snapshot: name range out of bounds.");
@@ -999,18 +3144,23 @@ std::optional<IndexerService::DeviceIndex> IndexerService::loadSnapshotFile(cons
         }
     }
 
+    idx.records.assign(records);
+    idx.stringPool = std::move(stringPool);
+
     if (ver >= 4) {
         static_assert(sizeof(ScannerEngine::TrigramEntry) == 8, "TrigramEntry must be 8 bytes for snapshot IO.");
 
-        auto readU32Vec = [&](quint64 maxElems, std::vector<quint32>& out) -> bool {
+        auto readU32Vec = [&](quint64 maxElems, MappedArray<quint32>& out) -> bool {
             quint64 n = 0;
             s >> n;
             if (n == 0) { out.clear(); return true; }
             if (n > maxElems) return false;
 
-            out.resize(static_cast<size_t>(n));
+            std::vector<quint32> v(static_cast<size_t>(n));
             const qint64 bytes = static_cast<qint64>(n * sizeof(quint32));
-            return s.readRawData(reinterpret_cast<char*>(out.data()), bytes) == bytes;
+            if (s.readRawData(reinterpret_cast<char*>(v.data()), bytes) != bytes) return false;
+            out = std::move(v);
+            return true;
         };
 
         quint64 flatCount = 0;
@@ -1019,14 +3169,17 @@ std::optional<IndexerService::DeviceIndex> IndexerService::loadSnapshotFile(cons
         static constexpr quint64 kMaxFlat = 2'000'000'000ULL; // guardrail
         if (flatCount > kMaxFlat) return std::nullopt;
 
-        idx.flatIndex.resize(static_cast<size_t>(flatCount));
+        std::vector<ScannerEngine::TrigramEntry> flatIndex(static_cast<size_t>(flatCount));
         if (flatCount > 0) {
             const qint64 bytes = static_cast<qint64>(flatCount * sizeof(ScannerEngine::TrigramEntry));
-            if (s.readRawData(reinterpret_cast<char*>(idx.flatIndex.data()), bytes) != bytes) {
+            if (s.readRawData(reinterpret_cast<char*>(flatIndex.data()), bytes) != bytes) {
                 if (errorOut) *errorOut = QStringLiteral("Truncated snapshot (flatIndex).");
                 return std::nullopt;
             }
         }
+        // Pre-v8 trigrams were folded ASCII-only; leave idx.trigrams empty so the caller rebuilds
+        // them (and the sort orders) from the folded pool.
+        flatIndex = {};
 
         const quint64 nRec = recordCount;
 
@@ -1041,7 +3194,7 @@ std::optional<IndexerService::DeviceIndex> IndexerService::loadSnapshotFile(cons
         if (!readU32Vec(nRec, idx.rankByMtime)) return std::nullopt;
 
         // Basic consistency: if any are present, they should match recordCount
-        auto mustMatch = [&](const std::vector<quint32>& v) -> bool {
+        auto mustMatch = [&](const MappedArray<quint32>& v) -> bool {
             return v.empty() || v.size() == static_cast<size_t>(recordCount);
         };
         if (!mustMatch(idx.orderByName) || !mustMatch(idx.orderByPath) || !mustMatch(idx.orderBySize) || !mustMatch(idx.orderByMtime) ||
@@ -1102,115 +3255,392 @@ QString IndexerService::joinInternalPath(const QString& internalDir, const QStri
 }
 
 bool IndexerService::nameContainsCaseInsensitive(std::string_view haystack, std::string_view needle) {
-    if (needle.empty()) return true;
-
-    auto it = std::search(haystack.begin(), haystack.end(),
-                          needle.begin(), needle.end(),
-                          [](unsigned char a, unsigned char b) {
-                              return std::tolower(a) == std::tolower(b);
-                          });
-    return it != haystack.end();
+    return NameMatcher({needle}).matches(haystack);
 }
 
-IndexerService::ParsedScan IndexerService::parseHelperStdout(const QByteArray& raw) {
-    ParsedScan out;
+static constexpr quint64 kMaxScanRecords = 500'000'000ULL;
+static constexpr quint64 kMaxScanPoolBytes = 8ULL * 1024 * 1024 * 1024; // 8 GiB
 
-    if (raw.isEmpty()) {
-        out.error = QStringLiteral("Helper produced no stdout data.");
-        return out;
-    }
+/**
+ * Handles one fully received frame of the helper's scan stream.
+ *
+ * Record batches are validated against the string pool received so far, transposed into the
+ * record columns, and their trigrams are generated immediately, so the trigram build overlaps
+ * with the disk scan.
+ *
+ * @param st The stream state; st.header describes the frame that was just completed.
+ * @return True if the frame was valid, false (with st.error set) otherwise.
+ */
+bool IndexerService::handleScanFrame(ScanStream& st) {
+    using ScanProtocol::FrameType;
+    const auto type = static_cast<FrameType>(st.header.type);
+
+    switch (type) {
+        case FrameType::Hello: {
+            ScanProtocol::HelloPayload hello{};
+            std::memcpy(&hello, st.smallPayload.constData(), sizeof(hello));
+
+            if (hello.magic != ScanProtocol::kMagic || hello.version != ScanProtocol::kVersion) {
+                st.error = QStringLiteral("Unsupported scan stream (magic/version mismatch).");
+                return false;
+            }
+            if (hello.recordSize != sizeof(ScannerEngine::FileRecord)) {
+                st.error = QStringLiteral("Scan stream record size mismatch (%1 bytes).").arg(hello.recordSize);
+                return false;
+            }
 
-    QDataStream s(raw);
-    s.setByteOrder(QDataStream::LittleEndian);
+            st.sawHello = true;
+            st.delta = (hello.flags & ScanProtocol::kHelloDelta) != 0;
 
-    auto readExact = [&](void* dst, qint64 n) -> bool {
-        return s.readRawData(reinterpret_cast<char*>(dst), n) == n;
-    };
+            // Best-effort: avoid repeated reallocation (and the transient 2x it costs) for big volumes
+            try {
+                const quint64 hint = std::min<quint64>(hello.recordsHint, kMaxScanRecords);
+                st.records.reserve(static_cast<size_t>(hint));
+                if (!st.delta) {
+                    st.nameIdOf.reserve(static_cast<size_t>(hint));
+                    st.trigrams.reserve(static_cast<size_t>(hint) * 2); // per distinct name, not per record
+                }
+            } catch (...) {
+                // Not fatal; vectors will simply grow on demand.
+            }
+            return true;
+        }
 
-    quint64 recordCount = 0;
-    if (!readExact(&recordCount, sizeof(recordCount))) {
-        out.error = QStringLiteral("Failed to read recordCount.");
-        return out;
-    }
+        case FrameType::Pool:
+            return true;
+
+        case FrameType::Records: {
+            const size_t recordsBefore = st.records.size();
+            const quint64 poolSize = st.stringPool.size();
+
+            // Fold the pool up to the furthest name end seen so far (names never straddle that point)
+            size_t foldTo = st.foldedBytes;
+            for (size_t i = 0; i < st.recordBatch.size(); ++i) {
+                const auto& r = st.recordBatch[i];
+                const quint64 end = static_cast<quint64>(r.nameOffset) + static_cast<quint64>(r.nameLen);
+                if (end > poolSize) {
+                    st.error = QStringLiteral("Corrupt record %1: name range out of bounds.")
+                                   .arg(static_cast<qulonglong>(recordsBefore + i));
+                    return false;
+                }
+                foldTo = std::max(foldTo, static_cast<size_t>(end));
+            }
+            foldScanStreamPool(st, foldTo);
+
+            st.records.append(st.recordBatch.data(), st.recordBatch.size());
+            st.recordBatch.clear();
+
+            // Delta streams are merged record by record (applyScanDelta); full scans intern each name,
+            // and only names seen for the first time add trigrams
+            if (!st.delta) {
+                const size_t namesBefore = st.nameInterner.size();
+                st.nameIdOf.reserve(st.records.size());
+                for (size_t i = recordsBefore; i < st.records.size(); ++i) {
+                    bool added = false;
+                    st.nameIdOf.push_back(st.nameInterner.intern(st.stringPool.data(), st.records.nameOffsets[i],
+                                                                 st.records.nameLens[i], added));
+                }
+                appendTrigramsForNames(st.nameInterner.offsets(), st.nameInterner.lens(), st.foldedPool.data(),
+                                       namesBefore, st.nameInterner.size(), st.trigrams);
+            }
+            return true;
+        }
 
-    static constexpr quint64 kMaxRecords = 500'000'000ULL;
-    if (recordCount == 0 || recordCount > kMaxRecords) {
-        out.error = QStringLiteral("Invalid recordCount: %1").arg(recordCount);
-        return out;
+        case FrameType::Parents: {
+            quint32 first = 0;
+            std::memcpy(&first, st.smallPayload.constData(), sizeof(first));
+
+            const size_t count = (static_cast<size_t>(st.smallPayload.size()) - sizeof(quint32)) / sizeof(quint32);
+            if (static_cast<quint64>(first) + count > st.records.size()) {
+                st.error = QStringLiteral("Parents frame references unknown records.");
+                return false;
+            }
+
+            const char* src = st.smallPayload.constData() + sizeof(quint32);
+            for (size_t i = 0; i < count; ++i) {
+                quint32 parent = 0;
+                std::memcpy(&parent, src + i * sizeof(quint32), sizeof(parent));
+                st.records.setParent(first + i, parent);
+            }
+            return true;
+        }
+
+        case FrameType::FileIds:
+        case FrameType::ParentFileIds: {
+            std::vector<quint64>& ids = (type == FrameType::FileIds) ? st.fileIds : st.parentFileIds;
+
+            quint32 first = 0;
+            std::memcpy(&first, st.smallPayload.constData(), sizeof(first));
+
+            // Sent in record order, after the records they describe
+            const size_t count = (static_cast<size_t>(st.smallPayload.size()) - sizeof(quint32)) / sizeof(quint64);
+            if (first != ids.size() || static_cast<quint64>(first) + count > st.records.size()) {
+                st.error = QStringLiteral("File id frame references unknown records.");
+                return false;
+            }
+
+            ids.resize(first + count);
+            std::memcpy(ids.data() + first, st.smallPayload.constData() + sizeof(quint32), count * sizeof(quint64));
+            return true;
+        }
+
+        case FrameType::Changed:
+        case FrameType::ChangedDirs: {
+            std::vector<quint64>& ids = (type == FrameType::Changed) ? st.changedFileIds : st.changedDirIds;
+            const size_t count = static_cast<size_t>(st.smallPayload.size()) / sizeof(quint64);
+            const size_t old = ids.size();
+            ids.resize(old + count);
+            std::memcpy(ids.data() + old, st.smallPayload.constData(), count * sizeof(quint64));
+            return true;
+        }
+
+        case FrameType::Stats: {
+            const size_t count = static_cast<size_t>(st.smallPayload.size()) / sizeof(ScanProtocol::StatsEntry);
+            const size_t old = st.stats.size();
+            st.stats.resize(old + count);
+            std::memcpy(st.stats.data() + old, st.smallPayload.constData(), count * sizeof(ScanProtocol::StatsEntry));
+            return true;
+        }
+
+        case FrameType::Checkpoint:
+            std::memcpy(&st.checkpoint, st.smallPayload.constData(), sizeof(st.checkpoint));
+            st.hasCheckpoint = true;
+            return true;
+
+        case FrameType::End: {
+            ScanProtocol::EndPayload end{};
+            std::memcpy(&end, st.smallPayload.constData(), sizeof(end));
+
+            if (end.recordCount != st.records.size() || end.poolSize != st.stringPool.size()) {
+                st.error = QStringLiteral("Scan stream ended with mismatched totals.");
+                return false;
+            }
+
+            st.sawEnd = true;
+            return true;
+        }
     }
 
-    const quint64 recordBytes64 = recordCount * static_cast<quint64>(sizeof(ScannerEngine::FileRecord));
-    if (recordBytes64 / static_cast<quint64>(sizeof(ScannerEngine::FileRecord)) != recordCount) {
-        out.error = QStringLiteral("Record byte size overflow.");
-        return out;
+    st.error = QStringLiteral("Unknown scan stream frame type %1.").arg(st.header.type);
+    return false;
+}
+
+/**
+ * Validates a frame header and prepares the destination buffer for its payload.
+ *
+ * Pool and Records payloads are read directly into the tail of the final vectors, everything
+ * else goes into a small scratch buffer.
+ *
+ * @return True if the payload can be received, false (with st.error set) otherwise.
+ */
+bool IndexerService::beginScanPayload(ScanStream& st) {
+    using ScanProtocol::FrameType;
+    const quint32 n = st.header.payloadBytes;
+    const auto type = static_cast<FrameType>(st.header.type);
+
+    if (n > ScanProtocol::kMaxPayloadBytes) {
+        st.error = QStringLiteral("Scan stream frame too large (%1 bytes).").arg(n);
+        return false;
     }
-    if (recordBytes64 > static_cast<quint64>(std::numeric_limits<qint64>::max())) {
-        out.error = QStringLiteral("Record blob too large to read safely.");
-        return out;
+    if (!st.sawHello && type != FrameType::Hello) {
+        st.error = QStringLiteral("Scan stream did not start with a header frame.");
+        return false;
+    }
+    if (st.sawHello && type == FrameType::Hello) {
+        st.error = QStringLiteral("Duplicate scan stream header frame.");
+        return false;
     }
 
+    st.inPayload = true;
+    st.payloadFilled = 0;
+    st.payloadDst = nullptr;
+
     try {
-        out.records.resize(static_cast<size_t>(recordCount));
+        switch (type) {
+            case FrameType::Hello:
+            case FrameType::End:
+                if (n != (type == FrameType::Hello ? sizeof(ScanProtocol::HelloPayload) : sizeof(ScanProtocol::EndPayload))) {
+                    st.error = QStringLiteral("Malformed scan stream frame (type %1).").arg(st.header.type);
+                    return false;
+                }
+                st.smallPayload.resize(n);
+                st.payloadDst = st.smallPayload.data();
+                return true;
+
+            case FrameType::Parents:
+                if (n < sizeof(quint32) || (n % sizeof(quint32)) != 0) {
+                    st.error = QStringLiteral("Malformed parents frame.");
+                    return false;
+                }
+                st.smallPayload.resize(n);
+                st.payloadDst = st.smallPayload.data();
+                return true;
+
+            case FrameType::FileIds:
+            case FrameType::ParentFileIds:
+                if (n < sizeof(quint32) || ((n - sizeof(quint32)) % sizeof(quint64)) != 0) {
+                    st.error = QStringLiteral("Malformed file id frame.");
+                    return false;
+                }
+                st.smallPayload.resize(n);
+                st.payloadDst = st.smallPayload.data();
+                return true;
+
+            case FrameType::Changed:
+            case FrameType::ChangedDirs:
+            case FrameType::Stats:
+            case FrameType::Checkpoint: {
+                const size_t unit = (type == FrameType::Stats) ? sizeof(ScanProtocol::StatsEntry) : sizeof(quint64);
+                if (type == FrameType::Checkpoint ? n != sizeof(ScanProtocol::CheckpointPayload) : (n % unit) != 0) {
+                    st.error = QStringLiteral("Malformed scan stream frame (type %1).").arg(st.header.type);
+                    return false;
+                }
+                st.smallPayload.resize(n);
+                st.payloadDst = st.smallPayload.data();
+                return true;
+            }
+
+            case FrameType::Pool: {
+                const size_t old = st.stringPool.size();
+                if (old + n > kMaxScanPoolBytes) {
+                    st.error = QStringLiteral("String pool too large.");
+                    return false;
+                }
+                st.stringPool.resize(old + n);
+                st.payloadDst = st.stringPool.data() + old;
+                return true;
+            }
+
+            case FrameType::Records: {
+                if ((n % sizeof(ScannerEngine::FileRecord)) != 0) {
+                    st.error = QStringLiteral("Malformed records frame.");
+                    return false;
+                }
+                const size_t old = st.records.size();
+                const size_t add = n / sizeof(ScannerEngine::FileRecord);
+                if (old + add > kMaxScanRecords) {
+                    st.error = QStringLiteral("Too many records in scan stream.");
+                    return false;
+                }
+                st.recordBatch.resize(add);
+                st.payloadDst = reinterpret_cast<char*>(st.recordBatch.data());
+                return true;
+            }
+        }
     } catch (...) {
-        out.error = QStringLiteral("Memory allocation failed for records.");
-        return out;
+        st.error = QStringLiteral("Memory allocation failed while receiving scan data.");
+        return false;
     }
 
-    if (!readExact(out.records.data(), static_cast<qint64>(recordBytes64))) {
-        out.error = QStringLiteral("Truncated stream while reading records.");
-        return out;
-    }
+    st.error = QStringLiteral("Unknown scan stream frame type %1.").arg(st.header.type);
+    return false;
+}
 
-    quint64 poolSize = 0;
-    if (!readExact(&poolSize, sizeof(poolSize))) {
-        out.error = QStringLiteral("Failed to read string pool size.");
-        return out;
+bool IndexerService::consumeScanStream(ScanStream& st, QIODevice* proc) {
+    if (!proc) return st.error.isEmpty();
+
+    while (st.error.isEmpty()) {
+        const qint64 avail = proc->bytesAvailable();
+        if (avail <= 0) break;
+
+        if (st.sawEnd) {
+            st.error = QStringLiteral("Unexpected data after end of scan stream.");
+            break;
+        }
+
+        if (!st.inPayload) {
+            char* dst = reinterpret_cast<char*>(&st.header) + st.headerFilled;
+            const qint64 want = static_cast<qint64>(sizeof(st.header) - st.headerFilled);
+            const qint64 got = proc->read(dst, std::min(avail, want));
+            if (got <= 0) break;
+
+            st.headerFilled += static_cast<quint32>(got);
+            if (st.headerFilled < sizeof(st.header)) continue;
+
+            st.headerFilled = 0;
+            if (!beginScanPayload(st)) break;
+        } else {
+            const qint64 want = static_cast<qint64>(st.header.payloadBytes - st.payloadFilled);
+            const qint64 got = want > 0 ? proc->read(st.payloadDst + st.payloadFilled, std::min(avail, want)) : 0;
+            if (got < 0) break;
+            st.payloadFilled += static_cast<quint32>(got);
+        }
+
+        if (st.inPayload && st.payloadFilled == st.header.payloadBytes) {
+            st.inPayload = false;
+            if (!handleScanFrame(st)) break;
+        }
     }
 
-    static constexpr quint64 kMaxPoolBytes = 8ULL * 1024 * 1024 * 1024; // 8 GiB
-    if (poolSize == 0 || poolSize > kMaxPoolBytes) {
-        out.error = QStringLiteral("Invalid string pool size: %1 bytes").arg(poolSize);
-        return out;
+    return st.error.isEmpty();
+}
+
+bool IndexerService::finishScanStream(ScanStream& st) {
+    if (!st.error.isEmpty()) return false;
+
+    if (!st.sawHello) {
+        st.error = QStringLiteral("Helper produced no stdout data.");
+        return false;
     }
-    if (poolSize > static_cast<quint64>(std::numeric_limits<qint64>::max())) {
-        out.error = QStringLiteral("String pool too large to read safely.");
-        return out;
+    if (!st.sawEnd || st.inPayload || st.headerFilled != 0) {
+        st.error = QStringLiteral("Truncated scan stream.");
+        return false;
     }
-
-    try {
-        out.stringPool.resize(static_cast<size_t>(poolSize));
-    } catch (...) {
-        out.error = QStringLiteral("Memory allocation failed for string pool.");
-        return out;
+    // A delta without changes is fine; a full scan always finds at least the root
+    if (!st.delta && (st.records.empty() || st.stringPool.empty())) {
+        st.error = QStringLiteral("Scan stream contained no entries.");
+        return false;
     }
-
-    if (!readExact(out.stringPool.data(), static_cast<qint64>(poolSize))) {
-        out.error = QStringLiteral("Truncated stream while reading string pool.");
-        return out;
+    if (!st.fileIds.empty() && st.fileIds.size() != st.records.size()) {
+        st.error = QStringLiteral("Scan stream has file ids for only some records.");
+        return false;
+    }
+    if (st.delta && (st.fileIds.size() != st.records.size() || st.parentFileIds.size() != st.records.size() ||
+                     !st.hasCheckpoint)) {
+        st.error = QStringLiteral("Incomplete delta scan stream.");
+        return false;
     }
 
-    // Basic sanity: ensure all name ranges are in-bounds (best-effort)
-    for (size_t i = 0; i < out.records.size(); ++i) {
-        const auto& r = out.records[i];
-        const quint64 end = static_cast<quint64>(r.nameOffset) + static_cast<quint64>(r.nameLen);
-        if (end > poolSize) {
-            out.error = QStringLiteral("Corrupt record %1: name range out of bounds.").arg(static_cast<qulonglong>(i));
-            out.records.clear();
-            out.stringPool.clear();
-            return out;
+    const quint32 n = static_cast<quint32>(st.records.size());
+    for (size_t i = 0; i < st.records.size(); ++i) {
+        const quint32 p = st.records.parents[i];
+        if (p != 0xFFFFFFFFu && p >= n) {
+            st.error = QStringLiteral("Corrupt record %1: parent out of bounds.").arg(static_cast<qulonglong>(i));
+            return false;
         }
     }
 
-    return out;
+    foldScanStreamPool(st, st.stringPool.size());
+    if (!st.delta) {
+        st.names = NameTable::assemble(st.nameInterner, st.nameIdOf, st.records, st.stringPool, st.foldedPool);
+        st.nameInterner = {};
+        st.nameIdOf = {};
+    }
+    sortTrigramIndex(st.trigrams);
+    st.smallPayload.clear();
+    return true;
+}
+
+void IndexerService::foldScanStreamPool(ScanStream& st, size_t upTo) {
+    if (upTo <= st.foldedBytes) return;
+
+    st.foldedPool.resize(st.stringPool.size());
+    CaseFold::foldUtf8(st.stringPool.data() + st.foldedBytes, upTo - st.foldedBytes, st.foldedPool.data() + st.foldedBytes);
+    st.foldedBytes = upTo;
+}
+
+DirPathResolver::Tree IndexerService::dirTreeFor(const DeviceIndex& idx) {
+    const RecordColumns& r = idx.records;
+    return DirPathResolver::Tree{r.parents.data(), r.nameOffsets.data(), r.nameLens.data(), r.size(),
+                                 idx.stringPool.data()};
 }
 
 /**
  * Constructs the file system path for a given directory ID within the index associated
  * with a specific user ID and device ID.
  *
- * This method retrieves and builds the path structure by walking up the parent directory
- * references from the provided directory ID. If the directory ID is set to a special value
- * or is invalid, a fallback path is returned. Results may be cached for subsequent lookups.
+ * Resolution reuses the index's cached ancestor paths (see DirPathResolver), so only the
+ * directories between dirId and its nearest resolved ancestor are walked.
  *
  * @param uid The unique identifier of the user owning the device index.
  * @param deviceId The identifier of the device containing the directory.
@@ -1226,54 +3656,13 @@ QString IndexerService::dirPathFor(quint32 uid, const QString& deviceId, quint32
     auto it = uidIt->second.find(deviceId);
     if (it == uidIt->second.end()) return QStringLiteral("…");
 
-    const DeviceIndex& idx = it->second;
-
-    if (dirId == 0xFFFFFFFFu) {
-        return QStringLiteral("/");
-    }
-
-    // Cache hit
-    auto cacheIt = idx.dirPathCache.find(dirId);
-    if (cacheIt != idx.dirPathCache.end()) {
-        return cacheIt->second;
-    }
-
-    if (dirId >= idx.records.size()) {
-        return QStringLiteral("…");
-    }
-
-    // Walk parents and build path
-    QStringList parts;
-    quint32 cur = dirId;
-    int safety = 0;
-
-    while (cur != 0xFFFFFFFFu && cur < idx.records.size() && safety++ < 4096) {
-        const auto& r = idx.records[cur];
-        std::string_view name(&idx.stringPool[r.nameOffset], r.nameLen);
-
-        // Skip dot entries and empty names (root-like)
-        if (!(name == "." || name == ".." || name.empty())) {
-            parts.push_front(QString::fromUtf8(name.data(), static_cast<int>(name.size())));
-        }
-
-        const quint32 next = r.parentRecordIdx;
-        if (next == cur) break; // self-loop safety
-        cur = next;
-    }
-
-    QString path = QStringLiteral("/");
-    if (!parts.isEmpty()) {
-        path += parts.join(QStringLiteral("/"));
-    }
-
-    // Store into cache (mutable)
-    idx.dirPathCache.emplace(dirId, path);
-    return path;
+    const DeviceIndex& idx = *it->second;
+    return idx.dirPaths.resolve(dirTreeFor(idx), dirId);
 }
 
 void IndexerService::Ping(QString& versionOut, quint32& apiVersionOut) const {
     versionOut = "kerythingd";
-    apiVersionOut = 1;
+    apiVersionOut = 4; // 2: SearchPacked, 3: SearchPacked "includePaths", 4: "timings", GetStats
 }
 
 void IndexerService::ListKnownDevices(QVariantList& devicesOut) const {
@@ -1412,13 +3801,13 @@ void IndexerService::ListIndexedDevices(QVariantList& indexedOut) const {
 
     for (const auto& kv : uidIt->second) {
         const QString& deviceId = kv.first;
-        const DeviceIndex& idx = kv.second;
+        const DeviceIndex& idx = *kv.second;
 
         QVariantMap m;
         m.insert(QStringLiteral("deviceId"), deviceId);
         m.insert(QStringLiteral("fsType"), idx.fsType);
         m.insert(QStringLiteral("generation"), QVariant::fromValue<qulonglong>(idx.generation));
-        m.insert(QStringLiteral("entryCount"), QVariant::fromValue<qulonglong>(idx.records.size()));
+        m.insert(QStringLiteral("entryCount"), QVariant::fromValue<qulonglong>(idx.liveRecordCount()));
         m.insert(QStringLiteral("lastIndexedTime"), QVariant::fromValue<qlonglong>(idx.lastIndexedTime));
         m.insert(QStringLiteral("label"), idx.labelLastKnown);
         m.insert(QStringLiteral("uuid"), idx.uuidLastKnown);
@@ -1529,455 +3918,858 @@ void IndexerService::CancelJob(quint64 jobId) {
 
         if (!j2.proc) return;
         if (j2.proc->state() != QProcess::NotRunning) {
-            j2.proc->kill();
-        }
-    });
-
-    // IMPORTANT: Do NOT emit JobFinished or erase here.
-    // We only finalize from the QProcess::finished handler.
-}
-
-void IndexerService::Search(const QString& query,
-                            const QStringList& deviceIds,
-                            const QString& sortKey,
-                            const QString& sortDir,
-                            quint32 offset,
-                            quint32 limit,
-                            const QVariantMap& options,
-                            quint64& totalHitsOut,
-                            QVariantList& rowsOut) const {
-    Q_UNUSED(options);
+            j2.proc->kill();
+        }
+    });
 
-    const quint32 uid = callerUidOr0();
-    ensureLoadedForUid(uid);
+    // IMPORTANT: Do NOT emit JobFinished or erase here.
+    // We only finalize from the QProcess::finished handler.
+}
 
-    rowsOut.clear();
+bool IndexerService::collectSearchPage(const SearchSnapshot& snap,
+                                       const SearchCancel& cancel,
+                                       const SearchFilter& optionsFilter,
+                                       const QString& query,
+                                       const QStringList& deviceIds,
+                                       const QString& sortKey,
+                                       const QString& sortDir,
+                                       quint32 offset,
+                                       quint32 limit,
+                                       quint64& totalHitsOut,
+                                       std::vector<PageHit>& hitsOut,
+                                       SearchTrace* trace) const {
+    const quint32 uid = snap.uid;
+    const auto& indexes = snap.indexes;
+
+    hitsOut.clear();
+    totalHitsOut = 0;
 
-    auto uidIt = m_indexesByUid.find(uid);
-    if (uidIt == m_indexesByUid.end()) {
-        totalHitsOut = 0;
-        return;
+    if (indexes.empty()) {
+        return true;
     }
-    const auto& indexes = uidIt->second;
 
     const bool desc = (sortDir.compare(QStringLiteral("desc"), Qt::CaseInsensitive) == 0);
-    const QStringList tokens = tokenizeQuery(query);
+    SearchFilter filter = optionsFilter;
+    const QStringList tokens = tokenizeQuery(query, &filter.extensions);
 
     auto deviceAllowed = [&](const QString& dev) -> bool {
         return deviceIds.isEmpty() || deviceIds.contains(dev);
     };
 
+    const QString key = sortKey.isEmpty() ? QStringLiteral("name") : sortKey.toLower();
+    const OrderKey orderKey = orderKeyFor(key);
+
+    // A single range on the sort field is a slice of every device's order: paged like an unfiltered query
+    const bool sliceOnly = !filter.dirsOnly && !filter.filesOnly && filter.extensions.isEmpty() &&
+                           ((orderKey == OrderKey::Size && filter.sizeActive() && !filter.mtimeActive()) ||
+                            (orderKey == OrderKey::Mtime && filter.mtimeActive() && !filter.sizeActive()));
+
     // ---- Fast path: empty query ----
-    if (tokens.isEmpty()) {
-        // If no device filter, use cached global order for O(limit) paging.
-        const QString key = sortKey.isEmpty() ? QStringLiteral("name") : sortKey.toLower();
+    if (tokens.isEmpty() && (!filter.active() || sliceOnly)) {
+        const auto mergeStart = std::chrono::steady_clock::now();
+        if (trace) trace->path = QStringLiteral("empty");
 
-        if (deviceIds.isEmpty()) {
-            // Heuristic: only build global-order cache when the user is paging far enough down
-            // that the old O(offset) merge-walk becomes expensive.
-            quint64 totalAll = 0;
-            for (const auto& kv : indexes) {
-                totalAll += static_cast<quint64>(kv.second.records.size());
-            }
-            totalHitsOut = totalAll;
+        std::vector<OrderRun> runs = orderRunsFor(snap, deviceIds, orderKey);
 
-            if (limit == 0 || totalAll == 0) return;
+        if (sliceOnly) {
+            for (OrderRun& run : runs) {
+                const FilterBounds b = filterBoundsFor(*run.idx, filter);
+                run.order = orderKey == OrderKey::Size ? run.order.subspan(b.sizeLo, b.sizeHi - b.sizeLo)
+                                                       : run.order.subspan(b.mtimeLo, b.mtimeHi - b.mtimeLo);
+            }
+        }
 
-            static constexpr quint64 kCacheOffsetThreshold = 100'000ULL;
+        quint64 total = 0;
+        for (const auto& run : runs) total += static_cast<quint64>(run.order.size());
+        totalHitsOut = total;
 
-            const bool farByOffset = static_cast<quint64>(offset) >= kCacheOffsetThreshold;
-            const bool farByFraction = (totalAll >= 1'000'000ULL) &&
-                                       (static_cast<quint64>(offset) >= (totalAll / 4ULL));
+        const quint64 start = static_cast<quint64>(offset);
+        const quint64 end = std::min(start + static_cast<quint64>(limit), total);
+        if (start >= end) return true;
 
-            const bool shouldUseCache = farByOffset || farByFraction;
+        hitsOut.reserve(static_cast<size_t>(end - start));
 
+        if (deviceIds.isEmpty() && !sliceOnly) {
             // ---- Opportunistic warm-up for the common initial empty-query page ----
-            // Goal: after daemon restart, the *first big jump* becomes instant without adding threads.
-            if (offset == 0 && totalAll >= 1'000'000ULL) {
-                const quint64 epoch = m_uidEpoch.contains(uid) ? m_uidEpoch.at(uid) : 0;
-                const QString wk = warmKey(uid, epoch, key);
-
-                // Only schedule if cache is missing and we haven’t already queued it for this epoch.
-                if (!globalOrderForUid(uid, key) && !m_globalWarmScheduled.contains(wk)) {
-                    m_globalWarmScheduled.insert(wk);
-
-                    // Defer build until after we return this D-Bus reply.
-                    QTimer::singleShot(0, const_cast<IndexerService*>(this), [this, uid, key, epoch, wk]() {
-                        // If indexes changed since scheduling, skip.
-                        const quint64 curEpoch = m_uidEpoch.contains(uid) ? m_uidEpoch.at(uid) : 0;
-                        if (curEpoch != epoch) {
-                            m_globalWarmScheduled.erase(wk);
-                            return;
+            // With the cache in place, any later jump is a plain O(limit) copy.
+            if (offset == 0 && total >= 1'000'000ULL && !globalOrderForUid(uid, snap.epoch, key)) {
+                const QString wk = warmKey(uid, snap.epoch, key);
+
+                // Only schedule if we haven’t already queued it for this epoch.
+                bool schedule = false;
+                {
+                    std::lock_guard lock(m_searchCacheMutex);
+                    schedule = m_globalWarmScheduled.insert(wk).second;
+                }
+
+                if (schedule) {
+                    // Build on another worker, after this reply has gone out.
+                    m_searchPool->start([this, snapCopy = snap, key, wk]() {
+                        // If indexes changed since scheduling, skip. If somebody already built it, nothing to do.
+                        bool current = false;
+                        {
+                            std::lock_guard lock(m_searchCacheMutex);
+                            current = uidEpoch(snapCopy.uid) == snapCopy.epoch;
                         }
 
-                        // If somebody already built it, nothing to do.
-                        if (!globalOrderForUid(uid, key)) {
-                            rebuildGlobalOrderForUid(uid, key);
+                        if (current && !globalOrderForUid(snapCopy.uid, snapCopy.epoch, key)) {
+                            (void)rebuildGlobalOrderForUid(snapCopy, key, SearchCancel{});
                         }
 
+                        std::lock_guard lock(m_searchCacheMutex);
                         m_globalWarmScheduled.erase(wk);
                     });
                 }
             }
 
-            if (shouldUseCache) {
-                const auto* cache = globalOrderForUid(uid, key);
-                if (!cache) {
-                    rebuildGlobalOrderForUid(uid, key);
-                    cache = globalOrderForUid(uid, key);
+            auto cache = globalOrderForUid(uid, snap.epoch, key);
+            if (cache && cache->asc.size() == total && cache->deviceIds.size() == static_cast<qsizetype>(runs.size())) {
+                // runs and the cache's device table are both sorted by deviceId
+                for (quint64 i = start; i < end; ++i) {
+                    const quint64 idxPos = desc ? (total - 1 - i) : i;
+                    const auto& e = cache->asc[static_cast<size_t>(idxPos)];
+                    const OrderRun& run = runs[e.deviceOrdinal];
+                    hitsOut.push_back(PageHit{run.deviceId, run.idx, e.recordIdx});
                 }
+                if (trace) trace->mergeNs += nsSince(mergeStart);
+                return true;
+            }
+        }
+
+        // No cache (or a device filter): select where the page starts in every device's order, then
+        // merge just the page. Cost depends on the device count and limit, not on the offset.
+        const quint64 ascBegin = desc ? (total - end) : start;
+        const bool ok = mergeOrderRuns(runs, orderKey, globalRankSplit(runs, orderKey, ascBegin), end - start, cancel,
+                                       [&](quint32 run, quint32 recIdx) {
+                                           hitsOut.push_back(PageHit{runs[run].deviceId, runs[run].idx, recIdx});
+                                       });
+        if (!ok) return false;
+
+        if (desc) std::reverse(hitsOut.begin(), hitsOut.end());
+        if (trace) trace->mergeNs += nsSince(mergeStart);
+        return true;
+    }
+
+    // ---- Non-empty (or filtered) query: trigram filter + refine (cached as a search session) ----
+
+    const QStringList normTokens = normalizeSearchTokens(tokens);
+    const QString deviceKey = searchDeviceKey(deviceIds);
+    const QString filterKey = filter.key();
+    const QString sessionKey = searchSessionKey(normTokens, deviceKey, filterKey);
+
+    std::shared_ptr<SearchSession> session;
+    std::shared_ptr<const SearchSession> parent;
+    {
+        std::lock_guard lock(m_searchCacheMutex);
+        session = findSearchSession(uid, snap.epoch, sessionKey);
+
+        // As-you-type: when this query only narrows a cached one ("rep" -> "repo"), refine that
+        // session's hits instead of going back to the trigram index.
+        if (!session) {
+            parent = findNarrowableSession(uid, snap.epoch, deviceKey, filterKey, normTokens);
+            if (parent) {
+                ++m_searchCacheStats.narrowed;
+            }
+        }
+    }
+
+    if (trace) {
+        trace->path = session ? QStringLiteral("hit") : parent ? QStringLiteral("narrowed") : QStringLiteral("miss");
+    }
+
+    if (!session) {
+        auto freshPtr = std::make_shared<SearchSession>();
+        SearchSession& fresh = *freshPtr;
+        fresh.epoch = snap.epoch;
+        fresh.key = sessionKey;
+        fresh.deviceKey = deviceKey;
+        fresh.filterKey = filterKey;
+        fresh.tokens = normTokens;
+
+        const std::vector<QByteArray> tokBytes = [&]() {
+            std::vector<QByteArray> out;
+            out.reserve(tokens.size());
+            for (const auto& t : tokens) out.push_back(t.toUtf8());
+            return out;
+        }();
+
+        // All tokens are matched in one pass over each candidate name
+        const NameMatcher matcher = [&]() {
+            std::vector<std::string_view> needles;
+            needles.reserve(tokBytes.size());
+            for (const auto& tb : tokBytes) needles.emplace_back(tb.constData(), static_cast<size_t>(tb.size()));
+            return NameMatcher(needles);
+        }();
+
+        for (const auto& kv : indexes) {
+            const QString& devId = kv.first;
+            if (!deviceAllowed(devId)) continue;
+
+            const DeviceIndex& idx = *kv.second;
+            const FilterBounds bounds = filter.boundsActive() ? filterBoundsFor(idx, filter) : FilterBounds{};
+
+            std::vector<quint32> ownCandidates;
+            const std::vector<quint32>* candidatesPtr = &ownCandidates;
+
+            // Only a parent without a filter can hold hits with some other extension
+            const bool checkExtension = parent && parent->filterKey.isEmpty() && !filter.extensions.isEmpty();
+
+            // Candidates that need no refinement at all go straight into the session
+            bool exact = false;
 
-                if (cache) {
-                    // Override totalHitsOut with cached size (should match totalAll, but cache is authoritative here)
-                    totalHitsOut = static_cast<quint64>(cache->asc.size());
+            // Candidates whose names are known to contain every token
+            bool namesMatched = false;
 
-                    const quint64 start = static_cast<quint64>(offset);
-                    const quint64 end = std::min(start + static_cast<quint64>(limit), totalHitsOut);
-                    if (start >= end) return;
+            const auto candidatesStart = std::chrono::steady_clock::now();
 
-                    rowsOut.reserve(static_cast<int>(end - start));
+            if (parent) {
+                // Devices without hits in the parent can't have any now
+                const qsizetype d = parent->deviceIds.indexOf(devId);
+                if (d < 0) continue;
+                candidatesPtr = &parent->hitsByDevice[static_cast<size_t>(d)];
+            } else if (!filter.extensions.isEmpty()) {
+                // An extension's posting list is usually far shorter than any trigram candidate set.
+                // Two different extensions can't both match.
+                if (filter.extensions.size() == 1) {
+                    ownCandidates = deviceCandidatesForExtension(idx, filter.extensions.front());
+                }
+                exact = tokens.isEmpty() && !filter.boundsActive();
+            } else if (tokens.isEmpty()) {
+                ownCandidates = deviceCandidatesForFilter(idx, filter, bounds);
+                exact = true;
+            } else {
+                // Times its own candidates and name refine
+                ownCandidates = deviceMatchesForQuery(idx, tokens, matcher, cancel, trace);
+                namesMatched = true;
+                exact = !filter.boundsActive();
+            }
+            if (cancel.cancelled()) return false;
+
+            if (trace && !namesMatched) trace->candidatesNs += nsSince(candidatesStart);
 
-                    // Re-find uidIt (safe; but cheap) for device lookup
-                    auto uidIt2 = m_indexesByUid.find(uid);
-                    if (uidIt2 == m_indexesByUid.end()) return;
+            if (exact) {
+                if (ownCandidates.empty()) continue;
 
-                    for (quint64 i = start; i < end; ++i) {
-                        const quint64 idxPos = desc ? (totalHitsOut - 1 - i) : i;
-                        const auto& e = cache->asc[static_cast<size_t>(idxPos)];
+                fresh.totalHits += static_cast<quint64>(ownCandidates.size());
+                fresh.deviceIds.push_back(devId);
+                fresh.hitsByDevice.push_back(std::move(ownCandidates));
+                continue;
+            }
 
-                        auto devIt = uidIt2->second.find(e.deviceId);
-                        if (devIt == uidIt2->second.end()) continue;
+            const auto& candidates = *candidatesPtr;
+            if (candidates.empty()) continue;
 
-                        const DeviceIndex& devIdx = devIt->second;
-                        if (e.recordIdx >= devIdx.records.size()) continue;
+            const auto refineStart = std::chrono::steady_clock::now();
+            tbb::enumerable_thread_specific<std::vector<quint32>> tlsHits;
 
-                        const auto& r = devIdx.records[e.recordIdx];
-                        std::string_view nm(devIdx.stringPool.data() + r.nameOffset, r.nameLen);
+            // Parallel refinement: check the filter's rank bounds, then tokens against name (case-insensitive substring)
+            tbb::parallel_for(
+                tbb::blocked_range<size_t>(0, candidates.size(), 4096),
+                [&](const tbb::blocked_range<size_t>& r) {
+                    if (cancel.cancelled()) return;
 
-                        const quint64 entryId = makeEntryId(e.deviceId, e.recordIdx);
-                        const quint32 flags = (r.isDir ? kFlagIsDir : 0u) | (r.isSymlink ? kFlagIsSymlink : 0u);
+                    auto& local = tlsHits.local();
+                    local.reserve(local.size() + (r.size() / 8)); // small heuristic
 
-                        QVariantList row;
-                        row.reserve(7);
-                        row << QVariant::fromValue(entryId)
-                            << QVariant::fromValue(e.deviceId)
-                            << QVariant::fromValue(QString::fromUtf8(nm.data(), static_cast<int>(nm.size())))
-                            << QVariant::fromValue(r.parentRecordIdx)
-                            << QVariant::fromValue(static_cast<quint64>(r.size))
-                            << QVariant::fromValue(static_cast<qint64>(r.modificationTime))
-                            << QVariant::fromValue(flags);
+                    for (size_t i = r.begin(); i != r.end(); ++i) {
+                        const quint32 recIdx = candidates[i];
+                        if (filter.boundsActive() && !filterAdmits(idx, filter, bounds, recIdx)) continue;
+                        if (checkExtension && !extensionMatches(idx, filter, recIdx)) continue;
 
-                        rowsOut.push_back(row);
+                        if (namesMatched || tokens.isEmpty() ||
+                            matcher.matchesFolded(idx.records.name(recIdx, idx.foldedPool.data()))) {
+                            local.push_back(recIdx);
+                        }
                     }
-                    return;
                 }
+            );
+
+            // A cancelled refine is incomplete; never cache it
+            if (cancel.cancelled()) return false;
+
+            // Merge thread-local buffers
+            size_t totalLocal = 0;
+            for (const auto& v : tlsHits) totalLocal += v.size();
+
+            std::vector<quint32> hits;
+            hits.reserve(totalLocal);
+            for (auto& v : tlsHits) {
+                hits.insert(hits.end(), v.begin(), v.end());
+            }
+
+            if (trace) {
+                trace->candidates += candidates.size();
+                trace->refineNs += nsSince(refineStart);
             }
+            if (hits.empty()) continue;
 
-            // If heuristic says "not far" OR cache wasn't available, fall through to old merge path below.
+            fresh.totalHits += static_cast<quint64>(hits.size());
+            fresh.deviceIds.push_back(devId);
+            fresh.hitsByDevice.push_back(std::move(hits));
         }
 
-        // Fallback: old merge behavior (used when deviceIds filter is active, or cache rebuild failed)
-        quint64 total = 0;
+        {
+            std::lock_guard lock(m_searchCacheMutex);
+            storeSearchSession(uid, freshPtr);
+        }
+        session = std::move(freshPtr);
+    }
 
-        struct Cursor {
-            const QString* deviceId = nullptr;
-            const DeviceIndex* idx = nullptr;
-            const std::vector<quint32>* order = nullptr;
-            quint32 pos = 0;
-        };
-        std::vector<Cursor> cursors;
-        cursors.reserve(indexes.size());
-
-        auto pickOrder = [&](const DeviceIndex& idx) -> const std::vector<quint32>* {
-            if (sortKey.compare(QStringLiteral("size"), Qt::CaseInsensitive) == 0) return &idx.orderBySize;
-            if (sortKey.compare(QStringLiteral("mtime"), Qt::CaseInsensitive) == 0) return &idx.orderByMtime;
-            if (sortKey.compare(QStringLiteral("path"), Qt::CaseInsensitive) == 0) return &idx.orderByPath;
-            return &idx.orderByName; // default
-        };
+    totalHitsOut = session->totalHits;
+    if (limit == 0 || totalHitsOut == 0) {
+        return true;
+    }
 
-        for (const auto& kv : indexes) {
-            if (!deviceAllowed(kv.first)) continue;
-            const DeviceIndex& idx = kv.second;
-            total += static_cast<quint64>(idx.records.size());
+    std::vector<const DeviceIndex*> sessionIndexes;
+    std::vector<const QString*> sessionDeviceIds;
+    sessionIndexes.reserve(session->deviceIds.size());
+    sessionDeviceIds.reserve(session->deviceIds.size());
+    for (const QString& devId : session->deviceIds) {
+        auto it = indexes.find(devId);
+        sessionIndexes.push_back(it != indexes.end() ? it->second.get() : nullptr);
+        sessionDeviceIds.push_back(it != indexes.end() ? &it->first : nullptr);
+    }
 
-            const auto* ord = pickOrder(idx);
-            if (!ord || ord->empty()) continue;
+    const QString hitsOrderKey = key + (desc ? QStringLiteral(":desc") : QStringLiteral(":asc"));
+    const quint64 endPos = static_cast<quint64>(offset) + static_cast<quint64>(limit);
 
-            Cursor c;
-            c.deviceId = &kv.first;
-            c.idx = &idx;
-            c.order = ord;
-            c.pos = 0;
-            cursors.push_back(c);
-        }
+    // The first page of a big result only needs its top offset+limit hits. Any later page (scrolling)
+    // or a small result orders the whole session once, so following pages are plain slices.
+    std::vector<SessionHit> topPage;
+    std::shared_ptr<const OrderedHits> cachedOrder;
+    {
+        std::lock_guard lock(m_searchCacheMutex);
+        cachedOrder = session->ordered;
+    }
 
-        totalHitsOut = total;
-        if (limit == 0 || total == 0) return;
+    const std::vector<SessionHit>* ordered = nullptr;
 
-        auto nameView = [&](const DeviceIndex& idx, quint32 recIdx) -> std::string_view {
-            const auto& r = idx.records[recIdx];
-            return std::string_view(idx.stringPool.data() + r.nameOffset, r.nameLen);
-        };
+    const auto orderStart = std::chrono::steady_clock::now();
 
-        auto lessNode = [&](const Cursor& a, const Cursor& b) {
-            const quint32 ai = (*a.order)[desc ? (static_cast<quint32>(a.order->size() - 1 - a.pos)) : a.pos];
-            const quint32 bi = (*b.order)[desc ? (static_cast<quint32>(b.order->size() - 1 - b.pos)) : b.pos];
-
-            if (sortKey.compare(QStringLiteral("size"), Qt::CaseInsensitive) == 0) {
-                const auto sa = a.idx->records[ai].size;
-                const auto sb = b.idx->records[bi].size;
-                if (sa != sb) return sa > sb; // reversed for min-heap emulation
-            } else if (sortKey.compare(QStringLiteral("mtime"), Qt::CaseInsensitive) == 0) {
-                const auto ta = a.idx->records[ai].modificationTime;
-                const auto tb = b.idx->records[bi].modificationTime;
-                if (ta != tb) return ta > tb;
-            } else if (sortKey.compare(QStringLiteral("path"), Qt::CaseInsensitive) == 0) {
-                const auto pa = a.idx->records[ai].parentRecordIdx;
-                const auto pb = b.idx->records[bi].parentRecordIdx;
-                if (pa != pb) return pa > pb;
-            }
-
-            const int c = ciCompareBytes(nameView(*a.idx, ai), nameView(*b.idx, bi));
-            if (c != 0) return c > 0;
-
-            // tie-breakers: deviceId then recordIdx
-            if (*a.deviceId != *b.deviceId) return *a.deviceId > *b.deviceId;
-            return ai > bi;
-        };
+    if (cachedOrder && cachedOrder->orderKey == hitsOrderKey) {
+        ordered = &cachedOrder->hits;
+    } else if (offset == 0 && totalHitsOut > kSessionEagerOrderHits) {
+        topPage = orderSearchHits(*session, sessionIndexes, sortKey, desc, endPos, cancel);
+        if (cancel.cancelled()) return false;
+        ordered = &topPage;
+    } else {
+        auto built = std::make_shared<OrderedHits>();
+        built->orderKey = hitsOrderKey;
+        built->hits = orderSearchHits(*session, sessionIndexes, sortKey, desc, totalHitsOut, cancel);
+        if (cancel.cancelled()) return false;
+        cachedOrder = built;
+        ordered = &cachedOrder->hits;
+
+        std::lock_guard lock(m_searchCacheMutex);
+        session->ordered = std::move(built);
+        trimSearchSessions(session.get());
+    }
+
+    if (trace) trace->orderNs += nsSince(orderStart);
+
+    const quint64 end = std::min<quint64>(endPos, ordered->size());
+    if (static_cast<quint64>(offset) >= end) {
+        return true;
+    }
+
+    hitsOut.reserve(static_cast<size_t>(end - offset));
 
-        std::priority_queue<Cursor, std::vector<Cursor>, decltype(lessNode)> pq(lessNode);
-        for (const auto& c : cursors) pq.push(c);
+    for (quint64 i = offset; i < end; ++i) {
+        const SessionHit& h = (*ordered)[static_cast<size_t>(i)];
+        const DeviceIndex* devIdx = sessionIndexes[h.deviceOrdinal];
+        if (!devIdx || h.recordIdx >= devIdx->records.size()) continue;
+
+        hitsOut.push_back(PageHit{sessionDeviceIds[h.deviceOrdinal], devIdx, h.recordIdx});
+    }
 
-        quint64 globalPos = 0;
-        const quint64 endPos = static_cast<quint64>(offset) + static_cast<quint64>(limit);
+    return true;
+}
 
-        while (!pq.empty() && globalPos < endPos) {
-            Cursor cur = pq.top();
-            pq.pop();
+void IndexerService::Search(const QString& query,
+                            const QStringList& deviceIds,
+                            const QString& sortKey,
+                            const QString& sortDir,
+                            quint32 offset,
+                            quint32 limit,
+                            const QVariantMap& options,
+                            quint64& totalHitsOut,
+                            QVariantList& rowsOut) const {
+    const quint32 uid = callerUidOr0();
+    ensureLoadedForUid(uid);
 
-            const quint32 ordIdx = desc
-                ? static_cast<quint32>(cur.order->size() - 1 - cur.pos)
-                : cur.pos;
+    totalHitsOut = 0;
+    rowsOut.clear();
 
-            const quint32 recIdx = (*cur.order)[ordIdx];
+    const auto received = std::chrono::steady_clock::now();
+    const SearchCancel cancel = searchCancelFor(options);
+    const SearchFilter filter = searchFilterFor(options);
+    const bool timings = options.value(QStringLiteral("timings")).toBool();
+
+    // Answer from a search worker; the D-Bus reply is sent from there
+    auto snap = std::make_shared<const SearchSnapshot>(searchSnapshotForUid(uid));
+    setDelayedReply(true);
+    const QDBusMessage request = message();
+    QDBusConnection conn = connection();
+
+    m_searchPool->start([this, snap, cancel, filter, timings, received, request, conn, query, deviceIds, sortKey,
+                         sortDir, offset, limit]() mutable {
+        SearchTrace trace;
+        trace.queuedNs = nsSince(received);
+
+        quint64 totalHits = 0;
+        std::vector<PageHit> hits;
+        if (cancel.cancelled() ||
+            !collectSearchPage(*snap, cancel, filter, query, deviceIds, sortKey, sortDir, offset, limit, totalHits, hits,
+                               &trace)) {
+            conn.send(searchCancelledReply(request));
+            return;
+        }
 
-            if (globalPos >= offset) {
-                const auto& r = cur.idx->records[recIdx];
-                std::string_view nm = nameView(*cur.idx, recIdx);
+        const auto marshalStart = std::chrono::steady_clock::now();
+        QVariantList args{
+            QVariant::fromValue(static_cast<qulonglong>(totalHits)),
+            QVariant::fromValue(rowsForHits(hits)),
+        };
+        trace.marshalNs = nsSince(marshalStart);
+        trace.hits = totalHits;
 
-                const quint64 entryId = makeEntryId(*cur.deviceId, recIdx);
-                const quint32 flags = (r.isDir ? kFlagIsDir : 0u) | (r.isSymlink ? kFlagIsSymlink : 0u);
+        sendSearchReply(conn, request, std::move(args), trace, received, timings);
+    });
+}
 
-                QVariantList row;
-                row.reserve(7);
-                row << QVariant::fromValue(entryId)
-                    << QVariant::fromValue(*cur.deviceId)
-                    << QVariant::fromValue(QString::fromUtf8(nm.data(), static_cast<int>(nm.size())))
-                    << QVariant::fromValue(r.parentRecordIdx)
-                    << QVariant::fromValue(static_cast<quint64>(r.size))
-                    << QVariant::fromValue(static_cast<qint64>(r.modificationTime))
-                    << QVariant::fromValue(flags);
+void IndexerService::SearchPacked(const QString& query,
+                                  const QStringList& deviceIds,
+                                  const QString& sortKey,
+                                  const QString& sortDir,
+                                  quint32 offset,
+                                  quint32 limit,
+                                  const QVariantMap& options,
+                                  quint64& totalHitsOut,
+                                  QByteArray& packedOut) const {
+    const quint32 uid = callerUidOr0();
+    ensureLoadedForUid(uid);
 
-                rowsOut.push_back(row);
-            }
+    totalHitsOut = 0;
+    packedOut.clear();
+
+    const auto received = std::chrono::steady_clock::now();
+    const SearchCancel cancel = searchCancelFor(options);
+    const SearchFilter filter = searchFilterFor(options);
+    const bool includePaths = options.value(QStringLiteral("includePaths")).toBool();
+    const bool timings = options.value(QStringLiteral("timings")).toBool();
+
+    auto snap = std::make_shared<const SearchSnapshot>(searchSnapshotForUid(uid));
+    setDelayedReply(true);
+    const QDBusMessage request = message();
+    QDBusConnection conn = connection();
+
+    m_searchPool->start([this, snap, cancel, filter, includePaths, timings, received, request, conn, query, deviceIds,
+                         sortKey, sortDir, offset, limit]() mutable {
+        SearchTrace trace;
+        trace.queuedNs = nsSince(received);
+
+        quint64 totalHits = 0;
+        std::vector<PageHit> hits;
+        if (cancel.cancelled() ||
+            !collectSearchPage(*snap, cancel, filter, query, deviceIds, sortKey, sortDir, offset, limit, totalHits, hits,
+                               &trace)) {
+            conn.send(searchCancelledReply(request));
+            return;
+        }
+        trace.hits = totalHits;
 
-            ++globalPos;
+        if (!includePaths || hits.empty()) {
+            const auto marshalStart = std::chrono::steady_clock::now();
+            QVariantList args{
+                QVariant::fromValue(static_cast<qulonglong>(totalHits)),
+                QVariant::fromValue(packedPageForHits(hits)),
+            };
+            trace.marshalNs = nsSince(marshalStart);
 
-            ++cur.pos;
-            if (cur.pos < cur.order->size()) {
-                pq.push(cur);
-            }
+            sendSearchReply(conn, request, std::move(args), trace, received, timings);
+            return;
         }
 
-        return;
+        // Directory paths come from the main-thread caches (DirPathResolver isn't thread-safe);
+        // snap keeps the hits' indexes alive until then
+        auto* self = const_cast<IndexerService*>(this);
+        QMetaObject::invokeMethod(self, [self, snap, request, conn, totalHits, hits = std::move(hits), trace, received,
+                                         timings]() mutable {
+            const auto marshalStart = std::chrono::steady_clock::now();
+            const std::vector<PageDir> dirs = self->pageDirectoriesFor(hits);
+            QVariantList args{
+                QVariant::fromValue(static_cast<qulonglong>(totalHits)),
+                QVariant::fromValue(packedPageForHits(hits, dirs)),
+            };
+            trace.marshalNs = nsSince(marshalStart);
+
+            self->sendSearchReply(conn, request, std::move(args), trace, received, timings);
+        });
+    });
+}
+
+void IndexerService::sendSearchReply(QDBusConnection& conn, const QDBusMessage& request, QVariantList args,
+                                     SearchTrace& trace, std::chrono::steady_clock::time_point received,
+                                     bool withTimings) const {
+    trace.totalNs = nsSince(received);
+
+    {
+        std::lock_guard lock(m_searchCacheMutex);
+        SearchStats& st = m_searchStats;
+        SearchTrace& sum = st.totals;
+
+        ++st.searches;
+        if (trace.path == QStringLiteral("empty")) ++st.emptyQueries;
+        sum.queuedNs += trace.queuedNs;
+        sum.candidatesNs += trace.candidatesNs;
+        sum.refineNs += trace.refineNs;
+        sum.orderNs += trace.orderNs;
+        sum.mergeNs += trace.mergeNs;
+        sum.marshalNs += trace.marshalNs;
+        sum.totalNs += trace.totalNs;
+        sum.trigramRanges += trace.trigramRanges;
+        sum.candidates += trace.candidates;
+        sum.hits += trace.hits;
+        st.maxTotalNs = std::max(st.maxTotalNs, trace.totalNs);
+
+        // Bucket b: under 2^b ms (bucket 0: under 1 ms)
+        const quint64 ms = trace.totalNs / 1'000'000;
+        const size_t bucket = ms == 0 ? 0 : static_cast<size_t>(std::bit_width(ms));
+        ++st.latencyHistogram[std::min(bucket, SearchStats::kLatencyBuckets - 1)];
+    }
+
+    if (withTimings) {
+        args.push_back(trace.toVariantMap());
     }
+    conn.send(request.createReply(args));
+}
 
-    // ---- Non-empty query: trigram filter + refine ----
+QVariantMap IndexerService::SearchTrace::toVariantMap() const {
+    QVariantMap m;
+    m.insert(QStringLiteral("queuedNs"), static_cast<qulonglong>(queuedNs));
+    m.insert(QStringLiteral("candidatesNs"), static_cast<qulonglong>(candidatesNs));
+    m.insert(QStringLiteral("refineNs"), static_cast<qulonglong>(refineNs));
+    m.insert(QStringLiteral("orderNs"), static_cast<qulonglong>(orderNs));
+    m.insert(QStringLiteral("mergeNs"), static_cast<qulonglong>(mergeNs));
+    m.insert(QStringLiteral("marshalNs"), static_cast<qulonglong>(marshalNs));
+    m.insert(QStringLiteral("totalNs"), static_cast<qulonglong>(totalNs));
+    m.insert(QStringLiteral("trigramRanges"), static_cast<qulonglong>(trigramRanges));
+    m.insert(QStringLiteral("candidates"), static_cast<qulonglong>(candidates));
+    m.insert(QStringLiteral("hits"), static_cast<qulonglong>(hits));
+    m.insert(QStringLiteral("path"), path);
+    return m;
+}
 
-    struct DeviceHits {
-        const QString* deviceId = nullptr;
-        const DeviceIndex* idx = nullptr;
-        std::vector<quint32> hits; // recordIdx, sorted by rank (ascending)
-    };
+QVariantList IndexerService::rowsForHits(const std::vector<PageHit>& hits) {
+    QVariantList rowsOut;
+    rowsOut.reserve(static_cast<int>(hits.size()));
 
-    auto pickRank = [&](const DeviceIndex& idx) -> const std::vector<quint32>& {
-        if (sortKey.compare(QStringLiteral("size"), Qt::CaseInsensitive) == 0) return idx.rankBySize;
-        if (sortKey.compare(QStringLiteral("mtime"), Qt::CaseInsensitive) == 0) return idx.rankByMtime;
-        if (sortKey.compare(QStringLiteral("path"), Qt::CaseInsensitive) == 0) return idx.rankByPath;
-        return idx.rankByName;
-    };
+    for (const PageHit& h : hits) {
+        const auto& r = h.idx->records[h.recordIdx];
+        std::string_view nm(h.idx->stringPool.data() + r.nameOffset, r.nameLen);
 
-    const std::vector<QByteArray> tokBytes = [&]() {
-        std::vector<QByteArray> out;
-        out.reserve(tokens.size());
-        for (const auto& t : tokens) out.push_back(t.toUtf8());
-        return out;
-    }();
+        const quint64 entryId = makeEntryId(*h.deviceId, h.recordIdx);
+        const quint32 flags = (r.isDir ? kFlagIsDir : 0u) | (r.isSymlink ? kFlagIsSymlink : 0u);
 
-    std::vector<DeviceHits> perDev;
-    perDev.reserve(indexes.size());
+        QVariantList row;
+        row.reserve(7);
+        row << QVariant::fromValue(entryId)
+            << QVariant::fromValue(*h.deviceId)
+            << QVariant::fromValue(QString::fromUtf8(nm.data(), static_cast<int>(nm.size())))
+            << QVariant::fromValue(r.parentRecordIdx)
+            << QVariant::fromValue(static_cast<quint64>(r.size))
+            << QVariant::fromValue(static_cast<qint64>(r.modificationTime))
+            << QVariant::fromValue(flags);
 
-    totalHitsOut = 0;
+        rowsOut.push_back(row);
+    }
 
-    for (const auto& kv : indexes) {
-        const QString& devId = kv.first;
-        if (!deviceAllowed(devId)) continue;
+    return rowsOut;
+}
+
+QByteArray IndexerService::packedPageForHits(const std::vector<PageHit>& hits, const std::vector<PageDir>& dirs) {
+    // Device table: each distinct deviceId once, in order of first appearance
+    std::vector<const QString*> devices;
+    std::vector<QByteArray> deviceBytes;
+    std::vector<quint16> ordinals(hits.size(), 0);
+
+    size_t nameBytes = 0;
+    for (size_t i = 0; i < hits.size(); ++i) {
+        const PageHit& h = hits[i];
+
+        size_t d = 0;
+        while (d < devices.size() && *devices[d] != *h.deviceId) ++d;
+        if (d == devices.size()) {
+            devices.push_back(h.deviceId);
+            deviceBytes.push_back(h.deviceId->toUtf8());
+        }
+        ordinals[i] = static_cast<quint16>(d);
 
-        const DeviceIndex& idx = kv.second;
-        const auto candidates = deviceCandidatesForQuery(idx, tokens);
-        if (candidates.empty()) continue;
+        nameBytes += h.idx->records[h.recordIdx].nameLen;
+    }
 
-        tbb::enumerable_thread_specific<std::vector<quint32>> tlsHits;
+    size_t tableBytes = 0;
+    for (const auto& b : deviceBytes) tableBytes += sizeof(quint16) + static_cast<size_t>(b.size());
 
-        // Parallel refinement: check tokens against name (case-insensitive substring)
-        tbb::parallel_for(
-            tbb::blocked_range<size_t>(0, candidates.size(), 4096),
-            [&](const tbb::blocked_range<size_t>& r) {
-                auto& local = tlsHits.local();
-                local.reserve(local.size() + (r.size() / 8)); // small heuristic
+    // Directory table (includePaths): every dir's device already appears in the rows
+    std::vector<QByteArray> dirPaths;
+    dirPaths.reserve(dirs.size());
+    size_t pathBytes = 0;
+    for (const PageDir& d : dirs) {
+        dirPaths.push_back(d.path.toUtf8());
+        pathBytes += static_cast<size_t>(dirPaths.back().size());
+    }
 
-                for (size_t i = r.begin(); i != r.end(); ++i) {
-                    const quint32 recIdx = candidates[i];
-                    const auto& rec = idx.records[recIdx];
-                    std::string_view nm(idx.stringPool.data() + rec.nameOffset, rec.nameLen);
+    const size_t rowsAt = SearchProtocol::align8(sizeof(SearchProtocol::PageHeader) + tableBytes);
+    const size_t namesAt = rowsAt + hits.size() * sizeof(SearchProtocol::Row);
+    const size_t dirsAt = dirs.empty() ? namesAt + nameBytes : SearchProtocol::align8(namesAt + nameBytes);
+    const size_t pathsAt = dirsAt + dirs.size() * sizeof(SearchProtocol::DirEntry);
+
+    QByteArray packedOut(static_cast<qsizetype>(pathsAt + pathBytes), '\0');
+    char* out = packedOut.data();
+
+    SearchProtocol::PageHeader hdr{};
+    hdr.magic = SearchProtocol::kMagic;
+    hdr.version = SearchProtocol::kVersion;
+    hdr.deviceCount = static_cast<uint16_t>(devices.size());
+    hdr.rowCount = static_cast<uint32_t>(hits.size());
+    hdr.rowSize = sizeof(SearchProtocol::Row);
+    hdr.nameBytes = static_cast<uint32_t>(nameBytes);
+    hdr.dirCount = static_cast<uint32_t>(dirs.size());
+    std::memcpy(out, &hdr, sizeof(hdr));
+
+    size_t pos = sizeof(hdr);
+    for (const auto& b : deviceBytes) {
+        const auto len = static_cast<quint16>(b.size());
+        std::memcpy(out + pos, &len, sizeof(len));
+        std::memcpy(out + pos + sizeof(len), b.constData(), len);
+        pos += sizeof(len) + len;
+    }
 
-                    for (const auto& tb : tokBytes) {
-                        const std::string_view needle(tb.constData(), static_cast<size_t>(tb.size()));
-                        if (!nameContainsCaseInsensitive(nm, needle)) {
-                            goto no_match;
-                        }
-                    }
+    size_t nameAt = 0;
+    for (size_t i = 0; i < hits.size(); ++i) {
+        const PageHit& h = hits[i];
+        const auto& r = h.idx->records[h.recordIdx];
+
+        SearchProtocol::Row row{};
+        row.entryId = makeEntryId(*h.deviceId, h.recordIdx);
+        row.size = r.size;
+        row.mtime = r.modificationTime;
+        row.dirId = r.parentRecordIdx;
+        row.flags = (r.isDir ? kFlagIsDir : 0u) | (r.isSymlink ? kFlagIsSymlink : 0u);
+        row.nameOffset = static_cast<uint32_t>(nameAt);
+        row.nameLen = r.nameLen;
+        row.deviceOrdinal = ordinals[i];
+        std::memcpy(out + rowsAt + i * sizeof(row), &row, sizeof(row));
+
+        std::memcpy(out + namesAt + nameAt, h.idx->stringPool.data() + r.nameOffset, r.nameLen);
+        nameAt += r.nameLen;
+    }
 
-                    local.push_back(recIdx);
+    size_t pathAt = 0;
+    for (size_t i = 0; i < dirs.size(); ++i) {
+        size_t d = 0;
+        while (d < devices.size() && *devices[d] != *dirs[i].deviceId) ++d;
 
-                no_match:
-                    (void)0;
-                }
-            }
-        );
+        SearchProtocol::DirEntry entry{};
+        entry.dirId = dirs[i].dirId;
+        entry.pathOffset = static_cast<uint32_t>(pathAt);
+        entry.pathLen = static_cast<uint32_t>(dirPaths[i].size());
+        entry.deviceOrdinal = static_cast<uint16_t>(d);
+        std::memcpy(out + dirsAt + i * sizeof(entry), &entry, sizeof(entry));
 
-        // Merge thread-local buffers
-        DeviceHits dh;
-        dh.deviceId = &devId;
-        dh.idx = &idx;
+        std::memcpy(out + pathsAt + pathAt, dirPaths[i].constData(), static_cast<size_t>(dirPaths[i].size()));
+        pathAt += static_cast<size_t>(dirPaths[i].size());
+    }
+
+    return packedOut;
+}
+
+std::vector<IndexerService::PageDir> IndexerService::pageDirectoriesFor(const std::vector<PageHit>& hits) const {
+    // Distinct dirIds per device index, in order of first appearance
+    struct DeviceDirs {
+        const QString* deviceId = nullptr;
+        const DeviceIndex* idx = nullptr;
+        std::vector<quint32> dirIds;
+        std::unordered_set<quint32> seen;
+    };
+    std::vector<DeviceDirs> perDevice;
+
+    for (const PageHit& h : hits) {
+        auto it = std::find_if(perDevice.begin(), perDevice.end(), [&](const DeviceDirs& d) { return d.idx == h.idx; });
+        if (it == perDevice.end()) {
+            perDevice.push_back(DeviceDirs{h.deviceId, h.idx, {}, {}});
+            it = perDevice.end() - 1;
+        }
+
+        const quint32 dirId = h.idx->records.parents[h.recordIdx];
+        if (it->seen.insert(dirId).second) it->dirIds.push_back(dirId);
+    }
 
-        size_t totalLocal = 0;
-        for (const auto& v : tlsHits) totalLocal += v.size();
+    std::vector<PageDir> out;
+    for (const DeviceDirs& d : perDevice) {
+        // One pass per device, as in ResolveDirectories: shared ancestors are resolved once
+        std::vector<QString> internals;
+        d.idx->dirPaths.resolveMany(dirTreeFor(*d.idx), d.dirIds, internals);
 
-        dh.hits.reserve(totalLocal);
-        for (auto& v : tlsHits) {
-            dh.hits.insert(dh.hits.end(), v.begin(), v.end());
+        const QString prefix = directoryDisplayPrefix(*d.deviceId);
+        for (size_t i = 0; i < d.dirIds.size(); ++i) {
+            out.push_back(PageDir{d.deviceId, d.dirIds[i], joinDisplayPrefix(prefix, internals[i])});
         }
+    }
+    return out;
+}
+
+std::vector<IndexerService::SessionHit> IndexerService::orderSearchHits(const SearchSession& session,
+                                                                        const std::vector<const DeviceIndex*>& indexes,
+                                                                        const QString& sortKey,
+                                                                        bool desc,
+                                                                        quint64 need,
+                                                                        const SearchCancel& cancel) {
+    auto pickRank = [&](const DeviceIndex& idx) -> const MappedArray<quint32>& {
+        if (sortKey.compare(QStringLiteral("size"), Qt::CaseInsensitive) == 0) return idx.rankBySize;
+        if (sortKey.compare(QStringLiteral("mtime"), Qt::CaseInsensitive) == 0) return idx.rankByMtime;
+        if (sortKey.compare(QStringLiteral("path"), Qt::CaseInsensitive) == 0) return idx.rankByPath;
+        return idx.rankByName;
+    };
 
-        if (dh.hits.empty()) continue;
+    struct DeviceHits {
+        quint32 ordinal = 0;
+        const DeviceIndex* idx = nullptr;
+        std::vector<quint32> hits; // recordIdx; only the first `need`, in page order (asc/desc applied)
+    };
+
+    std::vector<DeviceHits> perDev;
+    perDev.reserve(session.hitsByDevice.size());
+
+    for (size_t d = 0; d < session.hitsByDevice.size(); ++d) {
+        const DeviceIndex* idx = indexes[d];
+        if (!idx || session.hitsByDevice[d].empty()) continue;
+        if (cancel.cancelled()) return {};
 
-        totalHitsOut += static_cast<quint64>(dh.hits.size());
+        DeviceHits dh;
+        dh.ordinal = static_cast<quint32>(d);
+        dh.idx = idx;
+        dh.hits = session.hitsByDevice[d];
 
-        const auto& rank = pickRank(idx);
-        auto cmpByRankAsc = [&](quint32 a, quint32 b) {
+        const auto& rank = pickRank(*idx);
+        auto cmpByPageOrder = [&](quint32 a, quint32 b) {
             const quint32 ra = rank[a];
             const quint32 rb = rank[b];
-            if (ra != rb) return ra < rb;
-            return a < b;
+            if (ra != rb) return desc ? (ra > rb) : (ra < rb);
+            return desc ? (a > b) : (a < b);
         };
 
+        // No page can come from beyond the first `need` hits of any single device, so select
+        // those (nth_element) and sort only them instead of sorting every hit.
+        const bool par = dh.hits.size() >= 200'000;
+
+        if (need < dh.hits.size()) {
+            const auto nth = dh.hits.begin() + static_cast<std::ptrdiff_t>(need);
+            if (par) {
+                std::nth_element(std::execution::par, dh.hits.begin(), nth, dh.hits.end(), cmpByPageOrder);
+            } else {
+                std::nth_element(dh.hits.begin(), nth, dh.hits.end(), cmpByPageOrder);
+            }
+            dh.hits.resize(static_cast<size_t>(need));
+            dh.hits.shrink_to_fit();
+        }
+
         if (dh.hits.size() >= 200'000) {
-            std::sort(std::execution::par, dh.hits.begin(), dh.hits.end(), cmpByRankAsc);
+            std::sort(std::execution::par, dh.hits.begin(), dh.hits.end(), cmpByPageOrder);
         } else {
-            std::sort(dh.hits.begin(), dh.hits.end(), cmpByRankAsc);
+            std::sort(dh.hits.begin(), dh.hits.end(), cmpByPageOrder);
         }
 
         perDev.push_back(std::move(dh));
     }
 
-    if (limit == 0 || totalHitsOut == 0) {
-        return;
-    }
-
-    // k-way merge across devices for the requested page
+    // k-way merge across devices
     struct Node {
         size_t devIdx = 0;
-        quint32 pos = 0; // position within that device's logical stream (asc or desc)
-    };
-
-    auto hitAt = [&](const DeviceHits& dh, quint32 pos) -> quint32 {
-        // dh.hits is always stored ascending by rank.
-        if (!desc) {
-            return dh.hits[pos];
-        }
-        const size_t n = dh.hits.size();
-        return dh.hits[(n - 1u) - static_cast<size_t>(pos)];
+        quint32 pos = 0; // position within that device's page-ordered hits
     };
 
     auto nodeLess = [&](const Node& a, const Node& b) {
         const DeviceHits& da = perDev[a.devIdx];
         const DeviceHits& db = perDev[b.devIdx];
 
-        const quint32 ra = hitAt(da, a.pos);
-        const quint32 rb = hitAt(db, b.pos);
-
-        const auto& rankA = pickRank(*da.idx);
-        const auto& rankB = pickRank(*db.idx);
+        const quint32 ra = da.hits[a.pos];
+        const quint32 rb = db.hits[b.pos];
 
-        // Compare by rank, honoring desc by flipping
-        const quint32 ka = rankA[ra];
-        const quint32 kb = rankB[rb];
+        // Compare by rank
+        const quint32 ka = pickRank(*da.idx)[ra];
+        const quint32 kb = pickRank(*db.idx)[rb];
 
         // priority_queue is max-heap; return true when "a should come after b"
         if (ka != kb) return ka > kb;
 
         // tie-breakers for deterministic paging
-        if (*da.deviceId != *db.deviceId) {
-            return (*da.deviceId > *db.deviceId);
+        const QString& devA = session.deviceIds[static_cast<int>(da.ordinal)];
+        const QString& devB = session.deviceIds[static_cast<int>(db.ordinal)];
+        if (devA != devB) {
+            return devA > devB;
         }
         return ra > rb;
     };
 
     std::priority_queue<Node, std::vector<Node>, decltype(nodeLess)> pq(nodeLess);
 
+    size_t available = 0;
     for (size_t i = 0; i < perDev.size(); ++i) {
-        if (!perDev[i].hits.empty()) {
-            pq.push(Node{i, 0});
-        }
+        available += perDev[i].hits.size();
+        pq.push(Node{i, 0});
     }
 
-    quint64 globalPos = 0;
-    const quint64 endPos = static_cast<quint64>(offset) + static_cast<quint64>(limit);
+    std::vector<SessionHit> out;
+    out.reserve(static_cast<size_t>(std::min<quint64>(need, available)));
+
+    while (!pq.empty() && out.size() < need) {
+        if ((out.size() & 0xFFFF) == 0 && cancel.cancelled()) return {};
 
-    while (!pq.empty() && globalPos < endPos) {
         Node n = pq.top();
         pq.pop();
 
-        DeviceHits& dh = perDev[n.devIdx];
-        const quint32 recIdx = hitAt(dh, n.pos);
-        const auto& r = dh.idx->records[recIdx];
+        const DeviceHits& dh = perDev[n.devIdx];
+        out.push_back(SessionHit{dh.ordinal, dh.hits[n.pos]});
 
-        if (globalPos >= offset) {
-            std::string_view nm(dh.idx->stringPool.data() + r.nameOffset, r.nameLen);
+        ++n.pos;
+        if (n.pos < static_cast<quint32>(dh.hits.size())) {
+            pq.push(n);
+        }
+    }
 
-            const quint64 entryId = makeEntryId(*dh.deviceId, recIdx);
-            const quint32 flags = (r.isDir ? kFlagIsDir : 0u) | (r.isSymlink ? kFlagIsSymlink : 0u);
+    return out;
+}
 
-            QVariantList row;
-            row.reserve(7);
-            row << QVariant::fromValue(entryId)
-                << QVariant::fromValue(*dh.deviceId)
-                << QVariant::fromValue(QString::fromUtf8(nm.data(), static_cast<int>(nm.size())))
-                << QVariant::fromValue(r.parentRecordIdx)
-                << QVariant::fromValue(static_cast<quint64>(r.size))
-                << QVariant::fromValue(static_cast<qint64>(r.modificationTime))
-                << QVariant::fromValue(flags);
+QString IndexerService::directoryDisplayPrefix(const QString& deviceId) const {
+    // Mount point preferred
+    const auto devOpt = findDeviceById(deviceId);
+    if (devOpt) {
+        const QVariantMap dev = *devOpt;
+        const bool mounted = dev.value(QStringLiteral("mounted")).toBool();
+        const QString mp = dev.value(QStringLiteral("primaryMountPoint")).toString().trimmed();
+        const QString label = dev.value(QStringLiteral("label")).toString().trimmed();
 
-            rowsOut.push_back(row);
-        }
+        if (mounted && !mp.isEmpty()) return mp;
+        if (!label.isEmpty()) return QStringLiteral("[") + label + QStringLiteral("]");
+    }
+    return QStringLiteral("[") + deviceId + QStringLiteral("]");
+}
 
-        ++globalPos;
+QString IndexerService::joinDisplayPrefix(const QString& prefix, const QString& internalPath) {
+    // internalPath is like "/foo/bar" or "/"
+    if (prefix.isEmpty()) return internalPath;
 
-        ++n.pos;
-        if (n.pos < static_cast<quint32>(dh.hits.size())) {
-            pq.push(n);
-        }
+    // If prefix is a mount point like "/mnt/Data", prefer "/mnt/Data" + "/foo"
+    if (prefix.startsWith('/')) {
+        if (internalPath == QStringLiteral("/")) return prefix;
+        return prefix + internalPath;
     }
+
+    // If prefix is "[Label]" use "[Label]/foo"
+    if (internalPath == QStringLiteral("/")) return prefix + QStringLiteral("/");
+    return prefix + internalPath;
 }
 
 void IndexerService::ResolveDirectories(const QString& deviceId,
@@ -1992,53 +4784,26 @@ void IndexerService::ResolveDirectories(const QString& deviceId,
     // Only resolve if we have an index for this device
     auto uidIt = m_indexesByUid.find(uid);
     if (uidIt == m_indexesByUid.end()) return;
-    if (uidIt->second.find(deviceId) == uidIt->second.end()) return;
-
-    // Build a display prefix for this device (mountpoint preferred)
-    QString prefix;
-    {
-        const auto devOpt = findDeviceById(deviceId);
-        if (devOpt) {
-            const QVariantMap dev = *devOpt;
-            const bool mounted = dev.value(QStringLiteral("mounted")).toBool();
-            const QString mp = dev.value(QStringLiteral("primaryMountPoint")).toString().trimmed();
-            const QString label = dev.value(QStringLiteral("label")).toString().trimmed();
-
-            if (mounted && !mp.isEmpty()) {
-                prefix = mp;
-            } else if (!label.isEmpty()) {
-                prefix = QStringLiteral("[") + label + QStringLiteral("]");
-            } else {
-                prefix = QStringLiteral("[") + deviceId + QStringLiteral("]");
-            }
-        } else {
-            prefix = QStringLiteral("[") + deviceId + QStringLiteral("]");
-        }
-    }
+    auto devIt = uidIt->second.find(deviceId);
+    if (devIt == uidIt->second.end()) return;
 
-    auto joinPrefix = [&](const QString& internalPath) -> QString {
-        // internalPath is like "/foo/bar" or "/"
-        if (prefix.isEmpty()) return internalPath;
+    const QString prefix = directoryDisplayPrefix(deviceId);
 
-        // If prefix is a mount point like "/mnt/Data", prefer "/mnt/Data" + "/foo"
-        if (prefix.startsWith('/')) {
-            if (internalPath == QStringLiteral("/")) return prefix;
-            return prefix + internalPath;
-        }
+    std::vector<quint32> ids;
+    ids.reserve(static_cast<size_t>(dirIds.size()));
+    for (const QVariant& v : dirIds) ids.push_back(v.toUInt());
 
-        // If prefix is "[Label]" use "[Label]/foo"
-        if (internalPath == QStringLiteral("/")) return prefix + QStringLiteral("/");
-        return prefix + internalPath;
-    };
+    // One pass for the whole batch: shared ancestors are resolved once
+    const DeviceIndex& idx = *devIt->second;
+    std::vector<QString> internals;
+    idx.dirPaths.resolveMany(dirTreeFor(idx), ids, internals);
 
-    for (const QVariant& v : dirIds) {
-        const quint32 id = v.toUInt();
-        const QString internal = dirPathFor(uid, deviceId, id);
-        const QString shown = joinPrefix(internal);
+    for (size_t i = 0; i < ids.size(); ++i) {
+        const QString shown = joinDisplayPrefix(prefix, internals[i]);
 
         QVariantList pair;
         pair.reserve(2);
-        pair << QVariant::fromValue(id)
+        pair << QVariant::fromValue(ids[i])
              << QVariant::fromValue(shown);
 
         out.push_back(pair);
@@ -2119,10 +4884,10 @@ void IndexerService::ResolveEntries(const QVariantList& entryIds,
 
         for (const auto& kv : indexes) {
             const QString& devId = kv.first;
-            const DeviceIndex& idx = kv.second;
+            const DeviceIndex& idx = *kv.second;
 
             if (deviceHash32(devId) != wantHash) continue;
-            if (recordIdx >= idx.records.size()) continue;
+            if (recordIdx >= idx.records.size() || idx.isDead(recordIdx)) continue;
             if (makeEntryId(devId, recordIdx) != entryId) continue;
 
             matchedDeviceId = &devId;
@@ -2198,7 +4963,7 @@ void IndexerService::ForgetIndex(const QString& deviceId) {
     auto uidIt = m_indexesByUid.find(uid);
     if (uidIt == m_indexesByUid.end()) {
         // Nothing loaded; still attempt snapshot deletion.
-        uidIt = m_indexesByUid.emplace(uid, std::unordered_map<QString, DeviceIndex>{}).first;
+        uidIt = m_indexesByUid.emplace(uid, std::unordered_map<QString, std::shared_ptr<DeviceIndex>>{}).first;
     }
 
     bool removed = false;
@@ -2213,8 +4978,24 @@ void IndexerService::ForgetIndex(const QString& deviceId) {
         }
     }
 
-    // 2) Delete snapshot file (best-effort)
+    // 2) Delete snapshot file and journals (best-effort); a write still running deletes what it leaves behind
     {
+        const auto stIt = m_persistStates.find(watchKey(uid, deviceId));
+        if (stIt != m_persistStates.end()) {
+            SnapshotPersistState& st = stIt->second;
+            for (const SnapshotWriteDone& d : st.queuedDone) d(false, QStringLiteral("The index was removed."));
+            st.queued.reset();
+            st.queuedDone.clear();
+            if (st.writing) {
+                st.forgotten = true;
+                st.journalToken = 0;
+                st.fallbackTokens.clear();
+            } else {
+                m_persistStates.erase(stIt);
+            }
+        }
+        removeWatchJournals(uid, deviceId);
+
         const QString snap = snapshotPathFor(uid, deviceId);
         QFile f(snap);
         if (f.exists()) {
@@ -2256,18 +5037,21 @@ void IndexerService::SetWatchEnabled(const QString& deviceId, bool enabled) {
         return;
     }
 
-    DeviceIndex& idx = it->second;
-    if (idx.watchEnabled == enabled) {
+    if (it->second->watchEnabled == enabled) {
         return; // idempotent
     }
 
+    DeviceIndex& idx = mutableDeviceIndex(it->second);
+
     idx.watchEnabled = enabled;
 
-    // Persist best-effort so the toggle survives daemon restart.
-    QString err;
-    if (!saveSnapshot(uid, deviceId, idx, &err)) {
-        sendErrorReply(QDBusError::Failed, QStringLiteral("Failed to persist watch setting: %1").arg(err));
-        return;
+    // Persist best-effort so the toggle survives daemon restart: one journal entry, or a
+    // background snapshot write if the device isn't journaling.
+    WatchJournal::Op op;
+    op.kind = WatchJournal::OpKind::SetWatchEnabled;
+    op.enabled = enabled;
+    if (!appendWatchJournal(uid, deviceId, {op})) {
+        scheduleSnapshotWrite(uid, deviceId, it->second);
     }
 
     // Refresh watch arming/status now that intent changed
@@ -2295,7 +5079,10 @@ quint64 IndexerService::startIndexForUid(quint32 uid, const QString& deviceId, b
         if (uidIt == m_indexesByUid.end()) return 0;
         auto it = uidIt->second.find(deviceId);
         if (it == uidIt->second.end()) return 0;
-        if (!it->second.watchEnabled) return 0;
+        if (!it->second->watchEnabled) return 0;
+
+        // Another uid's full scan of this device is running; its result is shared with this uid
+        if (sharedFullScanRunning(uid, deviceId)) return 0;
     }
 
     // Refuse if a job is already running for this uid+deviceId.
@@ -2335,6 +5122,39 @@ quint64 IndexerService::startIndexForUid(quint32 uid, const QString& deviceId, b
     job->devNode = devNode;
     job->fsType = fsType;
 
+    // NTFS indexes with a change journal checkpoint are brought up to date from the journal.
+    // The journal only sees Windows' changes, so not for watch-triggered rescans (those are about
+    // changes made here), nor while the volume is mounted here without the watch applying changes.
+    // EXT4 indexes re-read only the directories changed since their checkpoint; inode change times
+    // see every change, so that covers watch rescans (overflow recovery) too.
+    QStringList helperArgs{QStringLiteral("--stream")};
+    {
+        auto uidIt = m_indexesByUid.find(uid);
+        const DeviceIndex* prev = nullptr;
+        if (uidIt != m_indexesByUid.end()) {
+            const auto it = uidIt->second.find(deviceId);
+            if (it != uidIt->second.end()) prev = it->second.get();
+        }
+
+        const bool mounted = dev.value(QStringLiteral("mounted")).toBool();
+        const bool hasCheckpoint = prev && prev->journal.journalId != 0 && !prev->fileIds.empty() &&
+                                   prev->fileIds.size() == prev->records.size();
+
+        if (hasCheckpoint && fsType == QStringLiteral("ntfs") && !isAuto && (!mounted || prev->watchEnabled)) {
+            job->incremental = true;
+            helperArgs << QStringLiteral("--usn-since")
+                       << QString::number(static_cast<qulonglong>(prev->journal.journalId))
+                       << QString::number(static_cast<qulonglong>(prev->journal.nextUsn))
+                       << QString::number(static_cast<qulonglong>(prev->journal.journalFileId));
+        } else if (hasCheckpoint && fsType == QStringLiteral("ext4")) {
+            job->incremental = true;
+            helperArgs << QStringLiteral("--changed-since")
+                       << QString::number(static_cast<qulonglong>(prev->journal.journalId))
+                       << QString::number(static_cast<qulonglong>(prev->journal.nextUsn));
+        }
+    }
+    helperArgs << devNode << fsType;
+
     // Qt-owned process; we deleteLater() when finished.
     job->proc = new QProcess(this);
 
@@ -2365,10 +5185,18 @@ quint64 IndexerService::startIndexForUid(quint32 uid, const QString& deviceId, b
         Job& j = *it->second;
         if (!j.proc) return;
 
-        j.stdoutBuf += j.proc->readAllStandardOutput();
+        // Decode frames as they arrive; a broken stream can't recover, so stop the helper early.
+        const auto decodeStart = std::chrono::steady_clock::now();
+        const bool decoded = consumeScanStream(j.stream, j.proc);
+        j.decodeTime += std::chrono::steady_clock::now() - decodeStart;
+
+        if (!decoded && j.proc->state() != QProcess::NotRunning) {
+            qWarning().noquote() << QStringLiteral("[index] job %1: %2").arg(jobId).arg(j.stream.error);
+            j.proc->kill();
+        }
     });
 
-    // Read progress from stderr (KERYTHING_PROGRESS lines)
+    // Read progress and phase timings from stderr (KERYTHING_PROGRESS / KERYTHING_PHASE lines)
     connect(m_jobs[jobId]->proc, &QProcess::readyReadStandardError, this, [this, jobId, uid]() {
         auto it = m_jobs.find(jobId);
         if (it == m_jobs.end() || !it->second) return;
@@ -2380,6 +5208,16 @@ quint64 IndexerService::startIndexForUid(quint32 uid, const QString& deviceId, b
         std::optional<int> latestPctSeen;
 
         auto consumeLine = [&](QByteArrayView lineView) {
+            // "KERYTHING_PHASE <name> <microseconds>" (see ScannerUtils::reportPhase)
+            static constexpr QByteArrayView kPhasePrefix("KERYTHING_PHASE ");
+            if (lineView.startsWith(kPhasePrefix)) {
+                const QList<QByteArray> parts = QByteArray(lineView.mid(kPhasePrefix.size())).simplified().split(' ');
+                bool ok = false;
+                const quint64 us = parts.size() == 2 ? parts[1].toULongLong(&ok) : 0;
+                if (ok) addJobPhase(j.helperPhases, QString::fromLatin1(parts[0]), us);
+                return;
+            }
+
             static constexpr QByteArrayView kPrefix("KERYTHING_PROGRESS ");
             if (!lineView.startsWith(kPrefix)) return;
 
@@ -2436,7 +5274,25 @@ quint64 IndexerService::startIndexForUid(quint32 uid, const QString& deviceId, b
 
                 // Drain any remaining stdout after process exit
                 if (j.proc) {
-                    j.stdoutBuf += j.proc->readAllStandardOutput();
+                    const auto decodeStart = std::chrono::steady_clock::now();
+                    consumeScanStream(j.stream, j.proc);
+                    j.decodeTime += std::chrono::steady_clock::now() - decodeStart;
+                }
+
+                // The delta can't bring the index up to date: do a full scan in the same job
+                if (j.incremental && j.proc && j.state == Job::State::Running && exitStatus == QProcess::NormalExit &&
+                    exitCode == ScanProtocol::kExitNeedsFullScan) {
+                    qInfo().noquote() << QStringLiteral("[index] job %1: delta scan unusable, falling back to a full scan")
+                                         .arg(jobId);
+                    j.incremental = false;
+                    j.stream = ScanStream{};
+                    j.stderrBuf.clear();
+                    j.lastPct = -1;
+                    j.decodeTime = {};
+                    j.helperPhases.clear();
+                    j.proc->setArguments({ QStringLiteral("--stream"), j.devNode, j.fsType });
+                    j.proc->start();
+                    return;
                 }
 
                 QVariantMap props;
@@ -2447,6 +5303,11 @@ quint64 IndexerService::startIndexForUid(quint32 uid, const QString& deviceId, b
                 // Decide final status once, from the finished handler only.
                 if (j.state == Job::State::Cancelling) {
                     Q_EMIT JobFinished(jobId, QStringLiteral("cancelled"), QStringLiteral("Cancelled by request"), props);
+                } else if (!j.stream.error.isEmpty()) {
+                    // We killed the helper ourselves because its output was unusable
+                    Q_EMIT JobFinished(jobId, QStringLiteral("error"),
+                                       QStringLiteral("Failed to parse scan output: %1").arg(j.stream.error),
+                                       props);
                 } else if (exitStatus == QProcess::CrashExit) {
                     Q_EMIT JobFinished(jobId, QStringLiteral("error"), QStringLiteral("Scanner helper crashed"), props);
                 } else if (exitCode != 0) {
@@ -2455,28 +5316,57 @@ quint64 IndexerService::startIndexForUid(quint32 uid, const QString& deviceId, b
                                        QStringLiteral("Scanner helper failed (exit code %1)").arg(exitCode),
                                        props);
                 } else {
-                    // Parse + store the index in memory
-                    ParsedScan parsed = parseHelperStdout(j.stdoutBuf);
-                    if (!parsed.error.isEmpty()) {
+                    // Records/pool/trigrams were decoded while streaming; just validate + store in memory
+                    addJobPhase(j.daemonPhases, QStringLiteral("decode"), j.decodeTime);
+                    auto phaseStart = std::chrono::steady_clock::now();
+                    auto endPhase = [&](const QString& name) {
+                        const auto now = std::chrono::steady_clock::now();
+                        addJobPhase(j.daemonPhases, name, now - phaseStart);
+                        phaseStart = now;
+                    };
+
+                    if (!finishScanStream(j.stream)) {
                         Q_EMIT JobFinished(jobId, QStringLiteral("error"),
-                                           QStringLiteral("Failed to parse scan output: %1").arg(parsed.error),
+                                           QStringLiteral("Failed to parse scan output: %1").arg(j.stream.error),
                                            props);
+                    } else if (j.stream.delta) {
+                        endPhase(QStringLiteral("finish"));
+                        finishIncrementalScan(jobId, j, props);
                     } else {
-                        DeviceIndex& idx = m_indexesByUid[j.ownerUid][j.deviceId];
+                        endPhase(QStringLiteral("finish"));
+
+                        // Build the new generation aside and publish it once complete, so searches
+                        // that are still running keep reading the previous one.
+                        std::shared_ptr<DeviceIndex>& slot = m_indexesByUid[j.ownerUid][j.deviceId];
+                        auto fresh = std::make_shared<DeviceIndex>();
+                        if (slot) {
+                            fresh->generation = slot->generation;
+                            fresh->lastIndexedTime = slot->lastIndexedTime;
+                            fresh->watchEnabled = slot->watchEnabled;
+                        }
+
+                        DeviceIndex& idx = *fresh;
                         idx.fsType = j.fsType;
                         idx.generation += 1;
-                        idx.records = std::move(parsed.records);
-                        idx.stringPool = std::move(parsed.stringPool);
-                        idx.dirPathCache.clear();
+                        idx.records = std::move(j.stream.records);
+                        idx.stringPool = std::move(j.stream.stringPool);
+                        idx.foldedPool = std::move(j.stream.foldedPool);
+                        idx.names = std::move(j.stream.names);
+                        idx.fileIds = std::move(j.stream.fileIds);
+                        if (j.stream.hasCheckpoint) idx.journal = j.stream.checkpoint;
+                        idx.trigrams = TrigramIndex::build(j.stream.trigrams.data(), j.stream.trigrams.size(),
+                                                           idx.names.nameCount());
+                        j.stream.trigrams = {};
+                        endPhase(QStringLiteral("trigrams"));
 
-                        // Invalidate incremental lookup caches (they depend on records/stringPool)
-                        idx.dirIdByPathCache.clear();
-                        idx.dirIdByPathBuilt = false;
-                        idx.recordByParentAndNameCache.clear();
-                        idx.recordByParentAndNameBuilt = false;
-
-                        buildTrigramIndex(idx);
                         buildSortOrders(idx);
+                        endPhase(QStringLiteral("sortOrders"));
+                        buildExtensionIndex(idx);
+                        endPhase(QStringLiteral("extensions"));
+                        buildNameSignatures(idx);
+                        endPhase(QStringLiteral("signatures"));
+
+                        recordScanTimings(j, static_cast<quint64>(idx.records.size()), props);
 
                         const qint64 indexedNow = QDateTime::currentSecsSinceEpoch();
 
@@ -2494,42 +5384,64 @@ quint64 IndexerService::startIndexForUid(quint32 uid, const QString& deviceId, b
                         const qint64 prevLastIndexedTime = idx.lastIndexedTime;
                         idx.lastIndexedTime = indexedNow;
 
-                        QString saveErr;
-                        if (!saveSnapshot(j.ownerUid, j.deviceId, idx, &saveErr)) {
-                            // revert (keeps in-memory state honest)
-                            idx.lastIndexedTime = prevLastIndexedTime;
+                        slot = std::move(fresh);
+                        bumpUidEpoch(j.ownerUid);
 
-                            Q_EMIT JobFinished(jobId,
-                                               QStringLiteral("error"),
-                                               QStringLiteral("Indexed, but failed to save snapshot: %1").arg(saveErr),
-                                               props);
-                        } else {
-                            // Batch/coalesce index updates
-                            queueDeviceIndexUpdated(j.ownerUid,
-                                                    j.deviceId,
-                                                    static_cast<quint64>(idx.generation),
-                                                    static_cast<quint64>(idx.records.size()));
-
-                            if (m_watchMgr) m_watchMgr->refreshWatchesForUid(j.ownerUid);
-
-                            Q_EMIT JobProgress(jobId, 100, props);
-
-                            // Final "rescanning" update (100%) so GUI can clear/replace it
-                            {
-                                auto* self = const_cast<IndexerService*>(this);
-                                QVariantMap st;
-                                st.insert(QStringLiteral("deviceId"), j.deviceId);
-                                st.insert(QStringLiteral("percent"), 100u);
-                                Q_EMIT self->DaemonStateChanged(uid, QStringLiteral("rescanning"), st);
-                            }
+                        // Batch/coalesce index updates
+                        queueDeviceIndexUpdated(j.ownerUid,
+                                                j.deviceId,
+                                                static_cast<quint64>(idx.generation),
+                                                static_cast<quint64>(idx.records.size()));
+
+                        if (m_watchMgr) m_watchMgr->refreshWatchesForUid(j.ownerUid);
+
+                        Q_EMIT JobProgress(jobId, 100, props);
 
-                            Q_EMIT JobFinished(jobId,
-                                               QStringLiteral("ok"),
-                                               QStringLiteral("Indexed %1 entries (generation %2)")
-                                                   .arg(static_cast<qulonglong>(idx.records.size()))
-                                                   .arg(static_cast<qulonglong>(idx.generation)),
-                                               props);
+                        // Final "rescanning" update (100%) so GUI can clear/replace it
+                        {
+                            auto* self = const_cast<IndexerService*>(this);
+                            QVariantMap st;
+                            st.insert(QStringLiteral("deviceId"), j.deviceId);
+                            st.insert(QStringLiteral("percent"), 100u);
+                            Q_EMIT self->DaemonStateChanged(uid, QStringLiteral("rescanning"), st);
                         }
+
+                        const QString okMessage = QStringLiteral("Indexed %1 entries (generation %2)")
+                                                      .arg(static_cast<qulonglong>(idx.records.size()))
+                                                      .arg(static_cast<qulonglong>(idx.generation));
+
+                        // Records were renumbered, so no older journal applies to the new scan
+                        suspendWatchJournal(j.ownerUid, j.deviceId);
+
+                        // The job finishes once the snapshot is on disk
+                        const quint32 ownerUid = j.ownerUid;
+                        const QString ownerDeviceId = j.deviceId;
+                        const std::weak_ptr<DeviceIndex> written = slot;
+                        scheduleSnapshotWrite(ownerUid, ownerDeviceId, slot,
+                                              [this, jobId, props, ownerUid, ownerDeviceId, written, prevLastIndexedTime,
+                                               okMessage](bool ok, const QString& saveErr) {
+                            std::shared_ptr<DeviceIndex>* current = nullptr;
+                            if (auto uidIt = m_indexesByUid.find(ownerUid); uidIt != m_indexesByUid.end()) {
+                                if (auto devIt = uidIt->second.find(ownerDeviceId); devIt != uidIt->second.end()) {
+                                    if (devIt->second == written.lock()) current = &devIt->second;
+                                }
+                            }
+
+                            if (!ok) {
+                                // revert (keeps in-memory state honest)
+                                if (current) mutableDeviceIndex(*current).lastIndexedTime = prevLastIndexedTime;
+
+                                Q_EMIT JobFinished(jobId,
+                                                   QStringLiteral("error"),
+                                                   QStringLiteral("Indexed, but failed to save snapshot: %1").arg(saveErr),
+                                                   props);
+                                return;
+                            }
+
+                            if (current) publishSharedIndex(ownerUid, ownerDeviceId, *current);
+
+                            Q_EMIT JobFinished(jobId, QStringLiteral("ok"), okMessage, props);
+                        });
                     }
                 }
 
@@ -2547,7 +5459,7 @@ quint64 IndexerService::startIndexForUid(quint32 uid, const QString& deviceId, b
     // Spawn helper (daemon is root, so no pkexec)
     const QString helperPath = QStringLiteral("/usr/bin/kerything-scanner-helper");
     m_jobs[jobId]->proc->setProgram(helperPath);
-    m_jobs[jobId]->proc->setArguments({ devNode, fsType });
+    m_jobs[jobId]->proc->setArguments(helperArgs);
 
     m_jobs[jobId]->proc->start();
 
@@ -2575,7 +5487,7 @@ std::vector<IndexerService::WatchTarget> IndexerService::watchTargetsForUid(quin
 
     for (const auto& kv : uidIt->second) {
         const QString& deviceId = kv.first;
-        const DeviceIndex& idx = kv.second;
+        const DeviceIndex& idx = *kv.second;
 
         if (!idx.watchEnabled) continue;
 
@@ -2670,7 +5582,7 @@ void IndexerService::scheduleOverflowRecovery(quint32 uid, const QString& device
 
         st2.reconcileNextRetryMs = 0;
 
-        // Best-effort recovery: full rescan.
+        // Best-effort recovery: rescan (EXT4 indexes with a checkpoint only re-read the changed directories).
         // If it starts, consider reconcile “attempted”; if it doesn’t, try again later.
         const quint64 jobId = startIndexForUid(uid, deviceId, true);
         if (jobId == 0) {
@@ -2697,7 +5609,8 @@ static QString errnoString(int e) {
     return QStringLiteral("(%1): %2").arg(e).arg(QString::fromLocal8Bit(std::strerror(e)));
 }
 
-void IndexerService::probeTouchedEntries(quint32 uid, const QString& deviceId, const QVariantList& touched) const {
+void IndexerService::probeTouchedEntries(quint32 uid, const QString& deviceId,
+                                         const std::vector<WatchManager::TouchedEntry>& touched) const {
     // Find mount point for open_by_handle_at "mount_fd"
     const auto devOpt = findDeviceById(deviceId);
     if (!devOpt) {
@@ -2713,233 +5626,847 @@ void IndexerService::probeTouchedEntries(quint32 uid, const QString& deviceId, c
         return;
     }
 
-    const QByteArray mpBytes = QFile::encodeName(QDir::cleanPath(mp));
+    const QByteArray mpBytes = QFile::encodeName(QDir::cleanPath(mp));
+
+    // open_by_handle_at() is picky about mount_fd: O_PATH may be rejected (EBADF).
+    const int mountFd = ::open(mpBytes.constData(), O_RDONLY | O_CLOEXEC | O_DIRECTORY);
+    if (mountFd < 0) {
+        qInfo().noquote() << QStringLiteral("[watch-probe] uid=%1 device=%2 open(mount) failed %3")
+                             .arg(uid).arg(deviceId).arg(errnoString(errno));
+        return;
+    }
+
+    int probed = 0;
+    int ok = 0;
+    int enoent = 0;
+    int otherErr = 0;
+
+    for (const WatchManager::TouchedEntry& t : touched) {
+        const QString name = QString::fromLocal8Bit(t.name);
+        const quint64 mask = t.mask;
+
+        // Generic fallback token
+        if (t.generic) {
+            qInfo().noquote() << QStringLiteral("[watch-probe] uid=%1 device=%2 generic token mask=0x%3")
+                                 .arg(uid)
+                                 .arg(deviceId)
+                                 .arg(QString::number(mask, 16));
+            continue;
+        }
+
+        if (t.name.isEmpty() || t.handle.isEmpty()) {
+            qInfo().noquote() << QStringLiteral("[watch-probe] uid=%1 device=%2 malformed touched entry (missing fields)")
+                                 .arg(uid).arg(deviceId);
+            continue;
+        }
+
+        probed++;
+
+        const QByteArray& handleBlob = t.handle;
+        if (handleBlob.size() < static_cast<int>(sizeof(file_handle))) {
+            qInfo().noquote() << QStringLiteral("[watch-probe] uid=%1 device=%2 name=%3 handle too small (%4 bytes)")
+                                 .arg(uid).arg(deviceId).arg(name).arg(handleBlob.size());
+            continue;
+        }
+
+        // NOTE: the handle is the *entire file_handle blob* (struct header + handle bytes)
+        // exactly as captured from fanotify_event_info_fid.
+        const file_handle* fhView = reinterpret_cast<const file_handle*>(handleBlob.constData());
+        const size_t expect = sizeof(file_handle) + static_cast<size_t>(fhView->handle_bytes);
+        if (handleBlob.size() < static_cast<int>(expect)) {
+            qInfo().noquote() << QStringLiteral("[watch-probe] uid=%1 device=%2 name=%3 handle truncated (%4 < %5)")
+                                 .arg(uid).arg(deviceId).arg(name).arg(handleBlob.size()).arg(static_cast<qulonglong>(expect));
+            continue;
+        }
+
+        // open_by_handle_at wants a writable buffer (kernel may write to it), so copy into a mutable block.
+        QByteArray handleMutable = handleBlob.left(static_cast<int>(expect));
+
+        auto* fh = reinterpret_cast<file_handle*>(handleMutable.data());
+
+        // Resolve parent directory from handle
+        const int parentFd = ::open_by_handle_at(mountFd, fh, O_RDONLY | O_CLOEXEC);
+        if (parentFd < 0) {
+            qInfo().noquote() << QStringLiteral("[watch-probe] uid=%1 device=%2 name=%3 open_by_handle_at failed %4 mask=0x%5")
+                                 .arg(uid)
+                                 .arg(deviceId)
+                                 .arg(name)
+                                 .arg(errnoString(errno))
+                                 .arg(QString::number(mask, 16));
+            continue;
+        }
+
+        // Stat the child in that directory
+        struct stat st {};
+        const int rc = ::fstatat(parentFd, t.name.constData(), &st, AT_SYMLINK_NOFOLLOW);
+        if (rc != 0) {
+            const int e = errno;
+            if (e == ENOENT) enoent++;
+            else otherErr++;
+
+            qInfo().noquote() << QStringLiteral("[watch-probe] uid=%1 device=%2 name=%3 fstatat failed %4 mask=0x%5")
+                                 .arg(uid)
+                                 .arg(deviceId)
+                                 .arg(name)
+                                 .arg(errnoString(e))
+                                 .arg(QString::number(mask, 16));
+
+            ::close(parentFd);
+            continue;
+        }
+
+        ok++;
+
+        const bool isDir = S_ISDIR(st.st_mode);
+        const bool isReg = S_ISREG(st.st_mode);
+        const bool isLnk = S_ISLNK(st.st_mode);
+
+        qInfo().noquote() << QStringLiteral("[watch-probe] uid=%1 device=%2 name=%3 type=%4 size=%5 mtime=%6 mask=0x%7")
+                             .arg(uid)
+                             .arg(deviceId)
+                             .arg(name)
+                             .arg(isDir ? QStringLiteral("dir") : (isReg ? QStringLiteral("file") : (isLnk ? QStringLiteral("symlink") : QStringLiteral("other"))))
+                             .arg(static_cast<qulonglong>(st.st_size))
+                             .arg(static_cast<qlonglong>(st.st_mtime))
+                             .arg(QString::number(mask, 16));
+
+        ::close(parentFd);
+    }
+
+    ::close(mountFd);
+
+    qInfo().noquote() << QStringLiteral("[watch-probe] uid=%1 device=%2 done probed=%3 ok=%4 enoent=%5 otherErr=%6")
+                         .arg(uid)
+                         .arg(deviceId)
+                         .arg(probed)
+                         .arg(ok)
+                         .arg(enoent)
+                         .arg(otherErr);
+}
+
+static bool watchIncrementalEnabled() {
+    // Enable with: KERYTHING_WATCH_INCREMENTAL=1
+    const QByteArray v = qgetenv("KERYTHING_WATCH_INCREMENTAL");
+    if (v.isEmpty()) return false;
+    if (v == "0") return false;
+    return true;
+}
+
+void IndexerService::ensureChildTableBuilt(DeviceIndex& idx) {
+    if (idx.childTableBuilt) return;
+
+    const DirPathResolver::Tree tree = dirTreeFor(idx);
+
+    idx.childTable.clear();
+    idx.childTable.reserve(idx.records.size());
+    idx.childCountCache.assign(idx.records.size(), 0);
+    idx.rootDirId = DirPathResolver::kRootDirId;
+
+    for (quint32 recIdx = 0; recIdx < static_cast<quint32>(idx.records.size()); ++recIdx) {
+        if (idx.isDead(recIdx)) continue;
+
+        const quint32 parent = idx.records.parents[recIdx];
+        idx.childTable.insert(tree, recIdx);
+
+        // The root's own record (ext4: parentless, NTFS: its own parent): top-level entries are its children
+        if (idx.rootDirId == DirPathResolver::kRootDirId && idx.records.isDir(recIdx) && idx.records.nameLens[recIdx] == 0
+            && (parent == DirPathResolver::kRootDirId || parent == recIdx)) {
+            idx.rootDirId = recIdx;
+        }
+
+        if (parent < idx.childCountCache.size() && parent != recIdx) {
+            ++idx.childCountCache[parent];
+        }
+    }
+
+    idx.childTableBuilt = true;
+
+    qInfo().noquote() << QStringLiteral("[watch-inc] built childTable entries=%1 bytes=%2")
+                         .arg(idx.childTable.size())
+                         .arg(idx.childTable.byteSize());
+}
+
+/**
+ * Resolves an internal directory path ("/foo/bar") to its dirId by walking the path one
+ * component at a time through the index's child table.
+ *
+ * @return The dirId (kRootDirId or the root record for "/"), or ChildTable::kNone if any
+ *         component is missing or not a directory.
+ */
+quint32 IndexerService::dirIdForInternalPath(const DeviceIndex& idx, const QString& internalDir) {
+    const DirPathResolver::Tree tree = dirTreeFor(idx);
+
+    const QByteArray utf8 = internalDir.toUtf8();
+    std::string_view rest(utf8.constData(), static_cast<size_t>(utf8.size()));
+
+    quint32 dirId = idx.rootDirId;
+    while (!rest.empty()) {
+        const size_t slash = rest.find('/');
+        const std::string_view name = rest.substr(0, slash);
+        rest = slash == std::string_view::npos ? std::string_view() : rest.substr(slash + 1);
+
+        if (name.empty() || name == "." || name == "..") continue; // resolved paths never carry these
+
+        const quint32 child = idx.childTable.find(tree, dirId, name);
+        if (child == ChildTable::kNone || !idx.records.isDir(child)) return ChildTable::kNone;
+
+        dirId = child;
+    }
+    return dirId;
+}
+
+static std::optional<QString> readFdPath(int fd) {
+    if (fd < 0) return std::nullopt;
+    const QByteArray link = QByteArrayLiteral("/proc/self/fd/") + QByteArray::number(fd);
+
+    char buf[4096];
+    const ssize_t n = ::readlink(link.constData(), buf, sizeof(buf) - 1);
+    if (n < 0) return std::nullopt;
+    buf[n] = '\0';
+    return QString::fromLocal8Bit(buf);
+}
+
+// --- Begin: Watch delta segment ---
+
+quint32 IndexerService::appendDeltaRecord(DeviceIndex& idx, quint32 parentDirId, const QByteArray& name,
+                                          quint64 size, quint64 mtime, bool isDir, bool isSymlink, quint64 fileId) {
+    std::vector<char>& pool = idx.stringPool.mut();
+    std::vector<char>& folded = idx.foldedPool.mut();
+
+    ScannerEngine::FileRecord r{};
+    r.parentRecordIdx = parentDirId;
+    r.size = size;
+    r.modificationTime = mtime;
+    r.nameOffset = static_cast<uint32_t>(pool.size());
+    r.nameLen = static_cast<uint16_t>(std::min<qsizetype>(name.size(), 0xFFFF));
+    r.isDir = isDir ? 1 : 0;
+    r.isSymlink = isSymlink ? 1 : 0;
+
+    pool.insert(pool.end(), name.constData(), name.constData() + r.nameLen);
+    folded.resize(pool.size());
+    CaseFold::foldUtf8(pool.data() + r.nameOffset, r.nameLen, folded.data() + r.nameOffset);
+
+    // Keep the file id column parallel (if the scanner provided one)
+    if (!idx.fileIds.empty()) {
+        idx.fileIds.mut().push_back(fileId);
+    }
+
+    idx.records.push_back(r);
+    return static_cast<quint32>(idx.records.size() - 1);
+}
+
+void IndexerService::markDeadRecord(DeviceIndex& idx, quint32 recIdx) {
+    if (recIdx >= idx.records.size() || idx.isDead(recIdx)) return;
+
+    idx.deadBits.resize((idx.records.size() + 63) / 64, 0);
+    idx.deadBits[recIdx >> 6] |= quint64(1) << (recIdx & 63);
+    ++idx.deadCount;
+}
+
+void IndexerService::applyDeltaToOrders(DeviceIndex& idx, std::vector<quint32> added, std::vector<quint32> moved,
+                                        bool removedAny) {
+    const quint32 n = static_cast<quint32>(idx.records.size());
+    static constexpr quint32 kNone = 0xFFFFFFFFu;
+
+    const RecordColumns& records = idx.records;
+    auto nameView = [&](quint32 i) -> std::string_view {
+        return records.name(i, idx.foldedPool.data());
+    };
+
+    auto byName = [&](quint32 a, quint32 b) {
+        const int c = ciCompareBytes(nameView(a), nameView(b));
+        if (c != 0) return c < 0;
+        return a < b;
+    };
+
+    auto bySize = [&](quint32 a, quint32 b) {
+        const auto sa = records.sizes[a];
+        const auto sb = records.sizes[b];
+        if (sa != sb) return sa < sb;
+        return byName(a, b);
+    };
+
+    auto byMtime = [&](quint32 a, quint32 b) {
+        const auto ta = records.mtimes[a];
+        const auto tb = records.mtimes[b];
+        if (ta != tb) return ta < tb;
+        return byName(a, b);
+    };
+
+    // Same order as buildPathOrder without its directory ranks: two parents are compared by
+    // their ancestor chains (first differing component by name; an ancestor sorts first).
+    auto parentOf = [&](quint32 i) -> quint32 {
+        const quint32 p = records.parents[i];
+        return (p < n && p != i) ? p : kNone;
+    };
+
+    auto chainOf = [&](quint32 dir, std::vector<quint32>& chain) {
+        chain.clear();
+        for (quint32 cur = dir; cur != kNone && chain.size() < 4096; cur = parentOf(cur)) {
+            chain.push_back(cur);
+        }
+        std::reverse(chain.begin(), chain.end());
+    };
+
+    // Chains are cached per side: a binary search keeps its left side fixed, and neighbouring
+    // probes often share a parent
+    std::vector<quint32> chainA;
+    std::vector<quint32> chainB;
+    quint32 chainAOf = kNone;
+    quint32 chainBOf = kNone;
+    auto byPath = [&](quint32 a, quint32 b) {
+        const quint32 pa = parentOf(a);
+        const quint32 pb = parentOf(b);
+        if (pa != pb) {
+            if (pa == kNone) return true;
+            if (pb == kNone) return false;
+
+            if (pa != chainAOf) {
+                chainOf(pa, chainA);
+                chainAOf = pa;
+            }
+            if (pb != chainBOf) {
+                chainOf(pb, chainB);
+                chainBOf = pb;
+            }
+            const size_t common = std::min(chainA.size(), chainB.size());
+            for (size_t k = 0; k < common; ++k) {
+                if (chainA[k] != chainB[k]) return byName(chainA[k], chainB[k]);
+            }
+            return chainA.size() < chainB.size();
+        }
+        return byName(a, b);
+    };
+
+    // Moved entries must already be in the orders: records created in this batch (always appended
+    // at the end) go in through `added` instead, and deleted ones are dropped as tombstones.
+    const quint32 firstAdded = added.empty() ? n : *std::min_element(added.begin(), added.end());
+    std::erase_if(moved, [&](quint32 rec) { return rec >= firstAdded || idx.isDead(rec); });
+    std::sort(moved.begin(), moved.end());
+    moved.erase(std::unique(moved.begin(), moved.end()), moved.end());
+
+    std::vector<char> isMoved;
+    if (!moved.empty()) {
+        isMoved.assign(n, 0);
+        for (quint32 rec : moved) isMoved[rec] = 1;
+    }
+
+    // Per order: drop tombstones and moved entries in one pass, find each (sorted) reinsert's place
+    // by binary search over what is kept, shift the kept entries up once from the end, then rewrite
+    // ranks only over the span whose positions changed. O(n) moves but only O(k log n) comparisons,
+    // which matters for byPath (each walks two ancestor chains).
+    auto patch = [&](MappedArray<quint32>& orderArr, MappedArray<quint32>& rankArr, bool withMoved, auto&& less) {
+        std::vector<quint32> fresh = added;
+        if (withMoved) fresh.insert(fresh.end(), moved.begin(), moved.end());
+        if (fresh.empty() && !removedAny) return;
+        if (rankArr.size() == 0 && firstAdded > 0) return; // never built for this index
+
+        std::vector<quint32>& order = orderArr.mut();
+        std::vector<quint32>& rank = rankArr.mut();
+        rank.resize(n, kDeadRank);
+
+        const size_t oldSize = order.size();
+        size_t lo = SIZE_MAX;
+        size_t hi = 0;
+
+        size_t w = 0;
+        for (size_t r = 0; r < oldSize; ++r) {
+            const quint32 rec = order[r];
+            const bool dead = removedAny && idx.isDead(rec);
+            if (dead || (withMoved && !isMoved.empty() && isMoved[rec])) {
+                lo = std::min(lo, r);
+                hi = std::max(hi, r);
+                if (dead) rank[rec] = kDeadRank;
+                continue;
+            }
+            order[w++] = rec;
+        }
+
+        std::sort(fresh.begin(), fresh.end(), less);
+
+        // Kept entries before which each reinsert goes (non-decreasing, so each search starts
+        // where the previous one ended)
+        std::vector<size_t> at(fresh.size());
+        size_t from = 0;
+        for (size_t f = 0; f < fresh.size(); ++f) {
+            from = static_cast<size_t>(std::upper_bound(order.begin() + static_cast<std::ptrdiff_t>(from),
+                                                        order.begin() + static_cast<std::ptrdiff_t>(w), fresh[f], less)
+                                       - order.begin());
+            at[f] = from;
+        }
+
+        const size_t newSize = w + fresh.size();
+        order.resize(newSize);
+
+        // Kept entries at or past at[j - 1] move up by j (the reinserts before them)
+        size_t i = w;
+        for (size_t j = fresh.size(); j > 0; --j) {
+            const size_t p = at[j - 1];
+            std::move_backward(order.begin() + static_cast<std::ptrdiff_t>(p), order.begin() + static_cast<std::ptrdiff_t>(i),
+                               order.begin() + static_cast<std::ptrdiff_t>(i + j));
+            order[p + j - 1] = fresh[j - 1];
+            i = p;
+        }
+        if (!fresh.empty()) {
+            lo = std::min(lo, at.front());
+            hi = std::max(hi, at.back() + fresh.size() - 1);
+        }
+
+        if (lo == SIZE_MAX) return;
+        if (newSize != oldSize) hi = newSize - 1; // everything after the first change shifted
+
+        for (size_t pos = lo; pos <= hi && pos < newSize; ++pos) {
+            rank[order[pos]] = static_cast<quint32>(pos);
+        }
+    };
+
+    // Created-then-deleted records never enter the orders
+    std::erase_if(added, [&](quint32 rec) { return idx.isDead(rec); });
+
+    patch(idx.orderByName, idx.rankByName, false, byName);
+    patch(idx.orderBySize, idx.rankBySize, true, bySize);
+    patch(idx.orderByMtime, idx.rankByMtime, true, byMtime);
+    patch(idx.orderByPath, idx.rankByPath, false, byPath);
+
+    if (added.empty() && !removedAny) return;
+
+    // The delta's own trigram list covers every record past the base index
+    idx.deltaTrigrams.clear();
+    appendTrigramsForNames(idx.records.nameOffsets.data(), idx.records.nameLens.data(), idx.foldedPool.data(),
+                           idx.deltaBegin(), n, idx.deltaTrigrams);
+    std::sort(idx.deltaTrigrams.begin(), idx.deltaTrigrams.end());
+}
+
+std::shared_ptr<IndexerService::DeviceIndex> IndexerService::compactDeviceIndex(const DeviceIndex& idx) {
+    const quint32 n = static_cast<quint32>(idx.records.size());
+    static constexpr quint32 kNone = 0xFFFFFFFFu;
+
+    auto out = std::make_shared<DeviceIndex>();
+    out->fsType = idx.fsType;
+    out->generation = idx.generation + 1; // record ids change
+    out->lastIndexedTime = idx.lastIndexedTime;
+    out->labelLastKnown = idx.labelLastKnown;
+    out->uuidLastKnown = idx.uuidLastKnown;
+    out->watchEnabled = idx.watchEnabled;
+    out->journal = idx.journal;
+
+    std::vector<quint32> remap(n, kNone);
+    quint32 live = 0;
+    for (quint32 i = 0; i < n; ++i) {
+        if (!idx.isDead(i)) remap[i] = live++;
+    }
+
+    RecordColumns records;
+    std::vector<char> pool;
+    std::vector<char> folded;
+    std::vector<quint64> fileIds;
+    records.reserve(live);
+    pool.reserve(idx.stringPool.size());
+    folded.reserve(idx.stringPool.size());
+
+    const bool hasFileIds = idx.fileIds.size() == n;
+    if (hasFileIds) fileIds.reserve(live);
+
+    for (quint32 i = 0; i < n; ++i) {
+        if (remap[i] == kNone) continue;
+
+        ScannerEngine::FileRecord r = idx.records[i];
+        const quint32 p = r.parentRecordIdx;
+        r.parentRecordIdx = (p < n) ? remap[p] : p;
+
+        const char* name = idx.stringPool.data() + r.nameOffset;
+        const char* foldedName = idx.foldedPool.data() + r.nameOffset;
+        r.nameOffset = static_cast<uint32_t>(pool.size());
+        pool.insert(pool.end(), name, name + r.nameLen);
+        folded.insert(folded.end(), foldedName, foldedName + r.nameLen);
+
+        records.push_back(r);
+        if (hasFileIds) fileIds.push_back(idx.fileIds[i]);
+    }
+
+    out->records = std::move(records);
+    out->stringPool = std::move(pool);
+    out->foldedPool = std::move(folded);
+    out->fileIds = std::move(fileIds);
+
+    buildTrigramIndex(*out);
+    buildSortOrders(*out);
+    buildExtensionIndex(*out);
+    buildNameSignatures(*out);
+    return out;
+}
+
+void IndexerService::scheduleDeltaCompaction(quint32 uid, const QString& deviceId) {
+    auto uidIt = m_indexesByUid.find(uid);
+    if (uidIt == m_indexesByUid.end()) return;
+    auto devIt = uidIt->second.find(deviceId);
+    if (devIt == uidIt->second.end() || !devIt->second->hasDelta()) return;
+
+    const DeviceIndex& idx = *devIt->second;
+    const quint64 threshold = std::max(kDeltaCompactMinRecords, idx.records.size() / kDeltaCompactFraction);
+    if (idx.deltaSize() >= threshold) {
+        startDeltaCompaction(uid, deviceId);
+        return;
+    }
+
+    // Small deltas are folded in (and persisted) once the device has been quiet for a while
+    WatchBatchState& st = m_watchBatchState[watchKey(uid, deviceId)];
+    if (!st.compactTimer) {
+        st.compactTimer = new QTimer(this);
+        st.compactTimer->setSingleShot(true);
+        connect(st.compactTimer, &QTimer::timeout, this, [this, uid, deviceId]() {
+            startDeltaCompaction(uid, deviceId);
+        });
+    }
+    st.compactTimer->start(kDeltaIdleCompactMs);
+}
+
+IndexerService::SnapshotWriteDone IndexerService::takeCompactionDone(WatchBatchState& st) {
+    if (st.compactionDone.empty()) return {};
 
-    // open_by_handle_at() is picky about mount_fd: O_PATH may be rejected (EBADF).
-    const int mountFd = ::open(mpBytes.constData(), O_RDONLY | O_CLOEXEC | O_DIRECTORY);
-    if (mountFd < 0) {
-        qInfo().noquote() << QStringLiteral("[watch-probe] uid=%1 device=%2 open(mount) failed %3")
-                             .arg(uid).arg(deviceId).arg(errnoString(errno));
+    std::vector<SnapshotWriteDone> waiting = std::move(st.compactionDone);
+    st.compactionDone.clear();
+    return [waiting = std::move(waiting)](bool ok, const QString& error) {
+        for (const SnapshotWriteDone& d : waiting) d(ok, error);
+    };
+}
+
+void IndexerService::startDeltaCompaction(quint32 uid, const QString& deviceId, SnapshotWriteDone done) {
+    WatchBatchState& st = m_watchBatchState[watchKey(uid, deviceId)];
+    if (done) st.compactionDone.push_back(std::move(done));
+    if (st.compactionRunning) return;
+
+    std::shared_ptr<DeviceIndex>* slot = nullptr;
+    if (auto uidIt = m_indexesByUid.find(uid); uidIt != m_indexesByUid.end()) {
+        if (auto devIt = uidIt->second.find(deviceId); devIt != uidIt->second.end()) slot = &devIt->second;
+    }
+    if (!slot) {
+        if (SnapshotWriteDone waiting = takeCompactionDone(st)) waiting(false, QStringLiteral("The index was removed."));
         return;
     }
 
-    int probed = 0;
-    int ok = 0;
-    int enoent = 0;
-    int otherErr = 0;
+    if (!(*slot)->hasDelta()) {
+        // Folded in meanwhile (or replaced by a scan): whoever waits gets the current version written
+        if (SnapshotWriteDone waiting = takeCompactionDone(st)) scheduleSnapshotWrite(uid, deviceId, *slot, std::move(waiting));
+        return;
+    }
 
-    for (const QVariant& v : touched) {
-        const QVariantMap m = v.toMap();
+    if (st.compactTimer) st.compactTimer->stop();
+    st.compactionRunning = true;
 
-        const QString name = m.value(QStringLiteral("name")).toString();
-        const QString fsidHex = m.value(QStringLiteral("fsidHex")).toString();
-        const QString handleHex = m.value(QStringLiteral("handleHex")).toString();
-        const quint64 mask = m.value(QStringLiteral("mask")).toULongLong();
+    // Pinning the source makes any further watch update clone it (mutableDeviceIndex), so an
+    // unchanged slot pointer afterwards means nothing was applied while we were compacting.
+    std::shared_ptr<const DeviceIndex> source = pinDeviceIndex(*slot);
+    qInfo().noquote() << QStringLiteral("[watch-delta] compacting uid=%1 device=%2 delta=%3")
+                         .arg(uid).arg(deviceId).arg(source->deltaSize());
 
-        // Generic fallback token
-        if (name == QStringLiteral("*")) {
-            qInfo().noquote() << QStringLiteral("[watch-probe] uid=%1 device=%2 generic token ('*') mask=0x%3")
-                                 .arg(uid)
-                                 .arg(deviceId)
-                                 .arg(QString::number(mask, 16));
-            continue;
-        }
+    m_searchPool->start([this, uid, deviceId, source]() {
+        std::shared_ptr<DeviceIndex> compacted = compactDeviceIndex(*source);
 
-        if (name.isEmpty() || fsidHex.isEmpty() || handleHex.isEmpty()) {
-            qInfo().noquote() << QStringLiteral("[watch-probe] uid=%1 device=%2 malformed touched entry (missing fields)")
-                                 .arg(uid).arg(deviceId);
-            continue;
-        }
+        QMetaObject::invokeMethod(this, [this, uid, deviceId, source, compacted]() {
+            WatchBatchState& st2 = m_watchBatchState[watchKey(uid, deviceId)];
+            st2.compactionRunning = false;
 
-        probed++;
+            std::shared_ptr<DeviceIndex>* slot2 = nullptr;
+            if (auto uidIt2 = m_indexesByUid.find(uid); uidIt2 != m_indexesByUid.end()) {
+                if (auto devIt2 = uidIt2->second.find(deviceId); devIt2 != uidIt2->second.end()) slot2 = &devIt2->second;
+            }
+            if (!slot2) {
+                if (SnapshotWriteDone waiting = takeCompactionDone(st2)) waiting(false, QStringLiteral("The index was removed."));
+                return;
+            }
 
-        const QByteArray handleBlob = QByteArray::fromHex(handleHex.toLatin1());
-        if (handleBlob.size() < static_cast<int>(sizeof(file_handle))) {
-            qInfo().noquote() << QStringLiteral("[watch-probe] uid=%1 device=%2 name=%3 handle too small (%4 bytes)")
-                                 .arg(uid).arg(deviceId).arg(name).arg(handleBlob.size());
-            continue;
-        }
+            if (slot2->get() != source.get()) {
+                // Superseded (new watch batch, rescan or forget); try again later if still needed,
+                // right away if someone waits for the write
+                if (st2.compactionDone.empty()) {
+                    scheduleDeltaCompaction(uid, deviceId);
+                } else {
+                    startDeltaCompaction(uid, deviceId);
+                }
+                return;
+            }
 
-        // NOTE: handleHex encodes the *entire file_handle blob* (struct header + handle bytes)
-        // exactly as captured from fanotify_event_info_fid.
-        const file_handle* fhView = reinterpret_cast<const file_handle*>(handleBlob.constData());
-        const size_t expect = sizeof(file_handle) + static_cast<size_t>(fhView->handle_bytes);
-        if (handleBlob.size() < static_cast<int>(expect)) {
-            qInfo().noquote() << QStringLiteral("[watch-probe] uid=%1 device=%2 name=%3 handle truncated (%4 < %5)")
-                                 .arg(uid).arg(deviceId).arg(name).arg(handleBlob.size()).arg(static_cast<qulonglong>(expect));
-            continue;
-        }
+            *slot2 = compacted;
+            bumpUidEpoch(uid);
 
-        // open_by_handle_at wants a writable buffer (kernel may write to it), so copy into a mutable block.
-        QByteArray handleMutable = handleBlob.left(static_cast<int>(expect));
+            // The delta is folded in: a new snapshot (and an empty journal) replaces the old pair.
+            // Records were renumbered, so the old journal can't take later batches.
+            suspendWatchJournal(uid, deviceId);
+            scheduleSnapshotWrite(uid, deviceId, compacted, takeCompactionDone(st2));
 
-        auto* fh = reinterpret_cast<file_handle*>(handleMutable.data());
+            queueDeviceIndexUpdated(uid, deviceId,
+                                    static_cast<quint64>(compacted->generation),
+                                    static_cast<quint64>(compacted->records.size()));
+        }, Qt::QueuedConnection);
+    });
+}
 
-        // Resolve parent directory from handle
-        const int parentFd = ::open_by_handle_at(mountFd, fh, O_RDONLY | O_CLOEXEC);
-        if (parentFd < 0) {
-            qInfo().noquote() << QStringLiteral("[watch-probe] uid=%1 device=%2 name=%3 open_by_handle_at failed %4 mask=0x%5")
-                                 .arg(uid)
-                                 .arg(deviceId)
-                                 .arg(name)
-                                 .arg(errnoString(errno))
-                                 .arg(QString::number(mask, 16));
-            continue;
-        }
+// --- End: Watch delta segment ---
 
-        // Stat the child in that directory
-        struct stat st {};
-        const QByteArray nameBytes = name.toLocal8Bit();
-        const int rc = ::fstatat(parentFd, nameBytes.constData(), &st, AT_SYMLINK_NOFOLLOW);
-        if (rc != 0) {
-            const int e = errno;
-            if (e == ENOENT) enoent++;
-            else otherErr++;
+// --- Begin: Delta scans ---
 
-            qInfo().noquote() << QStringLiteral("[watch-probe] uid=%1 device=%2 name=%3 fstatat failed %4 mask=0x%5")
-                                 .arg(uid)
-                                 .arg(deviceId)
-                                 .arg(name)
-                                 .arg(errnoString(e))
-                                 .arg(QString::number(mask, 16));
+quint64 IndexerService::applyScanDelta(DeviceIndex& idx, const ScanStream& st, bool& needsCompaction) {
+    static constexpr quint32 kNone = 0xFFFFFFFFu;
+    needsCompaction = false;
 
-            ::close(parentFd);
-            continue;
+    const quint32 n = static_cast<quint32>(idx.records.size());
+    std::unordered_set<quint64> changed(st.changedFileIds.begin(), st.changedFileIds.end());
+    const std::unordered_set<quint64> wantedParents(st.parentFileIds.begin(), st.parentFileIds.end());
+
+    // Every entry of a re-read directory is changed too: the ones missing from the delta are gone
+    if (!st.changedDirIds.empty()) {
+        const std::unordered_set<quint64> dirs(st.changedDirIds.begin(), st.changedDirIds.end());
+        for (quint32 i = 0; i < n; ++i) {
+            if (idx.isDead(i) || idx.records.nameLens[i] == 0) continue; // the volume root isn't an entry of anything
+
+            const quint32 p = idx.records.parents[i];
+            if (p != kNone && p >= n) continue;
+            if (dirs.count(p == kNone ? 0 : idx.fileIds[p]) != 0) changed.insert(idx.fileIds[i]);
         }
+    }
 
-        ok++;
-
-        const bool isDir = S_ISDIR(st.st_mode);
-        const bool isReg = S_ISREG(st.st_mode);
-        const bool isLnk = S_ISLNK(st.st_mode);
+    std::unordered_map<quint64, size_t> statsByFile; // into st.stats
+    for (size_t k = 0; k < st.stats.size(); ++k) {
+        statsByFile.emplace(st.stats[k].fileId, k);
+    }
 
-        qInfo().noquote() << QStringLiteral("[watch-probe] uid=%1 device=%2 name=%3 type=%4 size=%5 mtime=%6 mask=0x%7")
-                             .arg(uid)
-                             .arg(deviceId)
-                             .arg(name)
-                             .arg(isDir ? QStringLiteral("dir") : (isReg ? QStringLiteral("file") : (isLnk ? QStringLiteral("symlink") : QStringLiteral("other"))))
-                             .arg(static_cast<qulonglong>(st.st_size))
-                             .arg(static_cast<qlonglong>(st.st_mtime))
-                             .arg(QString::number(mask, 16));
+    // One pass over the index: the current records of every changed file, the directories the
+    // delta's records are in, and the records that only get new stats
+    std::unordered_map<quint64, std::vector<quint32>> oldByFile;
+    std::unordered_map<quint64, quint32> dirByFile;
+    std::vector<std::pair<quint32, size_t>> statHits; // (record, into st.stats)
+    for (quint32 i = 0; i < n; ++i) {
+        if (idx.isDead(i)) continue;
+
+        const quint64 id = idx.fileIds[i];
+        if (changed.count(id) != 0) {
+            oldByFile[id].push_back(i);
+        } else if (const auto it = statsByFile.find(id); it != statsByFile.end()) {
+            statHits.emplace_back(i, it->second);
+        }
+        if (idx.records.isDir(i) && wantedParents.count(id) != 0) dirByFile.emplace(id, i);
+    }
 
-        ::close(parentFd);
+    std::unordered_map<quint64, std::vector<quint32>> newByFile; // into st.records
+    for (quint32 k = 0; k < st.records.size(); ++k) {
+        newByFile[st.fileIds[k]].push_back(k);
     }
 
-    ::close(mountFd);
+    std::vector<quint32> added;
+    std::vector<quint32> moved;
+    bool removedAny = false;
+    quint64 touched = 0;
+
+    std::vector<std::pair<quint32, quint64>> pendingParents; // (appended record, parent file id)
+    std::unordered_map<quint64, quint32> newDirByFile;
+    bool replacedDirs = false;
+
+    const std::vector<quint32> none;
+    std::vector<quint32> match;
+
+    for (const quint64 id : changed) {
+        const auto oldIt = oldByFile.find(id);
+        const auto newIt = newByFile.find(id);
+        const std::vector<quint32>& olds = oldIt != oldByFile.end() ? oldIt->second : none;
+        const std::vector<quint32>& news = newIt != newByFile.end() ? newIt->second : none;
+
+        // Same links (name + parent) as before: only size/mtime/flags changed, update in place
+        bool sameLinks = olds.size() == news.size();
+        match.assign(news.size(), kNone);
+        for (size_t a = 0; sameLinks && a < news.size(); ++a) {
+            const auto& nr = st.records[news[a]];
+            const std::string_view name(st.stringPool.data() + nr.nameOffset, nr.nameLen);
+            const auto parentIt = dirByFile.find(st.parentFileIds[news[a]]);
+            const quint32 parent = parentIt != dirByFile.end() ? parentIt->second : kNone;
+
+            sameLinks = false;
+            for (const quint32 o : olds) {
+                const auto& r = idx.records[o];
+                if (r.parentRecordIdx == parent && std::find(match.begin(), match.end(), o) == match.end() &&
+                    std::string_view(idx.stringPool.data() + r.nameOffset, r.nameLen) == name) {
+                    match[a] = o;
+                    sameLinks = true;
+                    break;
+                }
+            }
+        }
 
-    qInfo().noquote() << QStringLiteral("[watch-probe] uid=%1 device=%2 done probed=%3 ok=%4 enoent=%5 otherErr=%6")
-                         .arg(uid)
-                         .arg(deviceId)
-                         .arg(probed)
-                         .arg(ok)
-                         .arg(enoent)
-                         .arg(otherErr);
-}
+        if (sameLinks) {
+            for (size_t a = 0; a < news.size(); ++a) {
+                const auto& nr = st.records[news[a]];
+                const quint32 o = match[a];
+                if (idx.records.sizes[o] != nr.size || idx.records.mtimes[o] != nr.modificationTime) moved.push_back(o);
 
-static bool watchIncrementalEnabled() {
-    // Enable with: KERYTHING_WATCH_INCREMENTAL=1
-    const QByteArray v = qgetenv("KERYTHING_WATCH_INCREMENTAL");
-    if (v.isEmpty()) return false;
-    if (v == "0") return false;
-    return true;
-}
+                idx.records.setStats(o, nr.size, nr.modificationTime, nr.isDir, nr.isSymlink);
+                ++touched;
+            }
+            continue;
+        }
 
-static QString recordKey(quint32 parentDirId, const QString& name) {
-    return QString::number(parentDirId) + QStringLiteral("\n") + name;
-}
+        // Renamed, moved, created, deleted or links changed: replace all of the file's records
+        for (const quint32 o : olds) {
+            replacedDirs |= idx.records.isDir(o);
+            markDeadRecord(idx, o);
+            removedAny = true;
+            ++touched;
+        }
 
-void IndexerService::ensureDirIdByPathBuilt(DeviceIndex& idx, quint32 uid, const QString& deviceId) const {
-    if (idx.dirIdByPathBuilt) return;
+        for (const quint32 k : news) {
+            const auto& nr = st.records[k];
+            const QByteArray name = QByteArray::fromRawData(st.stringPool.data() + nr.nameOffset, nr.nameLen);
+            const quint32 recIdx = appendDeltaRecord(idx, kNone, name, nr.size, nr.modificationTime,
+                                                     nr.isDir, nr.isSymlink, id);
+            added.push_back(recIdx);
+            pendingParents.emplace_back(recIdx, st.parentFileIds[k]);
+            if (nr.isDir) newDirByFile[id] = recIdx;
+            ++touched;
+        }
+    }
 
-    idx.dirIdByPathCache.clear();
-    idx.dirIdByPathCache.reserve(idx.records.size() / 2);
+    // Same links, new stats
+    for (const auto& [i, k] : statHits) {
+        const ScanProtocol::StatsEntry& e = st.stats[k];
+        if (idx.records.sizes[i] != e.size || idx.records.mtimes[i] != e.modificationTime) moved.push_back(i);
 
-    // Root (special parent id value) is represented by internal path "/"
-    idx.dirIdByPathCache.emplace(QStringLiteral("/"), 0xFFFFFFFFu);
+        idx.records.setStats(i, e.size, e.modificationTime, (e.flags & ScanProtocol::kStatsIsDir) != 0,
+                             (e.flags & ScanProtocol::kStatsIsSymlink) != 0);
+        ++touched;
+    }
 
-    for (quint32 recIdx = 0; recIdx < static_cast<quint32>(idx.records.size()); ++recIdx) {
-        const auto& r = idx.records[recIdx];
-        if (!r.isDir) continue;
+    // Parents of the new records: directories of this delta first, then the index's
+    for (const auto& [recIdx, parentId] : pendingParents) {
+        quint32 parent = kNone;
+        if (const auto it = newDirByFile.find(parentId); it != newDirByFile.end()) {
+            parent = it->second;
+        } else if (const auto it2 = dirByFile.find(parentId); it2 != dirByFile.end() && !idx.isDead(it2->second)) {
+            parent = it2->second;
+        }
+        idx.records.setParent(recIdx, parent);
+    }
+
+    // Unchanged entries of a replaced (renamed/moved) directory follow it to its new record
+    if (replacedDirs) {
+        std::vector<uint32_t>& parents = idx.records.parents.mut();
+        for (quint32 i = 0; i < n; ++i) {
+            const quint32 p = parents[i];
+            if (p >= n || idx.isDead(i) || !idx.isDead(p)) continue;
+
+            const auto it = newDirByFile.find(idx.fileIds[p]);
+            if (it != newDirByFile.end()) {
+                parents[i] = it->second;
+                needsCompaction = true;
+            }
+        }
 
-        const QString p = dirPathFor(uid, deviceId, recIdx);
-        if (!p.isEmpty()) {
-            idx.dirIdByPathCache.emplace(p, recIdx);
+        // Whatever is still below a removed directory went with it (an EXT4 delta only lists the
+        // directory it was removed from, not the entries it had)
+        for (bool again = true; again;) {
+            again = false;
+            for (quint32 i = 0; i < parents.size(); ++i) {
+                const quint32 p = parents[i];
+                if (p < parents.size() && !idx.isDead(i) && idx.isDead(p)) {
+                    markDeadRecord(idx, i);
+                    ++touched;
+                    again = true;
+                }
+            }
         }
     }
 
-    idx.dirIdByPathBuilt = true;
+    if (!needsCompaction && (!added.empty() || !moved.empty() || removedAny)) {
+        applyDeltaToOrders(idx, std::move(added), std::move(moved), removedAny);
+    }
 
-    qInfo().noquote() << QStringLiteral("[watch-inc] built dirIdByPathCache device=%1 entries=%2")
-                         .arg(deviceId)
-                         .arg(idx.dirIdByPathCache.size());
+    return touched;
 }
 
-void IndexerService::ensureRecordByParentAndNameBuilt(DeviceIndex& idx) const {
-    if (idx.recordByParentAndNameBuilt) return;
-
-    idx.recordByParentAndNameCache.clear();
-    idx.recordByParentAndNameCache.reserve(idx.records.size());
+void IndexerService::finishIncrementalScan(quint64 jobId, Job& j, QVariantMap props) {
+    std::shared_ptr<DeviceIndex>* found = nullptr;
+    if (auto uidIt = m_indexesByUid.find(j.ownerUid); uidIt != m_indexesByUid.end()) {
+        if (auto devIt = uidIt->second.find(j.deviceId); devIt != uidIt->second.end()) found = &devIt->second;
+    }
 
-    for (quint32 recIdx = 0; recIdx < static_cast<quint32>(idx.records.size()); ++recIdx) {
-        const auto& r = idx.records[recIdx];
-        const QString name = QString::fromUtf8(idx.stringPool.data() + r.nameOffset,
-                                              static_cast<int>(r.nameLen));
-        idx.recordByParentAndNameCache.emplace(recordKey(r.parentRecordIdx, name), recIdx);
+    if (!found || (*found)->fileIds.size() != (*found)->records.size()) {
+        // Forgotten, or replaced by an index without file ids while the helper ran
+        Q_EMIT JobFinished(jobId, QStringLiteral("error"),
+                           QStringLiteral("The index changed while it was being updated; please re-index the device."),
+                           props);
+        return;
     }
 
-    idx.recordByParentAndNameBuilt = true;
+    std::shared_ptr<DeviceIndex>& slot = *found;
+    DeviceIndex& idx = mutableDeviceIndex(slot);
 
-    qInfo().noquote() << QStringLiteral("[watch-inc] built recordByParentAndNameCache entries=%1")
-                         .arg(idx.recordByParentAndNameCache.size());
-}
+    // Changed around the watch path; the old snapshot and its journal still replay to the old state
+    suspendWatchJournal(j.ownerUid, j.deviceId);
 
-static std::optional<QString> readFdPath(int fd) {
-    if (fd < 0) return std::nullopt;
-    const QByteArray link = QByteArrayLiteral("/proc/self/fd/") + QByteArray::number(fd);
+    const auto applyStart = std::chrono::steady_clock::now();
+    bool needsCompaction = false;
+    const quint64 touched = applyScanDelta(idx, j.stream, needsCompaction);
 
-    char buf[4096];
-    const ssize_t n = ::readlink(link.constData(), buf, sizeof(buf) - 1);
-    if (n < 0) return std::nullopt;
-    buf[n] = '\0';
-    return QString::fromLocal8Bit(buf);
-}
+    idx.journal = j.stream.checkpoint;
+    idx.lastIndexedTime = QDateTime::currentSecsSinceEpoch();
 
-static void repairOrderAndRankForRecord(std::vector<quint32>& order,
-                                       std::vector<quint32>& rank,
-                                       quint32 recIdx,
-                                       const auto& lessByRecordAsc)
-{
-    if (order.empty() || rank.empty()) return;
-    if (rank.size() != order.size()) return;
-    if (recIdx >= rank.size()) return;
+    // The delta went around the lookup caches
+    idx.dirPaths.clear();
+    idx.childTable.clear();
+    idx.childTableBuilt = false;
+    idx.childCountCache.clear();
 
-    const quint32 oldPos = rank[recIdx];
-    if (oldPos >= order.size()) return;
-    if (order[oldPos] != recIdx) {
-        // Rank/order mismatch (shouldn't happen); don't try to "fix" blindly.
-        return;
+    if (needsCompaction) {
+        slot = compactDeviceIndex(idx); // idx is gone after this
     }
+    bumpUidEpoch(j.ownerUid);
 
-    // Remove
-    order.erase(order.begin() + static_cast<ptrdiff_t>(oldPos));
+    addJobPhase(j.daemonPhases, QStringLiteral("applyDelta"), std::chrono::steady_clock::now() - applyStart);
+    recordScanTimings(j, static_cast<quint64>(slot->liveRecordCount()), props);
 
-    // Find new position (ascending)
-    auto it = std::lower_bound(order.begin(), order.end(), recIdx,
-                               [&](quint32 a, quint32 b) { return lessByRecordAsc(a, b); });
+    qInfo().noquote() << QStringLiteral("[index] job %1: delta scan, %2 files and %3 directories changed, %4 records touched")
+                         .arg(jobId).arg(static_cast<qulonglong>(j.stream.changedFileIds.size() + j.stream.stats.size()))
+                         .arg(static_cast<qulonglong>(j.stream.changedDirIds.size()))
+                         .arg(static_cast<qulonglong>(touched));
 
-    const quint32 newPos = static_cast<quint32>(std::distance(order.begin(), it));
-    order.insert(order.begin() + static_cast<ptrdiff_t>(newPos), recIdx);
+    queueDeviceIndexUpdated(j.ownerUid, j.deviceId,
+                            static_cast<quint64>(slot->generation),
+                            static_cast<quint64>(slot->liveRecordCount()));
 
-    // Update rank only for the affected interval
-    const quint32 lo = std::min(oldPos, newPos);
-    const quint32 hi = std::max(oldPos, newPos);
+    if (m_watchMgr) m_watchMgr->refreshWatchesForUid(j.ownerUid);
 
-    for (quint32 p = lo; p <= hi && p < order.size(); ++p) {
-        rank[order[p]] = p;
+    publishSharedIndex(j.ownerUid, j.deviceId, slot);
+
+    Q_EMIT JobProgress(jobId, 100, props);
+
+    // Final "rescanning" update (100%) so GUI can clear/replace it
+    {
+        QVariantMap st;
+        st.insert(QStringLiteral("deviceId"), j.deviceId);
+        st.insert(QStringLiteral("percent"), 100u);
+        Q_EMIT DaemonStateChanged(j.ownerUid, QStringLiteral("rescanning"), st);
     }
+
+    const QString okMessage = QStringLiteral("Updated %1 entries from %2 (generation %3)")
+                                  .arg(static_cast<qulonglong>(touched))
+                                  .arg(j.fsType == QStringLiteral("ext4") ? QStringLiteral("the changed directories")
+                                                                          : QStringLiteral("the change journal"))
+                                  .arg(static_cast<qulonglong>(slot->generation));
+
+    // The job finishes once the snapshot is on disk; a remaining delta is folded in first (until
+    // then the old snapshot and its older checkpoint replay to the same result)
+    scheduleSnapshotWrite(j.ownerUid, j.deviceId, slot, [this, jobId, props, okMessage](bool ok, const QString& saveErr) {
+        if (!ok) {
+            Q_EMIT JobFinished(jobId, QStringLiteral("error"),
+                               QStringLiteral("Indexed, but failed to save snapshot: %1").arg(saveErr), props);
+            return;
+        }
+        Q_EMIT JobFinished(jobId, QStringLiteral("ok"), okMessage, props);
+    });
 }
 
-bool IndexerService::applyIncrementalBatchIfSafe(quint32 uid, const QString& deviceId, const QVariantList& touched) {
+// --- End: Delta scans ---
+
+bool IndexerService::applyIncrementalBatchIfSafe(quint32 uid, const QString& deviceId,
+                                                 const std::vector<WatchManager::TouchedEntry>& touched) {
     // NOTE: caller must ensureLoadedForUid(uid)
     auto uidIt = m_indexesByUid.find(uid);
     if (uidIt == m_indexesByUid.end()) return false;
@@ -2947,14 +6474,9 @@ bool IndexerService::applyIncrementalBatchIfSafe(quint32 uid, const QString& dev
     auto devIt = uidIt->second.find(deviceId);
     if (devIt == uidIt->second.end()) return false;
 
-    DeviceIndex& idx = devIt->second;
-
     // If we see any generic tokens, incremental isn’t safe.
-    for (const QVariant& v : touched) {
-        const QVariantMap m = v.toMap();
-        if (m.value(QStringLiteral("name")).toString() == QStringLiteral("*")) {
-            return false;
-        }
+    for (const WatchManager::TouchedEntry& t : touched) {
+        if (t.generic) return false;
     }
 
     // Need mount point FD for open_by_handle_at
@@ -2967,143 +6489,315 @@ bool IndexerService::applyIncrementalBatchIfSafe(quint32 uid, const QString& dev
     const int mountFd = ::open(mpBytes.constData(), O_RDONLY | O_CLOEXEC | O_DIRECTORY);
     if (mountFd < 0) return false;
 
-    ensureDirIdByPathBuilt(idx, uid, deviceId);
-    ensureRecordByParentAndNameBuilt(idx);
+    // Clone first if a search is still reading this index (records/orders are patched in place below)
+    DeviceIndex& idx = mutableDeviceIndex(devIt->second);
+
+    ensureChildTableBuilt(idx);
+
+    // Cached dirIds are only good for this generation of the index, on this mount
+    DirHandleCache& dirHandles = m_watchBatchState[watchKey(uid, deviceId)].dirHandles;
+    dirHandles.reset(idx.generation, mpBytes);
 
     int updated = 0;
     int unsafe = 0;
+    int handleHits = 0;
+
+    static constexpr quint32 kUnresolved = 0xFFFFFFFEu; // below kRootDirId, above any record
+
+    // One touched entry. Its parent is either opened through the file handle (parentFd), or, when
+    // the handle is cached, known by dirId and reached by path from the mount point (relPath).
+    struct Touched {
+        const WatchManager::TouchedEntry* entry = nullptr;
+        QString name;
+        QString internalDir;
+        int parentFd = -1;
+        quint32 dirId = kUnresolved;
+        QByteArray relPath; // child path relative to mountFd (parentFd < 0 only)
+    };
 
-    for (const QVariant& v : touched) {
-        const QVariantMap m = v.toMap();
+    std::vector<Touched> pending;
+    pending.reserve(touched.size());
 
-        const QString name = m.value(QStringLiteral("name")).toString();
-        const QString handleHex = m.value(QStringLiteral("handleHex")).toString();
+    // Directory fds stay open until the end (created directories are verified through them)
+    std::vector<int> openFds;
 
-        if (name.isEmpty() || handleHex.isEmpty()) {
-            unsafe++;
-            continue;
-        }
+    const QString mountClean = QDir::cleanPath(mp);
 
-        const QByteArray handleBlob = QByteArray::fromHex(handleHex.toLatin1());
-        if (handleBlob.size() < static_cast<int>(sizeof(file_handle))) {
-            unsafe++;
-            continue;
-        }
+    // open_by_handle_at() + readlink: the parent's fd and its internal path
+    auto openParent = [&](Touched& t) -> bool {
+        const QByteArray& handleBlob = t.entry->handle;
+        if (handleBlob.size() < static_cast<int>(sizeof(file_handle))) return false;
 
         const file_handle* fhView = reinterpret_cast<const file_handle*>(handleBlob.constData());
         const size_t expect = sizeof(file_handle) + static_cast<size_t>(fhView->handle_bytes);
-        if (handleBlob.size() < static_cast<int>(expect)) {
-            unsafe++;
-            continue;
-        }
+        if (handleBlob.size() < static_cast<int>(expect)) return false;
 
+        // open_by_handle_at wants a writable buffer
         QByteArray handleMutable = handleBlob.left(static_cast<int>(expect));
         auto* fh = reinterpret_cast<file_handle*>(handleMutable.data());
 
         const int parentFd = ::open_by_handle_at(mountFd, fh, O_RDONLY | O_CLOEXEC);
-        if (parentFd < 0) {
-            unsafe++;
-            continue;
-        }
+        if (parentFd < 0) return false;
 
         const auto parentAbsOpt = readFdPath(parentFd);
         if (!parentAbsOpt) {
             ::close(parentFd);
-            unsafe++;
-            continue;
+            return false;
         }
 
         const QString parentAbs = QDir::cleanPath(*parentAbsOpt);
-        const QString mountClean = QDir::cleanPath(mp);
 
-        QString internalDir = QStringLiteral("/");
         if (parentAbs == mountClean) {
-            internalDir = QStringLiteral("/");
+            t.internalDir = QStringLiteral("/");
         } else if (parentAbs.startsWith(mountClean + QStringLiteral("/"))) {
-            internalDir = parentAbs.mid(mountClean.size());
+            t.internalDir = parentAbs.mid(mountClean.size());
         } else {
             // Unexpected: handle didn’t resolve under our mountpoint
             ::close(parentFd);
-            unsafe++;
-            continue;
+            return false;
         }
 
-        const auto dirIt = idx.dirIdByPathCache.find(internalDir);
-        if (dirIt == idx.dirIdByPathCache.end()) {
-            // Directory unknown to index: implies create/move into new dir → not safe
-            ::close(parentFd);
+        t.parentFd = parentFd;
+        t.dirId = kUnresolved;
+        t.relPath.clear();
+        openFds.push_back(parentFd);
+        return true;
+    };
+
+    for (const WatchManager::TouchedEntry& e : touched) {
+        if (e.name.isEmpty() || e.handle.isEmpty()) {
             unsafe++;
             continue;
         }
 
-        const quint32 parentDirId = dirIt->second;
+        Touched t;
+        t.entry = &e;
+        t.name = QString::fromLocal8Bit(e.name);
+
+        // Hit: a live directory of this generation; skip the handle syscalls and the path lookup
+        if (const auto cached = dirHandles.find(e.fsid, e.handle)) {
+            const quint32 dirId = *cached;
+            if (dirId == DirPathResolver::kRootDirId) {
+                t.dirId = dirId;
+                t.relPath = e.name;
+            } else if (dirId < idx.records.size() && !idx.isDead(dirId) && idx.records.isDir(dirId)) {
+                t.dirId = dirId;
+                t.relPath = QFile::encodeName(idx.dirPaths.resolve(dirTreeFor(idx), dirId).mid(1)) + "/" + e.name;
+            } else {
+                dirHandles.erase(e.fsid, e.handle);
+            }
 
-        // Must already exist in index for this “safe incremental” phase
-        const auto recIt = idx.recordByParentAndNameCache.find(recordKey(parentDirId, name));
-        if (recIt == idx.recordByParentAndNameCache.end()) {
-            ::close(parentFd);
-            unsafe++;
-            continue;
+            if (t.dirId != kUnresolved) {
+                handleHits++;
+                pending.push_back(std::move(t));
+                continue;
+            }
         }
 
-        const quint32 recIdx = recIt->second;
-        if (recIdx >= idx.records.size()) {
-            ::close(parentFd);
+        if (!openParent(t)) {
             unsafe++;
             continue;
         }
+        pending.push_back(std::move(t));
+    }
 
-        struct stat st {};
-        const QByteArray nameBytes = name.toLocal8Bit();
-        if (::fstatat(parentFd, nameBytes.constData(), &st, AT_SYMLINK_NOFOLLOW) != 0) {
-            // If it’s gone on disk, that’s a delete/rename → not safe for now
-            ::close(parentFd);
-            unsafe++;
-            continue;
+    std::vector<quint32> added;
+    std::vector<quint32> moved;
+    bool removedAny = false;
+
+    WatchJournal::Batch journalOps; // what this batch changed, for the device's journal
+
+    std::vector<quint32> deletedDirs; // deleted on disk, but still with live children in the index
+    std::vector<std::pair<quint32, size_t>> createdDirs; // (recIdx, index into doneEntries)
+    std::vector<Touched> doneEntries;
+
+    auto childCountOf = [&](quint32 dirId) -> quint32 {
+        return dirId < idx.childCountCache.size() ? idx.childCountCache[dirId] : 0;
+    };
+
+    auto tombstone = [&](quint32 recIdx) {
+        const quint32 parent = idx.records.parents[recIdx];
+        if (parent < idx.childCountCache.size() && idx.childCountCache[parent] > 0) {
+            --idx.childCountCache[parent];
         }
+        idx.childTable.erase(dirTreeFor(idx), recIdx);
+        markDeadRecord(idx, recIdx);
+        removedAny = true;
+
+        WatchJournal::Op op;
+        op.kind = WatchJournal::OpKind::Remove;
+        op.recIdx = recIdx;
+        journalOps.push_back(std::move(op));
+        updated++;
+    };
 
-        // Update metadata in-place
-        auto& r = idx.records[recIdx];
-        r.size = static_cast<quint64>(st.st_size);
-        r.modificationTime = static_cast<qint64>(st.st_mtime);
-        r.isDir = S_ISDIR(st.st_mode);
-        r.isSymlink = S_ISLNK(st.st_mode);
+    // Entries inside a directory created in this same batch only resolve once it exists, so retry
+    // the unresolved ones for as long as a round makes progress.
+    while (!pending.empty()) {
+        std::vector<Touched> retry;
+        bool progress = false;
+
+        for (Touched& t : pending) {
+            if (t.dirId == kUnresolved) {
+                const quint32 dirId = dirIdForInternalPath(idx, t.internalDir);
+                if (dirId == ChildTable::kNone) {
+                    retry.push_back(std::move(t));
+                    continue;
+                }
+                t.dirId = dirId;
+                dirHandles.insert(t.entry->fsid, t.entry->handle, t.dirId);
+            }
+            progress = true;
+
+            struct stat st {};
+            bool onDisk = t.parentFd >= 0
+                              ? ::fstatat(t.parentFd, t.entry->name.constData(), &st, AT_SYMLINK_NOFOLLOW) == 0
+                              : ::fstatat(mountFd, t.relPath.constData(), &st, AT_SYMLINK_NOFOLLOW) == 0;
+            if (!onDisk && errno == ENOENT && t.parentFd < 0) {
+                // Gone by path: deleted, or an ancestor was renamed. Only the handle can tell, so
+                // resolve this entry the slow way in the next round.
+                dirHandles.erase(t.entry->fsid, t.entry->handle);
+                if (openParent(t)) {
+                    retry.push_back(std::move(t));
+                } else {
+                    unsafe++;
+                }
+                continue;
+            }
+            if (!onDisk && errno != ENOENT) {
+                unsafe++;
+                continue;
+            }
 
-        // Repair precomputed sort orders affected by mtime/size changes
-        {
-            auto nameView = [&](quint32 i) -> std::string_view {
-                const auto& rr = idx.records[i];
-                return std::string_view(idx.stringPool.data() + rr.nameOffset, rr.nameLen);
-            };
+            const quint32 parentDirId = t.dirId;
+            const QByteArray nameUtf8 = t.name.toUtf8();
+            const quint32 knownIdx = idx.childTable.find(dirTreeFor(idx), parentDirId,
+                                                         std::string_view(nameUtf8.constData(), static_cast<size_t>(nameUtf8.size())));
+            const bool known = knownIdx < idx.records.size();
+
+            if (onDisk && known) {
+                // Update metadata in-place (detaches a mapped snapshot view on first write)
+                const quint32 recIdx = knownIdx;
+                idx.records.setStats(recIdx, static_cast<quint64>(st.st_size), static_cast<quint64>(st.st_mtime),
+                                     S_ISDIR(st.st_mode), S_ISLNK(st.st_mode));
+
+                WatchJournal::Op op;
+                op.kind = WatchJournal::OpKind::SetStats;
+                op.recIdx = recIdx;
+                op.size = static_cast<quint64>(st.st_size);
+                op.mtime = static_cast<quint64>(st.st_mtime);
+                op.isDir = S_ISDIR(st.st_mode);
+                op.isSymlink = S_ISLNK(st.st_mode);
+                journalOps.push_back(std::move(op));
+
+                // Size/mtime orders are repaired for the whole batch at the end
+                moved.push_back(recIdx);
+
+                // Name and parent are unchanged here, so orderByName/orderByPath stay valid (a new isDir
+                // only matters for records below it, and it has none in the index yet).
+                updated++;
+            } else if (onDisk) {
+                // Created (or moved in): append to the delta segment
+                WatchJournal::Op op;
+                op.kind = WatchJournal::OpKind::Append;
+                op.parentDirId = parentDirId;
+                op.size = static_cast<quint64>(st.st_size);
+                op.mtime = static_cast<quint64>(st.st_mtime);
+                op.fileId = static_cast<quint64>(st.st_ino);
+                op.isDir = S_ISDIR(st.st_mode);
+                op.isSymlink = S_ISLNK(st.st_mode);
+                op.name = nameUtf8;
+
+                const quint32 recIdx = appendDeltaRecord(idx, parentDirId, op.name, op.size, op.mtime,
+                                                         op.isDir, op.isSymlink, op.fileId);
+                added.push_back(recIdx);
+                journalOps.push_back(std::move(op));
+
+                idx.childTable.insert(dirTreeFor(idx), recIdx);
+                idx.childCountCache.resize(idx.records.size(), 0);
+                if (parentDirId < idx.childCountCache.size()) ++idx.childCountCache[parentDirId];
+
+                if (S_ISDIR(st.st_mode)) {
+                    createdDirs.emplace_back(recIdx, doneEntries.size());
+                }
+                updated++;
+            } else if (known) {
+                // Deleted (or moved away). A directory goes last, after the deletions inside it.
+                const quint32 recIdx = knownIdx;
+                if (idx.records.isDir(recIdx) && childCountOf(recIdx) > 0) {
+                    deletedDirs.push_back(recIdx);
+                } else {
+                    tombstone(recIdx);
+                }
+            }
 
-            auto lessByMtimeAsc = [&](quint32 a, quint32 b) {
-                const auto ta = idx.records[a].modificationTime;
-                const auto tb = idx.records[b].modificationTime;
-                if (ta != tb) return ta < tb;
-                const int c = ciCompareBytes(nameView(a), nameView(b));
-                if (c != 0) return c < 0;
-                return a < b;
-            };
+            doneEntries.push_back(std::move(t));
+        }
 
-            auto lessBySizeAsc = [&](quint32 a, quint32 b) {
-                const auto sa = idx.records[a].size;
-                const auto sb = idx.records[b].size;
-                if (sa != sb) return sa < sb;
-                const int c = ciCompareBytes(nameView(a), nameView(b));
-                if (c != 0) return c < 0;
-                return a < b;
-            };
+        if (!progress) {
+            // Directory unknown to the index and not created in this batch
+            unsafe += static_cast<int>(retry.size());
+            break;
+        }
+        pending = std::move(retry);
+    }
 
-            repairOrderAndRankForRecord(idx.orderByMtime, idx.rankByMtime, recIdx, lessByMtimeAsc);
-            repairOrderAndRankForRecord(idx.orderBySize,  idx.rankBySize,  recIdx, lessBySizeAsc);
+    // Deleted directories, innermost first; one that still has children was moved away as a
+    // whole tree, which this phase can't follow.
+    for (bool progress = true; progress && !deletedDirs.empty();) {
+        progress = false;
+        for (auto it = deletedDirs.begin(); it != deletedDirs.end();) {
+            if (childCountOf(*it) == 0) {
+                tombstone(*it);
+                it = deletedDirs.erase(it);
+                progress = true;
+            } else {
+                ++it;
+            }
+        }
+    }
+    unsafe += static_cast<int>(deletedDirs.size());
+
+    // A created directory must not hold more than the batch added to it (else a tree was moved in)
+    for (const auto& [recIdx, entry] : createdDirs) {
+        const Touched& t = doneEntries[entry];
+
+        const int dirFd = t.parentFd >= 0
+                              ? ::openat(t.parentFd, t.entry->name.constData(), O_RDONLY | O_CLOEXEC | O_DIRECTORY)
+                              : ::openat(mountFd, t.relPath.constData(), O_RDONLY | O_CLOEXEC | O_DIRECTORY);
+        DIR* dir = dirFd >= 0 ? ::fdopendir(dirFd) : nullptr;
+        if (!dir) {
+            if (dirFd >= 0) ::close(dirFd);
+            unsafe++;
+            continue;
         }
 
-        ::close(parentFd);
-        updated++;
+        quint32 onDisk = 0;
+        while (const dirent* e = ::readdir(dir)) {
+            if (std::strcmp(e->d_name, ".") != 0 && std::strcmp(e->d_name, "..") != 0) ++onDisk;
+        }
+        ::closedir(dir);
+
+        if (onDisk > childCountOf(recIdx)) unsafe++;
     }
 
+    for (int fd : openFds) ::close(fd);
     ::close(mountFd);
 
+    if (!added.empty() || !moved.empty() || removedAny) {
+        applyDeltaToOrders(idx, std::move(added), std::move(moved), removedAny);
+    }
+
+    // Persisted even for an unsafe batch: what was applied stays applied until the rescan
+    if (!journalOps.empty()) {
+        appendWatchJournal(uid, deviceId, journalOps);
+    }
+
+    if (updated > 0) {
+        // Invalidate global cache so empty-query paging reflects updated mtime/size ordering if user sorts by those.
+        bumpUidEpoch(uid);
+    }
+
     if (unsafe > 0) {
         qInfo().noquote() << QStringLiteral("[watch-inc] unsafe batch uid=%1 device=%2 updated=%3 unsafe=%4 -> fallback rescan")
                              .arg(uid).arg(deviceId).arg(updated).arg(unsafe);
@@ -3111,16 +6805,15 @@ bool IndexerService::applyIncrementalBatchIfSafe(quint32 uid, const QString& dev
     }
 
     if (updated > 0) {
-        // Invalidate global cache so empty-query paging reflects updated mtime/size ordering if user sorts by those.
-        bumpUidEpoch(uid);
-
         // Batch index update signal (so GUI refreshes rows)
         queueDeviceIndexUpdated(uid, deviceId,
                                 static_cast<quint64>(idx.generation),
-                                static_cast<quint64>(idx.records.size()));
+                                static_cast<quint64>(idx.liveRecordCount()));
+
+        qInfo().noquote() << QStringLiteral("[watch-inc] applied uid=%1 device=%2 updated=%3 delta=%4 handleHits=%5")
+                             .arg(uid).arg(deviceId).arg(updated).arg(idx.deltaSize()).arg(handleHits);
 
-        qInfo().noquote() << QStringLiteral("[watch-inc] applied uid=%1 device=%2 updated=%3")
-                             .arg(uid).arg(deviceId).arg(updated);
+        scheduleDeltaCompaction(uid, deviceId);
         return true;
     }
 
@@ -3130,7 +6823,7 @@ bool IndexerService::applyIncrementalBatchIfSafe(quint32 uid, const QString& dev
 
 void IndexerService::applyWatchBatch(quint32 uid,
                                      const QString& deviceId,
-                                     const QVariantList& touched,
+                                     const std::vector<WatchManager::TouchedEntry>& touched,
                                      bool overflowSeen) {
     if (deviceId.trimmed().isEmpty()) return;
 
@@ -3149,19 +6842,13 @@ void IndexerService::applyWatchBatch(quint32 uid,
     int generic = 0;
     int malformed = 0;
 
-    for (const QVariant& v : touched) {
-        const QVariantMap m = v.toMap();
-        const QString name = m.value(QStringLiteral("name")).toString();
-        if (name == QStringLiteral("*")) {
+    for (const WatchManager::TouchedEntry& t : touched) {
+        if (t.generic) {
             generic++;
             continue;
         }
 
-        const QString fsidHex = m.value(QStringLiteral("fsidHex")).toString();
-        const QString handleHex = m.value(QStringLiteral("handleHex")).toString();
-        const auto maskVar = m.value(QStringLiteral("mask"));
-
-        const bool ok = !name.isEmpty() && !fsidHex.isEmpty() && !handleHex.isEmpty() && maskVar.isValid();
+        const bool ok = !t.name.isEmpty() && !t.handle.isEmpty() && t.mask != 0;
         if (ok) structured++;
         else malformed++;
     }
@@ -3169,7 +6856,7 @@ void IndexerService::applyWatchBatch(quint32 uid,
     qInfo().noquote() << QStringLiteral("[watch] batch uid=%1 device=%2 touched=%3 structured=%4 generic=%5 malformed=%6 overflow=%7")
                          .arg(uid)
                          .arg(deviceId)
-                         .arg(touched.size())
+                         .arg(static_cast<qulonglong>(touched.size()))
                          .arg(structured)
                          .arg(generic)
                          .arg(malformed)
@@ -3194,10 +6881,10 @@ void IndexerService::applyWatchBatch(quint32 uid,
         return;
     }
 
-    if (touched.isEmpty() && !overflowSeen) return;
+    if (touched.empty() && !overflowSeen) return;
 
     // Try safe incremental first (updates existing entries only).
-    if (watchIncrementalEnabled() && !touched.isEmpty()) {
+    if (watchIncrementalEnabled() && !touched.empty()) {
         if (applyIncrementalBatchIfSafe(uid, deviceId, touched)) {
             return; // done; no rescan needed
         }
@@ -15,23 +15,49 @@
 #include <QVariantMap>
 #include <QByteArray>
 #include <QTimer>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <limits>
 #include <memory>
+#include <mutex>
 #include <optional>
+#include <span>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 #include <deque>
+#include <functional>
+#include <list>
 
+#include <QtDBus/QDBusConnection>
 #include <QtDBus/QDBusContext>
+#include <QtDBus/QDBusMessage>
 
 #include "../ScannerEngine.h"
+#include "../ScanProtocol.h"
+#include "MappedArray.h"
+#include "ChildTable.h"
+#include "DirHandleCache.h"
+#include "DirPathResolver.h"
+#include "ExtensionIndex.h"
+#include "NameMatcher.h"
+#include "NameTable.h"
+#include "RecordColumns.h"
+#include "TrigramIndex.h"
+#include "WatchJournal.h"
+#include "WatchManager.h"
 
 class IndexerService final : public QObject, protected QDBusContext {
     Q_OBJECT
     Q_CLASSINFO("D-Bus Interface", "net.reikooters.Kerything1.Indexer")
 
+    // kerything-bench drives the build, search and snapshot paths directly (bench/IndexerBench.h)
+    friend class IndexerBench;
+
 public:
-    explicit IndexerService(QObject* parent = nullptr);
+    // indexRoot: snapshots and watch journals go to <indexRoot>/<uid>/
+    explicit IndexerService(QObject* parent = nullptr, QString indexRoot = QStringLiteral("/var/lib/kerything/indexes"));
     ~IndexerService() override;
 
     // --- WatchManager integration (prototype) ---
@@ -44,12 +70,10 @@ public:
     void startAutoRescanIfAllowed(quint32 uid, const QString& deviceId);
 
     // Called by WatchManager after it drains events and coalesces them into a time batch.
-    // touched entries: array of dicts with:
-    //  - fsidHex: string   (hex of fid->fsid; may be empty for generic fallback)
-    //  - handleHex: string (hex of file_handle blob; may be empty for generic fallback)
-    //  - name: string      (child name, or "*" for generic fallback)
-    //  - mask: uint64      (OR of observed fanotify masks)
-    void applyWatchBatch(quint32 uid, const QString& deviceId, const QVariantList& touched, bool overflowSeen);
+    // touched entries carry the raw fsid/file handle bytes and child name (see WatchManager::TouchedEntry);
+    // a generic entry means events arrived that could not be parsed.
+    void applyWatchBatch(quint32 uid, const QString& deviceId,
+                         const std::vector<WatchManager::TouchedEntry>& touched, bool overflowSeen);
 
 public slots:
     /**
@@ -137,6 +161,16 @@ public slots:
     //    [entryId:uint64, deviceId:string, name:string, dirId:uint32, size:uint64, mtime:int64, flags:uint32]
     /**
      * Searches the index based on the provided query and filters, returning the matching results along with metadata.
+     * The query runs on a search worker and the reply is delayed until it is done (see m_searchPool).
+     * If options has "querySerial" (uint64), a newer serial from the same caller (or CancelSearch)
+     * cancels the search; it then fails with net.reikooters.Kerything1.Error.Cancelled.
+     *
+     * Optional filters in options (all bounds inclusive): "minSize"/"maxSize" (bytes),
+     * "mtimeFrom"/"mtimeTo" (unix seconds), "dirsOnly"/"filesOnly" (bool). "ext:pdf" and "*.pdf"
+     * query tokens match the file extension exactly instead of a name substring.
+     *
+     * With options "timings" (bool), the reply carries a third value: an a{sv} of the search's stage
+     * times in nanoseconds and its counters (see SearchTrace). Replies without it are unchanged.
      *
      * @param query The search query string used to filter the records in the index.
      * @param deviceIds A list of device IDs to limit the search scope. If empty, all devices are searched.
@@ -158,6 +192,26 @@ public slots:
                 quint64& totalHitsOut,
                 QVariantList& rowsOut) const;
 
+    /**
+     * Same as Search, but returns the page as one packed byte array (see SearchProtocol.h):
+     * a device-id table, fixed-width rows and a names blob, with no per-field variants.
+     *
+     * With options "includePaths" (bool), the page also carries the display path of each distinct
+     * dirId in it (as ResolveDirectories would return it), saving the client that round trip.
+     *
+     * @param totalHitsOut Populated with the total number of records matching the query.
+     * @param packedOut Populated with the packed page.
+     */
+    void SearchPacked(const QString& query,
+                      const QStringList& deviceIds,
+                      const QString& sortKey,
+                      const QString& sortDir,
+                      quint32 offset,
+                      quint32 limit,
+                      const QVariantMap& options,
+                      quint64& totalHitsOut,
+                      QByteArray& packedOut) const;
+
     // // Returns:
     // //  out: array of pairs:
     // //    [dirId:uint32, path:string]
@@ -216,6 +270,38 @@ public slots:
      */
     void SetWatchEnabled(const QString& deviceId, bool enabled);
 
+    /**
+     * Cancels the calling client's running and queued searches with querySerial <= serial.
+     * Searches without a querySerial are never cancelled.
+     */
+    void CancelSearch(quint64 serial);
+
+    /**
+     * Reports counters of the daemon-wide search session cache.
+     *
+     * @param statsOut Populated with: hits, misses, evictions, narrowed, cancelled, sessions (uint64),
+     *                 bytes (current memory use) and maxBytes (cap).
+     */
+    void GetSearchCacheStats(QVariantMap& statsOut) const;
+
+    /**
+     * Reports where the daemon spends its time and memory, for diagnostics.
+     *
+     * @param statsOut Populated with:
+     *  - search: searches and emptyQueries (uint64), the summed SearchTrace stage times in ns (queuedNs,
+     *    candidatesNs, refineNs, orderNs, mergeNs, marshalNs, totalNs) and maxTotalNs, the summed
+     *    counters (trigramRanges, candidates, hits), and latencyHistogram: entry b counts the searches
+     *    that took under 2^b ms (and at least half that), the last entry the slower ones
+     *  - searchCache: as GetSearchCacheStats, plus hitRate (double)
+     *  - globalOrder: entries and bytes of the caller's cached empty-query orders
+     *  - devices: per index of the caller: deviceId, entryCount, mapped (bool, read from the snapshot
+     *    file), bytes, and the bytes of each structure (records, stringPool, foldedPool, names, trigrams,
+     *    extensions, orders, ranks, nameSignatures, fileIds, delta, caches)
+     *  - scans: the caller's last finished scans, oldest first: jobId, deviceId, fsType, incremental,
+     *    entryCount, finishedTime, totalUs, helperPhases and daemonPhases (name -> microseconds)
+     */
+    void GetStats(QVariantMap& statsOut) const;
+
 signals:
     void JobAdded(quint64 jobId, const QVariantMap& props);
     void JobProgress(quint64 jobId, quint32 percent, const QVariantMap& props);
@@ -245,62 +331,421 @@ private:
         // watch toggle (per-uid); persisted in snapshots (v5+)
         bool watchEnabled = true;
 
-        std::vector<ScannerEngine::FileRecord> records;
-        std::vector<char> stringPool;
+        // Owned after a scan, or views into the mmap'd snapshot (v6+) after a load.
+        // Records are stored column by column (v11+ snapshots map each column directly).
+        RecordColumns records;
+        MappedArray<char> stringPool;
+
+        // CaseFold'ed copy of stringPool (same offsets); used for trigrams, matching and name order
+        MappedArray<char> foldedPool;
+
+        // Distinct names (each stored once in the pools) -> their records (v14+), up to deltaBegin()
+        NameTable names;
 
         // Search acceleration
-        std::vector<ScannerEngine::TrigramEntry> flatIndex; // sorted by (trigram, recordIdx)
+        TrigramIndex trigrams;     // compressed trigram -> name id postings (v14+; recordIdx before)
+        ExtensionIndex extensions; // folded extension -> recordIdx postings (v12+), up to deltaBegin()
+
+        // NameSignature::of each folded name, by name id (v16+; per record in v13-v15): prunes 1-2
+        // byte queries. Delta records are signed on the fly.
+        MappedArray<quint64> nameSignatures;
+
+        // File system id of each record (NTFS: MFT record number, EXT4: inode number), parallel to
+        // records; empty if the scanner didn't send any. Lets a delta scan find the records of a file.
+        MappedArray<quint64> fileIds;
+
+        // Where the next delta scan starts (see ScanProtocol::CheckpointPayload); journalId 0 = none (v10+)
+        ScanProtocol::CheckpointPayload journal{};
 
         // Precomputed sort orders (ascending)
-        std::vector<quint32> orderByName;
-        std::vector<quint32> orderByPath;
-        std::vector<quint32> orderBySize;
-        std::vector<quint32> orderByMtime;
-
-        // Inverse of orderBy* : recordIdx -> rank (ascending position)
-        std::vector<quint32> rankByName;
-        std::vector<quint32> rankByPath;
-        std::vector<quint32> rankBySize;
-        std::vector<quint32> rankByMtime;
-
-        // dirId (record index) -> full directory path
-        mutable std::unordered_map<quint32, QString> dirPathCache;
-
-        // internal directory path ("/foo/bar") -> dirId (record idx)
-        mutable std::unordered_map<QString, quint32> dirIdByPathCache;
-        mutable bool dirIdByPathBuilt = false;
-
-        // key = "<parentDirId>\n<name>" -> recordIdx
-        mutable std::unordered_map<QString, quint32> recordByParentAndNameCache;
-        mutable bool recordByParentAndNameBuilt = false;
+        MappedArray<quint32> orderByName;
+        MappedArray<quint32> orderByPath;
+        MappedArray<quint32> orderBySize;
+        MappedArray<quint32> orderByMtime;
+
+        // Inverse of orderBy* : recordIdx -> rank (ascending position); kDeadRank for tombstones
+        MappedArray<quint32> rankByName;
+        MappedArray<quint32> rankByPath;
+        MappedArray<quint32> rankBySize;
+        MappedArray<quint32> rankByMtime;
+
+        // Watch delta (LSM-style overlay, folded back into the base by compactDeviceIndex):
+        // records from deltaBegin() on were created by incremental watch updates and are found
+        // through deltaTrigrams (by recordIdx) instead of `trigrams`. Deleted records stay in place as
+        // tombstones (dead bit set) and are removed from the orders. Persisted only as the
+        // device's WatchJournal; snapshots are always written compacted.
+        std::vector<ScannerEngine::TrigramEntry> deltaTrigrams; // sorted, like the scan's flat index
+        std::vector<quint64> deadBits;                          // empty = no tombstones
+        quint32 deadCount = 0;
+
+        [[nodiscard]] quint32 deltaBegin() const { return names.recordCount; }
+        [[nodiscard]] bool hasDelta() const { return records.size() > deltaBegin() || deadCount > 0; }
+        [[nodiscard]] quint64 deltaSize() const { return records.size() - deltaBegin() + deadCount; }
+        [[nodiscard]] quint64 liveRecordCount() const { return records.size() - deadCount; }
+        [[nodiscard]] bool isDead(quint32 i) const {
+            return deadCount != 0 && (i >> 6) < deadBits.size() && ((deadBits[i >> 6] >> (i & 63)) & 1u) != 0;
+        }
+
+        // Holders reading this version off the main thread, and clones viewing its arrays (see
+        // pinDeviceIndex). A copied or moved DeviceIndex starts unpinned.
+        struct PinCount {
+            mutable std::atomic<quint32> count{0};
+
+            PinCount() = default;
+            PinCount(const PinCount&) {}
+            PinCount& operator=(const PinCount&) { return *this; }
+        };
+        PinCount pins;
+
+        // The caches below are only used (and filled) on the main thread; search workers never touch them.
+        // A clone starts without them (see mutableDeviceIndex).
+
+        // dirId (record index) -> full directory path (byte-budgeted LRU)
+        mutable DirPathResolver dirPaths;
+
+        // (parentDirId, name) -> recordIdx for live records; directory paths are walked through it too
+        mutable ChildTable childTable;
+        mutable bool childTableBuilt = false;
+
+        // The root directory's own record (empty-named, built with childTable), else kRootDirId
+        mutable quint32 rootDirId = DirPathResolver::kRootDirId;
+
+        // dirId -> number of live entries directly inside it (built with childTable)
+        mutable std::vector<quint32> childCountCache;
     };
 
+    static constexpr quint32 kDeadRank = 0xFFFFFFFFu;
+
     // --- Begin: Empty-query global-order cache (for fast jump paging) ---
 
+    // 6 bytes per record: the device is an ordinal into GlobalOrderCache::deviceIds
+#pragma pack(push, 1)
     struct GlobalOrderEntry {
-        QString deviceId;
         quint32 recordIdx = 0;
+        quint16 deviceOrdinal = 0;
     };
+#pragma pack(pop)
+
+    static_assert(sizeof(GlobalOrderEntry) == 6);
 
     struct GlobalOrderCache {
         quint64 epoch = 0;                 // invalidated when indexes change for that uid
         QString sortKey;                   // "name"/"path"/"size"/"mtime"
+        QStringList deviceIds;             // deviceOrdinal -> deviceId
         std::vector<GlobalOrderEntry> asc; // ascending global order (all devices)
     };
 
+    enum class OrderKey : quint8 {
+        Name,
+        Path,
+        Size,
+        Mtime,
+    };
+
+    // --- Begin: Concurrent search ---
+
+    // The indexes of one uid as seen by a search. Built on the main thread; the pinned pointers
+    // keep every DeviceIndex alive (and unchanged, see mutableDeviceIndex) until the search is done.
+    struct SearchSnapshot {
+        quint32 uid = 0;
+        quint64 epoch = 0;
+        std::unordered_map<QString, std::shared_ptr<const DeviceIndex>> indexes;
+    };
+
+    [[nodiscard]] SearchSnapshot searchSnapshotForUid(quint32 uid) const;
+
+    // Copy-on-write access for the main thread: clones the index first if it is pinned (by a search,
+    // a snapshot write, a compaction or another uid's view). The clone is a shareDeviceIndex() view,
+    // so only the arrays written afterwards are actually copied, and it takes over the lookup caches.
+    DeviceIndex& mutableDeviceIndex(std::shared_ptr<DeviceIndex>& slot) const;
+
+    // A reference that keeps idx alive and pinned until it is released; taken on the main thread only
+    [[nodiscard]] static std::shared_ptr<const DeviceIndex> pinDeviceIndex(std::shared_ptr<const DeviceIndex> idx);
+
+    // A DeviceIndex whose arrays are views into src's (src stays pinned as their backing), with the
+    // rest of its state copied and the lookup caches left to be rebuilt on demand
+    [[nodiscard]] static std::shared_ptr<DeviceIndex> shareDeviceIndex(const std::shared_ptr<const DeviceIndex>& src);
+
+    // Cooperative cancellation: a search is superseded once its caller's watermark passes its serial.
+    // Checked between posting intersections, per refine chunk and during sorting/merging.
+    struct SearchCancel {
+        std::shared_ptr<const std::atomic<quint64>> watermark; // null = not cancellable
+        quint64 serial = 0;
+
+        [[nodiscard]] bool cancelled() const {
+            return watermark && watermark->load(std::memory_order_relaxed) > serial;
+        }
+    };
+
+    // Main thread: raises the caller's watermark to options["querySerial"], cancelling its older searches
+    [[nodiscard]] SearchCancel searchCancelFor(const QVariantMap& options) const;
+
+    // Error reply for a cancelled search (also counts it)
+    [[nodiscard]] QDBusMessage searchCancelledReply(const QDBusMessage& request) const;
+
+    // D-Bus sender (unique name) -> lowest querySerial that may still run. Only touched on the main
+    // thread (D-Bus slots and the watcher below), so the const search paths fill it without a lock;
+    // running searches hold their own reference to the counter.
+    mutable std::unordered_map<QString, std::shared_ptr<std::atomic<quint64>>> m_searchWatermarkBySender;
+
+    // Drops a sender's watermark once it leaves the bus
+    mutable class QDBusServiceWatcher* m_searchSenderWatcher = nullptr;
+
+    // The caller's watermark, created (and its name watched) on first use
+    [[nodiscard]] std::shared_ptr<std::atomic<quint64>> searchWatermarkForCaller() const;
+
+    // One row of a search page; pointers refer into the snapshot and are valid as long as it is
+    struct PageHit {
+        const QString* deviceId = nullptr;
+        const DeviceIndex* idx = nullptr;
+        quint32 recordIdx = 0;
+    };
+
+    // A distinct parent directory of a page, with its display path ("includePaths")
+    struct PageDir {
+        const QString* deviceId = nullptr;
+        quint32 dirId = 0;
+        QString path;
+    };
+
+    // Stage times (ns) and counters of one search. Summed into m_searchStats; with options
+    // "timings" also returned to the caller.
+    struct SearchTrace {
+        quint64 queuedNs = 0;     // D-Bus call -> picked up by a search worker
+        quint64 candidatesNs = 0; // trigram postings, extension postings or filter slices -> candidates
+        quint64 refineNs = 0;     // candidates -> hits (name match, filter bounds)
+        quint64 orderNs = 0;      // ordering a session's hits (orderSearchHits)
+        quint64 mergeNs = 0;      // empty query: the page from the global order cache or a k-way merge
+        quint64 marshalNs = 0;    // page -> reply (rows or packed page, "includePaths" directories)
+        quint64 totalNs = 0;      // D-Bus call -> reply
+
+        quint64 trigramRanges = 0; // posting lists decoded or intersected
+        quint64 candidates = 0;    // names or records that went through a refine
+        quint64 hits = 0;          // all hits, not just the page
+
+        // "empty" (empty-query fast path), "hit" (cached session), "narrowed" (refined a cached
+        // parent session) or "miss"
+        QString path;
+
+        [[nodiscard]] QVariantMap toVariantMap() const;
+    };
+
+    // Every answered search since startup (GetStats); guarded by m_searchCacheMutex
+    struct SearchStats {
+        static constexpr size_t kLatencyBuckets = 14; // the last one: 4096 ms and up
+
+        quint64 searches = 0;
+        quint64 emptyQueries = 0;
+        SearchTrace totals; // field sums
+        quint64 maxTotalNs = 0;
+        std::array<quint64, kLatencyBuckets> latencyHistogram{};
+    };
+
+    // Records trace into m_searchStats and sends the reply (any thread); withTimings appends trace to args
+    void sendSearchReply(QDBusConnection& conn, const QDBusMessage& request, QVariantList args, SearchTrace& trace,
+                         std::chrono::steady_clock::time_point received, bool withTimings) const;
+
+    mutable SearchStats m_searchStats;
+
+    // Search filters from options; size and mtime ranges are answered from orderBySize/orderByMtime
+    struct SearchFilter {
+        static constexpr quint64 kUnbounded = std::numeric_limits<quint64>::max();
+
+        quint64 minSize = 0;
+        quint64 maxSize = kUnbounded;
+        quint64 mtimeFrom = 0;
+        quint64 mtimeTo = kUnbounded;
+        bool dirsOnly = false;
+        bool filesOnly = false;
+
+        // Folded extensions from ext:/*.xxx query tokens (see tokenizeQuery); a record's extension
+        // has to equal every one of them
+        QList<QByteArray> extensions;
+
+        [[nodiscard]] bool sizeActive() const { return minSize != 0 || maxSize != kUnbounded; }
+        [[nodiscard]] bool mtimeActive() const { return mtimeFrom != 0 || mtimeTo != kUnbounded; }
+        [[nodiscard]] bool boundsActive() const { return sizeActive() || mtimeActive() || dirsOnly || filesOnly; }
+        [[nodiscard]] bool active() const { return boundsActive() || !extensions.isEmpty(); }
+
+        // Part of the search session key (empty when inactive)
+        [[nodiscard]] QString key() const;
+    };
+
+    // A filter's ranges as [lo, hi) positions in one device's orderBySize / orderByMtime, so a
+    // record passes when its ranks fall inside them (two compares, no field reads)
+    struct FilterBounds {
+        quint32 sizeLo = 0;
+        quint32 sizeHi = 0;
+        quint32 mtimeLo = 0;
+        quint32 mtimeHi = 0;
+    };
+
+    [[nodiscard]] static SearchFilter searchFilterFor(const QVariantMap& options);
+    [[nodiscard]] static FilterBounds filterBoundsFor(const DeviceIndex& idx, const SearchFilter& filter);
+    // Checks the bounds only: extension candidates come from the extension index
+    [[nodiscard]] static bool filterAdmits(const DeviceIndex& idx, const SearchFilter& filter, const FilterBounds& bounds,
+                                           quint32 recIdx);
+    [[nodiscard]] static bool extensionMatches(const DeviceIndex& idx, const SearchFilter& filter, quint32 recIdx);
+
+    // Empty query: the records passing filter, taken from the narrower of its range slices
+    [[nodiscard]] static std::vector<quint32> deviceCandidatesForFilter(const DeviceIndex& idx, const SearchFilter& filter,
+                                                                        const FilterBounds& bounds);
+
+    // Shared implementation of Search/SearchPacked (runs on a search worker): fills hitsOut with the requested page.
+    // Returns false if the search was cancelled.
+    bool collectSearchPage(const SearchSnapshot& snap,
+                           const SearchCancel& cancel,
+                           const SearchFilter& filter,
+                           const QString& query,
+                           const QStringList& deviceIds,
+                           const QString& sortKey,
+                           const QString& sortDir,
+                           quint32 offset,
+                           quint32 limit,
+                           quint64& totalHitsOut,
+                           std::vector<PageHit>& hitsOut,
+                           SearchTrace* trace = nullptr) const;
+
+    static QVariantList rowsForHits(const std::vector<PageHit>& hits);
+    static QByteArray packedPageForHits(const std::vector<PageHit>& hits, const std::vector<PageDir>& dirs = {});
+
+    // Main thread (uses the directory path caches): the page's distinct dirIds and their display paths
+    [[nodiscard]] std::vector<PageDir> pageDirectoriesFor(const std::vector<PageHit>& hits) const;
+
+    // What ResolveDirectories puts in front of internal paths: the mount point, else "[label]"/"[deviceId]"
+    [[nodiscard]] QString directoryDisplayPrefix(const QString& deviceId) const;
+    [[nodiscard]] static QString joinDisplayPrefix(const QString& prefix, const QString& internalPath);
+
+    // Queries run here (delayed D-Bus replies), so a slow one doesn't stall the event loop
+    class QThreadPool* m_searchPool = nullptr;
+    static constexpr int kSearchWorkerThreads = 4;
+
+    // Guards everything below that search workers share: the uid epochs, global-order cache,
+    // warm-up set and search session cache. Never held while searching or building.
+    mutable std::mutex m_searchCacheMutex;
+
+    // --- End: Concurrent search ---
+
     void bumpUidEpoch(quint32 uid) const;
-    const GlobalOrderCache* globalOrderForUid(quint32 uid, const QString& sortKey) const;
-    void rebuildGlobalOrderForUid(quint32 uid, const QString& sortKey) const;
+    [[nodiscard]] quint64 uidEpoch(quint32 uid) const; // m_searchCacheMutex held
+    std::shared_ptr<const GlobalOrderCache> globalOrderForUid(quint32 uid, quint64 epoch, const QString& sortKey) const;
+    std::shared_ptr<const GlobalOrderCache> rebuildGlobalOrderForUid(const SearchSnapshot& snap, const QString& sortKey,
+                                                                     const SearchCancel& cancel) const;
+
+    // One device's sorted order (orderByName/...), or a range slice of it: an input run of the
+    // empty-query global merge
+    struct OrderRun {
+        const QString* deviceId = nullptr;
+        const DeviceIndex* idx = nullptr;
+        std::span<const quint32> order;
+    };
+
+    [[nodiscard]] static OrderKey orderKeyFor(const QString& sortKey);
+    [[nodiscard]] static std::vector<OrderRun> orderRunsFor(const SearchSnapshot& snap, const QStringList& deviceIds,
+                                                           OrderKey key);
 
-    // Simple warm-up scheduling (no threads): prevents repeated scheduling storms.
+    // Global empty-query order: sort field, folded name, then deviceId and recordIdx as tie-breakers
+    [[nodiscard]] static bool orderLess(OrderKey key, const OrderRun& a, quint32 ai, const OrderRun& b, quint32 bi);
+
+    // Multi-sequence selection: per-run positions whose prefixes together are exactly the first
+    // `rank` entries of the merged order. O(k^2 log^2 n) comparisons, nothing is materialized.
+    [[nodiscard]] static std::vector<quint32> globalRankSplit(const std::vector<OrderRun>& runs, OrderKey key, quint64 rank);
+
+    // k-way merges `count` entries starting at the per-run positions pos, calling emit(runIndex, recordIdx).
+    // Returns false if cancelled.
+    template<typename Emit>
+    static bool mergeOrderRuns(const std::vector<OrderRun>& runs, OrderKey key, std::vector<quint32> pos,
+                               quint64 count, const SearchCancel& cancel, Emit&& emit);
+
+    // Simple warm-up scheduling: prevents repeated scheduling storms.
     [[nodiscard]] static QString warmKey(quint32 uid, quint64 epoch, const QString& sortKey);
 
     mutable std::unordered_map<quint32, quint64> m_uidEpoch;
-    mutable std::unordered_map<quint32, std::unordered_map<QString, GlobalOrderCache>> m_globalOrderByUid;
+    mutable std::unordered_map<quint32, std::unordered_map<QString, std::shared_ptr<const GlobalOrderCache>>> m_globalOrderByUid;
     mutable std::unordered_set<QString> m_globalWarmScheduled;
 
     // --- End: Empty-query global-order cache ---
 
+    // --- Begin: Search session cache (non-empty queries, reused across page fetches) ---
+
+    struct SessionHit {
+        quint32 deviceOrdinal = 0; // index into SearchSession::deviceIds
+        quint32 recordIdx = 0;
+    };
+
+    // All hits of a session in page order for one sort key + direction
+    struct OrderedHits {
+        QString orderKey;
+        std::vector<SessionHit> hits;
+    };
+
+    // Everything but `ordered` and `lastUsed` is immutable once the session is stored;
+    // those two are guarded by m_searchCacheMutex.
+    struct SearchSession {
+        quint64 epoch = 0;      // invalidated when indexes change for that uid
+        quint64 lastUsed = 0;   // LRU tick
+        QString key;            // normalized tokens + device filter
+        QString deviceKey;      // device filter part of key
+        QString filterKey;      // SearchFilter part of key
+        QStringList tokens;     // normalized tokens (folded, sorted, deduped)
+
+        // Refined hits (unordered) for each searched device that had any
+        QStringList deviceIds;
+        std::vector<std::vector<quint32>> hitsByDevice;
+        quint64 totalHits = 0;
+
+        // Built on demand
+        std::shared_ptr<const OrderedHits> ordered;
+
+        [[nodiscard]] size_t bytes() const;
+    };
+
+    struct SearchCacheStats {
+        quint64 hits = 0;
+        quint64 misses = 0;
+        quint64 evictions = 0;
+        quint64 narrowed = 0; // misses answered by refining a cached parent session
+        quint64 cancelled = 0; // searches superseded before they finished
+    };
+
+    [[nodiscard]] static QStringList normalizeSearchTokens(const QStringList& tokens);
+    [[nodiscard]] static QString searchDeviceKey(const QStringList& deviceIds);
+    [[nodiscard]] static QString searchSessionKey(const QStringList& normTokens, const QString& deviceKey,
+                                                  const QString& filterKey);
+
+    // True if every hit of normTokens is necessarily a hit of prevTokens
+    [[nodiscard]] static bool tokensNarrow(const QStringList& prevTokens, const QStringList& normTokens);
+
+    // All of these expect m_searchCacheMutex to be held
+    std::shared_ptr<const SearchSession> findNarrowableSession(quint32 uid, quint64 epoch, const QString& deviceKey,
+                                                               const QString& filterKey,
+                                                               const QStringList& normTokens) const;
+    std::shared_ptr<SearchSession> findSearchSession(quint32 uid, quint64 epoch, const QString& key) const;
+    void storeSearchSession(quint32 uid, const std::shared_ptr<SearchSession>& session) const;
+    void trimSearchSessions(const SearchSession* keep) const;
+
+    // Merge a session's hits across devices into page order; only the first `need` are produced
+    // (nothing if cancelled).
+    static std::vector<SessionHit> orderSearchHits(const SearchSession& session,
+                                                   const std::vector<const DeviceIndex*>& indexes,
+                                                   const QString& sortKey,
+                                                   bool desc,
+                                                   quint64 need,
+                                                   const SearchCancel& cancel);
+
+    static constexpr size_t kSearchSessionsPerUid = 8;
+    static constexpr size_t kSearchCacheMaxBytes = 256ULL * 1024 * 1024;
+
+    // Results up to this size are fully ordered on the first page already
+    static constexpr quint64 kSessionEagerOrderHits = 100'000;
+
+    mutable std::unordered_map<quint32, std::list<std::shared_ptr<SearchSession>>> m_searchSessionsByUid; // front = most recent
+    mutable quint64 m_searchCacheTick = 0;
+    mutable size_t m_searchCacheBytes = 0;
+    mutable SearchCacheStats m_searchCacheStats;
+
+    // --- End: Search session cache ---
+
     // --- Begin: DeviceIndexUpdated batching scaffold ---
 
     struct PendingIndexUpdate {
@@ -322,6 +767,52 @@ private:
 
     // --- End: DeviceIndexUpdated batching scaffold ---
 
+    // Incremental decoder state for the helper's framed stdout (see ScanProtocol.h).
+    // Payloads are read straight into stringPool (and each Records batch is transposed into the
+    // record columns as it completes), so stdout is never buffered whole.
+    struct ScanStream {
+        ScanProtocol::FrameHeader header{};
+        quint32 headerFilled = 0;
+        bool inPayload = false;
+        quint32 payloadFilled = 0;
+        char* payloadDst = nullptr;
+        QByteArray smallPayload; // Hello / Parents / End
+        std::vector<ScannerEngine::FileRecord> recordBatch; // the Records frame being received
+
+        bool sawHello = false;
+        bool sawEnd = false;
+        bool delta = false; // Hello flag kHelloDelta
+        QString error;
+
+        RecordColumns records;
+        std::vector<char> stringPool;
+
+        // Folded copy of stringPool[0, foldedBytes), extended as record batches arrive
+        std::vector<char> foldedPool;
+        size_t foldedBytes = 0;
+
+        // Full scans intern names batch by batch (nameIdOf is parallel to records); the pools are
+        // rewritten to one copy per name, and `names` assembled, once the stream ends
+        NameTable::Interner nameInterner;
+        std::vector<quint32> nameIdOf;
+        NameTable names;
+
+        // Trigrams of each new name (by name id), built while the helper is still scanning (unsorted until the end)
+        std::vector<ScannerEngine::TrigramEntry> trigrams;
+
+        std::vector<quint64> fileIds;        // FileIds frames (parallel to records)
+        std::vector<quint64> parentFileIds;  // ParentFileIds frames (delta streams)
+        std::vector<quint64> changedFileIds; // Changed frames (delta streams)
+        std::vector<quint64> changedDirIds;  // ChangedDirs frames (delta streams)
+        std::vector<ScanProtocol::StatsEntry> stats; // Stats frames (delta streams)
+
+        bool hasCheckpoint = false;
+        ScanProtocol::CheckpointPayload checkpoint{};
+    };
+
+    // Phase name -> microseconds, in the order first seen
+    using JobPhases = std::vector<std::pair<QString, quint64>>;
+
     struct Job {
         enum class State : quint8 { Running, Cancelling };
 
@@ -336,16 +827,46 @@ private:
 
         QProcess* proc = nullptr;
         QByteArray stderrBuf;
-        QByteArray stdoutBuf;
+        ScanStream stream;
         int lastPct = -1;
+
+        // Helper runs with --usn-since / --changed-since (falls back to a full scan in the same job if it can't)
+        bool incremental = false;
+
+        // Phase timings: the helper's KERYTHING_PHASE lines, and the daemon's own steps
+        std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+        std::chrono::steady_clock::duration decodeTime{}; // consumeScanStream, summed while streaming
+        JobPhases helperPhases;
+        JobPhases daemonPhases;
     };
 
-    struct ParsedScan {
-        std::vector<ScannerEngine::FileRecord> records;
-        std::vector<char> stringPool;
-        QString error;
+    // A finished scan's phase timings (GetStats "scans")
+    struct ScanTimings {
+        quint64 jobId = 0;
+        quint32 uid = 0;
+        QString deviceId;
+        QString fsType;
+        bool incremental = false;
+        quint64 entryCount = 0;
+        qint64 finishedTime = 0; // unix seconds
+        quint64 totalUs = 0;     // job start -> index in memory
+        JobPhases helperPhases;
+        JobPhases daemonPhases;
     };
 
+    static void addJobPhase(JobPhases& phases, const QString& name, std::chrono::steady_clock::duration elapsed);
+    static void addJobPhase(JobPhases& phases, const QString& name, quint64 us);
+    [[nodiscard]] static QVariantMap jobPhasesMap(const JobPhases& phases);
+
+    // Keeps j's timings for GetStats, logs them and adds them to its JobFinished props
+    void recordScanTimings(const Job& j, quint64 entryCount, QVariantMap& props);
+
+    static constexpr size_t kRecentScans = 16;
+    std::deque<ScanTimings> m_recentScans; // oldest first
+
+    // Bytes per structure of one index (GetStats "devices")
+    [[nodiscard]] static QVariantMap memoryBreakdownFor(const DeviceIndex& idx);
+
     // Internal entrypoint used by both manual (D-Bus) and auto-rescan (fanotify)
     quint64 startIndexForUid(quint32 uid, const QString& deviceId, bool isAuto);
 
@@ -359,12 +880,23 @@ private:
     void scheduleProcessSnapshotUpgradeQueue() const;
     void processOneSnapshotUpgrade() const;
 
-    [[nodiscard]] static QString baseIndexDirForUid(quint32 uid);
-    [[nodiscard]] static QString snapshotPathFor(quint32 uid, const QString& deviceId);
+    // Set once by the constructor, so the snapshot writer may read it too
+    const QString m_indexRoot;
+
+    [[nodiscard]] QString baseIndexDirForUid(quint32 uid) const;
+    [[nodiscard]] QString snapshotPathFor(quint32 uid, const QString& deviceId) const;
     [[nodiscard]] static QString escapeDeviceIdForFilename(const QString& deviceId);
 
-    bool saveSnapshot(quint32 uid, const QString& deviceId, const DeviceIndex& idx, QString* errorOut = nullptr) const;
-    [[nodiscard]] std::optional<DeviceIndex> loadSnapshotFile(const QString& path, QString* deviceIdOut, QString* errorOut = nullptr) const;
+    // Writes the snapshot file (thread-safe: runs on the snapshot writer). snapshotToken ties it to its WatchJournal.
+    bool saveSnapshot(quint32 uid, const QString& deviceId, const DeviceIndex& idx, quint64 snapshotToken,
+                      QString* errorOut = nullptr) const;
+    [[nodiscard]] std::optional<DeviceIndex> loadSnapshotFile(const QString& path, QString* deviceIdOut, QString* errorOut = nullptr,
+                                                              quint32* versionOut = nullptr, quint64* tokenOut = nullptr) const;
+    // v6+: sections become views into a shared read-only mapping of the file
+    [[nodiscard]] std::optional<DeviceIndex> loadMappedSnapshotFile(const QString& path, QString* deviceIdOut, QString* errorOut,
+                                                                    quint64* tokenOut) const;
+    // v1-v5: sections are read into owned vectors
+    [[nodiscard]] std::optional<DeviceIndex> loadLegacySnapshotFile(const QString& path, QString* deviceIdOut, QString* errorOut) const;
 
     [[nodiscard]] std::optional<QVariantMap> findDeviceById(const QString& deviceId) const;
 
@@ -375,25 +907,152 @@ private:
 
     [[nodiscard]] static bool nameContainsCaseInsensitive(std::string_view haystack, std::string_view needle);
 
-    [[nodiscard]] static ParsedScan parseHelperStdout(const QByteArray& raw);
+    // Decode whatever the helper has written so far; returns false once the stream is unusable.
+    static bool consumeScanStream(ScanStream& st, QIODevice* proc);
+    // Validate a completed stream and sort its (trigram, recordIdx) pairs.
+    static bool finishScanStream(ScanStream& st);
+    static bool beginScanPayload(ScanStream& st);
+    static bool handleScanFrame(ScanStream& st);
+    static void foldScanStreamPool(ScanStream& st, size_t upTo);
+
+    // Delta streams (NTFS change journal, EXT4 changed directories): apply to the live index and persist
+    void finishIncrementalScan(quint64 jobId, Job& j, QVariantMap props);
+
+    // Replaces the records of every changed file with the delta's, through the watch delta segment.
+    // Sets needsCompaction if directories with children were replaced (their subtrees' paths
+    // changed); otherwise the orders are patched already. Returns the number of records touched.
+    static quint64 applyScanDelta(DeviceIndex& idx, const ScanStream& st, bool& needsCompaction);
 
     // Build acceleration structures
+    // Deduped trigrams of names [begin, end) (name ids, or recordIdx for the watch delta)
+    static void appendTrigramsForNames(const uint32_t* nameOffsets,
+                                       const uint16_t* nameLens,
+                                       const char* foldedPool,
+                                       size_t begin,
+                                       size_t end,
+                                       std::vector<ScannerEngine::TrigramEntry>& out);
+    static void sortTrigramIndex(std::vector<ScannerEngine::TrigramEntry>& flatIndex);
+    static void buildFoldedPool(DeviceIndex& idx);
+    static void buildNameTable(DeviceIndex& idx);
     static void buildTrigramIndex(DeviceIndex& idx);
     static void buildSortOrders(DeviceIndex& idx);
 
+    // orderByPath/rankByPath: (directory path, name) order; see buildSortOrders
+    static void buildPathOrder(DeviceIndex& idx);
+
     [[nodiscard]] QString dirPathFor(quint32 uid, const QString& deviceId, quint32 dirId) const;
+    [[nodiscard]] static DirPathResolver::Tree dirTreeFor(const DeviceIndex& idx);
 
     // Helpers for fast searching
-    static QStringList tokenizeQuery(const QString& query);
-    static std::vector<quint32> deviceCandidatesForQuery(const DeviceIndex& idx, const QStringList& tokens);
+
+    // Whitespace-separated tokens; ext:xxx / *.xxx tokens go to extensionsOut (folded) instead
+    static QStringList tokenizeQuery(const QString& query, QList<QByteArray>* extensionsOut = nullptr);
+    // Live records whose name contains every token (in no particular order): each distinct name
+    // is matched once, then expanded to its records; the watch delta is matched record by record
+    static std::vector<quint32> deviceMatchesForQuery(const DeviceIndex& idx, const QStringList& tokens,
+                                                      const NameMatcher& matcher, const SearchCancel& cancel,
+                                                      SearchTrace* trace = nullptr);
+    // Records (ascending, live) whose extension is extension, including the watch delta
+    static std::vector<quint32> deviceCandidatesForExtension(const DeviceIndex& idx, const QByteArray& extension);
+    static void buildExtensionIndex(DeviceIndex& idx);
+    static void buildNameSignatures(DeviceIndex& idx);
 
     std::unordered_map<quint64, std::unique_ptr<Job>> m_jobs;
     quint64 m_nextJobId = 1;
 
-    // uid -> (deviceId -> in-memory index)
-    mutable std::unordered_map<quint32, std::unordered_map<QString, DeviceIndex>> m_indexesByUid;
+    // uid -> (deviceId -> in-memory index); only the main thread touches the map itself
+    mutable std::unordered_map<quint32, std::unordered_map<QString, std::shared_ptr<DeviceIndex>>> m_indexesByUid;
     mutable std::unordered_set<quint32> m_loadedUids;
 
+    // --- Begin: Shared device indexes ---
+
+    // Uids that index the same device share one copy of its data: the latest full scan (or snapshot)
+    // of each device is registered here, and every other uid indexing that device gets a
+    // shareDeviceIndex() view of it with its own per-uid state (watch toggle, generation, caches).
+    // Visibility doesn't change: only uids that already have the device indexed are handed a copy.
+    struct SharedIndexEntry {
+        std::weak_ptr<const DeviceIndex> index;
+        qint64 indexedTime = 0; // lastIndexedTime of that scan
+    };
+
+    // deviceId -> freshest scan
+    mutable std::unordered_map<QString, SharedIndexEntry> m_sharedIndexes;
+
+    // Registers idx as the device's freshest scan (unless a fresher one is known) and hands it to
+    // every other loaded uid whose own copy is older and not being rescanned
+    void publishSharedIndex(quint32 uid, const QString& deviceId, const std::shared_ptr<DeviceIndex>& idx) const;
+
+    // A view of the device's shared scan carrying own's per-uid state, if that scan is at least as
+    // fresh as own; nullptr otherwise
+    [[nodiscard]] std::shared_ptr<DeviceIndex> adoptSharedIndex(const QString& deviceId, const DeviceIndex& own) const;
+
+    // True if some uid other than uid is running a full scan of the device (its result will be shared)
+    [[nodiscard]] bool sharedFullScanRunning(quint32 uid, const QString& deviceId) const;
+
+    // --- End: Shared device indexes ---
+
+    // --- Begin: Snapshot persistence ---
+
+    // Called on the main thread once the write (or a newer one that replaced it) has finished
+    using SnapshotWriteDone = std::function<void(bool ok, const QString& error)>;
+
+    struct SnapshotPersistState {
+        quint32 uid = 0;
+        QString deviceId;
+
+        // Token of the snapshot the device's journal extends; 0 = watch batches aren't journaled
+        quint64 journalToken = 0;
+
+        // Journals of older snapshots (oldest first) the live index still extends, appended to
+        // alongside journalToken until its snapshot is on disk. If that write fails, the newest
+        // of them takes over again. Empty whenever journalToken is 0.
+        std::vector<quint64> fallbackTokens;
+
+        bool writing = false;
+
+        // Next write, waiting for the running one (a newer request replaces it)
+        std::shared_ptr<const DeviceIndex> queued;
+        quint64 queuedToken = 0;
+        std::vector<SnapshotWriteDone> queuedDone;
+
+        // Forgotten while a write was running: delete what it leaves behind
+        bool forgotten = false;
+    };
+
+    /**
+     * Persists idx in the background, from the version passed in (holding it makes the main thread
+     * clone before any further change, see mutableDeviceIndex).
+     *
+     * Starts a new journal for the snapshot right away, so watch batches applied from now on are
+     * journaled on top of it; the journal the live index extended so far keeps them too until the
+     * write has finished. Callers that renumbered records suspend journaling first. An index with a
+     * watch delta is compacted (and then written) instead.
+     */
+    void scheduleSnapshotWrite(quint32 uid, const QString& deviceId, std::shared_ptr<const DeviceIndex> idx,
+                               SnapshotWriteDone done = {}) const;
+    void startSnapshotWrite(quint32 uid, const QString& deviceId, std::shared_ptr<const DeviceIndex> idx, quint64 token,
+                            std::vector<SnapshotWriteDone> done) const;
+    void finishSnapshotWrite(quint32 uid, const QString& deviceId, quint64 token, bool ok, const QString& error,
+                             std::vector<SnapshotWriteDone> done) const;
+
+    // The live index was changed outside the watch path: stop journaling until the next snapshot
+    void suspendWatchJournal(quint32 uid, const QString& deviceId) const;
+    // Appends one applied watch batch; false if the device isn't journaling (or the append failed)
+    bool appendWatchJournal(quint32 uid, const QString& deviceId, const WatchJournal::Batch& batch) const;
+    // Replays the journal of the snapshot just loaded; returns the number of batches applied
+    static size_t replayWatchJournal(DeviceIndex& idx, const std::vector<WatchJournal::Batch>& batches);
+
+    [[nodiscard]] QString journalPathFor(quint32 uid, const QString& deviceId, quint64 token) const;
+    void removeWatchJournals(quint32 uid, const QString& deviceId, const std::vector<quint64>& keep = {}) const;
+
+    // One thread: snapshot writes run one at a time, off the main thread
+    class QThreadPool* m_snapshotPool = nullptr;
+
+    // key = watchKey(uid, deviceId)
+    mutable std::unordered_map<QString, SnapshotPersistState> m_persistStates;
+
+    // --- End: Snapshot persistence ---
+
     // queued upgrades (uid, deviceId)
     mutable std::deque<std::pair<quint32, QString>> m_snapshotUpgradeQueue;
     mutable bool m_snapshotUpgradeScheduled = false;
@@ -409,22 +1068,60 @@ private:
         bool needsReconcile = false;
         int reconcileFailCount = 0;
         qint64 reconcileNextRetryMs = 0;
+
+        // Delta compaction: idle timer, and whether a compaction is running on the search pool
+        QTimer* compactTimer = nullptr;
+        bool compactionRunning = false;
+        // Waiting for the compacted index to be written (see scheduleSnapshotWrite)
+        std::vector<SnapshotWriteDone> compactionDone;
+
+        // Parent handles of earlier events -> dirIds (incremental batches only)
+        DirHandleCache dirHandles;
     };
 
     // key = "uid:deviceId"
     QString watchKey(quint32 uid, const QString& deviceId) const;
     void ensureWatchQuietTimer(quint32 uid, const QString& deviceId);
     void scheduleOverflowRecovery(quint32 uid, const QString& deviceId);
-    void probeTouchedEntries(quint32 uid, const QString& deviceId, const QVariantList& touched) const;
+    void probeTouchedEntries(quint32 uid, const QString& deviceId,
+                             const std::vector<WatchManager::TouchedEntry>& touched) const;
+
+    static void ensureChildTableBuilt(DeviceIndex& idx);
+    [[nodiscard]] static quint32 dirIdForInternalPath(const DeviceIndex& idx, const QString& internalDir);
+    bool applyIncrementalBatchIfSafe(quint32 uid, const QString& deviceId,
+                                     const std::vector<WatchManager::TouchedEntry>& touched);
+
+    // --- Begin: Watch delta segment ---
+
+    // Compact once the delta reaches this size (or 1/kDeltaCompactFraction of the index), else after idling
+    static constexpr quint64 kDeltaCompactMinRecords = 65'536;
+    static constexpr quint64 kDeltaCompactFraction = 16;
+    static constexpr int kDeltaIdleCompactMs = 60'000;
+
+    // Appends a record created on disk (caller updates the lookup caches)
+    static quint32 appendDeltaRecord(DeviceIndex& idx, quint32 parentDirId, const QByteArray& name,
+                                     quint64 size, quint64 mtime, bool isDir, bool isSymlink, quint64 fileId);
+    static void markDeadRecord(DeviceIndex& idx, quint32 recIdx);
+
+    // Batched order repair: drops tombstones from every sort order, merges `added` in and re-places
+    // `moved` (size/mtime changed) in the size/mtime orders; then patches ranks and deltaTrigrams.
+    static void applyDeltaToOrders(DeviceIndex& idx, std::vector<quint32> added, std::vector<quint32> moved,
+                                   bool removedAny);
+
+    // A dense copy without delta or tombstones (record ids change), with all structures rebuilt
+    [[nodiscard]] static std::shared_ptr<DeviceIndex> compactDeviceIndex(const DeviceIndex& idx);
+
+    void scheduleDeltaCompaction(quint32 uid, const QString& deviceId);
+    // done runs once the compacted index has been written (or the compaction was dropped)
+    void startDeltaCompaction(quint32 uid, const QString& deviceId, SnapshotWriteDone done = {});
+    [[nodiscard]] static SnapshotWriteDone takeCompactionDone(WatchBatchState& st);
 
-    void ensureDirIdByPathBuilt(DeviceIndex& idx, quint32 uid, const QString& deviceId) const;
-    void ensureRecordByParentAndNameBuilt(DeviceIndex& idx) const;
-    bool applyIncrementalBatchIfSafe(quint32 uid, const QString& deviceId, const QVariantList& touched);
+    // --- End: Watch delta segment ---
 
     std::unordered_map<QString, WatchBatchState> m_watchBatchState;
     // --- end handling fanotify events ---
 
-    std::unique_ptr<class WatchManager> m_watchMgr;
+    std::unique_ptr<WatchManager> m_watchMgr;
 
     // Periodically refresh watch arming/status so mount/unmount changes are picked up
     class QTimer* m_watchRefreshTimer = nullptr;
@@ -0,0 +1,103 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026  Reikooters <https://github.com/Reikooters>
+
+#ifndef KERYTHING_KERYTHINGD_MAPPEDARRAY_H
+#define KERYTHING_KERYTHINGD_MAPPEDARRAY_H
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * Read-mostly array used for the big DeviceIndex sections.
+ *
+ * It either owns a std::vector<T>, or is a read-only view into a shared backing object
+ * (an mmap'd snapshot file). Readers only ever see `const T*`, so a view costs no anonymous
+ * memory and its pages can be dropped by the kernel under memory pressure.
+ *
+ * Mutation goes through mut(), which detaches a view into an owned copy first
+ * (copy-on-write). Hot read paths must therefore use the const accessors only.
+ */
+template <typename T>
+class MappedArray {
+    static_assert(std::is_trivially_copyable_v<T>, "MappedArray only holds trivially copyable types.");
+
+public:
+    MappedArray() = default;
+    MappedArray(std::vector<T>&& v) : m_owned(std::move(v)) {}
+
+    MappedArray& operator=(std::vector<T>&& v) {
+        m_owned = std::move(v);
+        m_view = nullptr;
+        m_viewSize = 0;
+        m_backing.reset();
+        return *this;
+    }
+
+    // View `count` elements at `data`, keeping `backing` alive for as long as we reference it.
+    static MappedArray view(const T* data, size_t count, std::shared_ptr<const void> backing) {
+        MappedArray a;
+        a.m_view = data;
+        a.m_viewSize = count;
+        a.m_backing = std::move(backing);
+        return a;
+    }
+
+    [[nodiscard]] bool isMapped() const { return m_backing != nullptr; }
+
+    [[nodiscard]] size_t size() const { return m_backing ? m_viewSize : m_owned.size(); }
+    [[nodiscard]] bool empty() const { return size() == 0; }
+    [[nodiscard]] const T* data() const { return m_backing ? m_view : m_owned.data(); }
+
+    [[nodiscard]] const T* begin() const { return data(); }
+    [[nodiscard]] const T* end() const { return data() + size(); }
+
+    const T& operator[](size_t i) const { return data()[i]; }
+
+    // Heap bytes held by this array (0 for a mapped view)
+    [[nodiscard]] size_t ownedBytes() const { return m_owned.capacity() * sizeof(T); }
+
+    /**
+     * Returns the owned vector for mutation, copying a mapped view into anonymous memory first.
+     *
+     * @return A reference to the owned storage; valid until the next assignment.
+     */
+    std::vector<T>& mut() {
+        if (m_backing) {
+            m_owned.assign(m_view, m_view + m_viewSize);
+            m_view = nullptr;
+            m_viewSize = 0;
+            m_backing.reset();
+        }
+        return m_owned;
+    }
+
+    void clear() {
+        m_owned.clear();
+        m_view = nullptr;
+        m_viewSize = 0;
+        m_backing.reset();
+    }
+
+    /**
+     * A view of the same elements, without copying them. A view shares this one's backing; owned
+     * storage is kept alive through owner, which must hold this array and never mutate it again.
+     */
+    [[nodiscard]] MappedArray viewSharing(std::shared_ptr<const void> owner) const {
+        if (m_backing) return view(m_view, m_viewSize, m_backing);
+        return view(m_owned.data(), m_owned.size(), std::move(owner));
+    }
+
+    // The shared backing object of a mapped view (null when owned)
+    [[nodiscard]] const std::shared_ptr<const void>& backing() const { return m_backing; }
+
+private:
+    std::vector<T> m_owned;
+    const T* m_view = nullptr;
+    size_t m_viewSize = 0;
+    std::shared_ptr<const void> m_backing;
+};
+
+#endif //KERYTHING_KERYTHINGD_MAPPEDARRAY_H
@@ -0,0 +1,224 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026  Reikooters <https://github.com/Reikooters>
+
+#include "NameMatcher.h"
+#include "CaseFold.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define KERYTHING_NAMEMATCH_X86 1
+#include <immintrin.h>
+#endif
+
+// --- Begin: Scalar kernels ---
+
+static inline char foldByte(char c) {
+    const auto u = static_cast<unsigned char>(c);
+    return (u >= 'A' && u <= 'Z') ? static_cast<char>(u | 0x20) : c;
+}
+
+static void foldAsciiScalar(const char* src, size_t n, char* dst) {
+    for (size_t i = 0; i < n; ++i) {
+        dst[i] = foldByte(src[i]);
+    }
+}
+
+// Checks positions [from, n - m] one by one
+static bool containsFoldedScalarFrom(const char* hay, size_t n, const char* needle, size_t m, size_t from) {
+    const char first = needle[0];
+    const char last = needle[m - 1];
+
+    for (size_t i = from; i + m <= n; ++i) {
+        if (hay[i] == first && hay[i + m - 1] == last &&
+            (m <= 2 || std::memcmp(hay + i + 1, needle + 1, m - 2) == 0)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool containsFoldedScalar(const char* hay, size_t n, const char* needle, size_t m) {
+    return containsFoldedScalarFrom(hay, n, needle, m, 0);
+}
+
+// --- End: Scalar kernels ---
+
+#ifdef KERYTHING_NAMEMATCH_X86
+
+// --- Begin: SSE2 kernels (x86-64 baseline) ---
+
+static void foldAsciiSse2(const char* src, size_t n, char* dst) {
+    // (c - ('A' - 128)) < (-128 + 26) as signed bytes <=> 'A' <= c <= 'Z'
+    const __m128i bias = _mm_set1_epi8(static_cast<char>('A' - 128));
+    const __m128i limit = _mm_set1_epi8(static_cast<char>(-128 + 26));
+    const __m128i bit = _mm_set1_epi8(0x20);
+
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        const __m128i isUpper = _mm_cmplt_epi8(_mm_sub_epi8(v, bias), limit);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_or_si128(v, _mm_and_si128(isUpper, bit)));
+    }
+    foldAsciiScalar(src + i, n - i, dst + i);
+}
+
+static bool containsFoldedSse2(const char* hay, size_t n, const char* needle, size_t m) {
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[m - 1]);
+
+    size_t i = 0;
+    for (; i + m - 1 + 16 <= n; i += 16) {
+        const __m128i blockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hay + i));
+        const __m128i blockLast = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hay + i + m - 1));
+
+        auto mask = static_cast<uint32_t>(_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(blockFirst, first), _mm_cmpeq_epi8(blockLast, last))));
+
+        while (mask != 0) {
+            const size_t pos = i + static_cast<size_t>(std::countr_zero(mask));
+            if (m <= 2 || std::memcmp(hay + pos + 1, needle + 1, m - 2) == 0) {
+                return true;
+            }
+            mask &= mask - 1;
+        }
+    }
+
+    return containsFoldedScalarFrom(hay, n, needle, m, i);
+}
+
+// --- End: SSE2 kernels ---
+
+// --- Begin: AVX2 kernels ---
+
+__attribute__((target("avx2")))
+static void foldAsciiAvx2(const char* src, size_t n, char* dst) {
+    const __m256i bias = _mm256_set1_epi8(static_cast<char>('A' - 128));
+    const __m256i limit = _mm256_set1_epi8(static_cast<char>(-128 + 26));
+    const __m256i bit = _mm256_set1_epi8(0x20);
+
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        const __m256i isUpper = _mm256_cmpgt_epi8(limit, _mm256_sub_epi8(v, bias));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_or_si256(v, _mm256_and_si256(isUpper, bit)));
+    }
+    foldAsciiSse2(src + i, n - i, dst + i);
+}
+
+__attribute__((target("avx2")))
+static bool containsFoldedAvx2(const char* hay, size_t n, const char* needle, size_t m) {
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[m - 1]);
+
+    size_t i = 0;
+    for (; i + m - 1 + 32 <= n; i += 32) {
+        const __m256i blockFirst = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(hay + i));
+        const __m256i blockLast = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(hay + i + m - 1));
+
+        auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(blockFirst, first), _mm256_cmpeq_epi8(blockLast, last))));
+
+        while (mask != 0) {
+            const size_t pos = i + static_cast<size_t>(std::countr_zero(mask));
+            if (m <= 2 || std::memcmp(hay + pos + 1, needle + 1, m - 2) == 0) {
+                return true;
+            }
+            mask &= mask - 1;
+        }
+    }
+
+    // Remaining positions: the 16-byte kernel still covers most of a short tail
+    return i + m <= n && containsFoldedSse2(hay + i, n - i, needle, m);
+}
+
+// --- End: AVX2 kernels ---
+
+#endif // KERYTHING_NAMEMATCH_X86
+
+namespace {
+    struct Kernels {
+        void (*fold)(const char*, size_t, char*) = foldAsciiScalar;
+        bool (*contains)(const char*, size_t, const char*, size_t) = containsFoldedScalar;
+        const char* name = "scalar";
+    };
+
+    const Kernels& kernels() {
+        static const Kernels k = []() {
+            Kernels out;
+#ifdef KERYTHING_NAMEMATCH_X86
+            out.fold = foldAsciiSse2;
+            out.contains = containsFoldedSse2;
+            out.name = "sse2";
+
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2")) {
+                out.fold = foldAsciiAvx2;
+                out.contains = containsFoldedAvx2;
+                out.name = "avx2";
+            }
+#endif
+            return out;
+        }();
+        return k;
+    }
+}
+
+void NameMatch::foldAscii(const char* src, size_t n, char* dst) {
+    kernels().fold(src, n, dst);
+}
+
+bool NameMatch::containsFolded(const char* haystack, size_t n, const char* needle, size_t m) {
+    if (m == 0) return true;
+    if (m > n) return false;
+    return kernels().contains(haystack, n, needle, m);
+}
+
+const char* NameMatch::kernelName() {
+    return kernels().name;
+}
+
+NameMatcher::NameMatcher(const std::vector<std::string_view>& tokens) {
+    m_needles.reserve(tokens.size());
+    for (std::string_view t : tokens) {
+        if (t.empty()) continue;
+        std::string folded(t.size(), '\0');
+        CaseFold::foldUtf8(t.data(), t.size(), folded.data());
+        m_needles.push_back(std::move(folded));
+    }
+
+    // Longer needles reject more names; try them first
+    std::stable_sort(m_needles.begin(), m_needles.end(), [](const std::string& a, const std::string& b) {
+        return a.size() > b.size();
+    });
+}
+
+bool NameMatcher::matches(std::string_view name) const {
+    if (m_needles.empty()) return true;
+    if (name.size() < m_needles.front().size()) return false;
+
+    // Names are at most 64K (nameLen is uint16), but almost always fit the stack buffer
+    char stackBuf[512];
+    std::string heapBuf;
+    char* folded = stackBuf;
+    if (name.size() > sizeof(stackBuf)) {
+        heapBuf.resize(name.size());
+        folded = heapBuf.data();
+    }
+
+    CaseFold::foldUtf8(name.data(), name.size(), folded);
+
+    return matchesFolded(std::string_view(folded, name.size()));
+}
+
+bool NameMatcher::matchesFolded(std::string_view folded) const {
+    for (const std::string& needle : m_needles) {
+        if (!NameMatch::containsFolded(folded.data(), folded.size(), needle.data(), needle.size())) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,60 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026  Reikooters <https://github.com/Reikooters>
+
+#ifndef KERYTHING_KERYTHINGD_NAMEMATCHER_H
+#define KERYTHING_KERYTHINGD_NAMEMATCHER_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Vectorized case-insensitive substring matching for the search refine phase.
+ *
+ * Both sides are case-folded first (ASCII runs with the kernels below, see also CaseFold), then
+ * every needle is located with a first/last-byte broadcast filter: candidate positions are found
+ * 16/32 bytes at a time and only those are verified with memcmp.
+ *
+ * The SIMD kernel is picked once at runtime (AVX2 if the CPU has it, else SSE2 on x86-64),
+ * with a scalar fallback on other architectures.
+ */
+namespace NameMatch {
+    // Writes the ASCII-folded copy of src[0, n) to dst (dst may equal src).
+    void foldAscii(const char* src, size_t n, char* dst);
+
+    // True if needle occurs in haystack; both must already be folded.
+    bool containsFolded(const char* haystack, size_t n, const char* needle, size_t m);
+
+    // Name of the selected kernel ("avx2", "sse2" or "scalar"), for logging.
+    const char* kernelName();
+}
+
+/**
+ * Matches a name against all tokens of a query at once.
+ *
+ * Tokens are folded with CaseFold (Unicode simple case folding). Names from the index's folded
+ * pool are searched as-is; raw names are folded once into a small stack buffer first, so a
+ * multi-token query touches the name's bytes a single time either way.
+ */
+class NameMatcher {
+public:
+    explicit NameMatcher(const std::vector<std::string_view>& tokens);
+
+    /**
+     * @param name Raw (unfolded) name bytes from the string pool.
+     * @return true if every token occurs in name (case-insensitive).
+     */
+    [[nodiscard]] bool matches(std::string_view name) const;
+
+    /**
+     * @param folded Name bytes that are already case-folded (DeviceIndex::foldedPool).
+     * @return true if every token occurs in folded.
+     */
+    [[nodiscard]] bool matchesFolded(std::string_view folded) const;
+
+private:
+    std::vector<std::string> m_needles; // folded, longest first (most selective)
+};
+
+#endif //KERYTHING_KERYTHINGD_NAMEMATCHER_H
@@ -0,0 +1,43 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026  Reikooters <https://github.com/Reikooters>
+
+#ifndef KERYTHING_KERYTHINGD_NAMESIGNATURE_H
+#define KERYTHING_KERYTHINGD_NAMESIGNATURE_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * 64-bit per-name signatures for queries too short for the trigram index.
+ *
+ * The low 32 bits record which bytes a (folded) name contains, the high 32 bits which adjacent
+ * byte pairs, both hashed down to 32 buckets. A name can only contain a 1-2 byte token if its
+ * signature has every bit of the token's signature, so "(sig & mask) == mask" over one contiguous
+ * array discards most names before any substring check. Letters and digits get buckets of their
+ * own; everything else shares the rest.
+ */
+namespace NameSignature {
+    [[nodiscard]] inline uint32_t byteBit(unsigned char c) {
+        if (c >= 'a' && c <= 'z') return c - 'a';
+        if (c >= '0' && c <= '9') return 26;
+        return 27 + (c % 5);
+    }
+
+    [[nodiscard]] inline uint32_t pairBit(unsigned char a, unsigned char b) {
+        const uint32_t h = (static_cast<uint32_t>(a) << 8 | b) * 2654435761u;
+        return 32 + (h >> 27);
+    }
+
+    // Signature of folded bytes s[0, n); a token's signature is its query mask
+    [[nodiscard]] inline uint64_t of(const char* s, size_t n) {
+        uint64_t sig = 0;
+        for (size_t i = 0; i < n; ++i) {
+            const auto c = static_cast<unsigned char>(s[i]);
+            sig |= uint64_t(1) << byteBit(c);
+            if (i + 1 < n) sig |= uint64_t(1) << pairBit(c, static_cast<unsigned char>(s[i + 1]));
+        }
+        return sig;
+    }
+}
+
+#endif //KERYTHING_KERYTHINGD_NAMESIGNATURE_H
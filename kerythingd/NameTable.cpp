@@ -0,0 +1,123 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026  Reikooters <https://github.com/Reikooters>
+
+#include "NameTable.h"
+
+#include <cstring>
+#include <functional>
+
+static constexpr uint32_t kNone = 0xFFFFFFFFu;
+
+uint32_t NameTable::Interner::intern(const char* pool, uint32_t offset, uint16_t len, bool& added) {
+    const std::string_view name(pool + offset, len);
+    const uint64_t hash = std::hash<std::string_view>{}(name);
+
+    const auto [it, inserted] = m_firstByHash.try_emplace(hash, static_cast<uint32_t>(m_offsets.size()));
+    if (!inserted) {
+        for (uint32_t id = it->second; id != kNone; id = m_nextSameHash[id]) {
+            if (m_lens[id] == len && std::memcmp(pool + m_offsets[id], name.data(), len) == 0) {
+                added = false;
+                return id;
+            }
+        }
+    }
+
+    // New name; a hash collision chains it behind the bucket's first id
+    const auto id = static_cast<uint32_t>(m_offsets.size());
+    if (!inserted) {
+        uint32_t last = it->second;
+        while (m_nextSameHash[last] != kNone) last = m_nextSameHash[last];
+        m_nextSameHash[last] = id;
+    }
+    m_nextSameHash.push_back(kNone);
+    m_offsets.push_back(offset);
+    m_lens.push_back(len);
+
+    added = true;
+    return id;
+}
+
+NameTable NameTable::assemble(const Interner& interner, const std::vector<uint32_t>& nameIdOf, RecordColumns& records,
+                              std::vector<char>& stringPool, std::vector<char>& foldedPool) {
+    const size_t names = interner.size();
+    const size_t count = nameIdOf.size();
+    const bool hasFolded = !foldedPool.empty();
+
+    NameTable out;
+    out.recordCount = static_cast<uint32_t>(count);
+
+    // 1) One copy of each name, in id order
+    std::vector<uint32_t>& offsets = out.nameOffsets.mut();
+    std::vector<uint16_t>& lens = out.nameLens.mut();
+    offsets.resize(names);
+    lens.assign(interner.lens(), interner.lens() + names);
+
+    size_t bytes = 0;
+    for (size_t id = 0; id < names; ++id) bytes += lens[id];
+
+    std::vector<char> pool(bytes);
+    std::vector<char> folded(hasFolded ? bytes : 0);
+    size_t at = 0;
+    for (size_t id = 0; id < names; ++id) {
+        const uint32_t from = interner.offsets()[id];
+        offsets[id] = static_cast<uint32_t>(at);
+        std::memcpy(pool.data() + at, stringPool.data() + from, lens[id]);
+        if (hasFolded) std::memcpy(folded.data() + at, foldedPool.data() + from, lens[id]);
+        at += lens[id];
+    }
+    stringPool = std::move(pool);
+    foldedPool = std::move(folded);
+
+    // 2) Records point at their name's copy
+    std::vector<uint32_t>& recordOffsets = records.nameOffsets.mut();
+    for (size_t i = 0; i < count; ++i) recordOffsets[i] = offsets[nameIdOf[i]];
+
+    // 3) Record lists; records are visited in order, so every list comes out ascending
+    std::vector<uint32_t>& first = out.recordFirst.mut();
+    first.assign(names + 1, 0);
+    for (size_t i = 0; i < count; ++i) ++first[nameIdOf[i] + 1];
+    for (size_t id = 0; id < names; ++id) first[id + 1] += first[id];
+
+    std::vector<uint32_t> cursor(first.begin(), first.end() - 1);
+    std::vector<uint32_t>& ids = out.recordIds.mut();
+    ids.resize(count);
+    for (size_t i = 0; i < count; ++i) ids[cursor[nameIdOf[i]]++] = static_cast<uint32_t>(i);
+
+    return out;
+}
+
+NameTable NameTable::build(RecordColumns& records, std::vector<char>& stringPool, std::vector<char>& foldedPool) {
+    const size_t count = records.size();
+
+    Interner interner;
+    std::vector<uint32_t> nameIdOf(count);
+    for (size_t i = 0; i < count; ++i) {
+        bool added = false;
+        nameIdOf[i] = interner.intern(stringPool.data(), records.nameOffsets[i], records.nameLens[i], added);
+    }
+
+    return assemble(interner, nameIdOf, records, stringPool, foldedPool);
+}
+
+bool NameTable::validate(size_t expectedRecordCount, size_t poolSize) const {
+    const size_t names = nameOffsets.size();
+    if (nameLens.size() != names || recordIds.size() != expectedRecordCount) return false;
+    if (names == 0) {
+        return recordFirst.empty() && recordIds.empty();
+    }
+    if (recordFirst.size() != names + 1 || recordFirst[0] != 0 || recordFirst[names] != recordIds.size()) return false;
+
+    for (size_t id = 0; id < names; ++id) {
+        if (static_cast<uint64_t>(nameOffsets[id]) + nameLens[id] > poolSize) return false;
+
+        // Every name has records; lists are ascending, so their last element bounds them all
+        if (recordFirst[id + 1] <= recordFirst[id]) return false;
+        if (recordIds[recordFirst[id + 1] - 1] >= expectedRecordCount) return false;
+    }
+    return true;
+}
+
+size_t NameTable::byteSize() const {
+    return nameOffsets.size() * sizeof(uint32_t) + nameLens.size() * sizeof(uint16_t) +
+           recordFirst.size() * sizeof(uint32_t) + recordIds.size() * sizeof(uint32_t);
+}
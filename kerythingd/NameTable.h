@@ -0,0 +1,105 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026  Reikooters <https://github.com/Reikooters>
+
+#ifndef KERYTHING_KERYTHINGD_NAMETABLE_H
+#define KERYTHING_KERYTHINGD_NAMETABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "MappedArray.h"
+#include "RecordColumns.h"
+
+/**
+ * The distinct file names of a device index, each with its records.
+ *
+ * Names like "index.js", "__init__.py" or "Thumbs.db" occur hundreds of thousands of times per
+ * volume. Interned, every distinct name is stored once in the string pool (its records share that
+ * nameOffset) and gets a name id. The trigram index is built over name ids, so a search refines
+ * each distinct name once and only expands the matching names to records at the end.
+ *
+ * Layout (all four arrays are persisted as snapshot sections and can be mmap'd as-is):
+ *  - nameOffsets, nameLens: per name id, its bytes in the string pool (and folded pool).
+ *  - recordFirst:           nameCount() + 1 offsets into recordIds.
+ *  - recordIds:             each name's records, ascending, back to back.
+ *
+ * Only records below recordCount are covered; later (watch delta) records are not interned.
+ */
+class NameTable {
+public:
+    /**
+     * Assigns name ids in the order names are first seen.
+     *
+     * Names are kept as pool offsets, never pointers, so the pool may grow between calls
+     * (a scan stream interns each record batch as it arrives).
+     */
+    class Interner {
+    public:
+        /**
+         * @return The id of pool[offset, offset + len); added is set if the name is new.
+         */
+        uint32_t intern(const char* pool, uint32_t offset, uint16_t len, bool& added);
+
+        [[nodiscard]] size_t size() const { return m_offsets.size(); }
+        [[nodiscard]] const uint32_t* offsets() const { return m_offsets.data(); }
+        [[nodiscard]] const uint16_t* lens() const { return m_lens.data(); }
+
+    private:
+        std::unordered_map<uint64_t, uint32_t> m_firstByHash; // hash -> first id with that hash
+        std::vector<uint32_t> m_nextSameHash;                 // id -> next id with the same hash
+        std::vector<uint32_t> m_offsets;
+        std::vector<uint16_t> m_lens;
+    };
+
+    MappedArray<uint32_t> nameOffsets;
+    MappedArray<uint16_t> nameLens;
+    MappedArray<uint32_t> recordFirst;
+    MappedArray<uint32_t> recordIds;
+
+    // Records covered by this table
+    uint32_t recordCount = 0;
+
+    [[nodiscard]] size_t nameCount() const { return nameOffsets.size(); }
+    [[nodiscard]] bool empty() const { return nameOffsets.empty(); }
+
+    // Name id's bytes in pool (the string pool or its folded copy)
+    [[nodiscard]] std::string_view name(uint32_t id, const char* pool) const {
+        return std::string_view(pool + nameOffsets[id], nameLens[id]);
+    }
+
+    [[nodiscard]] std::span<const uint32_t> recordsOf(uint32_t id) const {
+        return {recordIds.data() + recordFirst[id], recordFirst[id + 1] - recordFirst[id]};
+    }
+
+    /**
+     * Finishes interning records [0, nameIdOf.size()), where nameIdOf[i] is record i's id from interner.
+     *
+     * Rewrites stringPool (and foldedPool, unless it is empty) to hold each name once, in id order,
+     * and points every record at its name's copy. Records past nameIdOf.size() would be left
+     * pointing into the old pool, so it must cover every record.
+     */
+    static NameTable assemble(const Interner& interner, const std::vector<uint32_t>& nameIdOf, RecordColumns& records,
+                              std::vector<char>& stringPool, std::vector<char>& foldedPool);
+
+    /**
+     * Interns every record of an index that has no table yet (and no watch delta); see assemble().
+     */
+    static NameTable build(RecordColumns& records, std::vector<char>& stringPool, std::vector<char>& foldedPool);
+
+    /**
+     * Structural checks for a freshly loaded (possibly mmap'd) table.
+     *
+     * @return true if every name lies inside the pool and the record lists cover exactly
+     *         expectedRecordCount in-range records.
+     */
+    [[nodiscard]] bool validate(size_t expectedRecordCount, size_t poolSize) const;
+
+    // Total bytes of the four arrays (owned or mapped)
+    [[nodiscard]] size_t byteSize() const;
+};
+
+#endif //KERYTHING_KERYTHINGD_NAMETABLE_H
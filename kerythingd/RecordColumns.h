@@ -0,0 +1,139 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026  Reikooters <https://github.com/Reikooters>
+
+#ifndef KERYTHING_KERYTHINGD_RECORDCOLUMNS_H
+#define KERYTHING_KERYTHINGD_RECORDCOLUMNS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "MappedArray.h"
+#include "../ScannerEngine.h"
+
+/**
+ * The records of a device index, stored column by column.
+ *
+ * ScannerEngine::FileRecord is a packed 27-byte struct: right for the helper's wire format, but
+ * its 64-bit fields are unaligned, and a loop that needs one field (a size sort, a name refine)
+ * drags whole records through the cache. Here each field is its own aligned array, so such loops
+ * stream a single column, and every column maps straight out of its own snapshot section.
+ *
+ * operator[] reassembles a FileRecord for code that wants several fields of one record; loops over
+ * many records should read the columns they need instead. Writes go through the set*() and append
+ * functions, which detach mapped columns first (see MappedArray::mut()).
+ */
+class RecordColumns {
+public:
+    using Record = ScannerEngine::FileRecord;
+
+    // flags column
+    static constexpr uint8_t kIsDir = 1u << 0;
+    static constexpr uint8_t kIsSymlink = 1u << 1;
+
+    MappedArray<uint32_t> parents;     // parentRecordIdx
+    MappedArray<uint64_t> sizes;
+    MappedArray<uint64_t> mtimes;      // modificationTime
+    MappedArray<uint32_t> nameOffsets; // into the string pool
+    MappedArray<uint16_t> nameLens;
+    MappedArray<uint8_t> flags;        // kIsDir | kIsSymlink
+
+    [[nodiscard]] size_t size() const { return parents.size(); }
+    [[nodiscard]] bool empty() const { return parents.empty(); }
+
+    // Every column has the same length (a snapshot could be missing one)
+    [[nodiscard]] bool consistent() const {
+        const size_t n = parents.size();
+        return sizes.size() == n && mtimes.size() == n && nameOffsets.size() == n && nameLens.size() == n &&
+               flags.size() == n;
+    }
+
+    Record operator[](size_t i) const {
+        Record r{};
+        r.parentRecordIdx = parents[i];
+        r.size = sizes[i];
+        r.modificationTime = mtimes[i];
+        r.nameOffset = nameOffsets[i];
+        r.nameLen = nameLens[i];
+        r.isDir = (flags[i] & kIsDir) ? 1 : 0;
+        r.isSymlink = (flags[i] & kIsSymlink) ? 1 : 0;
+        return r;
+    }
+
+    [[nodiscard]] bool isDir(size_t i) const { return (flags[i] & kIsDir) != 0; }
+    [[nodiscard]] bool isSymlink(size_t i) const { return (flags[i] & kIsSymlink) != 0; }
+
+    // The name of record i in pool (the string pool or its folded copy)
+    [[nodiscard]] std::string_view name(size_t i, const char* pool) const {
+        return std::string_view(pool + nameOffsets[i], nameLens[i]);
+    }
+
+    static uint8_t flagsOf(bool isDir, bool isSymlink) {
+        return static_cast<uint8_t>((isDir ? kIsDir : 0) | (isSymlink ? kIsSymlink : 0));
+    }
+
+    // Transposes packed records (the helper's wire format) onto the end of the columns
+    void append(const Record* records, size_t count) {
+        std::vector<uint32_t>& p = parents.mut();
+        std::vector<uint64_t>& s = sizes.mut();
+        std::vector<uint64_t>& t = mtimes.mut();
+        std::vector<uint32_t>& o = nameOffsets.mut();
+        std::vector<uint16_t>& l = nameLens.mut();
+        std::vector<uint8_t>& f = flags.mut();
+
+        const size_t old = p.size();
+        p.resize(old + count);
+        s.resize(old + count);
+        t.resize(old + count);
+        o.resize(old + count);
+        l.resize(old + count);
+        f.resize(old + count);
+
+        for (size_t k = 0; k < count; ++k) {
+            const Record& r = records[k];
+            p[old + k] = r.parentRecordIdx;
+            s[old + k] = r.size;
+            t[old + k] = r.modificationTime;
+            o[old + k] = r.nameOffset;
+            l[old + k] = r.nameLen;
+            f[old + k] = flagsOf(r.isDir, r.isSymlink);
+        }
+    }
+
+    void push_back(const Record& r) { append(&r, 1); }
+
+    void assign(const std::vector<Record>& records) {
+        clear();
+        reserve(records.size());
+        append(records.data(), records.size());
+    }
+
+    void setParent(size_t i, uint32_t parent) { parents.mut()[i] = parent; }
+
+    void setStats(size_t i, uint64_t size, uint64_t mtime, bool isDir, bool isSymlink) {
+        sizes.mut()[i] = size;
+        mtimes.mut()[i] = mtime;
+        flags.mut()[i] = flagsOf(isDir, isSymlink);
+    }
+
+    void reserve(size_t n) {
+        parents.mut().reserve(n);
+        sizes.mut().reserve(n);
+        mtimes.mut().reserve(n);
+        nameOffsets.mut().reserve(n);
+        nameLens.mut().reserve(n);
+        flags.mut().reserve(n);
+    }
+
+    void clear() {
+        parents.clear();
+        sizes.clear();
+        mtimes.clear();
+        nameOffsets.clear();
+        nameLens.clear();
+        flags.clear();
+    }
+};
+
+#endif //KERYTHING_KERYTHINGD_RECORDCOLUMNS_H
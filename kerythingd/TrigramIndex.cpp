@@ -0,0 +1,366 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026  Reikooters <https://github.com/Reikooters>
+
+#include "TrigramIndex.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+static size_t varintSize(uint32_t v) {
+    size_t n = 1;
+    while (v >= 0x80) {
+        v >>= 7;
+        ++n;
+    }
+    return n;
+}
+
+static void appendVarint(std::vector<uint8_t>& out, uint32_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<uint8_t>(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(v));
+}
+
+static uint32_t readVarint(const uint8_t*& p) {
+    uint32_t v = 0;
+    int shift = 0;
+    while (true) {
+        const uint8_t b = *p++;
+        v |= static_cast<uint32_t>(b & 0x7F) << shift;
+        if ((b & 0x80) == 0 || shift >= 28) break;
+        shift += 7;
+    }
+    return v;
+}
+
+static uint64_t loadWord(const uint8_t* p) {
+    uint64_t w = 0;
+    std::memcpy(&w, p, sizeof(w));
+    return w;
+}
+
+static uint32_t blocksFor(uint32_t count) {
+    return (count + TrigramIndex::kBlockSize - 1) / TrigramIndex::kBlockSize;
+}
+
+TrigramIndex TrigramIndex::build(const ScannerEngine::TrigramEntry* sorted, size_t n, size_t recordCount) {
+    std::vector<uint32_t> bucketVec(kBucketCount + 1, 0);
+    std::vector<DirEntry> dir;
+    std::vector<Skip> skipVec;
+    std::vector<uint8_t> bytes;
+
+    // Typical gaps encode in 1-2 bytes
+    bytes.reserve(n * 2);
+
+    const size_t bitmapWords = (recordCount + 63) / 64;
+    const size_t bitmapBytes = bitmapWords * sizeof(uint64_t);
+
+    std::vector<uint32_t> values;
+
+    size_t i = 0;
+    while (i < n) {
+        const uint32_t tri = sorted[i].trigram & 0xFFFFFFu;
+
+        values.clear();
+        size_t j = i;
+        for (; j < n && (sorted[j].trigram & 0xFFFFFFu) == tri; ++j) {
+            const uint32_t rec = sorted[j].recordIdx;
+            if (rec >= recordCount) continue;
+            if (values.empty() || values.back() != rec) values.push_back(rec);
+        }
+        i = j;
+
+        if (values.empty()) {
+            continue;
+        }
+
+        DirEntry e{};
+        e.trigram = tri;
+        e.count = static_cast<uint32_t>(values.size());
+
+        // Size of the list encoding: all non-leading deltas + one Skip per block
+        size_t listBytes = static_cast<size_t>(blocksFor(e.count)) * sizeof(Skip);
+        for (size_t k = 1; k < values.size(); ++k) {
+            if (k % kBlockSize != 0) listBytes += varintSize(values[k] - values[k - 1]);
+        }
+
+        if (bitmapBytes < listBytes) {
+            e.kind = static_cast<uint8_t>(Kind::Bitmap);
+            bytes.resize((bytes.size() + 7) & ~static_cast<size_t>(7), 0);
+            e.dataOffset = bytes.size();
+            bytes.resize(bytes.size() + bitmapBytes, 0);
+
+            uint8_t* bits = bytes.data() + e.dataOffset;
+            for (uint32_t v : values) {
+                bits[v >> 3] |= static_cast<uint8_t>(1u << (v & 7));
+            }
+        } else {
+            e.kind = static_cast<uint8_t>(Kind::List);
+            e.dataOffset = bytes.size();
+            e.firstSkip = static_cast<uint32_t>(skipVec.size());
+
+            for (size_t k = 0; k < values.size(); ++k) {
+                if (k % kBlockSize == 0) {
+                    skipVec.push_back(Skip{values[k], static_cast<uint32_t>(bytes.size() - e.dataOffset)});
+                } else {
+                    appendVarint(bytes, values[k] - values[k - 1]);
+                }
+            }
+        }
+
+        ++bucketVec[(tri >> 8) + 1];
+        dir.push_back(e);
+    }
+
+    for (uint32_t b = 0; b < kBucketCount; ++b) {
+        bucketVec[b + 1] += bucketVec[b];
+    }
+
+    // A little tail padding lets a (corrupt) trailing varint never read past the mapping.
+    bytes.resize(bytes.size() + 8, 0);
+    bytes.shrink_to_fit();
+    dir.shrink_to_fit();
+    skipVec.shrink_to_fit();
+
+    TrigramIndex out;
+    out.buckets = std::move(bucketVec);
+    out.directory = std::move(dir);
+    out.skips = std::move(skipVec);
+    out.data = std::move(bytes);
+    out.recordCount = static_cast<uint32_t>(recordCount);
+    return out;
+}
+
+const TrigramIndex::DirEntry* TrigramIndex::find(uint32_t trigram) const {
+    if (directory.empty() || trigram > 0xFFFFFFu) {
+        return nullptr;
+    }
+
+    const uint32_t b = trigram >> 8;
+    const DirEntry* first = directory.data() + buckets[b];
+    const DirEntry* last = directory.data() + buckets[b + 1];
+
+    const DirEntry* it = std::lower_bound(first, last, trigram, [](const DirEntry& e, uint32_t t) {
+        return e.trigram < t;
+    });
+
+    return (it != last && it->trigram == trigram) ? it : nullptr;
+}
+
+void TrigramIndex::decode(const DirEntry& entry, std::vector<uint32_t>& out) const {
+    out.reserve(out.size() + entry.count);
+
+    const uint8_t* base = data.data() + entry.dataOffset;
+
+    if (static_cast<Kind>(entry.kind) == Kind::Bitmap) {
+        const size_t words = (static_cast<size_t>(recordCount) + 63) / 64;
+        for (size_t w = 0; w < words; ++w) {
+            uint64_t bits = loadWord(base + w * sizeof(uint64_t));
+            while (bits != 0) {
+                out.push_back(static_cast<uint32_t>(w * 64 + std::countr_zero(bits)));
+                bits &= bits - 1;
+            }
+        }
+        return;
+    }
+
+    const uint32_t blocks = blocksFor(entry.count);
+    const Skip* sk = skips.data() + entry.firstSkip;
+
+    for (uint32_t b = 0; b < blocks; ++b) {
+        const uint8_t* p = base + sk[b].byteOffset;
+        uint32_t cur = sk[b].firstRecord;
+        out.push_back(cur);
+
+        const uint32_t inBlock = std::min(kBlockSize, entry.count - b * kBlockSize);
+        for (uint32_t k = 1; k < inBlock; ++k) {
+            cur += readVarint(p);
+            out.push_back(cur);
+        }
+    }
+}
+
+void TrigramIndex::intersectInPlace(const DirEntry& entry, std::vector<uint32_t>& candidates) const {
+    size_t w = 0;
+
+    if (static_cast<Kind>(entry.kind) == Kind::Bitmap) {
+        const uint8_t* bits = data.data() + entry.dataOffset;
+        for (uint32_t c : candidates) {
+            if (c < recordCount && (bits[c >> 3] & (1u << (c & 7))) != 0) candidates[w++] = c;
+        }
+        candidates.resize(w);
+        return;
+    }
+
+    Cursor cur(*this, entry);
+
+    if (static_cast<uint64_t>(entry.count) > static_cast<uint64_t>(candidates.size()) * kGallopRatio) {
+        for (uint32_t c : candidates) {
+            cur.advanceTo(c);
+            if (!cur.valid()) break;
+            if (cur.value() == c) candidates[w++] = c;
+        }
+    } else {
+        size_t r = 0;
+        while (r < candidates.size() && cur.valid()) {
+            const uint32_t c = candidates[r];
+            if (c < cur.value()) {
+                ++r;
+            } else if (cur.value() < c) {
+                cur.next();
+            } else {
+                candidates[w++] = c;
+                ++r;
+                cur.next();
+            }
+        }
+    }
+
+    candidates.resize(w);
+}
+
+bool TrigramIndex::validate(size_t expectedRecordCount) const {
+    if (directory.empty()) {
+        return buckets.empty() || buckets.size() == kBucketCount + 1;
+    }
+
+    if (recordCount != expectedRecordCount || buckets.size() != kBucketCount + 1 ||
+        buckets[0] != 0 || buckets[kBucketCount] != directory.size()) {
+        return false;
+    }
+
+    for (uint32_t b = 0; b < kBucketCount; ++b) {
+        if (buckets[b] > buckets[b + 1]) return false;
+    }
+
+    const size_t bitmapBytes = ((expectedRecordCount + 63) / 64) * sizeof(uint64_t);
+
+    for (size_t i = 0; i < directory.size(); ++i) {
+        const DirEntry& e = directory[i];
+
+        if (e.count == 0 || e.trigram > 0xFFFFFFu) return false;
+        if (i > 0 && directory[i - 1].trigram >= e.trigram) return false;
+
+        const uint32_t b = e.trigram >> 8;
+        if (i < buckets[b] || i >= buckets[b + 1]) return false;
+
+        if (e.dataOffset > data.size()) return false;
+
+        if (static_cast<Kind>(e.kind) == Kind::Bitmap) {
+            if ((e.dataOffset & 7) != 0 || bitmapBytes > data.size() - e.dataOffset) return false;
+        } else if (static_cast<Kind>(e.kind) == Kind::List) {
+            const uint64_t blocks = blocksFor(e.count);
+            if (static_cast<uint64_t>(e.firstSkip) + blocks > skips.size()) return false;
+
+            const Skip& lastSkip = skips[e.firstSkip + blocks - 1];
+            if (lastSkip.byteOffset > data.size() - e.dataOffset || lastSkip.firstRecord >= expectedRecordCount) {
+                return false;
+            }
+        } else {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+size_t TrigramIndex::byteSize() const {
+    return buckets.size() * sizeof(uint32_t) + directory.size() * sizeof(DirEntry) +
+           skips.size() * sizeof(Skip) + data.size();
+}
+
+// --- Cursor ---
+
+TrigramIndex::Cursor::Cursor(const TrigramIndex& index, const DirEntry& entry)
+    : m_index(&index),
+      m_data(index.data.data() + entry.dataOffset),
+      m_kind(static_cast<Kind>(entry.kind)),
+      m_count(entry.count) {
+    if (m_kind == Kind::Bitmap) {
+        seekBitmap(0);
+        return;
+    }
+
+    m_skips = index.skips.data() + entry.firstSkip;
+    m_blocks = blocksFor(m_count);
+    enterBlock(0);
+}
+
+void TrigramIndex::Cursor::enterBlock(uint32_t block) {
+    if (block >= m_blocks) {
+        m_valid = false;
+        return;
+    }
+
+    m_block = block;
+    m_cur = m_skips[block].firstRecord;
+    m_p = m_data + m_skips[block].byteOffset;
+    m_leftInBlock = std::min(kBlockSize, m_count - block * kBlockSize) - 1;
+    m_valid = true;
+}
+
+void TrigramIndex::Cursor::seekBitmap(uint64_t from) {
+    const uint64_t bitsTotal = m_index->recordCount;
+    if (from >= bitsTotal) {
+        m_valid = false;
+        return;
+    }
+
+    const uint64_t words = (bitsTotal + 63) / 64;
+    uint64_t w = from >> 6;
+    uint64_t bits = loadWord(m_data + w * sizeof(uint64_t)) & (~0ULL << (from & 63));
+
+    while (bits == 0) {
+        if (++w >= words) {
+            m_valid = false;
+            return;
+        }
+        bits = loadWord(m_data + w * sizeof(uint64_t));
+    }
+
+    m_cur = static_cast<uint32_t>(w * 64 + std::countr_zero(bits));
+    m_valid = true;
+}
+
+void TrigramIndex::Cursor::next() {
+    if (!m_valid) return;
+
+    if (m_kind == Kind::Bitmap) {
+        seekBitmap(static_cast<uint64_t>(m_cur) + 1);
+        return;
+    }
+
+    if (m_leftInBlock > 0) {
+        m_cur += readVarint(m_p);
+        --m_leftInBlock;
+        return;
+    }
+
+    enterBlock(m_block + 1);
+}
+
+void TrigramIndex::Cursor::advanceTo(uint32_t target) {
+    if (!m_valid || m_cur >= target) return;
+
+    if (m_kind == Kind::Bitmap) {
+        seekBitmap(target);
+        return;
+    }
+
+    // Jump to the last block starting at or before target, if that is past the current block
+    if (m_block + 1 < m_blocks && m_skips[m_block + 1].firstRecord <= target) {
+        const Skip* first = m_skips + m_block + 1;
+        const Skip* last = m_skips + m_blocks;
+        const Skip* it = std::upper_bound(first, last, target, [](uint32_t t, const Skip& s) {
+            return t < s.firstRecord;
+        });
+        enterBlock(static_cast<uint32_t>((it - 1) - m_skips));
+    }
+
+    while (m_valid && m_cur < target) {
+        next();
+    }
+}
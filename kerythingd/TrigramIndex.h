@@ -0,0 +1,149 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026  Reikooters <https://github.com/Reikooters>
+
+#ifndef KERYTHING_KERYTHINGD_TRIGRAMINDEX_H
+#define KERYTHING_KERYTHINGD_TRIGRAMINDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "../ScannerEngine.h"
+#include "MappedArray.h"
+
+/**
+ * Compressed trigram -> recordIdx posting lists.
+ *
+ * The ids need not be records: a DeviceIndex builds it over its distinct names (NameTable ids),
+ * so "recordIdx" below is whatever id the index was built from.
+ *
+ * Replaces the flat sorted (trigram, recordIdx) vector, which repeats the 32-bit trigram next to
+ * every record id and needs a binary search over the whole vector per lookup.
+ *
+ * Layout (all four arrays are persisted as snapshot sections and can be mmap'd as-is):
+ *  - buckets:   kBucketCount + 1 offsets into directory, keyed by the top 16 bits of the 24-bit
+ *               trigram. A lookup is one bucket read plus a search over at most 256 entries.
+ *  - directory: one DirEntry per distinct trigram, sorted by trigram.
+ *  - skips:     per list posting, one Skip per block of kBlockSize postings
+ *               (first recordIdx of the block + byte offset of its deltas).
+ *  - data:      varint-encoded deltas (list postings), or a raw bitmap over all records
+ *               (bitmap postings, used for very dense trigrams like "e.t" where it is smaller).
+ */
+class TrigramIndex {
+public:
+    static constexpr uint32_t kBucketCount = 1u << 16;
+    static constexpr uint32_t kBlockSize = 128;
+
+    // Postings this many times longer than the candidate set are galloped (skip table) instead of merged
+    static constexpr uint32_t kGallopRatio = 8;
+
+    enum class Kind : uint8_t {
+        List = 0,
+        Bitmap = 1,
+    };
+
+    struct DirEntry {
+        uint32_t trigram;
+        uint32_t count;       // number of postings
+        uint32_t firstSkip;   // List: index of the first Skip of this posting
+        uint8_t kind;         // Kind
+        uint8_t reserved[3];
+        uint64_t dataOffset;  // byte offset into data (8-byte aligned for Bitmap)
+    };
+
+    struct Skip {
+        uint32_t firstRecord; // first recordIdx of this block (not stored in data)
+        uint32_t byteOffset;  // start of this block's deltas, relative to DirEntry::dataOffset
+    };
+
+    static_assert(sizeof(DirEntry) == 24, "DirEntry must be 24 bytes for snapshot IO.");
+    static_assert(sizeof(Skip) == 8, "Skip must be 8 bytes for snapshot IO.");
+
+    /**
+     * Forward iterator over one posting list, in ascending recordIdx order.
+     */
+    class Cursor {
+    public:
+        Cursor() = default;
+        Cursor(const TrigramIndex& index, const DirEntry& entry);
+
+        [[nodiscard]] bool valid() const { return m_valid; }
+        [[nodiscard]] uint32_t value() const { return m_cur; }
+
+        void next();
+
+        /**
+         * Advances to the first posting >= target (no-op if already there).
+         * List postings use the skip table to jump whole blocks.
+         */
+        void advanceTo(uint32_t target);
+
+    private:
+        void enterBlock(uint32_t block);
+        void seekBitmap(uint64_t from);
+
+        const TrigramIndex* m_index = nullptr;
+        const uint8_t* m_data = nullptr;
+        const Skip* m_skips = nullptr;
+        Kind m_kind = Kind::List;
+
+        uint32_t m_count = 0;
+        uint32_t m_blocks = 0;
+        uint32_t m_block = 0;
+        uint32_t m_leftInBlock = 0;
+        const uint8_t* m_p = nullptr;
+
+        uint32_t m_cur = 0;
+        bool m_valid = false;
+    };
+
+    MappedArray<uint32_t> buckets;
+    MappedArray<DirEntry> directory;
+    MappedArray<Skip> skips;
+    MappedArray<uint8_t> data;
+
+    // Records covered by this index (bitmap postings are this many bits long)
+    uint32_t recordCount = 0;
+
+    [[nodiscard]] bool empty() const { return directory.empty(); }
+
+    /**
+     * Builds the compressed index from (trigram, recordIdx) pairs sorted by trigram, then recordIdx.
+     *
+     * @param sorted Sorted entries; exact duplicates are tolerated and dropped.
+     * @param n Number of entries.
+     * @param recordCount Number of records in the device index (upper bound for recordIdx).
+     */
+    static TrigramIndex build(const ScannerEngine::TrigramEntry* sorted, size_t n, size_t recordCount);
+
+    /**
+     * @return The directory entry for the trigram, or nullptr if no record contains it.
+     */
+    [[nodiscard]] const DirEntry* find(uint32_t trigram) const;
+
+    /**
+     * Appends every recordIdx of the posting to out (ascending).
+     */
+    void decode(const DirEntry& entry, std::vector<uint32_t>& out) const;
+
+    /**
+     * Keeps only the candidates that are also in the posting (candidates must be ascending).
+     *
+     * Picks the cheapest strategy for the size ratio: bit tests for bitmap postings,
+     * skip-table galloping when the posting is much longer than the candidate set,
+     * and a linear merge otherwise.
+     */
+    void intersectInPlace(const DirEntry& entry, std::vector<uint32_t>& candidates) const;
+
+    /**
+     * Structural checks for a freshly loaded (possibly mmap'd) index; does not decode postings.
+     *
+     * @return true if all offsets are in-bounds and the directory is consistent.
+     */
+    [[nodiscard]] bool validate(size_t expectedRecordCount) const;
+
+    // Total bytes of the four arrays (owned or mapped)
+    [[nodiscard]] size_t byteSize() const;
+};
+
+#endif //KERYTHING_KERYTHINGD_TRIGRAMINDEX_H
@@ -0,0 +1,203 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026  Reikooters <https://github.com/Reikooters>
+
+#include "WatchJournal.h"
+
+#include <QDataStream>
+#include <QFile>
+#include <QSaveFile>
+
+#include <cstring>
+
+static constexpr quint64 kJournalMagic = 0x4B4552594A524E4CULL; // "KERYJRNL" (8 bytes)
+static constexpr quint32 kJournalVersion = 1;
+
+static constexpr quint64 kHeaderBytes = sizeof(quint64) + sizeof(quint32) + sizeof(quint64);
+static constexpr quint64 kFrameHeaderBytes = sizeof(quint32) + sizeof(quint64);
+
+// A single batch never comes close; anything larger is a corrupt size field
+static constexpr quint32 kMaxFrameBytes = 256u << 20;
+
+// FNV-1a; only meant to catch torn appends
+static quint64 frameChecksum(const char* data, size_t n) {
+    quint64 h = 0xCBF29CE484222325ULL;
+    for (size_t i = 0; i < n; ++i) {
+        h = (h ^ static_cast<unsigned char>(data[i])) * 0x100000001B3ULL;
+    }
+    return h;
+}
+
+static QByteArray encodeBatch(const WatchJournal::Batch& batch) {
+    QByteArray payload;
+    QDataStream s(&payload, QIODevice::WriteOnly);
+    s.setByteOrder(QDataStream::LittleEndian);
+
+    s << static_cast<quint32>(batch.size());
+    for (const WatchJournal::Op& op : batch) {
+        s << static_cast<quint8>(op.kind);
+        switch (op.kind) {
+            case WatchJournal::OpKind::SetStats:
+                s << op.recIdx << op.size << op.mtime << static_cast<quint8>(op.isDir) << static_cast<quint8>(op.isSymlink);
+                break;
+            case WatchJournal::OpKind::Append:
+                s << op.parentDirId << op.size << op.mtime << static_cast<quint8>(op.isDir)
+                  << static_cast<quint8>(op.isSymlink) << op.fileId << static_cast<quint32>(op.name.size());
+                s.writeRawData(op.name.constData(), static_cast<int>(op.name.size()));
+                break;
+            case WatchJournal::OpKind::Remove:
+                s << op.recIdx;
+                break;
+            case WatchJournal::OpKind::SetWatchEnabled:
+                s << static_cast<quint8>(op.enabled);
+                break;
+        }
+    }
+    return payload;
+}
+
+static bool decodeBatch(const QByteArray& payload, WatchJournal::Batch& out) {
+    QDataStream s(payload);
+    s.setByteOrder(QDataStream::LittleEndian);
+
+    quint32 count = 0;
+    s >> count;
+    if (count > static_cast<quint32>(payload.size())) return false; // every op takes at least one byte
+
+    out.clear();
+    out.reserve(count);
+    for (quint32 i = 0; i < count; ++i) {
+        WatchJournal::Op op;
+        quint8 kind = 0;
+        quint8 isDir = 0;
+        quint8 isSymlink = 0;
+        s >> kind;
+        op.kind = static_cast<WatchJournal::OpKind>(kind);
+
+        switch (op.kind) {
+            case WatchJournal::OpKind::SetStats:
+                s >> op.recIdx >> op.size >> op.mtime >> isDir >> isSymlink;
+                break;
+            case WatchJournal::OpKind::Append: {
+                quint32 nameLen = 0;
+                s >> op.parentDirId >> op.size >> op.mtime >> isDir >> isSymlink >> op.fileId >> nameLen;
+                if (nameLen == 0 || nameLen > 0xFFFFu) return false;
+                op.name.resize(static_cast<qsizetype>(nameLen));
+                if (s.readRawData(op.name.data(), static_cast<int>(nameLen)) != static_cast<int>(nameLen)) return false;
+                break;
+            }
+            case WatchJournal::OpKind::Remove:
+                s >> op.recIdx;
+                break;
+            case WatchJournal::OpKind::SetWatchEnabled: {
+                quint8 enabled = 0;
+                s >> enabled;
+                op.enabled = enabled != 0;
+                break;
+            }
+            default:
+                return false;
+        }
+
+        op.isDir = isDir != 0;
+        op.isSymlink = isSymlink != 0;
+        out.push_back(std::move(op));
+    }
+    return s.status() == QDataStream::Ok && s.atEnd();
+}
+
+bool WatchJournal::create(const QString& path, quint64 snapshotToken, QString* errorOut) {
+    QSaveFile f(path);
+    if (!f.open(QIODevice::WriteOnly)) {
+        if (errorOut) *errorOut = QStringLiteral("Failed to open journal for writing: %1").arg(path);
+        return false;
+    }
+
+    QDataStream s(&f);
+    s.setByteOrder(QDataStream::LittleEndian);
+    s << kJournalMagic << kJournalVersion << snapshotToken;
+
+    if (s.status() != QDataStream::Ok || !f.commit()) {
+        if (errorOut) *errorOut = QStringLiteral("Failed to write journal header: %1").arg(path);
+        return false;
+    }
+    return true;
+}
+
+bool WatchJournal::append(const QString& path, const Batch& batch, QString* errorOut) {
+    const QByteArray payload = encodeBatch(batch);
+
+    // Header and payload go out in one write, so a crash can tear at most this frame
+    QByteArray frame;
+    frame.reserve(static_cast<qsizetype>(kFrameHeaderBytes) + payload.size());
+    {
+        QDataStream s(&frame, QIODevice::WriteOnly);
+        s.setByteOrder(QDataStream::LittleEndian);
+        s << static_cast<quint32>(payload.size()) << frameChecksum(payload.constData(), static_cast<size_t>(payload.size()));
+    }
+    frame.append(payload);
+
+    QFile f(path);
+    if (!f.exists() || !f.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        if (errorOut) *errorOut = QStringLiteral("Failed to open journal for appending: %1").arg(path);
+        return false;
+    }
+    if (f.write(frame) != frame.size()) {
+        if (errorOut) *errorOut = QStringLiteral("Failed to append to journal: %1").arg(path);
+        return false;
+    }
+    return true;
+}
+
+bool WatchJournal::read(const QString& path, quint64 snapshotToken, std::vector<Batch>& out, QString* errorOut) {
+    out.clear();
+
+    QFile f(path);
+    if (!f.open(QIODevice::ReadWrite)) {
+        if (errorOut) *errorOut = QStringLiteral("Failed to open journal: %1").arg(path);
+        return false;
+    }
+
+    const QByteArray bytes = f.readAll();
+
+    QDataStream s(bytes);
+    s.setByteOrder(QDataStream::LittleEndian);
+
+    quint64 magic = 0;
+    quint32 version = 0;
+    quint64 token = 0;
+    s >> magic >> version >> token;
+    if (s.status() != QDataStream::Ok || magic != kJournalMagic || version != kJournalVersion) {
+        if (errorOut) *errorOut = QStringLiteral("Journal header mismatch: %1").arg(path);
+        return false;
+    }
+    if (token != snapshotToken) {
+        if (errorOut) *errorOut = QStringLiteral("Journal belongs to another snapshot: %1").arg(path);
+        return false;
+    }
+
+    quint64 good = kHeaderBytes;
+    while (good + kFrameHeaderBytes <= static_cast<quint64>(bytes.size())) {
+        quint32 size = 0;
+        quint64 checksum = 0;
+        std::memcpy(&size, bytes.constData() + good, sizeof(size));
+        std::memcpy(&checksum, bytes.constData() + good + sizeof(size), sizeof(checksum));
+
+        const quint64 payloadAt = good + kFrameHeaderBytes;
+        if (size > kMaxFrameBytes || payloadAt + size > static_cast<quint64>(bytes.size())) break;
+
+        const char* payload = bytes.constData() + payloadAt;
+        if (frameChecksum(payload, size) != checksum) break;
+
+        Batch batch;
+        if (!decodeBatch(QByteArray::fromRawData(payload, static_cast<qsizetype>(size)), batch)) break;
+
+        out.push_back(std::move(batch));
+        good = payloadAt + size;
+    }
+
+    // Drop a torn tail so later appends stay reachable
+    if (good < static_cast<quint64>(bytes.size())) {
+        (void)f.resize(static_cast<qint64>(good));
+    }
+    return true;
+}
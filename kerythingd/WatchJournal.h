@@ -0,0 +1,70 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026  Reikooters <https://github.com/Reikooters>
+
+#ifndef KERYTHING_KERYTHINGD_WATCHJOURNAL_H
+#define KERYTHING_KERYTHINGD_WATCHJOURNAL_H
+
+#include <cstdint>
+#include <vector>
+
+#include <QByteArray>
+#include <QString>
+
+/**
+ * Append-only log of the incremental watch updates applied to a device index since its snapshot.
+ *
+ * Rewriting a whole snapshot for every watch batch would cost far more than the batch itself, so
+ * each applied batch is appended here as one checksummed frame instead, and the journal is folded
+ * into a fresh snapshot whenever the index is compacted (or rescanned). Loading replays the frames
+ * on top of the snapshot, in order, through the same delta-segment operations, so record ids come
+ * out exactly as they were.
+ *
+ * A journal belongs to exactly one snapshot file: its header carries the snapshot's token (a random
+ * id written into the snapshot metadata, v15+), and a journal whose token doesn't match is ignored.
+ *
+ * A torn last frame (crash mid-append) is dropped and truncated away on load; everything before it
+ * still applies. Appends are not fsync'd.
+ *
+ * File layout (little-endian):
+ *  - Header: magic, version, snapshot token.
+ *  - Frames: payload size (u32), checksum (u64) of the payload, then the payload: the batch's ops.
+ */
+class WatchJournal {
+public:
+    enum class OpKind : quint8 {
+        SetStats = 1,        // recIdx: size/mtime/isDir/isSymlink changed
+        Append = 2,          // new delta record under parentDirId (appendDeltaRecord)
+        Remove = 3,          // recIdx is now a tombstone
+        SetWatchEnabled = 4, // the device's watch toggle
+    };
+
+    struct Op {
+        OpKind kind = OpKind::SetStats;
+        quint32 recIdx = 0;
+        quint32 parentDirId = 0;
+        quint64 size = 0;
+        quint64 mtime = 0;
+        quint64 fileId = 0;
+        bool isDir = false;
+        bool isSymlink = false;
+        bool enabled = false; // SetWatchEnabled
+        QByteArray name;      // Append: UTF-8 name
+    };
+
+    // One applied watch batch
+    using Batch = std::vector<Op>;
+
+    // Starts an empty journal for the snapshot with this token (replacing any file at path)
+    static bool create(const QString& path, quint64 snapshotToken, QString* errorOut = nullptr);
+
+    static bool append(const QString& path, const Batch& batch, QString* errorOut = nullptr);
+
+    /**
+     * Reads every intact batch of the journal at path, truncating a torn tail.
+     *
+     * @return false if the file is missing, unreadable or belongs to another snapshot.
+     */
+    static bool read(const QString& path, quint64 snapshotToken, std::vector<Batch>& out, QString* errorOut = nullptr);
+};
+
+#endif //KERYTHING_KERYTHINGD_WATCHJOURNAL_H
@@ -10,7 +10,6 @@
 #include <QDebug>
 #include <QDateTime>
 #include <QFile>
-#include <QVariantMap>
 
 #include <cerrno>
 #include <cstring>
@@ -148,42 +147,7 @@ void WatchManager::ensureEntryWatching(const Key& k, Entry& e, const QString& mo
         if (!e.batchTimer) {
             e.batchTimer = new QTimer(this);
             e.batchTimer->setSingleShot(true);
-            connect(e.batchTimer, &QTimer::timeout, this, [this, k]() {
-                auto it = m_entries.find(k);
-                if (it == m_entries.end()) return;
-                Entry& ee = it->second;
-
-                const bool overflow = ee.overflowSeen;
-
-                QVariantList touched;
-                touched.reserve(static_cast<int>(ee.pendingTouchedByKey.size()));
-
-                for (const auto& kv : ee.pendingTouchedByKey) {
-                    const Entry::PendingTouched& pt = kv.second;
-
-                    QVariantMap m;
-                    m.insert(QStringLiteral("fsidHex"), pt.fsidHex);
-                    m.insert(QStringLiteral("handleHex"), pt.handleHex);
-                    m.insert(QStringLiteral("name"), pt.name);
-                    m.insert(QStringLiteral("mask"), QVariant::fromValue<qulonglong>(pt.mask));
-                    touched.push_back(m);
-                }
-
-                const int count = touched.size();
-
-                ee.pendingTouchedByKey.clear();
-                ee.overflowSeen = false;
-
-                qInfo().noquote() << QStringLiteral("[watch] dispatch uid=%1 device=%2 touched=%3 overflow=%4")
-                                     .arg(k.uid)
-                                     .arg(k.deviceId)
-                                     .arg(count)
-                                     .arg(overflow ? QStringLiteral("1") : QStringLiteral("0"));
-
-                if (m_svc && (count > 0 || overflow)) {
-                    m_svc->applyWatchBatch(k.uid, k.deviceId, touched, overflow);
-                }
-            });
+            connect(e.batchTimer, &QTimer::timeout, this, [this, k]() { dispatchBatch(k); });
         }
 
         return;
@@ -262,42 +226,7 @@ void WatchManager::ensureEntryWatching(const Key& k, Entry& e, const QString& mo
                 // Create batch timer
                 e.batchTimer = new QTimer(this);
                 e.batchTimer->setSingleShot(true);
-                connect(e.batchTimer, &QTimer::timeout, this, [this, k]() {
-                    auto it = m_entries.find(k);
-                    if (it == m_entries.end()) return;
-                    Entry& ee = it->second;
-
-                    const bool overflow = ee.overflowSeen;
-
-                    QVariantList touched;
-                    touched.reserve(static_cast<int>(ee.pendingTouchedByKey.size()));
-
-                    for (const auto& kv : ee.pendingTouchedByKey) {
-                        const Entry::PendingTouched& pt = kv.second;
-
-                        QVariantMap m;
-                        m.insert(QStringLiteral("fsidHex"), pt.fsidHex);
-                        m.insert(QStringLiteral("handleHex"), pt.handleHex);
-                        m.insert(QStringLiteral("name"), pt.name);
-                        m.insert(QStringLiteral("mask"), QVariant::fromValue<qulonglong>(pt.mask));
-                        touched.push_back(m);
-                    }
-
-                    const int count = touched.size();
-
-                    ee.pendingTouchedByKey.clear();
-                    ee.overflowSeen = false;
-
-                    qInfo().noquote() << QStringLiteral("[watch] dispatch uid=%1 device=%2 touched=%3 overflow=%4")
-                                         .arg(k.uid)
-                                         .arg(k.deviceId)
-                                         .arg(count)
-                                         .arg(overflow ? QStringLiteral("1") : QStringLiteral("0"));
-
-                    if (m_svc && (count > 0 || overflow)) {
-                        m_svc->applyWatchBatch(k.uid, k.deviceId, touched, overflow);
-                    }
-                });
+                connect(e.batchTimer, &QTimer::timeout, this, [this, k]() { dispatchBatch(k); });
 
                 e.watchingMode = QStringLiteral("filesystemEvents");
                 e.status = Status{QStringLiteral("watching"), QString(), e.watchingMode};
@@ -366,42 +295,7 @@ void WatchManager::ensureEntryWatching(const Key& k, Entry& e, const QString& mo
         // Create batch timer
         e.batchTimer = new QTimer(this);
         e.batchTimer->setSingleShot(true);
-        connect(e.batchTimer, &QTimer::timeout, this, [this, k]() {
-            auto it = m_entries.find(k);
-            if (it == m_entries.end()) return;
-            Entry& ee = it->second;
-
-            const bool overflow = ee.overflowSeen;
-
-            QVariantList touched;
-            touched.reserve(static_cast<int>(ee.pendingTouchedByKey.size()));
-
-            for (const auto &kv: ee.pendingTouchedByKey) {
-                const Entry::PendingTouched &pt = kv.second;
-
-                QVariantMap m;
-                m.insert(QStringLiteral("fsidHex"), pt.fsidHex);
-                m.insert(QStringLiteral("handleHex"), pt.handleHex);
-                m.insert(QStringLiteral("name"), pt.name);
-                m.insert(QStringLiteral("mask"), QVariant::fromValue<qulonglong>(pt.mask));
-                touched.push_back(m);
-            }
-
-            const int count = touched.size();
-
-            ee.pendingTouchedByKey.clear();
-            ee.overflowSeen = false;
-
-            qInfo().noquote() << QStringLiteral("[watch] dispatch uid=%1 device=%2 touched=%3 overflow=%4")
-                    .arg(k.uid)
-                    .arg(k.deviceId)
-                    .arg(count)
-                    .arg(overflow ? QStringLiteral("1") : QStringLiteral("0"));
-
-            if (m_svc && (count > 0 || overflow)) {
-                m_svc->applyWatchBatch(k.uid, k.deviceId, touched, overflow);
-            }
-        });
+        connect(e.batchTimer, &QTimer::timeout, this, [this, k]() { dispatchBatch(k); });
 
         e.watchingMode = QStringLiteral("mountFallback");
         e.status = Status{QStringLiteral("watching"), QString(), e.watchingMode};
@@ -414,9 +308,33 @@ void WatchManager::ensureEntryWatching(const Key& k, Entry& e, const QString& mo
     }
 }
 
-static QByteArray toHexCompact(const void* data, size_t n) {
-    if (!data || n == 0) return {};
-    return QByteArray(reinterpret_cast<const char*>(data), static_cast<int>(n)).toHex();
+void WatchManager::dispatchBatch(const Key& k) {
+    auto it = m_entries.find(k);
+    if (it == m_entries.end()) return;
+    Entry& e = it->second;
+
+    const bool overflow = e.overflowSeen;
+
+    std::vector<TouchedEntry> touched;
+    touched.reserve(e.pendingTouchedByKey.size());
+    for (auto& kv : e.pendingTouchedByKey) {
+        touched.push_back(std::move(kv.second));
+    }
+
+    const int count = static_cast<int>(touched.size());
+
+    e.pendingTouchedByKey.clear();
+    e.overflowSeen = false;
+
+    qInfo().noquote() << QStringLiteral("[watch] dispatch uid=%1 device=%2 touched=%3 overflow=%4")
+                         .arg(k.uid)
+                         .arg(k.deviceId)
+                         .arg(count)
+                         .arg(overflow ? QStringLiteral("1") : QStringLiteral("0"));
+
+    if (m_svc && (count > 0 || overflow)) {
+        m_svc->applyWatchBatch(k.uid, k.deviceId, touched, overflow);
+    }
 }
 
 void WatchManager::onFanotifyReadable(const Key& k) {
@@ -480,9 +398,6 @@ void WatchManager::onFanotifyReadable(const Key& k) {
 
                         auto* fid = reinterpret_cast<const fanotify_event_info_fid*>(infoPtr);
 
-                        const QByteArray fsidHexB = toHexCompact(&fid->fsid, sizeof(fid->fsid));
-                        const QString fsidHex = QString::fromLatin1(fsidHexB);
-
                         // fanotify headers differ across kernel/libc versions:
                         // fid->handle may be a byte array payload, not a struct member.
                         const auto* fh = reinterpret_cast<const file_handle*>(
@@ -508,36 +423,35 @@ void WatchManager::onFanotifyReadable(const Key& k) {
                             continue;
                         }
 
-                        const QByteArray handleHexB = toHexCompact(
-                            static_cast<const void*>(fid->handle),
-                            handleBlobSize
-                        );
-                        const QString handleHex = QString::fromLatin1(handleHexB);
-
                         const size_t nameOff = fidBase + handleBlobSize;
-                        QString name;
+                        size_t nameLen = 0;
+                        const char* namePtr = nullptr;
 
                         if (hdr->len > nameOff) {
-                            const char* namePtr = reinterpret_cast<const char*>(infoPtr) + nameOff;
+                            namePtr = reinterpret_cast<const char*>(infoPtr) + nameOff;
                             const size_t nameMax = static_cast<size_t>(hdr->len - nameOff);
 
                             // name is NUL-terminated (kernel provides), but be defensive.
-                            size_t n = 0;
-                            for (; n < nameMax; ++n) {
-                                if (namePtr[n] == '\0') break;
-                            }
-                            if (n > 0) {
-                                name = QString::fromLocal8Bit(namePtr, static_cast<int>(n));
+                            for (; nameLen < nameMax; ++nameLen) {
+                                if (namePtr[nameLen] == '\0') break;
                             }
                         }
 
-                        if (!fsidHex.isEmpty() && !handleHex.isEmpty() && !name.isEmpty()) {
-                            const QString keyStr = fsidHex + QStringLiteral(":") + handleHex + QStringLiteral(":") + name;
-
-                            Entry::PendingTouched& pt = e.pendingTouchedByKey[keyStr];
-                            pt.fsidHex = fsidHex;
-                            pt.handleHex = handleHex;
-                            pt.name = name;
+                        if (nameLen > 0) {
+                            // Coalescing key: the raw fsid, handle blob and name, back to back
+                            QByteArray key;
+                            key.reserve(static_cast<qsizetype>(sizeof(fid->fsid) + handleBlobSize + nameLen));
+                            key.append(reinterpret_cast<const char*>(&fid->fsid), sizeof(fid->fsid));
+                            key.append(reinterpret_cast<const char*>(fid->handle), static_cast<qsizetype>(handleBlobSize));
+                            key.append(namePtr, static_cast<qsizetype>(nameLen));
+
+                            TouchedEntry& pt = e.pendingTouchedByKey[key];
+                            if (pt.handle.isEmpty()) {
+                                std::memcpy(&pt.fsid, &fid->fsid, sizeof(pt.fsid));
+                                pt.handle = QByteArray(reinterpret_cast<const char*>(fid->handle),
+                                                       static_cast<qsizetype>(handleBlobSize));
+                                pt.name = QByteArray(namePtr, static_cast<qsizetype>(nameLen));
+                            }
                             pt.mask |= static_cast<quint64>(meta->mask);
                         }
                     }
@@ -555,42 +469,7 @@ void WatchManager::onFanotifyReadable(const Key& k) {
             // Defensive: should exist while watching, but don’t crash if not.
             e.batchTimer = new QTimer(this);
             e.batchTimer->setSingleShot(true);
-            connect(e.batchTimer, &QTimer::timeout, this, [this, k]() {
-                auto it2 = m_entries.find(k);
-                if (it2 == m_entries.end()) return;
-                Entry& ee = it2->second;
-
-                const bool overflow = ee.overflowSeen;
-
-                QVariantList touched;
-                touched.reserve(static_cast<int>(ee.pendingTouchedByKey.size()));
-
-                for (const auto& kv : ee.pendingTouchedByKey) {
-                    const Entry::PendingTouched& pt = kv.second;
-
-                    QVariantMap m;
-                    m.insert(QStringLiteral("fsidHex"), pt.fsidHex);
-                    m.insert(QStringLiteral("handleHex"), pt.handleHex);
-                    m.insert(QStringLiteral("name"), pt.name);
-                    m.insert(QStringLiteral("mask"), QVariant::fromValue<qulonglong>(pt.mask));
-                    touched.push_back(m);
-                }
-
-                const int count = touched.size();
-
-                ee.pendingTouchedByKey.clear();
-                ee.overflowSeen = false;
-
-                qInfo().noquote() << QStringLiteral("[watch] dispatch uid=%1 device=%2 touched=%3 overflow=%4")
-                                     .arg(k.uid)
-                                     .arg(k.deviceId)
-                                     .arg(count)
-                                     .arg(overflow ? QStringLiteral("1") : QStringLiteral("0"));
-
-                if (m_svc && (count > 0 || overflow)) {
-                    m_svc->applyWatchBatch(k.uid, k.deviceId, touched, overflow);
-                }
-            });
+            connect(e.batchTimer, &QTimer::timeout, this, [this, k]() { dispatchBatch(k); });
         }
 
         if (!e.batchTimer->isActive()) {
@@ -601,11 +480,8 @@ void WatchManager::onFanotifyReadable(const Key& k) {
 
     // If we saw changes but couldn't parse DFID_NAME tokens, enqueue one generic token.
     if (sawNonOverflowEvent && !parsedAnyDfidName) {
-        const QString keyStr = QStringLiteral(":: *"); // stable-ish key; content doesn't matter externally
-        Entry::PendingTouched& pt = e.pendingTouchedByKey[keyStr];
-        pt.fsidHex.clear();
-        pt.handleHex.clear();
-        pt.name = QStringLiteral("*");
+        TouchedEntry& pt = e.pendingTouchedByKey[QByteArray()]; // no real entry has an empty key
+        pt.generic = true;
         pt.mask |= 1ULL;
     }
 
@@ -4,10 +4,12 @@
 #ifndef KERYTHING_KERYTHINGD_WATCHMANAGER_H
 #define KERYTHING_KERYTHINGD_WATCHMANAGER_H
 
+#include <QByteArray>
 #include <QObject>
 #include <QString>
 #include <QTimer>
 #include <unordered_map>
+#include <vector>
 
 class QSocketNotifier;
 class IndexerService;
@@ -30,6 +32,22 @@ public:
         bool retryOnlyOnMountChange = false; // true => "onRemount" mode (e.g. EINVAL on this mount)
     };
 
+    /**
+     * One coalesced directory-entry change, as read from a FAN_REPORT_DFID_NAME event.
+     *
+     * Bytes are carried as the kernel reported them, so the receiver can open_by_handle_at()
+     * the handle (or look it up in a cache) without decoding anything first.
+     */
+    struct TouchedEntry {
+        quint64 fsid = 0;
+        QByteArray handle; // struct file_handle header + f_handle bytes
+        QByteArray name;   // raw entry name, not NUL-terminated
+        quint64 mask = 0;  // OR of the fanotify masks seen for this entry
+
+        // Set when events arrived that could not be parsed; fsid/handle/name are then empty
+        bool generic = false;
+    };
+
     explicit WatchManager(IndexerService* svc, QObject* parent = nullptr);
     ~WatchManager() override;
 
@@ -60,15 +78,8 @@ private:
 
         QTimer* batchTimer = nullptr;
 
-        struct PendingTouched {
-            QString fsidHex;
-            QString handleHex;
-            QString name;
-            quint64 mask = 0;
-        };
-
-        // Coalescing key = "fsidHex:handleHex:name"
-        std::unordered_map<QString, PendingTouched> pendingTouchedByKey;
+        // Coalescing key = raw fsid + handle + name bytes (empty for the generic entry)
+        std::unordered_map<QByteArray, TouchedEntry> pendingTouchedByKey;
         bool overflowSeen = false;
 
         // Backoff to avoid retry spam on unsupported filesystems (e.g. NTFS/fuse)
@@ -82,6 +93,7 @@ private:
     void stopEntry(Entry& e);
     void ensureEntryWatching(const Key& k, Entry& e, const QString& mountPoint);
     void onFanotifyReadable(const Key& k);
+    void dispatchBatch(const Key& k);
 
     IndexerService* m_svc = nullptr;
 
@@ -1,9 +1,12 @@
 // SPDX-License-Identifier: GPL-3.0-or-later
 // Copyright (C) 2026  Reikooters <https://github.com/Reikooters>
 
+#include <algorithm>
 #include <iostream>
+#include <optional>
 #include <string>
 #include <string_view>
+#include <vector>
 #include <cstdlib>
 #include <cerrno>
 #include <cstring>
@@ -14,14 +17,22 @@
 
 #include "scanners/NtfsScannerEngine.h"
 #include "scanners/Ext4ScannerEngine.h"
+#include "ScanProtocol.h"
+#include "ScannerUtils.h"
 #include "Version.h"
 
 static void printUsage(const char* argv0) {
     std::cerr
         << "Usage:\n"
         << "  " << argv0 << " --version\n"
-        << "  " << argv0 << " <devicePath> <fsType>\n"
+        << "  " << argv0 << " [--stream] <devicePath> <fsType>\n"
+        << "  " << argv0 << " --stream --usn-since <journalId> <nextUsn> <journalMft> <devicePath> ntfs\n"
+        << "  " << argv0 << " --stream --changed-since <volumeId> <unixSeconds> <devicePath> ext4\n"
         << "Where:\n"
+        << "  --stream writes framed output (see ScanProtocol.h) while the scan is running\n"
+        << "  --usn-since only re-reads the files changed since that change journal checkpoint\n"
+        << "  --changed-since only re-reads the directories changed since that time\n"
+        << "              (exits with " << ScanProtocol::kExitNeedsFullScan << " if a full scan is needed instead)\n"
         << "  <devicePath> is a block device path like /dev/sdXN or /dev/nvme0n1pN\n"
         << "  <fsType> is one of: ntfs, ext4\n";
 }
@@ -134,6 +145,171 @@ struct ProgressReporter {
     }
 };
 
+/**
+ * Writes the framed streaming protocol (ScanProtocol.h) to stdout.
+ *
+ * Keeps watermarks of how many records / pool bytes have already been sent so the
+ * scanners' batch callbacks can simply hand over the growing database.
+ */
+struct FrameWriter {
+    uint64_t recordsSent = 0;
+    uint64_t poolSent = 0;
+    bool helloSent = false;
+    bool ok = true;
+
+    // Time spent writing (blocked on the daemon reading the pipe); reported as phase "emit" by writeEnd
+    std::chrono::steady_clock::duration writeTime{};
+
+    bool writeFrame(ScanProtocol::FrameType type, const char* data, size_t n) {
+        if (!ok) {
+            return false;
+        }
+
+        ScanProtocol::FrameHeader h{};
+        h.type = static_cast<uint8_t>(type);
+        h.payloadBytes = static_cast<uint32_t>(n);
+
+        const auto start = std::chrono::steady_clock::now();
+        ok = safeWriteAll(reinterpret_cast<const char*>(&h), sizeof(h)) &&
+             (n == 0 || safeWriteAll(data, static_cast<std::streamsize>(n)));
+        writeTime += std::chrono::steady_clock::now() - start;
+        return ok;
+    }
+
+    // Sent lazily from the first batch so the hint can come from the scanner's own reservation.
+    bool writeHello(uint64_t recordsHint, uint16_t recordSize, uint32_t flags = 0) {
+        if (helloSent) {
+            return ok;
+        }
+        helloSent = true;
+
+        ScanProtocol::HelloPayload hello{};
+        hello.magic = ScanProtocol::kMagic;
+        hello.version = ScanProtocol::kVersion;
+        hello.recordSize = recordSize;
+        hello.recordsHint = recordsHint;
+        hello.flags = flags;
+        return writeFrame(ScanProtocol::FrameType::Hello, reinterpret_cast<const char*>(&hello), sizeof(hello));
+    }
+
+    bool writePool(const std::vector<char>& pool) {
+        while (ok && poolSent < pool.size()) {
+            const size_t n = std::min<size_t>(pool.size() - poolSent, ScanProtocol::kMaxPayloadBytes);
+            writeFrame(ScanProtocol::FrameType::Pool, pool.data() + poolSent, n);
+            poolSent += n;
+        }
+        return ok;
+    }
+
+    // Pool must be flushed first so every name range in the batch is already known to the reader.
+    template <typename Record>
+    bool writeRecords(const std::vector<Record>& records, const std::vector<char>& pool) {
+        if (!writePool(pool)) {
+            return false;
+        }
+
+        while (ok && recordsSent < records.size()) {
+            const size_t n = std::min<size_t>(records.size() - recordsSent, ScanProtocol::kRecordsPerFrame);
+            writeFrame(ScanProtocol::FrameType::Records,
+                       reinterpret_cast<const char*>(records.data() + recordsSent),
+                       n * sizeof(Record));
+            recordsSent += n;
+        }
+        return ok;
+    }
+
+    // Sends the final parentRecordIdx of every record (overrides provisional values sent earlier).
+    template <typename Record>
+    bool writeParents(const std::vector<Record>& records) {
+        std::vector<uint32_t> payload;
+        payload.reserve(ScanProtocol::kRecordsPerFrame + 1);
+
+        for (size_t first = 0; ok && first < records.size(); first += ScanProtocol::kRecordsPerFrame) {
+            const size_t n = std::min<size_t>(records.size() - first, ScanProtocol::kRecordsPerFrame);
+
+            payload.clear();
+            payload.push_back(static_cast<uint32_t>(first));
+            for (size_t i = 0; i < n; ++i) {
+                payload.push_back(records[first + i].parentRecordIdx);
+            }
+
+            writeFrame(ScanProtocol::FrameType::Parents,
+                       reinterpret_cast<const char*>(payload.data()),
+                       payload.size() * sizeof(uint32_t));
+        }
+        return ok;
+    }
+
+    // FileIds / ParentFileIds: one uint64 per record, in record order
+    bool writeRecordIds(ScanProtocol::FrameType type, const std::vector<uint64_t>& ids) {
+        std::vector<char> payload;
+        payload.reserve(sizeof(uint32_t) + ScanProtocol::kRecordsPerFrame * sizeof(uint64_t));
+
+        for (size_t first = 0; ok && first < ids.size(); first += ScanProtocol::kRecordsPerFrame) {
+            const size_t n = std::min<size_t>(ids.size() - first, ScanProtocol::kRecordsPerFrame);
+            const auto first32 = static_cast<uint32_t>(first);
+
+            payload.resize(sizeof(uint32_t) + n * sizeof(uint64_t));
+            std::memcpy(payload.data(), &first32, sizeof(first32));
+            std::memcpy(payload.data() + sizeof(uint32_t), ids.data() + first, n * sizeof(uint64_t));
+
+            writeFrame(type, payload.data(), payload.size());
+        }
+        return ok;
+    }
+
+    // Changed / ChangedDirs: plain uint64 id lists
+    bool writeIdList(ScanProtocol::FrameType type, const std::vector<uint64_t>& fileIds) {
+        for (size_t first = 0; ok && first < fileIds.size(); first += ScanProtocol::kRecordsPerFrame) {
+            const size_t n = std::min<size_t>(fileIds.size() - first, ScanProtocol::kRecordsPerFrame);
+            writeFrame(type, reinterpret_cast<const char*>(fileIds.data() + first), n * sizeof(uint64_t));
+        }
+        return ok;
+    }
+
+    bool writeStats(const std::vector<ScanProtocol::StatsEntry>& stats) {
+        for (size_t first = 0; ok && first < stats.size(); first += ScanProtocol::kRecordsPerFrame) {
+            const size_t n = std::min<size_t>(stats.size() - first, ScanProtocol::kRecordsPerFrame);
+            writeFrame(ScanProtocol::FrameType::Stats,
+                       reinterpret_cast<const char*>(stats.data() + first),
+                       n * sizeof(ScanProtocol::StatsEntry));
+        }
+        return ok;
+    }
+
+    bool writeCheckpoint(const NtfsScannerEngine::UsnCheckpoint& checkpoint) {
+        ScanProtocol::CheckpointPayload payload{};
+        payload.journalId = checkpoint.journalId;
+        payload.nextUsn = checkpoint.nextUsn;
+        payload.journalFileId = checkpoint.journalMftIndex;
+        return writeFrame(ScanProtocol::FrameType::Checkpoint, reinterpret_cast<const char*>(&payload), sizeof(payload));
+    }
+
+    bool writeCheckpoint(const Ext4ScannerEngine::ChangeCheckpoint& checkpoint) {
+        ScanProtocol::CheckpointPayload payload{};
+        payload.journalId = checkpoint.volumeId;
+        payload.nextUsn = checkpoint.changedSince;
+        return writeFrame(ScanProtocol::FrameType::Checkpoint, reinterpret_cast<const char*>(&payload), sizeof(payload));
+    }
+
+    bool writeEnd() {
+        ScanProtocol::EndPayload end{};
+        end.recordCount = recordsSent;
+        end.poolSize = poolSent;
+        if (!writeFrame(ScanProtocol::FrameType::End, reinterpret_cast<const char*>(&end), sizeof(end))) {
+            return false;
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        std::cout.flush();
+        writeTime += std::chrono::steady_clock::now() - start;
+        ok = static_cast<bool>(std::cout);
+
+        ScannerUtils::reportPhase("emit", writeTime);
+        return ok;
+    }
+};
+
 int scanNtfs(const std::string& devicePath) {
     ProgressReporter reporter;
 
@@ -174,6 +350,70 @@ int scanNtfs(const std::string& devicePath) {
     return std::cout ? 0 : 3;
 }
 
+int scanNtfsStreaming(const std::string& devicePath) {
+    ProgressReporter reporter;
+    FrameWriter writer;
+
+    // NTFS records are final (apart from their parent) as soon as they are added,
+    // so we can hand them to the daemon while the MFT is still being read.
+    auto onBatch = [&](const NtfsScannerEngine::NtfsDatabase& partial) {
+        writer.writeHello(partial.records.capacity(), sizeof(NtfsScannerEngine::FileRecord));
+        writer.writeRecords(partial.records, partial.stringPool);
+    };
+
+    std::optional<NtfsScannerEngine::NtfsDatabase> db = NtfsScannerEngine::parseMft(devicePath, reporter, onBatch);
+    if (!db) {
+        return 2;
+    }
+
+    // The volume isn't being written while we scan it, so the journal's current end is where
+    // the next incremental scan starts.
+    const std::optional<NtfsScannerEngine::UsnCheckpoint> checkpoint =
+        NtfsScannerEngine::readUsnCheckpoint(devicePath, db->usnJournalMftIndex);
+
+    // Extension records are only added after the scan, then parents get resolved for everything.
+    if (!writer.writeHello(db->records.size(), sizeof(NtfsScannerEngine::FileRecord)) ||
+        !writer.writeRecords(db->records, db->stringPool) ||
+        !writer.writeParents(db->records) ||
+        !writer.writeRecordIds(ScanProtocol::FrameType::FileIds, db->mftIndexes) ||
+        (checkpoint && !writer.writeCheckpoint(*checkpoint)) ||
+        !writer.writeEnd()) {
+        std::cerr << "Error: failed writing scan stream to stdout.\n";
+        return 3;
+    }
+
+    return 0;
+}
+
+int scanNtfsDelta(const std::string& devicePath, const NtfsScannerEngine::UsnCheckpoint& since) {
+    ProgressReporter reporter;
+    FrameWriter writer;
+
+    NtfsScannerEngine::NtfsDelta delta;
+    switch (NtfsScannerEngine::parseUsnDelta(devicePath, since, delta, reporter)) {
+        case NtfsScannerEngine::DeltaResult::Ok:
+            break;
+        case NtfsScannerEngine::DeltaResult::NeedsFullScan:
+            return ScanProtocol::kExitNeedsFullScan;
+        case NtfsScannerEngine::DeltaResult::Failed:
+            return 2;
+    }
+
+    const NtfsScannerEngine::NtfsDatabase& db = delta.db;
+    if (!writer.writeHello(db.records.size(), sizeof(NtfsScannerEngine::FileRecord), ScanProtocol::kHelloDelta) ||
+        !writer.writeRecords(db.records, db.stringPool) ||
+        !writer.writeRecordIds(ScanProtocol::FrameType::FileIds, db.tempMftIndexes) ||
+        !writer.writeRecordIds(ScanProtocol::FrameType::ParentFileIds, db.tempParentMfts) ||
+        !writer.writeIdList(ScanProtocol::FrameType::Changed, delta.changedMftIndexes) ||
+        !writer.writeCheckpoint(delta.checkpoint) ||
+        !writer.writeEnd()) {
+        std::cerr << "Error: failed writing scan stream to stdout.\n";
+        return 3;
+    }
+
+    return 0;
+}
+
 int scanExt4(const std::string& devicePath) {
     ProgressReporter reporter;
 
@@ -214,11 +454,103 @@ int scanExt4(const std::string& devicePath) {
     return std::cout ? 0 : 3;
 }
 
+int scanExt4Streaming(const std::string& devicePath) {
+    ProgressReporter reporter;
+    FrameWriter writer;
+
+    // EXT4 records only get their parent/stat information once the inode scan is done,
+    // so only the (append-only) string pool is streamed while scanning.
+    auto onBatch = [&](const Ext4ScannerEngine::Ext4Database& partial) {
+        writer.writeHello(partial.records.capacity(), sizeof(Ext4ScannerEngine::FileRecord));
+        writer.writePool(partial.stringPool);
+    };
+
+    // Taken before the scan, so whatever changes while it runs is in the next delta
+    const std::optional<Ext4ScannerEngine::ChangeCheckpoint> checkpoint =
+        Ext4ScannerEngine::readChangeCheckpoint(devicePath);
+
+    std::optional<Ext4ScannerEngine::Ext4Database> db = Ext4ScannerEngine::parseInodes(devicePath, reporter, onBatch);
+    if (!db) {
+        return 2;
+    }
+
+    // Records are already final here, so no Parents frames are needed.
+    if (!writer.writeHello(db->records.size(), sizeof(Ext4ScannerEngine::FileRecord)) ||
+        !writer.writeRecords(db->records, db->stringPool) ||
+        !writer.writeRecordIds(ScanProtocol::FrameType::FileIds, db->inodeNumbers) ||
+        (checkpoint && !writer.writeCheckpoint(*checkpoint)) ||
+        !writer.writeEnd()) {
+        std::cerr << "Error: failed writing scan stream to stdout.\n";
+        return 3;
+    }
+
+    return 0;
+}
+
+int scanExt4Delta(const std::string& devicePath, const Ext4ScannerEngine::ChangeCheckpoint& since) {
+    ProgressReporter reporter;
+    FrameWriter writer;
+
+    Ext4ScannerEngine::Ext4Delta delta;
+    switch (Ext4ScannerEngine::parseChangedSince(devicePath, since, delta, reporter)) {
+        case Ext4ScannerEngine::DeltaResult::Ok:
+            break;
+        case Ext4ScannerEngine::DeltaResult::NeedsFullScan:
+            return ScanProtocol::kExitNeedsFullScan;
+        case Ext4ScannerEngine::DeltaResult::Failed:
+            return 2;
+    }
+
+    // The root directory is the top level of the index, not a record of its own
+    auto toFileId = [](uint32_t ino) -> uint64_t { return ino == EXT2_ROOT_INO ? 0 : ino; };
+
+    const Ext4ScannerEngine::Ext4Database& db = delta.db;
+
+    std::vector<uint64_t> parentIds;
+    parentIds.reserve(db.tempParentInodes.size());
+    for (const uint32_t ino : db.tempParentInodes) {
+        parentIds.push_back(toFileId(ino));
+    }
+
+    std::vector<uint64_t> changedDirs;
+    changedDirs.reserve(delta.changedDirs.size());
+    for (const uint32_t ino : delta.changedDirs) {
+        changedDirs.push_back(toFileId(ino));
+    }
+
+    std::vector<ScanProtocol::StatsEntry> stats;
+    stats.reserve(delta.changedStats.size());
+    for (const Ext4ScannerEngine::InodeStats& s : delta.changedStats) {
+        ScanProtocol::StatsEntry e{};
+        e.fileId = s.ino;
+        e.size = s.stats.size;
+        e.modificationTime = s.stats.modificationTime;
+        e.flags = (s.stats.isDir ? ScanProtocol::kStatsIsDir : 0) | (s.stats.isSymlink ? ScanProtocol::kStatsIsSymlink : 0);
+        stats.push_back(e);
+    }
+
+    // An entry's inode may have been somewhere else before, so every entry counts as changed
+    if (!writer.writeHello(db.records.size(), sizeof(Ext4ScannerEngine::FileRecord), ScanProtocol::kHelloDelta) ||
+        !writer.writeRecords(db.records, db.stringPool) ||
+        !writer.writeRecordIds(ScanProtocol::FrameType::FileIds, db.inodeNumbers) ||
+        !writer.writeRecordIds(ScanProtocol::FrameType::ParentFileIds, parentIds) ||
+        !writer.writeIdList(ScanProtocol::FrameType::Changed, db.inodeNumbers) ||
+        !writer.writeIdList(ScanProtocol::FrameType::ChangedDirs, changedDirs) ||
+        !writer.writeStats(stats) ||
+        !writer.writeCheckpoint(delta.checkpoint) ||
+        !writer.writeEnd()) {
+        std::cerr << "Error: failed writing scan stream to stdout.\n";
+        return 3;
+    }
+
+    return 0;
+}
+
 /**
  * The Helper:
  * 1. Takes a device path and file system type as arguments.
  * 2. Scans the specified partition.
- * 3. Dumps the results to stdout in binary format.
+ * 3. Dumps the results to stdout in binary format (or as framed batches with --stream).
  */
 int main(int argc, char* argv[]) {
     // Allow "--version" without requiring other args
@@ -227,13 +559,49 @@ int main(int argc, char* argv[]) {
         return 0;
     }
 
-    if (argc != 3) {
+    // Optional "--stream" ahead of the positional args selects the framed output format
+    const bool streaming = argc >= 2 && std::string_view(argv[1]) == "--stream";
+    int argBase = streaming ? 2 : 1;
+
+    auto parseU64 = [](const char* s, uint64_t& out) {
+        char* end = nullptr;
+        errno = 0;
+        out = std::strtoull(s, &end, 10);
+        return errno == 0 && end != s && *end == '\0';
+    };
+
+    // "--usn-since <journalId> <nextUsn> <journalMft>" (streaming, NTFS only): incremental scan
+    std::optional<NtfsScannerEngine::UsnCheckpoint> usnSince;
+    if (streaming && argc >= argBase + 4 && std::string_view(argv[argBase]) == "--usn-since") {
+        NtfsScannerEngine::UsnCheckpoint since;
+        if (!parseU64(argv[argBase + 1], since.journalId) || !parseU64(argv[argBase + 2], since.nextUsn) ||
+            !parseU64(argv[argBase + 3], since.journalMftIndex)) {
+            printUsage(argv[0]);
+            return 64; // EX_USAGE
+        }
+        usnSince = since;
+        argBase += 4;
+    }
+
+    // "--changed-since <volumeId> <unixSeconds>" (streaming, EXT4 only): incremental scan
+    std::optional<Ext4ScannerEngine::ChangeCheckpoint> changedSince;
+    if (streaming && !usnSince && argc >= argBase + 3 && std::string_view(argv[argBase]) == "--changed-since") {
+        Ext4ScannerEngine::ChangeCheckpoint since;
+        if (!parseU64(argv[argBase + 1], since.volumeId) || !parseU64(argv[argBase + 2], since.changedSince)) {
+            printUsage(argv[0]);
+            return 64; // EX_USAGE
+        }
+        changedSince = since;
+        argBase += 3;
+    }
+
+    if (argc != argBase + 2) {
         printUsage(argv[0]);
         return 64; // EX_USAGE
     }
 
-    std::string devicePathInput = argv[1];
-    std::string_view fsType = argv[2];
+    std::string devicePathInput = argv[argBase];
+    std::string_view fsType = argv[argBase + 1];
 
     if (!isAllowedFsType(fsType)) {
         std::cerr << "Error: unsupported fsType '" << fsType << "'.\n";
@@ -251,11 +619,27 @@ int main(int argc, char* argv[]) {
 
     std::cerr << "Scanning " << devicePath << " (" << fsType << ")\n";
 
+    if (usnSince && fsType != "ntfs") {
+        std::cerr << "Error: --usn-since is only supported for ntfs.\n";
+        return 64; // EX_USAGE
+    }
+
     if (fsType == "ntfs") {
-        return scanNtfs(devicePath);
+        if (usnSince) {
+            return scanNtfsDelta(devicePath, *usnSince);
+        }
+        return streaming ? scanNtfsStreaming(devicePath) : scanNtfs(devicePath);
+    }
+    if (changedSince && fsType != "ext4") {
+        std::cerr << "Error: --changed-since is only supported for ext4.\n";
+        return 64; // EX_USAGE
     }
+
     if (fsType == "ext4") {
-        return scanExt4(devicePath);
+        if (changedSince) {
+            return scanExt4Delta(devicePath, *changedSince);
+        }
+        return streaming ? scanExt4Streaming(devicePath) : scanExt4(devicePath);
     }
 
     return 64;
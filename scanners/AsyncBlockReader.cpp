@@ -0,0 +1,336 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026  Reikooters <https://github.com/Reikooters>
+
+#include "AsyncBlockReader.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef KERYTHING_HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+#ifdef KERYTHING_HAVE_LIBURING
+struct AsyncBlockReader::Uring {
+    io_uring ring{};
+    size_t inFlight = 0;
+};
+#else
+struct AsyncBlockReader::Uring {};
+#endif
+
+void AsyncBlockReader::AlignedFree::operator()(char* p) const {
+    std::free(p);
+}
+
+AsyncBlockReader::AsyncBlockReader(std::vector<Extent> extents, unsigned depth, bool direct)
+    : m_extents(std::move(extents)),
+      m_depth(std::max(depth, 1u)),
+      m_direct(direct) {}
+
+AsyncBlockReader::~AsyncBlockReader() {
+    if (m_reader.joinable()) {
+        {
+            std::lock_guard lock(m_mutex);
+            m_stop = true;
+        }
+        m_changed.notify_all();
+        m_reader.join();
+    }
+
+    stopUring();
+
+    if (m_fd >= 0) ::close(m_fd);
+    if (m_bufferedFd >= 0) ::close(m_bufferedFd);
+}
+
+bool AsyncBlockReader::open(const std::string& devicePath) {
+    m_bufferedFd = ::open(devicePath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (m_bufferedFd < 0) {
+        return false;
+    }
+
+    if (m_direct) {
+        m_fd = ::open(devicePath.c_str(), O_RDONLY | O_CLOEXEC | O_DIRECT);
+    }
+    if (m_fd < 0) {
+        m_directFailed = true;
+    }
+
+    size_t maxLength = 0;
+    for (const Extent& e : m_extents) {
+        maxLength = std::max(maxLength, e.length);
+    }
+
+    // Room for the alignment padding on both ends
+    const size_t capacity = ((maxLength + kAlign - 1) / kAlign + 1) * kAlign;
+    const unsigned slots = static_cast<unsigned>(std::min<size_t>(m_depth, std::max<size_t>(m_extents.size(), 1)));
+
+    m_slots.assign(slots, Slot{});
+    for (Slot& slot : m_slots) {
+        auto* p = static_cast<char*>(std::aligned_alloc(kAlign, capacity));
+        if (!p) {
+            return false;
+        }
+        m_buffers.emplace_back(p);
+        slot.buffer = p;
+    }
+    m_depth = slots;
+
+    if (startUring()) {
+        return true;
+    }
+
+    m_reader = std::thread([this] { readerThread(); });
+    return true;
+}
+
+const char* AsyncBlockReader::backendName() const {
+    return m_uring ? "io_uring" : "pread";
+}
+
+void AsyncBlockReader::widen(size_t i, uint64_t& alignedOffset, size_t& head, size_t& alignedLength) const {
+    const Extent& e = m_extents[i];
+    alignedOffset = e.offset & ~static_cast<uint64_t>(kAlign - 1);
+    head = static_cast<size_t>(e.offset - alignedOffset);
+    alignedLength = (head + e.length + kAlign - 1) & ~(kAlign - 1);
+}
+
+void AsyncBlockReader::finish(size_t i, Slot& slot, long long bytes) const {
+    const Extent& e = m_extents[i];
+
+    if (bytes < 0) {
+        slot.ok = false;
+        slot.got = 0;
+        return;
+    }
+
+    const auto read = static_cast<size_t>(bytes);
+    slot.ok = true;
+    slot.got = read > slot.head ? std::min(e.length, read - slot.head) : 0;
+}
+
+void AsyncBlockReader::readInto(size_t i, Slot& slot) {
+    uint64_t offset = 0;
+    size_t length = 0;
+    widen(i, offset, slot.head, length);
+
+    for (;;) {
+        const bool direct = !m_directFailed;
+        const int fd = direct ? m_fd : m_bufferedFd;
+
+        size_t done = 0;
+        bool failed = false;
+        while (done < length) {
+            const ssize_t n = ::pread(fd, slot.buffer + done, length - done, static_cast<off_t>(offset + done));
+            if (n > 0) {
+                done += static_cast<size_t>(n);
+                continue;
+            }
+            if (n == 0) {
+                break; // end of device
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            failed = true;
+            break;
+        }
+
+        if (failed && direct && errno == EINVAL) {
+            // The device wants a different alignment (or no direct I/O at all)
+            std::cerr << "Direct reads rejected, falling back to buffered reads.\n";
+            m_directFailed = true;
+            continue;
+        }
+
+        finish(i, slot, failed ? -1 : static_cast<long long>(done));
+        return;
+    }
+}
+
+// --- Begin: pread backend ---
+
+void AsyncBlockReader::readerThread() {
+    for (size_t i = 0; i < m_extents.size(); ++i) {
+        Slot& slot = m_slots[i % m_depth];
+
+        {
+            std::unique_lock lock(m_mutex);
+            m_changed.wait(lock, [&] { return m_stop || i < m_released + m_depth; });
+            if (m_stop) {
+                return;
+            }
+        }
+
+        readInto(i, slot);
+
+        {
+            std::lock_guard lock(m_mutex);
+            slot.ready = true;
+        }
+        m_changed.notify_all();
+    }
+}
+
+// --- End: pread backend ---
+
+// --- Begin: io_uring backend ---
+
+#ifdef KERYTHING_HAVE_LIBURING
+
+bool AsyncBlockReader::startUring() {
+    auto uring = std::make_unique<Uring>();
+    if (io_uring_queue_init(m_depth, &uring->ring, 0) < 0) {
+        return false; // e.g. disabled by kernel.io_uring_disabled
+    }
+    m_uring = std::move(uring);
+
+    const size_t initial = std::min<size_t>(m_depth, m_extents.size());
+    for (size_t i = 0; i < initial; ++i) {
+        submitUring(i);
+    }
+    return true;
+}
+
+void AsyncBlockReader::submitUring(size_t i) {
+    Slot& slot = m_slots[i % m_depth];
+    slot.ready = false;
+
+    uint64_t offset = 0;
+    size_t length = 0;
+    widen(i, offset, slot.head, length);
+
+    io_uring_sqe* sqe = io_uring_get_sqe(&m_uring->ring);
+    if (!sqe) {
+        // Can't happen with one entry per slot, but don't lose the read
+        readInto(i, slot);
+        slot.ready = true;
+        return;
+    }
+
+    const int fd = m_directFailed ? m_bufferedFd : m_fd;
+    io_uring_prep_read(sqe, fd, slot.buffer, static_cast<unsigned>(length), offset);
+    io_uring_sqe_set_data(sqe, reinterpret_cast<void*>(static_cast<uintptr_t>(i)));
+    io_uring_submit(&m_uring->ring);
+
+    ++m_uring->inFlight;
+}
+
+bool AsyncBlockReader::waitUring(size_t i) {
+    Slot& wanted = m_slots[i % m_depth];
+
+    while (!wanted.ready) {
+        io_uring_cqe* cqe = nullptr;
+        const int rc = io_uring_wait_cqe(&m_uring->ring, &cqe);
+        if (rc == -EINTR) continue;
+        if (rc < 0) return false;
+
+        const auto j = static_cast<size_t>(reinterpret_cast<uintptr_t>(io_uring_cqe_get_data(cqe)));
+        const int res = cqe->res;
+        io_uring_cqe_seen(&m_uring->ring, cqe);
+        --m_uring->inFlight;
+
+        Slot& slot = m_slots[j % m_depth];
+
+        uint64_t offset = 0;
+        size_t length = 0;
+        widen(j, offset, slot.head, length);
+
+        if (res == -EINVAL && m_fd >= 0) {
+            // Possibly several requests were queued on the direct fd; redo each one buffered
+            if (!m_directFailed) {
+                std::cerr << "Direct reads rejected, falling back to buffered reads.\n";
+                m_directFailed = true;
+            }
+            readInto(j, slot);
+        } else if (res >= 0 && static_cast<size_t>(res) < length) {
+            // Short read (end of device or an interrupted request): finish it synchronously
+            readInto(j, slot);
+        } else {
+            finish(j, slot, res);
+        }
+
+        slot.ready = true;
+    }
+
+    return true;
+}
+
+void AsyncBlockReader::stopUring() {
+    if (!m_uring) return;
+
+    // Buffers must outlive the requests still queued on them
+    while (m_uring->inFlight > 0) {
+        io_uring_cqe* cqe = nullptr;
+        const int rc = io_uring_wait_cqe(&m_uring->ring, &cqe);
+        if (rc == -EINTR) continue;
+        if (rc < 0) break;
+        io_uring_cqe_seen(&m_uring->ring, cqe);
+        --m_uring->inFlight;
+    }
+
+    io_uring_queue_exit(&m_uring->ring);
+    m_uring.reset();
+}
+
+#else
+
+bool AsyncBlockReader::startUring() { return false; }
+void AsyncBlockReader::submitUring(size_t) {}
+bool AsyncBlockReader::waitUring(size_t) { return false; }
+void AsyncBlockReader::stopUring() {}
+
+#endif // KERYTHING_HAVE_LIBURING
+
+// --- End: io_uring backend ---
+
+bool AsyncBlockReader::next(Block& out) {
+    if (m_handedOut) {
+        m_handedOut = false;
+        const size_t released = m_next - 1;
+
+        if (m_uring) {
+            const size_t refill = released + m_depth;
+            if (refill < m_extents.size()) {
+                submitUring(refill);
+            }
+        } else {
+            {
+                std::lock_guard lock(m_mutex);
+                m_slots[released % m_depth].ready = false;
+                m_released = m_next;
+            }
+            m_changed.notify_all();
+        }
+    }
+
+    if (m_next >= m_extents.size()) {
+        return false;
+    }
+
+    Slot& slot = m_slots[m_next % m_depth];
+
+    if (m_uring) {
+        if (!waitUring(m_next)) {
+            m_failed = true;
+            return false;
+        }
+    } else {
+        std::unique_lock lock(m_mutex);
+        m_changed.wait(lock, [&] { return slot.ready; });
+    }
+
+    out.index = m_next;
+    out.data = slot.buffer + slot.head;
+    out.size = slot.got;
+    out.ok = slot.ok;
+
+    ++m_next;
+    m_handedOut = true;
+    return true;
+}
@@ -0,0 +1,124 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026  Reikooters <https://github.com/Reikooters>
+
+#ifndef KERYTHING_ASYNCBLOCKREADER_H
+#define KERYTHING_ASYNCBLOCKREADER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Reads a fixed list of device extents in order while keeping several of them in flight, so the
+ * caller can parse one extent while the next ones are still loading.
+ *
+ * With liburing available (KERYTHING_HAVE_LIBURING) the reads are queued on an io_uring; otherwise,
+ * or if the kernel refuses a ring, a reader thread issues them with pread.
+ *
+ * With direct I/O the device is opened with O_DIRECT (so a one-off scan doesn't push everything else
+ * out of the page cache). Reads are then widened to 4 KiB alignment internally; if the device
+ * rejects direct reads, the reader falls back to buffered ones.
+ */
+class AsyncBlockReader {
+public:
+    struct Extent {
+        uint64_t offset; // byte offset on the device
+        size_t length;   // bytes
+    };
+
+    struct Block {
+        size_t index = 0;          // into the extent list
+        char* data = nullptr;      // valid until the next call to next(); may be modified in place
+        size_t size = 0;           // bytes actually read (short at the end of the device)
+        bool ok = false;
+    };
+
+    /**
+     * @param depth Number of extents in flight (and buffers), at least 1.
+     */
+    AsyncBlockReader(std::vector<Extent> extents, unsigned depth, bool direct);
+    ~AsyncBlockReader();
+
+    AsyncBlockReader(const AsyncBlockReader&) = delete;
+    AsyncBlockReader& operator=(const AsyncBlockReader&) = delete;
+
+    /**
+     * Opens the device and starts reading ahead.
+     * @return false if the device can't be opened.
+     */
+    bool open(const std::string& devicePath);
+
+    /**
+     * Waits for the next extent (in list order) and hands it out; the previously returned block's
+     * buffer is recycled for a later read.
+     *
+     * @return false once every extent has been returned, or if waiting for a read failed (see failed()).
+     */
+    bool next(Block& out);
+
+    // True if next() stopped early because the reads could no longer be waited for; the caller
+    // then hasn't seen every extent
+    [[nodiscard]] bool failed() const { return m_failed; }
+
+    // "io_uring" or "pread", for logging
+    [[nodiscard]] const char* backendName() const;
+
+private:
+    static constexpr size_t kAlign = 4096;
+
+    struct Slot {
+        char* buffer = nullptr;
+        size_t head = 0;   // data offset inside buffer (alignment padding)
+        size_t got = 0;    // bytes of the extent that were read
+        bool ok = false;
+        bool ready = false; // guarded by m_mutex (pread backend)
+    };
+
+    struct AlignedFree {
+        void operator()(char* p) const;
+    };
+
+    // Synchronous read of extent i into slot; used by the pread thread and as the io_uring fallback
+    void readInto(size_t i, Slot& slot);
+    void widen(size_t i, uint64_t& alignedOffset, size_t& head, size_t& alignedLength) const;
+    void finish(size_t i, Slot& slot, long long bytes) const;
+
+    void readerThread();
+
+    bool startUring();
+    void submitUring(size_t i);
+    bool waitUring(size_t i);
+    void stopUring();
+
+    std::vector<Extent> m_extents;
+    unsigned m_depth = 1;
+    bool m_direct = true;
+
+    int m_fd = -1;         // O_DIRECT if m_direct (and accepted)
+    int m_bufferedFd = -1; // used once direct reads get rejected
+    bool m_directFailed = false;
+
+    std::vector<std::unique_ptr<char, AlignedFree>> m_buffers;
+    std::vector<Slot> m_slots;
+    size_t m_next = 0; // next extent to hand out
+    bool m_handedOut = false; // slot of m_next - 1 is held by the caller
+    bool m_failed = false;
+
+    // pread backend
+    std::thread m_reader;
+    std::mutex m_mutex;
+    std::condition_variable m_changed;
+    size_t m_released = 0; // extents whose slots the caller has given back
+    bool m_stop = false;
+
+    // io_uring backend
+    struct Uring;
+    std::unique_ptr<Uring> m_uring;
+};
+
+#endif //KERYTHING_ASYNCBLOCKREADER_H
@@ -2,12 +2,62 @@
 // Copyright (C) 2026  Reikooters <https://github.com/Reikooters>
 
 #include "Ext4ScannerEngine.h"
+#include "../ScannerUtils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <thread>
 
 namespace Ext4ScannerEngine {
 
+    // One name found in a directory block: the record it becomes is decided at merge time
+    struct DirEntryName {
+        uint32_t ino;
+        uint32_t parentIno;
+        uint32_t nameOffset; // into the owning NameBatch's stringPool
+        uint16_t nameLen;
+    };
+
+    // Names found by one unit of work, in the order they were read
+    struct NameBatch {
+        std::vector<DirEntryName> names;
+        std::vector<char> stringPool;
+    };
+
+    // One data block of a directory, found by the inode pass and read by the directory pass
+    struct DirBlock {
+        uint64_t physBlock;
+        uint32_t dirIno;
+    };
+
+    // Phase one output for the block groups [firstGroup, endGroup)
+    struct GroupRange {
+        uint32_t firstGroup = 0;
+        uint32_t endGroup = 0;
+
+        std::vector<InodeStats> stats; // in inode order
+        std::vector<DirBlock> dirBlocks;
+        NameBatch inlineNames; // directories stored inside their inode (no blocks to schedule)
+
+        bool failed = false;
+    };
+
+    // Phase two output for the sorted dir blocks [begin, end)
+    struct DirBlockSlice {
+        size_t begin = 0;
+        size_t end = 0;
+
+        NameBatch found;
+    };
+
     // Helper struct to pass multiple pieces of data to dirCallback
     struct ScanContext {
-        Ext4Database& db;
+        NameBatch& out;
         uint32_t maxInodes;
     };
 
@@ -41,37 +91,380 @@ namespace Ext4ScannerEngine {
             return 0;
         }
 
-        // Check if this inode already has a record (e.g. from another hard link)
-        auto it = ctx->db.inodeToRecordIdx.find(dirent->inode);
-        uint32_t recordIndex;
+        // Hard links (an inode already named elsewhere) are resolved when the batches get merged
+        NameBatch& out = ctx->out;
+        out.names.push_back(DirEntryName{dirent->inode, dir_ino, static_cast<uint32_t>(out.stringPool.size()), len});
+        out.stringPool.insert(out.stringPool.end(), dirent->name, dirent->name + len);
+
+        return 0;
+    }
 
-        if (it == ctx->db.inodeToRecordIdx.end()) {
-            // "Birth" the record here because we have a name
-            FileRecord newRecord{};
-            newRecord.parentRecordIdx = 0xFFFFFFFF;
+    /**
+     * Runs work(i, fs) for every i in [0, count) on one thread per handle, and done(i) on the
+     * calling thread in index order as the items finish. tick() is called every 100ms while
+     * waiting, for progress reports.
+     */
+    template<typename Work, typename Done, typename Tick>
+    static void runOrdered(const std::vector<ext2_filsys>& handles, size_t count, Work&& work, Done&& done, Tick&& tick) {
+        std::atomic<size_t> next{0};
+        std::vector<char> finished(count, 0);
+        std::mutex mutex;
+        std::condition_variable finishedCv;
+
+        std::vector<std::thread> workers;
+        workers.reserve(handles.size());
+        for (ext2_filsys fs : handles) {
+            workers.emplace_back([&, fs] {
+                for (;;) {
+                    const size_t i = next.fetch_add(1, std::memory_order_relaxed);
+                    if (i >= count) {
+                        return;
+                    }
+
+                    work(i, fs);
+
+                    {
+                        std::lock_guard lock(mutex);
+                        finished[i] = 1;
+                    }
+                    finishedCv.notify_all();
+                }
+            });
+        }
 
-            ctx->db.records.push_back(newRecord);
-            recordIndex = ctx->db.records.size() - 1;
-            ctx->db.inodeToRecordIdx[dirent->inode] = recordIndex;
+        for (size_t i = 0; i < count; ++i) {
+            for (;;) {
+                std::unique_lock lock(mutex);
+                if (finishedCv.wait_for(lock, std::chrono::milliseconds(100), [&] { return finished[i] != 0; })) {
+                    break;
+                }
+                lock.unlock();
+                tick();
+            }
+            done(i);
+        }
 
-            // Keep the parallel vector in sync
-            ctx->db.tempParentInodes.push_back(dir_ino);
-        } else {
-            recordIndex = it->second;
-            // Update the parent just in case (though usually doesn't change for the same name)
-            ctx->db.tempParentInodes[recordIndex] = dir_ino;
+        for (std::thread& w : workers) {
+            w.join();
         }
+    }
 
-        // Store the name in the string pool
-        FileRecord& record = ctx->db.records[recordIndex];
-        record.nameOffset = ctx->db.stringPool.size();
-        record.nameLen = len;
-        ctx->db.stringPool.insert(ctx->db.stringPool.end(), dirent->name, dirent->name + len);
+    struct BlockMapContext {
+        std::vector<DirBlock>& out;
+        uint32_t dirIno;
+    };
 
+    static int collectDirBlock(ext2_filsys, blk64_t* blocknr, e2_blkcnt_t, blk64_t, int, void* priv_data) {
+        auto* ctx = static_cast<BlockMapContext*>(priv_data);
+        if (*blocknr != 0) { // holes
+            ctx->out.push_back(DirBlock{*blocknr, ctx->dirIno});
+        }
         return 0;
     }
 
-    std::optional<Ext4Database> parseInodes(const std::string& devicePath, ProgressCallback progressCb) {
+    static FileStats statsOf(const ext2_inode& inode) {
+        FileStats stats{};
+        stats.size = EXT2_I_SIZE(&inode);
+        stats.modificationTime = inode.i_mtime;
+        stats.isDir = LINUX_S_ISDIR(inode.i_mode);
+        stats.isSymlink = LINUX_S_ISLNK(inode.i_mode);
+        return stats;
+    }
+
+    static void setStats(FileRecord& record, const FileStats& stats) {
+        record.size = stats.size;
+        record.modificationTime = stats.modificationTime;
+        record.isDir = stats.isDir;
+        record.isSymlink = stats.isSymlink;
+    }
+
+    // Phase one: the inode tables of one block group range. Directory contents aren't read here,
+    // only their block maps (inline directories excepted, they're already in the inode).
+    // With changedSince set, only inodes with a ctime or mtime at or after it are kept (delta scans).
+    static void scanGroupRange(ext2_filsys fs, GroupRange& range, std::atomic<uint64_t>& usedInodesSeen,
+                               uint64_t changedSince = 0) {
+        const uint32_t inodesPerGroup = fs->super->s_inodes_per_group;
+        const uint64_t endIno = static_cast<uint64_t>(range.endGroup) * inodesPerGroup;
+
+        int bufferBlocks = 4096;
+
+        ext2_inode_scan inodeScan;
+        if (ext2fs_open_inode_scan(fs, bufferBlocks, &inodeScan) != 0) {
+            range.failed = true;
+            return;
+        }
+
+        if (range.firstGroup > 0 && ext2fs_inode_scan_goto_blockgroup(inodeScan, static_cast<int>(range.firstGroup)) != 0) {
+            ext2fs_close_inode_scan(inodeScan);
+            range.failed = true;
+            return;
+        }
+
+        ext2_ino_t ino;
+        ext2_inode inode;
+
+        ScanContext ctx{range.inlineNames, fs->super->s_inodes_count};
+
+        uint64_t seenSinceReport = 0;
+
+        while (ext2fs_get_next_inode(inodeScan, &ino, &inode) == 0 && ino != 0 && ino <= endIno) {
+            if (inode.i_links_count == 0) {
+                continue;
+            }
+
+            static constexpr uint64_t kProgressEvery = 4096;
+            if (++seenSinceReport == kProgressEvery) {
+                usedInodesSeen.fetch_add(seenSinceReport, std::memory_order_relaxed);
+                seenSinceReport = 0;
+            }
+
+            // A rename, link or unlink updates the ctime of the inode (and mtime + ctime of its directory)
+            if (changedSince != 0 && inode.i_ctime < changedSince && inode.i_mtime < changedSince) {
+                continue;
+            }
+
+            range.stats.push_back(InodeStats{ino, statsOf(inode)});
+
+            if (LINUX_S_ISDIR(inode.i_mode)) {
+                if (inode.i_flags & EXT4_INLINE_DATA_FL) {
+                    // This will trigger dirCallback for every file inside this directory
+                    ext2fs_dir_iterate2(fs, ino, 0, nullptr, dirCallback, &ctx);
+                } else {
+                    // Mapping extents only reads extent tree blocks, which small directories don't have
+                    BlockMapContext mapCtx{range.dirBlocks, ino};
+                    ext2fs_block_iterate3(fs, ino, BLOCK_FLAG_READ_ONLY | BLOCK_FLAG_DATA_ONLY, nullptr,
+                                          collectDirBlock, &mapCtx);
+                }
+            }
+        }
+
+        usedInodesSeen.fetch_add(seenSinceReport, std::memory_order_relaxed);
+        ext2fs_close_inode_scan(inodeScan);
+    }
+
+    // Walks the entries of one raw (little-endian) directory block, like ext2fs_dir_iterate2 does
+    static void parseDirBlock(ext2_filsys fs, uint32_t dirIno, char* block, ScanContext& ctx) {
+        const int blocksize = fs->blocksize;
+
+        int offset = 0;
+        while (offset + 8 <= blocksize) {
+            auto* dirent = reinterpret_cast<ext2_dir_entry*>(block + offset);
+
+            unsigned int recLen = 0;
+            if (ext2fs_get_rec_len(fs, dirent, &recLen) != 0 || recLen < 8 || (recLen & 3) != 0 ||
+                offset + static_cast<int>(recLen) > blocksize || (dirent->name_len & 0xFF) + 8u > recLen) {
+                return; // corrupt block: keep what was read so far
+            }
+
+            dirCallback(dirIno, 0, dirent, offset, blocksize, block, &ctx);
+            offset += static_cast<int>(recLen);
+        }
+    }
+
+    // Phase two: read one slice of the directory blocks in physical order. Nearby blocks are read
+    // together (gaps included) in large requests, so the disk streams instead of seeking per block.
+    static void readDirBlockSlice(ext2_filsys fs, const std::vector<DirBlock>& blocks, DirBlockSlice& slice) {
+        const auto blocksize = static_cast<size_t>(fs->blocksize);
+
+        static constexpr size_t kMaxRequestBytes = 4u << 20;
+        static constexpr uint64_t kMaxGapBlocks = 16; // cheaper to read through than to seek over
+        const size_t maxRequestBlocks = std::max<size_t>(1, kMaxRequestBytes / blocksize);
+
+        std::vector<char> buffer(maxRequestBlocks * blocksize);
+        ScanContext ctx{slice.found, fs->super->s_inodes_count};
+
+        size_t i = slice.begin;
+        while (i < slice.end) {
+            const uint64_t first = blocks[i].physBlock;
+
+            // Extend the request while the next block is close enough and still fits
+            size_t j = i + 1;
+            while (j < slice.end && blocks[j].physBlock - blocks[j - 1].physBlock <= kMaxGapBlocks &&
+                   blocks[j].physBlock - first < maxRequestBlocks) {
+                ++j;
+            }
+
+            const auto count = static_cast<int>(blocks[j - 1].physBlock - first + 1);
+            [[maybe_unused]] const bool readAll = io_channel_read_blk64(fs->io, first, count, buffer.data()) == 0;
+
+            for (size_t k = i; k < j; ++k) {
+                char* block = buffer.data() + (blocks[k].physBlock - first) * blocksize;
+
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+                // Raw blocks are little-endian; let libext2fs swap (and re-read) them
+                if (ext2fs_read_dir_block4(fs, blocks[k].physBlock, block, 0, blocks[k].dirIno) != 0) {
+                    continue;
+                }
+#else
+                // A failed multi-block read is retried block by block, skipping the bad ones
+                if (!readAll && io_channel_read_blk64(fs->io, blocks[k].physBlock, 1, block) != 0) {
+                    continue;
+                }
+#endif
+
+                parseDirBlock(fs, blocks[k].dirIno, block, ctx);
+            }
+
+            i = j;
+        }
+    }
+
+    // Appends a batch of names to db, birthing records for inodes seen for the first time. Batches are
+    // merged in a fixed order, so the result doesn't depend on thread timing.
+    static void mergeNames(Ext4Database& db, NameBatch& batch) {
+        const auto poolBase = static_cast<uint32_t>(db.stringPool.size());
+        db.stringPool.insert(db.stringPool.end(), batch.stringPool.begin(), batch.stringPool.end());
+
+        for (const DirEntryName& e : batch.names) {
+            uint32_t& slot = db.inodeToRecordIdx[e.ino];
+            uint32_t recordIndex;
+
+            if (slot == 0) {
+                // "Birth" the record here because we have a name
+                FileRecord newRecord{};
+                newRecord.parentRecordIdx = 0xFFFFFFFF;
+
+                db.records.push_back(newRecord);
+                recordIndex = static_cast<uint32_t>(db.records.size() - 1);
+                slot = recordIndex + 1;
+
+                // Keep the parallel vectors in sync
+                db.inodeNumbers.push_back(e.ino);
+                db.tempParentInodes.push_back(e.parentIno);
+            } else {
+                // Another hard link of an inode we already have: the last name seen wins
+                recordIndex = slot - 1;
+                db.tempParentInodes[recordIndex] = e.parentIno;
+            }
+
+            FileRecord& record = db.records[recordIndex];
+            record.nameOffset = poolBase + e.nameOffset;
+            record.nameLen = e.nameLen;
+        }
+
+        // Free the batch right away; the merged copy is what's kept
+        std::vector<DirEntryName>().swap(batch.names);
+        std::vector<char>().swap(batch.stringPool);
+    }
+
+    // Keeps the checkpoint this far behind the clock, for changes still in the page cache (mounted volumes)
+    static constexpr uint64_t kCheckpointSlackSecs = 120;
+
+    static uint64_t volumeIdOf(ext2_filsys fs) {
+        uint64_t id = 0;
+        std::memcpy(&id, fs->super->s_uuid, sizeof(id));
+        return std::max<uint64_t>(id, 1); // 0 means "no checkpoint" to the receiver
+    }
+
+    static ChangeCheckpoint checkpointNow(ext2_filsys fs) {
+        const auto now = static_cast<uint64_t>(std::time(nullptr));
+        return ChangeCheckpoint{volumeIdOf(fs), now > kCheckpointSlackSecs ? now - kCheckpointSlackSecs : 1};
+    }
+
+    // Scan threads: one per core by default, but a handle per thread means a separate
+    // read cache each, and past a point the device is the limit anyway. Spinning disks get
+    // one, since parallel readers would only make the head seek between them.
+    static unsigned scanThreadCount(const std::string& devicePath, unsigned threads, uint32_t groupCount) {
+        static constexpr unsigned kMaxThreads = 16;
+        if (threads == 0) {
+            threads = ScannerUtils::isRotational(devicePath)
+                ? 1u
+                : std::clamp(std::thread::hardware_concurrency(), 1u, kMaxThreads);
+        }
+        return std::clamp(threads, 1u, std::max(groupCount, 1u));
+    }
+
+    // Several ranges per thread so a few dense groups don't leave the others idle. Groups whose inode
+    // table was never initialized (INODE_UNINIT) hold no inodes in use and aren't part of any range.
+    static std::vector<GroupRange> planGroupRanges(ext2_filsys fs, unsigned threads) {
+        const uint32_t groupCount = fs->group_desc_count;
+        const bool lazyGroups = ext2fs_has_group_desc_csum(fs) != 0; // the flag is only kept with checksums
+
+        std::vector<char> used(groupCount, 1);
+        uint32_t usedGroups = groupCount;
+        if (lazyGroups) {
+            for (uint32_t g = 0; g < groupCount; ++g) {
+                if (ext2fs_bg_flags_test(fs, g, EXT2_BG_INODE_UNINIT)) {
+                    used[g] = 0;
+                    --usedGroups;
+                }
+            }
+        }
+
+        const uint32_t rangeCount = std::clamp(threads * 8u, 1u, std::max(usedGroups, 1u));
+        const uint32_t groupsPerRange = std::max(1u, (usedGroups + rangeCount - 1) / rangeCount);
+
+        std::vector<GroupRange> ranges;
+        uint32_t g = 0;
+        while (g < groupCount) {
+            if (!used[g]) {
+                ++g;
+                continue;
+            }
+
+            // Up to groupsPerRange initialized groups in a row
+            GroupRange range;
+            range.firstGroup = g;
+            while (g < groupCount && used[g] && g - range.firstGroup < groupsPerRange) {
+                ++g;
+            }
+            range.endGroup = g;
+            ranges.push_back(std::move(range));
+        }
+        return ranges;
+    }
+
+    // Each worker gets its own handle (libext2fs handles aren't thread-safe); fs is the first one
+    static std::vector<ext2_filsys> openHandles(ext2_filsys fs, const std::string& devicePath, unsigned threads) {
+        std::vector<ext2_filsys> handles{fs};
+        for (unsigned t = 1; t < threads; ++t) {
+            ext2_filsys extra;
+            if (ext2fs_open(devicePath.c_str(), 0, 0, 0, unix_io_manager, &extra) != 0) {
+                break; // scan with the handles we have
+            }
+            handles.push_back(extra);
+        }
+        return handles;
+    }
+
+    static void closeHandles(const std::vector<ext2_filsys>& handles) {
+        for (ext2_filsys h : handles) {
+            ext2fs_close(h);
+        }
+    }
+
+    /**
+     * Phase two: sorts dirBlocks and reads them in physical block order, in slices spread over the
+     * handles. merge(found, blocksDone) runs on the calling thread for each slice, in block order;
+     * tick() runs while waiting.
+     */
+    template<typename Merge, typename Tick>
+    static void readDirBlocksInOrder(const std::vector<ext2_filsys>& handles, std::vector<DirBlock>& dirBlocks,
+                                     Merge&& merge, Tick&& tick) {
+        std::sort(dirBlocks.begin(), dirBlocks.end(), [](const DirBlock& a, const DirBlock& b) {
+            return a.physBlock < b.physBlock;
+        });
+
+        std::cerr << "Reading " << dirBlocks.size() << " directory blocks in disk order..." << std::endl;
+
+        // Slices of about 64 MiB of directory data each
+        const size_t blocksPerSlice = std::max<size_t>(1, (64u << 20) / static_cast<size_t>(handles.front()->blocksize));
+        std::vector<DirBlockSlice> slices;
+        for (size_t b = 0; b < dirBlocks.size(); b += blocksPerSlice) {
+            DirBlockSlice slice;
+            slice.begin = b;
+            slice.end = std::min(dirBlocks.size(), b + blocksPerSlice);
+            slices.push_back(std::move(slice));
+        }
+
+        runOrdered(handles, slices.size(),
+            [&](size_t i, ext2_filsys h) { readDirBlockSlice(h, dirBlocks, slices[i]); },
+            [&](size_t i) { merge(slices[i].found, slices[i].end); },
+            tick);
+    }
+
+    std::optional<Ext4Database> parseInodes(const std::string& devicePath, ProgressCallback progressCb,
+                                            BatchCallback batchCb, unsigned threads) {
         ext2_filsys fs;
         errcode_t retval = ext2fs_open(devicePath.c_str(), 0, 0, 0, unix_io_manager, &fs);
         if (retval) {
@@ -82,85 +475,287 @@ namespace Ext4ScannerEngine {
         const uint32_t totalInodes = fs->super->s_inodes_count;
         const uint32_t freeInodes  = fs->super->s_free_inodes_count;
         const uint32_t inodesInUse = (freeInodes <= totalInodes) ? (totalInodes - freeInodes) : totalInodes;
+        const uint32_t groupCount = fs->group_desc_count;
 
-        // Reserve a reasonable starting size for the map (1.5 million files)
-        int initialCapacity = 1500000;
+        threads = scanThreadCount(devicePath, threads, groupCount);
+        std::vector<GroupRange> ranges = planGroupRanges(fs, threads);
+        const std::vector<ext2_filsys> handles = openHandles(fs, devicePath, threads);
+
+        std::cerr << "Scanning " << groupCount << " block groups with " << handles.size() << " thread(s)..." << std::endl;
 
         Ext4Database db;
-        db.records.reserve(initialCapacity);
-        db.tempParentInodes.reserve(initialCapacity);
-        db.inodeToRecordIdx.reserve(initialCapacity);
-        db.inodeToFileStats.reserve(initialCapacity);
+
+        // Every name becomes a record, so the used inode count is a good estimate
+        db.records.reserve(static_cast<size_t>(inodesInUse) + 1);
+        db.inodeNumbers.reserve(static_cast<size_t>(inodesInUse) + 1);
+        db.tempParentInodes.reserve(static_cast<size_t>(inodesInUse) + 1);
+        db.tempInodeStats.reserve(inodesInUse);
 
         // Pre-reserve string pool based on heuristic (average 20 chars per filename)
-        db.stringPool.reserve(initialCapacity * 20);
+        db.stringPool.reserve(static_cast<size_t>(inodesInUse) * 20);
+
+        db.inodeSlots = totalInodes + 1;
+        db.inodeToRecordIdx.reset(static_cast<uint32_t*>(std::calloc(db.inodeSlots, sizeof(uint32_t))));
+        if (!db.inodeToRecordIdx) {
+            std::cerr << "Error: out of memory for " << totalInodes << " inode slots" << std::endl;
+            closeHandles(handles);
+            return std::nullopt;
+        }
 
         // Explicitly add the root entry first
         FileRecord rootRec{};
         rootRec.parentRecordIdx = 0xFFFFFFFF;
         db.records.push_back(rootRec);
-        db.inodeToRecordIdx[EXT2_ROOT_INO] = 0;
+        db.inodeToRecordIdx[EXT2_ROOT_INO] = 1;
+        db.inodeNumbers.push_back(EXT2_ROOT_INO);
         db.tempParentInodes.push_back(0);
 
-        int bufferBlocks = 4096;
+        // Progress: the inode pass counts as the first half, the directory pass as the second
+        const uint64_t halfTotal = inodesInUse / 2;
+        std::atomic<uint64_t> usedInodesSeen{0};
+
+        if (progressCb) {
+            progressCb(0, inodesInUse);
+        }
 
-        ext2_inode_scan scan;
-        ext2fs_open_inode_scan(fs, bufferBlocks, &scan);
+        bool failed = false;
 
-        ext2_ino_t ino;
-        ext2_inode inode;
+        // Phase one: inode tables, sequential within each range
+        std::vector<DirBlock> dirBlocks;
+        auto phaseStart = std::chrono::steady_clock::now();
+        auto reportInodes = [&]() {
+            if (progressCb) {
+                const uint64_t seen = std::min<uint64_t>(usedInodesSeen.load(std::memory_order_relaxed), inodesInUse);
+                progressCb(seen / 2, inodesInUse);
+            }
+        };
+
+        runOrdered(handles, ranges.size(),
+            [&](size_t i, ext2_filsys h) { scanGroupRange(h, ranges[i], usedInodesSeen); },
+            [&](size_t i) {
+                GroupRange& range = ranges[i];
+                if (range.failed) {
+                    failed = true;
+                    return;
+                }
+
+                db.tempInodeStats.insert(db.tempInodeStats.end(), range.stats.begin(), range.stats.end());
+                dirBlocks.insert(dirBlocks.end(), range.dirBlocks.begin(), range.dirBlocks.end());
+                mergeNames(db, range.inlineNames);
+
+                std::vector<InodeStats>().swap(range.stats);
+                std::vector<DirBlock>().swap(range.dirBlocks);
+
+                reportInodes();
+                if (batchCb) {
+                    batchCb(db);
+                }
+            },
+            reportInodes);
+
+        ScannerUtils::reportPhase("inodes", std::chrono::steady_clock::now() - phaseStart);
+
+        // Phase two: every directory block, in physical block order
+        if (!failed) {
+            phaseStart = std::chrono::steady_clock::now();
+            size_t blocksMerged = 0;
+            auto reportBlocks = [&]() {
+                if (progressCb && !dirBlocks.empty()) {
+                    progressCb(halfTotal + (inodesInUse - halfTotal) * blocksMerged / dirBlocks.size(), inodesInUse);
+                }
+            };
+
+            readDirBlocksInOrder(handles, dirBlocks,
+                [&](NameBatch& found, size_t blocksDone) {
+                    mergeNames(db, found);
+                    blocksMerged = blocksDone;
+
+                    reportBlocks();
+                    if (batchCb) {
+                        batchCb(db);
+                    }
+                },
+                reportBlocks);
+
+            ScannerUtils::reportPhase("directories", std::chrono::steady_clock::now() - phaseStart);
+        }
 
-        ScanContext ctx{db, totalInodes};
+        closeHandles(handles);
+
+        if (failed) {
+            std::cerr << "Error: failed to scan the inode tables of " << devicePath << std::endl;
+            return std::nullopt;
+        }
 
-        uint64_t usedInodesSeen = 0;
         if (progressCb) {
-            progressCb(0, inodesInUse);
+            progressCb(inodesInUse, inodesInUse);
         }
 
-        // Crawl the directory tree to discover all names and structure
-        // We start from the root inode (2) and let ext2fs_dir_iterate2 recurse
-        // through directories.
-        while (ext2fs_get_next_inode(scan, &ino, &inode) == 0 && ino != 0) {
-            if (inode.i_links_count == 0) {
-                continue;
-            }
+        // Resolve parent Inodes to parent Record Indices
+        {
+            ScannerUtils::PhaseTimer phase("resolveParents");
+            db.resolveParentPointers();
+        }
+
+        // Populate stats into records
+        {
+            ScannerUtils::PhaseTimer phase("stats");
+            db.populateStatsIntoRecords();
+        }
+
+        return db;
+    }
+
+    std::optional<ChangeCheckpoint> readChangeCheckpoint(const std::string& devicePath) {
+        ext2_filsys fs;
+        if (ext2fs_open(devicePath.c_str(), 0, 0, 0, unix_io_manager, &fs) != 0) {
+            return std::nullopt;
+        }
+
+        const ChangeCheckpoint checkpoint = checkpointNow(fs);
+        ext2fs_close(fs);
+        return checkpoint;
+    }
+
+    DeltaResult parseChangedSince(const std::string& devicePath, const ChangeCheckpoint& since, Ext4Delta& out,
+                                  ProgressCallback progressCb, unsigned threads) {
+        ext2_filsys fs;
+        errcode_t retval = ext2fs_open(devicePath.c_str(), 0, 0, 0, unix_io_manager, &fs);
+        if (retval) {
+            std::cerr << "Error: " << error_message(retval) << std::endl;
+            return DeltaResult::Failed;
+        }
+
+        // A checkpoint ahead of the clock means the clock was set back: timestamps can't be trusted
+        const ChangeCheckpoint now = checkpointNow(fs);
+        if (since.changedSince == 0 || since.volumeId != now.volumeId ||
+            since.changedSince > now.changedSince + 2 * kCheckpointSlackSecs) {
+            std::cerr << "No usable checkpoint for this volume, a full scan is needed." << std::endl;
+            ext2fs_close(fs);
+            return DeltaResult::NeedsFullScan;
+        }
+
+        const uint32_t totalInodes = fs->super->s_inodes_count;
+        const uint32_t freeInodes  = fs->super->s_free_inodes_count;
+        const uint32_t inodesInUse = (freeInodes <= totalInodes) ? (totalInodes - freeInodes) : totalInodes;
+        const uint32_t groupCount = fs->group_desc_count;
+
+        threads = scanThreadCount(devicePath, threads, groupCount);
+        std::vector<GroupRange> ranges = planGroupRanges(fs, threads);
+        const std::vector<ext2_filsys> handles = openHandles(fs, devicePath, threads);
 
-            ++usedInodesSeen;
+        std::cerr << "Looking for changes in " << ranges.size() << " block group ranges with " << handles.size()
+                  << " thread(s)..." << std::endl;
 
-            FileStats stats{};
-            stats.size = EXT2_I_SIZE(&inode);
-            stats.modificationTime = inode.i_mtime;
-            stats.isDir = LINUX_S_ISDIR(inode.i_mode);
-            stats.isSymlink = LINUX_S_ISLNK(inode.i_mode);
+        out = Ext4Delta{};
+        out.checkpoint = now;
 
-            db.inodeToFileStats[ino] = stats;
+        Ext4Database& db = out.db;
+        db.inodeSlots = totalInodes + 1;
+        db.inodeToRecordIdx.reset(static_cast<uint32_t*>(std::calloc(db.inodeSlots, sizeof(uint32_t))));
+        if (!db.inodeToRecordIdx) {
+            std::cerr << "Error: out of memory for " << totalInodes << " inode slots" << std::endl;
+            closeHandles(handles);
+            return DeltaResult::Failed;
+        }
 
-            static constexpr uint64_t kProgressEvery = 4096; // must be power of two
-            if (progressCb && ((usedInodesSeen & (kProgressEvery - 1)) == 0)) {
-                progressCb(usedInodesSeen, inodesInUse);
+        // Progress: nearly all of the work is the inode pass
+        std::atomic<uint64_t> usedInodesSeen{0};
+        auto reportInodes = [&]() {
+            if (progressCb) {
+                progressCb(std::min<uint64_t>(usedInodesSeen.load(std::memory_order_relaxed), inodesInUse), inodesInUse);
             }
+        };
+
+        bool failed = false;
+        std::vector<InodeStats> changed;
+        std::vector<DirBlock> dirBlocks;
+
+        // Phase one: timestamps of every inode; block maps of the changed directories only
+        auto phaseStart = std::chrono::steady_clock::now();
+        runOrdered(handles, ranges.size(),
+            [&](size_t i, ext2_filsys h) { scanGroupRange(h, ranges[i], usedInodesSeen, since.changedSince); },
+            [&](size_t i) {
+                GroupRange& range = ranges[i];
+                if (range.failed) {
+                    failed = true;
+                    return;
+                }
+
+                changed.insert(changed.end(), range.stats.begin(), range.stats.end());
+                dirBlocks.insert(dirBlocks.end(), range.dirBlocks.begin(), range.dirBlocks.end());
+                mergeNames(db, range.inlineNames);
+
+                std::vector<InodeStats>().swap(range.stats);
+                std::vector<DirBlock>().swap(range.dirBlocks);
+                reportInodes();
+            },
+            reportInodes);
+
+        ScannerUtils::reportPhase("inodes", std::chrono::steady_clock::now() - phaseStart);
+
+        // Phase two: the changed directories' blocks, in physical block order
+        if (!failed) {
+            phaseStart = std::chrono::steady_clock::now();
+            readDirBlocksInOrder(handles, dirBlocks,
+                [&](NameBatch& found, size_t) { mergeNames(db, found); },
+                reportInodes);
+            ScannerUtils::reportPhase("directories", std::chrono::steady_clock::now() - phaseStart);
+        }
 
-            if (LINUX_S_ISDIR(inode.i_mode)) {
-                // This will trigger dirCallback for every file inside this directory
-                ext2fs_dir_iterate2(fs, ino, 0, nullptr, dirCallback, &ctx);
+        if (failed) {
+            closeHandles(handles);
+            std::cerr << "Error: failed to scan the inode tables of " << devicePath << std::endl;
+            return DeltaResult::Failed;
+        }
+
+        // Stats: the changed inodes are known already; the other entries of changed directories are read
+        // here, in inode order
+        phaseStart = std::chrono::steady_clock::now();
+        std::vector<char> hasStats(db.records.size(), 0);
+        for (const InodeStats& s : changed) {
+            if (s.stats.isDir) {
+                out.changedDirs.push_back(s.ino);
+            }
+
+            const uint32_t recordIdx = db.recordIdxForInode(s.ino);
+            if (recordIdx == 0xFFFFFFFF) {
+                out.changedStats.push_back(s);
+                continue;
             }
+            setStats(db.records[recordIdx], s.stats);
+            hasStats[recordIdx] = 1;
         }
 
-        if (progressCb) {
-            progressCb(inodesInUse, inodesInUse);
+        std::vector<uint32_t> unread;
+        for (uint32_t i = 0; i < db.records.size(); ++i) {
+            if (!hasStats[i]) unread.push_back(i);
+        }
+        std::sort(unread.begin(), unread.end(), [&](uint32_t a, uint32_t b) {
+            return db.inodeNumbers[a] < db.inodeNumbers[b];
+        });
+
+        for (const uint32_t i : unread) {
+            ext2_inode inode;
+            if (ext2fs_read_inode(fs, static_cast<ext2_ino_t>(db.inodeNumbers[i]), &inode) == 0) {
+                setStats(db.records[i], statsOf(inode));
+            }
         }
 
-        // Close the scan
-        ext2fs_close_inode_scan(scan);
-        ext2fs_close(fs);
+        closeHandles(handles);
+        ScannerUtils::reportPhase("stats", std::chrono::steady_clock::now() - phaseStart);
 
-        // Resolve parent Inodes to parent Record Indices
-        db.resolveParentPointers();
+        db.inodeToRecordIdx.reset();
+        db.inodeSlots = 0;
 
-        // Populate stats into records
-        db.populateStatsIntoRecords();
+        std::cerr << changed.size() << " inodes changed, " << out.changedDirs.size() << " directories re-read ("
+                  << db.records.size() << " entries)." << std::endl;
 
-        return db;
+        if (progressCb) {
+            progressCb(inodesInUse, inodesInUse);
+        }
+
+        return DeltaResult::Ok;
     }
 
     // We call this once after the scan is completely finished
@@ -177,9 +772,9 @@ namespace Ext4ScannerEngine {
                 continue;
             }
 
-            auto it = inodeToRecordIdx.find(parentInode);
-            if (it != inodeToRecordIdx.end()) {
-                records[i].parentRecordIdx = it->second;
+            const uint32_t parentRecordIdx = recordIdxForInode(static_cast<uint32_t>(parentInode));
+            if (parentRecordIdx != 0xFFFFFFFF) {
+                records[i].parentRecordIdx = parentRecordIdx;
             } else {
                 // If parent isn't in our DB, mark as root
                 records[i].parentRecordIdx = 0xFFFFFFFF;
@@ -194,18 +789,20 @@ namespace Ext4ScannerEngine {
     void Ext4Database::populateStatsIntoRecords() {
         std::cerr << "Populating stats into records..." << std::endl;
 
-        for (auto& it : inodeToRecordIdx) {
-            FileRecord& record = records[it.second];
-            FileStats& stats = inodeToFileStats[it.first];
-            record.size = stats.size;
-            record.modificationTime = stats.modificationTime;
-            record.isDir = stats.isDir;
-            record.isSymlink = stats.isSymlink;
+        // Inodes that never got a name (orphans, reserved inodes) are skipped; names whose inode
+        // wasn't scanned keep zeroed stats
+        for (const InodeStats& s : tempInodeStats) {
+            const uint32_t recordIdx = recordIdxForInode(s.ino);
+            if (recordIdx == 0xFFFFFFFF) continue;
+
+            setStats(records[recordIdx], s.stats);
         }
 
         // Clean up remaining temporary data
         // The memory is freed, and the GUI never even sees it.
-        inodeToRecordIdx.clear();
-        inodeToFileStats.clear();
+        inodeToRecordIdx.reset();
+        inodeSlots = 0;
+        tempInodeStats.clear();
+        tempInodeStats.shrink_to_fit();
     }
 }
\ No newline at end of file
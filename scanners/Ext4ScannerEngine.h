@@ -4,8 +4,9 @@
 #ifndef KERYTHING_EXT4SCANNERENGINE_H
 #define KERYTHING_EXT4SCANNERENGINE_H
 
+#include <cstdlib>
+#include <memory>
 #include <optional>
-#include <unordered_map>
 #include <vector>
 #include <iostream>
 #include <string>
@@ -48,43 +49,133 @@ namespace Ext4ScannerEngine {
         uint8_t reserved : 6;
     };
 
+    struct InodeStats {
+        uint32_t ino;
+        FileStats stats;
+    };
+
     struct Ext4Database {
         std::vector<FileRecord> records;
         std::vector<char> stringPool;
+        // Inode number of each record (parallel to records)
+        std::vector<uint64_t> inodeNumbers;
 
         // TEMPORARY (Only used during scan/setup)
-        // We keep this here so add() can fill it, then we clear it in resolveParentPointers()
-        std::unordered_map<uint32_t, uint32_t> inodeToRecordIdx;
+        // Inode number -> record index + 1 (0 = no record yet), one slot per inode in s_inodes_count.
+        // It's calloc'd, so only the pages covering inodes that actually get a name are ever committed.
+        std::unique_ptr<uint32_t[], void (*)(void*)> inodeToRecordIdx{nullptr, std::free};
+        uint32_t inodeSlots = 0;
         // Temporary storage for inodes index
         std::vector<uint32_t> tempParentInodes;
-        // Temporary storage for inode stats
-        std::unordered_map<uint32_t, FileStats> inodeToFileStats;
+        // Temporary storage for inode stats, in inode order
+        std::vector<InodeStats> tempInodeStats;
+
+        // @return The record index of ino, or 0xFFFFFFFF if it has none.
+        [[nodiscard]] uint32_t recordIdxForInode(uint32_t ino) const {
+            if (ino >= inodeSlots) return 0xFFFFFFFF;
+            return inodeToRecordIdx[ino] - 1; // 0 wraps to 0xFFFFFFFF
+        }
 
         // We call these once after the inode scan is completely finished
         void resolveParentPointers();
         void populateStatsIntoRecords();
     };
 
+    /**
+     * Where a later delta scan (parseChangedSince) starts: inodes whose ctime or mtime is at or after
+     * changedSince (unix seconds) are the ones that changed.
+     */
+    struct ChangeCheckpoint {
+        uint64_t volumeId = 0;     // from the superblock UUID; a different volume needs a full scan
+        uint64_t changedSince = 0;
+    };
+
+    // Output of parseChangedSince()
+    struct Ext4Delta {
+        // Every entry of the changed directories, with stats. Parents aren't resolved:
+        // tempParentInodes holds each record's directory inode instead.
+        Ext4Database db;
+        // Directories whose entries were all re-read (their entries that aren't in db are gone)
+        std::vector<uint32_t> changedDirs;
+        // Changed inodes that aren't an entry of a changed directory (same names, new stats)
+        std::vector<InodeStats> changedStats;
+        // Where the next delta starts
+        ChangeCheckpoint checkpoint;
+    };
+
+    enum class DeltaResult {
+        Ok,
+        NeedsFullScan, // different volume, or no usable checkpoint
+        Failed,
+    };
+
     /**
      * Progress callback: called with (done, total) to report scan progress.
      */
     using ProgressCallback = std::function<void(uint64_t done, uint64_t total)>;
 
+    /**
+     * Batch callback: called periodically during the inode scan with the partially built database.
+     * Only the string pool is append-only at this point; records still lack parent and stat
+     * information until parseInodes() returns.
+     */
+    using BatchCallback = std::function<void(const Ext4Database& db)>;
+
     /**
      * Parses the inodes of the specified Ext4 filesystem and builds an internal database structure.
      *
+     * The scan runs in two phases. The first reads the inode tables (stats, plus the block map of every
+     * directory); the second reads all directory blocks sorted by physical block number, in large
+     * requests, so directory reads don't interleave random seeks with the inode table stream.
+     *
+     * Each phase is split into ranges that worker threads (each with its own ext2_filsys handle) work
+     * through in parallel; spinning disks get a single thread by default. The calling thread merges
+     * the finished ranges in order, so the result doesn't depend on timing, and both callbacks run on it.
+     *
      * @param devicePath The file path to the device containing the Ext4 filesystem.
      * @param progressCb A callback function to report progress during inode scanning.
      *                   The callback takes two arguments: the number of inodes processed and the total number of inodes.
      *                   Can be null if progress reporting is not required.
+     * @param batchCb A callback invoked periodically during the scan so callers can stream out
+     *                string pool data while the scan is still running. Can be null.
+     * @param threads Number of scan threads; 0 picks one per CPU core (capped), 1 scans sequentially.
      * @return An optional Ext4Database object containing the parsed data.
      *         Returns std::nullopt if there is an error opening or scanning the filesystem.
      */
-    std::optional<Ext4Database> parseInodes(const std::string& devicePath, ProgressCallback progressCb = {});
+    std::optional<Ext4Database> parseInodes(const std::string& devicePath, ProgressCallback progressCb = {},
+                                            BatchCallback batchCb = {}, unsigned threads = 0);
+
+    /**
+     * Reads the checkpoint a scan started now is consistent with. Call it before the scan: changes
+     * made while the scan runs are then picked up again by the next delta.
+     *
+     * changedSince is a little behind the current time, for changes still in the page cache when the
+     * volume is scanned while mounted.
+     *
+     * @return std::nullopt if the filesystem can't be opened.
+     */
+    std::optional<ChangeCheckpoint> readChangeCheckpoint(const std::string& devicePath);
+
+    /**
+     * Finds what changed since an earlier checkpoint, without reading the whole volume's directories.
+     *
+     * The inode tables are still read (block groups flagged INODE_UNINIT are skipped), but only to
+     * compare timestamps: directories whose ctime or mtime is at or after since.changedSince get their
+     * entries re-read, and other changed inodes only report their new stats. Deletions are found
+     * through the changed directories they were removed from. The cost is the inode tables plus the
+     * changed directories, instead of every directory block on the volume.
+     *
+     * @param since Checkpoint of the scan the receiver's index came from.
+     * @param out Filled when Ok is returned.
+     * @param threads As for parseInodes().
+     */
+    DeltaResult parseChangedSince(const std::string& devicePath, const ChangeCheckpoint& since, Ext4Delta& out,
+                                  ProgressCallback progressCb = {}, unsigned threads = 0);
 
     /**
      * Callback function invoked for each directory entry during a directory iteration in the Ext4 filesystem.
-     * This function processes directory entries, updates the inode-to-record mappings, and populates file records.
+     * This function records the entry's name, inode and parent into the scanning thread's block group range;
+     * the ranges are turned into file records when they get merged.
      *
      * @param dir_ino The inode number of the directory being scanned.
      * @param entry_flags Flags providing additional information about the directory entry (e.g., error conditions, entry type).
@@ -1,14 +1,19 @@
 // SPDX-License-Identifier: GPL-3.0-or-later
 // Copyright (C) 2026  Reikooters <https://github.com/Reikooters>
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <execution>
 #include <fstream>
 #include <iostream>
+#include <numeric>
 #include "../ScannerUtils.h"
+#include "AsyncBlockReader.h"
 #include "NtfsScannerEngine.h"
 
 namespace NtfsScannerEngine {
     std::vector<MftRun> mftRuns;
-    std::unordered_map<uint64_t, std::vector<ExtensionFileInfo>> extensionRecordFileInfos;
 
     static uint64_t ntfsFiletimeToUnixSeconds(uint64_t filetime100ns) {
         // NTFS FILETIME: 100ns intervals since 1601-01-01 (UTC)
@@ -211,12 +216,12 @@ namespace NtfsScannerEngine {
             extensionRecordFileInfo.dataAttrFound = dataAttrFound;
             extensionRecordFileInfo.sizeFromData = sizeFromData;
 
-            extensionRecordFileInfos[baseIndex].emplace_back(extensionRecordFileInfo);
+            db.extensionRecordFileInfos[baseIndex].emplace_back(extensionRecordFileInfo);
         }
     }
 
     void processExtensionRecords(NtfsDatabase& db) {
-        for (const auto& extensionRecordFileInfosKvp : extensionRecordFileInfos) {
+        for (const auto& extensionRecordFileInfosKvp : db.extensionRecordFileInfos) {
             // Combine the data from all records into one FileInfo,
             // and rebuild the "allNames" list.
             FileInfo info{};
@@ -282,13 +287,18 @@ namespace NtfsScannerEngine {
     }
 
     void parseMftRuns(char* buffer, uint32_t attrOffset) {
+        parseDataRuns(buffer, attrOffset, mftRuns);
+    }
+
+    void parseDataRuns(char* buffer, uint32_t attrOffset, std::vector<MftRun>& out) {
         auto* attr = reinterpret_cast<AttributeHeader*>(buffer + attrOffset);
 
         // The "Mapping Pairs" (Data Runs) offset is at byte 32 of a non-resident attribute header
         uint16_t runOffset = *reinterpret_cast<uint16_t*>(reinterpret_cast<char*>(attr) + 32);
         uint8_t* runPos = reinterpret_cast<uint8_t*>(reinterpret_cast<char*>(attr) + runOffset);
 
-        uint64_t currentVcn = 0;
+        // Attributes split over several records (attribute lists) continue at a later VCN
+        uint64_t currentVcn = reinterpret_cast<NonResidentHeader*>(buffer + attrOffset + sizeof(AttributeHeader))->startVcn;
         int64_t currentLcn = 0;
 
         while (*runPos != 0) {
@@ -313,8 +323,15 @@ namespace NtfsScannerEngine {
                 }
             }
 
+            // No offset bytes: a sparse run (nothing allocated, LCN unchanged for the next run)
+            if (offSize == 0) {
+                out.push_back({ currentVcn, kSparseLcn, runLen });
+                currentVcn += runLen;
+                continue;
+            }
+
             currentLcn += runOff;
-            mftRuns.push_back({ currentVcn, (uint64_t)currentLcn, runLen });
+            out.push_back({ currentVcn, (uint64_t)currentLcn, runLen });
             currentVcn += runLen;
         }
     }
@@ -325,6 +342,7 @@ namespace NtfsScannerEngine {
 
         for (const auto& run : mftRuns) {
             if (virtualClusterNumber >= run.virtualClusterNumber && virtualClusterNumber < (run.virtualClusterNumber + run.length)) {
+                if (run.logicalClusterNumber == kSparseLcn) return 0;
                 return (run.logicalClusterNumber + (virtualClusterNumber - run.virtualClusterNumber)) * bytesPerCluster + virtualClusterNumberOffset;
             }
         }
@@ -332,15 +350,77 @@ namespace NtfsScannerEngine {
         return 0;
     }
 
-    std::optional<NtfsDatabase> parseMft(const std::string& devicePath, ProgressCallback progressCb) {
-        // Opening a disk device requires 'root' privileges on Linux.
-        std::ifstream disk(devicePath, std::ios::binary);
-        if (!disk) {
-            std::perror("Error opening device");
-            std::cerr << "Make sure to use sudo and the correct partition (e.g., /dev/sdc2).\n";
-            return std::nullopt;
+    /**
+     * Reads $MFT:$BITMAP (one bit per MFT record, set = in use) from record 0's attribute at attrOffset.
+     *
+     * Record 0 isn't trusted: an attribute that doesn't fit in the record yields an empty bitmap
+     * (every record is read), and the bitmap never grows past totalRecords bits.
+     */
+    static std::vector<uint8_t> readMftBitmap(std::ifstream& disk, char* buffer, uint32_t recordSize, uint32_t attrOffset,
+                                              uint64_t bytesPerCluster, uint64_t totalRecords) {
+        auto* attr = reinterpret_cast<AttributeHeader*>(buffer + attrOffset);
+        std::vector<uint8_t> bitmap;
+
+        const uint64_t maxBytes = (totalRecords + 7) / 8;
+        const uint64_t headerSize = sizeof(AttributeHeader) + (attr->nonResident ? sizeof(NonResidentHeader) : sizeof(ResidentHeader));
+        if (maxBytes == 0 || attr->length < headerSize || static_cast<uint64_t>(attrOffset) + attr->length > recordSize) {
+            std::cerr << "Warning: invalid $MFT:$BITMAP attribute, reading every MFT record instead.\n";
+            return {};
         }
 
+        if (attr->nonResident == 0) {
+            auto* res = reinterpret_cast<ResidentHeader*>(buffer + attrOffset + sizeof(AttributeHeader));
+            if (static_cast<uint64_t>(res->dataOffset) + res->dataLength > attr->length) {
+                std::cerr << "Warning: invalid $MFT:$BITMAP attribute, reading every MFT record instead.\n";
+                return {};
+            }
+
+            const char* data = buffer + attrOffset + res->dataOffset;
+            bitmap.assign(data, data + std::min<uint64_t>(res->dataLength, maxBytes));
+            return bitmap;
+        }
+
+        auto* nonResident = reinterpret_cast<NonResidentHeader*>(buffer + attrOffset + sizeof(AttributeHeader));
+        const uint64_t bitmapSize = std::min(nonResident->dataSize, maxBytes);
+
+        std::vector<MftRun> runs;
+        parseDataRuns(buffer, attrOffset, runs);
+
+        bitmap.resize(bitmapSize);
+        for (const auto& run : runs) {
+            const uint64_t begin = run.virtualClusterNumber * bytesPerCluster;
+            if (begin >= bitmapSize) {
+                break;
+            }
+
+            const uint64_t bytes = std::min(run.length * bytesPerCluster, bitmapSize - begin);
+            if (run.logicalClusterNumber == kSparseLcn) {
+                continue; // already zero
+            }
+            disk.seekg(static_cast<std::streamoff>(run.logicalClusterNumber * bytesPerCluster));
+            disk.read(reinterpret_cast<char*>(bitmap.data() + begin), static_cast<std::streamsize>(bytes));
+            if (!disk) {
+                std::cerr << "Warning: failed reading $MFT:$BITMAP, reading every MFT record instead.\n";
+                return {};
+            }
+        }
+
+        return bitmap;
+    }
+
+    // Volume geometry, from the boot sector and MFT record 0
+    struct Volume {
+        uint64_t bytesPerCluster = 0;
+        uint32_t recordSize = 0;
+        uint64_t mftOffset = 0;
+        uint64_t totalRecords = 0;
+    };
+
+    /**
+     * Reads the boot sector, then MFT record 0 to find all fragments of the MFT (into mftRuns)
+     * and, if bitmapOut is given, which records are in use.
+     */
+    static bool openVolume(std::ifstream& disk, const std::string& devicePath, Volume& vol, std::vector<uint8_t>* bitmapOut) {
         NTFS_BootSector boot;
 
         // Step 1: Read the boot sector to find the start of the MFT
@@ -349,7 +429,7 @@ namespace NtfsScannerEngine {
         if (std::string(boot.oemID, 8) != "NTFS    ") {
             std::cerr << "Error: " << devicePath << " does not appear to be a valid NTFS partition.\n";
             std::cerr << "OEM ID found: [" << std::string(boot.oemID, 8) << "]\n";
-            return std::nullopt;
+            return false;
         }
 
         uint64_t bytesPerCluster = static_cast<uint64_t>(boot.bytesPerSector) * boot.sectorsPerCluster;
@@ -370,7 +450,7 @@ namespace NtfsScannerEngine {
 
         if (mftOffset == 0 || recordSize == 0) {
             std::cerr << "Invalid MFT parameters calculated. Struct alignment might be wrong.\n";
-            return std::nullopt;
+            return false;
         }
 
         std::vector<char> buffer(recordSize);
@@ -379,13 +459,16 @@ namespace NtfsScannerEngine {
         disk.seekg(mftOffset);
         disk.read(buffer.data(), recordSize);
         auto* mftHeader = reinterpret_cast<MFT_RecordHeader*>(buffer.data());
+        applyFixups(buffer.data(), recordSize); // $BITMAP usually sits past the first sector
+
+        mftRuns.clear();
 
         uint32_t mftAttrOffset = mftHeader->firstAttributeOffset;
-        uint64_t totalMftSize = 0;
+        uint64_t totalMftSize = 0; // set by $DATA, which precedes $BITMAP
         while (mftAttrOffset + 16 <= mftHeader->usedSize) {
             auto* attr = reinterpret_cast<AttributeHeader*>(buffer.data() + mftAttrOffset);
 
-            if (attr->type == 0x80) { // $DATA Attribute
+            if (attr->type == 0x80 && mftRuns.empty()) { // $DATA Attribute
                 parseMftRuns(buffer.data(), mftAttrOffset);
 
                 if (attr->nonResident) {
@@ -393,6 +476,10 @@ namespace NtfsScannerEngine {
                         buffer.data() + mftAttrOffset + sizeof(AttributeHeader));
                     totalMftSize = nonResident->dataSize;
                 }
+                if (!bitmapOut) break;
+            } else if (attr->type == 0xB0 && attr->nameLength == 0 && bitmapOut) { // $BITMAP Attribute (follows $DATA)
+                *bitmapOut = readMftBitmap(disk, buffer.data(), recordSize, mftAttrOffset, bytesPerCluster,
+                                           totalMftSize / recordSize);
                 break;
             }
 
@@ -404,48 +491,156 @@ namespace NtfsScannerEngine {
             mftAttrOffset += attr->length;
         }
 
-        uint64_t totalRecords = totalMftSize / recordSize;
-        std::cerr << "MFT consists of " << mftRuns.size() << " fragments.\n";
-        std::cerr << "Total MFT Records: " << totalRecords << "\n";
+        vol.bytesPerCluster = bytesPerCluster;
+        vol.recordSize = recordSize;
+        vol.mftOffset = mftOffset;
+        vol.totalRecords = totalMftSize / recordSize;
 
-        // Batch processing buffer (4MB)
-        const size_t batchSizeInRecords = (4 * 1024 * 1024) / recordSize;
-        std::vector<char> batchBuffer(batchSizeInRecords * recordSize);
+        std::cerr << "MFT consists of " << mftRuns.size() << " fragments.\n";
+        std::cerr << "Total MFT Records: " << vol.totalRecords << "\n";
+        return true;
+    }
 
-        NtfsDatabase db;
-        db.records.reserve(totalRecords);
-        db.tempParentMfts.reserve(totalRecords);
-        db.mftToRecordIdx.reserve(totalRecords);
-        db.stringPool.reserve(totalRecords * 20); // Average filename length estimate
+    std::optional<NtfsDatabase> parseMft(const std::string& devicePath, ProgressCallback progressCb, BatchCallback batchCb) {
+        // Opening a disk device requires 'root' privileges on Linux.
+        std::ifstream disk(devicePath, std::ios::binary);
+        if (!disk) {
+            std::perror("Error opening device");
+            std::cerr << "Make sure to use sudo and the correct partition (e.g., /dev/sdc2).\n";
+            return std::nullopt;
+        }
 
-        uint64_t scannedRecords = 0;
-        if (progressCb) {
-            progressCb(0, totalRecords);
+        Volume vol;
+        std::vector<uint8_t> mftBitmap; // empty: treat every record as in use
+        if (!openVolume(disk, devicePath, vol, &mftBitmap)) {
+            return std::nullopt;
         }
 
-        // Step 3: Single Pass.
-        // We collect all valid records.
+        const uint64_t bytesPerCluster = vol.bytesPerCluster;
+        const uint32_t recordSize = vol.recordSize;
+        const uint64_t totalRecords = vol.totalRecords;
+
+        auto recordInUse = [&](uint64_t index) {
+            if (mftBitmap.empty()) return true;
+            if (index / 8 >= mftBitmap.size()) return true; // past a short bitmap: read it rather than skip it
+            return ((mftBitmap[index / 8] >> (index % 8)) & 1) != 0;
+        };
+
+        // Read extents of up to 4MB, in MFT order across all fragments. Only in-use records are
+        // read: free regions are skipped, apart from short gaps that are cheaper to read through.
+        const size_t batchSizeInRecords = (4 * 1024 * 1024) / recordSize;
+        static constexpr uint64_t kMaxGapRecords = 16;
+
+        std::vector<AsyncBlockReader::Extent> extents;
+        std::vector<uint64_t> extentFirstRecord; // MFT index of each extent's first record
+        std::vector<uint64_t> extentInUse;       // in-use records in each extent (for progress)
+        uint64_t inUseRecords = 0;
         for (const auto& run : mftRuns) {
+            if (run.logicalClusterNumber == kSparseLcn) continue;
+
             uint64_t runOffset = run.logicalClusterNumber * bytesPerCluster;
             uint64_t recordsInRun = (run.length * bytesPerCluster) / recordSize;
 
             // Starting index for this specific fragment/run
             uint64_t runStartIndex = (run.virtualClusterNumber * bytesPerCluster) / recordSize;
 
-            for (uint64_t r = 0; r < recordsInRun; r += batchSizeInRecords) {
-                uint64_t toRead = std::min(batchSizeInRecords, recordsInRun - r);
-                disk.seekg(runOffset + (r * recordSize));
-                disk.read(batchBuffer.data(), toRead * recordSize);
+            // The run's allocation can extend past the end of the MFT's data
+            if (runStartIndex >= totalRecords) continue;
+            recordsInRun = std::min(recordsInRun, totalRecords - runStartIndex);
 
-                for (uint64_t i = 0; i < toRead; ++i) {
-                    ++scannedRecords;
-
-                    static constexpr uint64_t kProgressEvery = 4096; // must be power of two
-                    if (progressCb && ((scannedRecords & (kProgressEvery - 1)) == 0)) {
-                        progressCb(scannedRecords, totalRecords);
+            uint64_t r = 0;
+            while (r < recordsInRun) {
+                while (r < recordsInRun && !recordInUse(runStartIndex + r)) {
+                    ++r;
+                }
+                if (r >= recordsInRun) break;
+
+                const uint64_t begin = r;
+                uint64_t lastUsed = r;
+                uint64_t used = 1;
+                for (uint64_t j = r + 1; j < recordsInRun && j - begin < batchSizeInRecords; ++j) {
+                    if (recordInUse(runStartIndex + j)) {
+                        lastUsed = j;
+                        ++used;
+                    } else if (j - lastUsed > kMaxGapRecords) {
+                        break;
                     }
+                }
+
+                const uint64_t toRead = lastUsed + 1 - begin;
+                extents.push_back({runOffset + (begin * recordSize), static_cast<size_t>(toRead * recordSize)});
+                extentFirstRecord.push_back(runStartIndex + begin);
+                extentInUse.push_back(used);
+                inUseRecords += used;
+
+                r = lastUsed + 1;
+            }
+        }
+
+        if (!mftBitmap.empty()) {
+            std::cerr << "In-use MFT Records: " << inUseRecords << "\n";
+        }
 
-                    char* recordPtr = batchBuffer.data() + (i * recordSize);
+        NtfsDatabase db;
+        db.records.reserve(inUseRecords);
+        db.tempParentMfts.reserve(inUseRecords);
+        db.tempMftIndexes.reserve(inUseRecords);
+        db.stringPool.reserve(inUseRecords * 20); // Average filename length estimate
+
+        // Several batches stay in flight while the current one is parsed; O_DIRECT keeps a one-off
+        // scan of the whole MFT from evicting everything else in the page cache
+        static constexpr unsigned kReadsInFlight = 4;
+        AsyncBlockReader reader(std::move(extents), kReadsInFlight, true);
+        if (!reader.open(devicePath)) {
+            std::perror("Error opening device");
+            return std::nullopt;
+        }
+
+        std::cerr << "Reading the MFT in " << extentFirstRecord.size() << " batches (" << reader.backendName() << ")\n";
+
+        // Progress counts in-use records only
+        uint64_t scannedRecords = 0;
+        if (progressCb) {
+            progressCb(0, inUseRecords);
+        }
+
+        // Step 3: Single Pass.
+        // We collect all valid records. Each batch is cut into shards that are parsed in parallel
+        // (fixups, attribute walk, UTF-16 -> UTF-8), each into its own database.
+        static constexpr uint64_t kShardRecords = 256;
+        const uint64_t shardsPerBatch = (batchSizeInRecords + kShardRecords - 1) / kShardRecords;
+        std::vector<NtfsDatabase> shards(shardsPerBatch);
+        std::vector<uint64_t> shardIds(shardsPerBatch);
+        std::iota(shardIds.begin(), shardIds.end(), 0);
+
+        // Phase timings: time spent waiting for the reader vs. parsing (batchCb is the writer's own)
+        using Clock = std::chrono::steady_clock;
+        Clock::duration readTime{};
+        Clock::duration parseTime{};
+
+        AsyncBlockReader::Block block;
+        for (auto waitStart = Clock::now(); reader.next(block); waitStart = Clock::now()) {
+            const auto parseStart = Clock::now();
+            readTime += parseStart - waitStart;
+
+            // A missing batch would silently drop its records (and orphan their children)
+            if (!block.ok) {
+                std::cerr << "Error: failed reading MFT batch " << block.index << ".\n";
+                return std::nullopt;
+            }
+
+            // Only whole records (a short read at the end of the device leaves a partial one)
+            const uint64_t toRead = block.size / recordSize;
+            char* batchBuffer = block.data;
+            const uint64_t firstRecord = extentFirstRecord[block.index];
+            const uint64_t shardCount = (toRead + kShardRecords - 1) / kShardRecords;
+
+            std::for_each(std::execution::par, shardIds.begin(), shardIds.begin() + static_cast<ptrdiff_t>(shardCount), [&](uint64_t s) {
+                NtfsDatabase& shard = shards[s];
+                const uint64_t end = std::min(toRead, (s + 1) * kShardRecords);
+
+                for (uint64_t i = s * kShardRecords; i < end; ++i) {
+                    char* recordPtr = batchBuffer + (i * recordSize);
                     auto* header = reinterpret_cast<MFT_RecordHeader*>(recordPtr);
 
                     // Check signature and 'In Use' flag
@@ -454,31 +649,375 @@ namespace NtfsScannerEngine {
                     }
 
                     applyFixups(recordPtr, recordSize);
-                    uint64_t recordIndex = runStartIndex + r + i;
+                    uint64_t recordIndex = firstRecord + i;
 
-                    processMftRecord(header, recordPtr, recordIndex, db);
+                    processMftRecord(header, recordPtr, recordIndex, shard);
                 }
+            });
+
+            for (uint64_t s = 0; s < shardCount; ++s) {
+                db.appendShard(shards[s]);
+            }
+            parseTime += Clock::now() - parseStart;
+
+            scannedRecords += extentInUse[block.index];
+            if (progressCb) {
+                progressCb(scannedRecords, inUseRecords);
+            }
+
+            if (batchCb) {
+                batchCb(db);
             }
         }
 
-        if (progressCb) progressCb(totalRecords, totalRecords);
+        if (reader.failed()) {
+            std::cerr << "Error: reading the MFT failed after " << scannedRecords << " records.\n";
+            return std::nullopt;
+        }
+
+        if (progressCb) progressCb(inUseRecords, inUseRecords);
+
+        ScannerUtils::reportPhase("read", readTime);
+        ScannerUtils::reportPhase("parse", parseTime);
 
         // Now that we've scanned the whole partition, process extension records since we have all their parts
-        processExtensionRecords(db);
+        {
+            ScannerUtils::PhaseTimer phase("extensions");
+            processExtensionRecords(db);
+        }
+
+        // $Extend (record 11) isn't indexed itself, but the change journal inside it is
+        for (size_t i = 0; i < db.records.size(); ++i) {
+            const auto& r = db.records[i];
+            if (db.tempParentMfts[i] == 11 &&
+                std::string_view(db.stringPool.data() + r.nameOffset, r.nameLen) == "$UsnJrnl") {
+                db.usnJournalMftIndex = db.tempMftIndexes[i];
+                break;
+            }
+        }
 
         std::cerr << "MFT scan and index complete. " << db.records.size() << " entries indexed. Resolving parent pointers...\n";
 
         // Resolve parent pointers and clear the large MFT map
-        db.resolveParentPointers();
+        {
+            ScannerUtils::PhaseTimer phase("resolveParents");
+            db.resolveParentPointers();
+        }
 
         std::cerr << "Resolving parent pointers completed.\n";
 
         return db;
     }
 
-    void NtfsDatabase::add(std::string_view name, uint64_t mftIndex, uint64_t parentMftIndex, uint64_t size, uint64_t mod, bool isDir, bool isSymlink) {
-        uint32_t currentIdx = static_cast<uint32_t>(records.size());
+    // --- Begin: Change journal ($UsnJrnl) ---
+
+    // Reads MFT record `index` into buffer, with fixups applied. False if the slot doesn't hold
+    // a valid record (on a read error the stream is left failed).
+    static bool readMftRecord(std::ifstream& disk, const Volume& vol, uint64_t index, std::vector<char>& buffer) {
+        if (index >= vol.totalRecords) return false;
+
+        const uint64_t offset = mftIndexToPhysicalOffset(index, vol.recordSize, vol.bytesPerCluster);
+        if (offset == 0) return false;
+
+        buffer.resize(vol.recordSize);
+        disk.clear();
+        disk.seekg(static_cast<std::streamoff>(offset));
+        disk.read(buffer.data(), vol.recordSize);
+        if (!disk) return false;
+
+        auto* header = reinterpret_cast<MFT_RecordHeader*>(buffer.data());
+        if (std::string_view(header->signature, 4) != "FILE" || header->usedSize > vol.recordSize) {
+            return false;
+        }
 
+        applyFixups(buffer.data(), vol.recordSize);
+        return true;
+    }
+
+    // Calls fn(attr, attrOffset) for each attribute of the record in buffer, until it returns false
+    template <typename Fn>
+    static void forEachAttribute(char* buffer, Fn&& fn) {
+        auto* header = reinterpret_cast<MFT_RecordHeader*>(buffer);
+        uint32_t attrOffset = header->firstAttributeOffset;
+
+        while (attrOffset + sizeof(AttributeHeader) <= header->usedSize) {
+            auto* attr = reinterpret_cast<AttributeHeader*>(buffer + attrOffset);
+            if (attr->type == 0xFFFFFFFF || attr->length == 0 || attrOffset + attr->length > header->usedSize) {
+                break;
+            }
+            if (!fn(attr, attrOffset)) {
+                break;
+            }
+            attrOffset += attr->length;
+        }
+    }
+
+    // Extension records named by the base record's $ATTRIBUTE_LIST (sorted, without the base record).
+    // Returns false if the list is non-resident, which isn't supported here.
+    static bool attributeListRecords(char* buffer, uint64_t index, std::vector<uint64_t>& out) {
+        bool ok = true;
+
+        forEachAttribute(buffer, [&](AttributeHeader* attr, uint32_t attrOffset) {
+            if (attr->type != 0x20) return true;
+            if (attr->nonResident) {
+                ok = false;
+                return false;
+            }
+
+            auto* res = reinterpret_cast<ResidentHeader*>(buffer + attrOffset + sizeof(AttributeHeader));
+            const uint32_t end = std::min<uint32_t>(res->dataOffset + res->dataLength, attr->length);
+
+            for (uint32_t pos = res->dataOffset; pos + sizeof(AttributeListEntry) <= end;) {
+                auto* entry = reinterpret_cast<AttributeListEntry*>(buffer + attrOffset + pos);
+                if (entry->length == 0) break;
+
+                const uint64_t record = entry->fileReference & 0xFFFFFFFFFFFFULL;
+                if (record != index) out.push_back(record);
+                pos += entry->length;
+            }
+            return false;
+        });
+
+        std::sort(out.begin(), out.end());
+        out.erase(std::unique(out.begin(), out.end()), out.end());
+        return ok;
+    }
+
+    static std::string attributeName(const AttributeHeader* attr) {
+        const auto* name = reinterpret_cast<const char16_t*>(reinterpret_cast<const char*>(attr) + attr->nameOffset);
+        return ScannerUtils::utf16ToUtf8(name, attr->nameLength);
+    }
+
+    // Where $UsnJrnl:$J lives, and the journal state from $UsnJrnl:$Max
+    struct UsnJournal {
+        UsnJournalMax max{};
+        uint64_t size = 0; // of $J, i.e. the next USN
+        std::vector<MftRun> runs;
+    };
+
+    static bool readUsnJournal(std::ifstream& disk, const Volume& vol, uint64_t journalMftIndex, UsnJournal& out) {
+        std::vector<char> buffer;
+        if (!readMftRecord(disk, vol, journalMftIndex, buffer)) return false;
+
+        auto* header = reinterpret_cast<MFT_RecordHeader*>(buffer.data());
+        if (!(header->flags & 0x01) || header->baseFileRecord != 0) return false;
+
+        // A big, fragmented $J doesn't fit in one record
+        std::vector<uint64_t> extensions;
+        if (!attributeListRecords(buffer.data(), journalMftIndex, extensions)) return false;
+
+        bool haveMax = false;
+        bool haveJ = false;
+
+        for (size_t k = 0; k <= extensions.size(); ++k) {
+            if (k > 0) {
+                if (!readMftRecord(disk, vol, extensions[k - 1], buffer)) return false;
+                header = reinterpret_cast<MFT_RecordHeader*>(buffer.data());
+                if ((header->baseFileRecord & 0xFFFFFFFFFFFFULL) != journalMftIndex) return false;
+            }
+
+            forEachAttribute(buffer.data(), [&](AttributeHeader* attr, uint32_t attrOffset) {
+                if (attr->type != 0x80 || attr->nameLength == 0) return true;
+
+                const std::string name = attributeName(attr);
+                if (name == "$Max" && attr->nonResident == 0) {
+                    auto* res = reinterpret_cast<ResidentHeader*>(buffer.data() + attrOffset + sizeof(AttributeHeader));
+                    if (res->dataLength >= sizeof(UsnJournalMax) && res->dataOffset + sizeof(UsnJournalMax) <= attr->length) {
+                        std::memcpy(&out.max, buffer.data() + attrOffset + res->dataOffset, sizeof(UsnJournalMax));
+                        haveMax = true;
+                    }
+                } else if (name == "$J" && attr->nonResident != 0) {
+                    auto* nonResident = reinterpret_cast<NonResidentHeader*>(buffer.data() + attrOffset + sizeof(AttributeHeader));
+                    if (nonResident->startVcn == 0) {
+                        out.size = nonResident->dataSize;
+                        haveJ = true;
+                    }
+                    parseDataRuns(buffer.data(), attrOffset, out.runs);
+                }
+                return true;
+            });
+        }
+
+        std::sort(out.runs.begin(), out.runs.end(), [](const MftRun& a, const MftRun& b) {
+            return a.virtualClusterNumber < b.virtualClusterNumber;
+        });
+        return haveMax && haveJ;
+    }
+
+    // Reads [offset, offset + length) of a non-resident stream; sparse and unmapped parts read as zeros
+    static bool readStreamRange(std::ifstream& disk, const std::vector<MftRun>& runs, uint64_t bytesPerCluster,
+                                uint64_t offset, size_t length, char* out) {
+        std::memset(out, 0, length);
+
+        for (const auto& run : runs) {
+            const uint64_t runBegin = run.virtualClusterNumber * bytesPerCluster;
+            const uint64_t runEnd = runBegin + run.length * bytesPerCluster;
+            const uint64_t begin = std::max(runBegin, offset);
+            const uint64_t end = std::min<uint64_t>(runEnd, offset + length);
+            if (begin >= end || run.logicalClusterNumber == kSparseLcn) continue;
+
+            disk.clear();
+            disk.seekg(static_cast<std::streamoff>(run.logicalClusterNumber * bytesPerCluster + (begin - runBegin)));
+            disk.read(out + (begin - offset), static_cast<std::streamsize>(end - begin));
+            if (!disk) return false;
+        }
+        return true;
+    }
+
+    std::optional<UsnCheckpoint> readUsnCheckpoint(const std::string& devicePath, uint64_t journalMftIndex) {
+        if (journalMftIndex == 0) return std::nullopt;
+
+        std::ifstream disk(devicePath, std::ios::binary);
+        Volume vol;
+        UsnJournal journal;
+        if (!disk || !openVolume(disk, devicePath, vol, nullptr) || !readUsnJournal(disk, vol, journalMftIndex, journal)) {
+            std::cerr << "Warning: change journal not readable; incremental re-indexing won't be available.\n";
+            return std::nullopt;
+        }
+
+        return UsnCheckpoint{journal.max.journalId, journal.size, journalMftIndex};
+    }
+
+    DeltaResult parseUsnDelta(const std::string& devicePath, const UsnCheckpoint& since, NtfsDelta& out,
+                              ProgressCallback progressCb) {
+        std::ifstream disk(devicePath, std::ios::binary);
+        if (!disk) {
+            std::perror("Error opening device");
+            return DeltaResult::Failed;
+        }
+
+        Volume vol;
+        if (!openVolume(disk, devicePath, vol, nullptr)) {
+            return DeltaResult::Failed;
+        }
+
+        UsnJournal journal;
+        if (!readUsnJournal(disk, vol, since.journalMftIndex, journal)) {
+            std::cerr << "Change journal not found.\n";
+            return DeltaResult::NeedsFullScan;
+        }
+
+        if (journal.max.journalId != since.journalId) {
+            std::cerr << "Change journal was recreated (id " << since.journalId << " -> " << journal.max.journalId << ").\n";
+            return DeltaResult::NeedsFullScan;
+        }
+        if (since.nextUsn < journal.max.lowestValidUsn || since.nextUsn > journal.size) {
+            std::cerr << "Change journal no longer covers USN " << since.nextUsn << " (valid: "
+                      << journal.max.lowestValidUsn << " - " << journal.size << ").\n";
+            return DeltaResult::NeedsFullScan;
+        }
+
+        std::cerr << "Reading change journal from USN " << since.nextUsn << " to " << journal.size << "\n";
+
+        // Both phases count for half of the progress
+        static constexpr uint64_t kProgressTotal = 1000;
+        const uint64_t journalBytes = journal.size - since.nextUsn;
+        if (progressCb) progressCb(0, kProgressTotal);
+
+        // Step 1: Collect the MFT index of every file the journal mentions. Chunks are page aligned,
+        // so no record spans two of them.
+        static constexpr uint64_t kUsnPageSize = 4096;
+        static constexpr uint64_t kChunkBytes = 1024 * 1024;
+        std::vector<char> chunk(kChunkBytes);
+        std::vector<uint64_t>& changed = out.changedMftIndexes;
+        const auto journalStart = std::chrono::steady_clock::now();
+
+        for (uint64_t pos = since.nextUsn; pos < journal.size;) {
+            const uint64_t chunkEnd = std::min(journal.size, (pos / kChunkBytes + 1) * kChunkBytes);
+            const auto n = static_cast<size_t>(chunkEnd - pos);
+            if (!readStreamRange(disk, journal.runs, vol.bytesPerCluster, pos, n, chunk.data())) {
+                std::cerr << "Failed reading the change journal.\n";
+                return DeltaResult::NeedsFullScan;
+            }
+
+            for (size_t at = 0; at + sizeof(UsnRecordHeader) <= n;) {
+                UsnRecordHeader rec{};
+                std::memcpy(&rec, chunk.data() + at, sizeof(rec));
+
+                const uint64_t leftInPage = kUsnPageSize - ((pos + at) % kUsnPageSize);
+                if (rec.recordLength < sizeof(rec) || (rec.recordLength % 8) != 0 || rec.recordLength > leftInPage) {
+                    at += leftInPage; // zero padding up to the next page (or garbage)
+                    continue;
+                }
+
+                if (rec.majorVersion >= 2 && rec.majorVersion <= 4) {
+                    changed.push_back(rec.fileReference & 0xFFFFFFFFFFFFULL);
+                }
+                at += rec.recordLength;
+            }
+
+            pos = chunkEnd;
+            if (progressCb) progressCb((pos - since.nextUsn) * (kProgressTotal / 2) / journalBytes, kProgressTotal);
+        }
+
+        std::sort(changed.begin(), changed.end());
+        changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+        std::erase(changed, since.journalMftIndex);
+
+        ScannerUtils::reportPhase("journal", std::chrono::steady_clock::now() - journalStart);
+        std::cerr << changed.size() << " files changed.\n";
+
+        // Step 2: Re-read the changed files. A record that is free now (or was reused as some other
+        // file's extension record) means the file was deleted.
+        NtfsDatabase& db = out.db;
+        std::vector<char> buffer;
+        std::vector<char> extension;
+        std::vector<uint64_t> extensions;
+        const auto recordsStart = std::chrono::steady_clock::now();
+
+        for (size_t k = 0; k < changed.size(); ++k) {
+            const uint64_t index = changed[k];
+
+            if (progressCb) progressCb(kProgressTotal / 2 + k * (kProgressTotal / 2) / changed.size(), kProgressTotal);
+
+            const bool valid = readMftRecord(disk, vol, index, buffer);
+            if (!disk) {
+                std::cerr << "Failed reading MFT record " << index << ".\n";
+                return DeltaResult::NeedsFullScan;
+            }
+
+            auto* header = reinterpret_cast<MFT_RecordHeader*>(buffer.data());
+            if (!valid || !(header->flags & 0x01) || header->baseFileRecord != 0) {
+                continue;
+            }
+
+            extensions.clear();
+            if (!attributeListRecords(buffer.data(), index, extensions)) {
+                std::cerr << "MFT record " << index << " has a non-resident attribute list.\n";
+                return DeltaResult::NeedsFullScan;
+            }
+
+            processMftRecord(header, buffer.data(), index, db);
+
+            for (uint64_t e : extensions) {
+                if (!readMftRecord(disk, vol, e, extension)) continue;
+
+                auto* extHeader = reinterpret_cast<MFT_RecordHeader*>(extension.data());
+                if ((extHeader->flags & 0x01) && (extHeader->baseFileRecord & 0xFFFFFFFFFFFFULL) == index) {
+                    processMftRecord(extHeader, extension.data(), e, db);
+                }
+            }
+        }
+
+        processExtensionRecords(db);
+        db.extensionRecordFileInfos.clear();
+        ScannerUtils::reportPhase("records", std::chrono::steady_clock::now() - recordsStart);
+
+        // The delta's parents are MFT indexes (tempParentMfts); the daemon resolves them
+        for (auto& r : db.records) {
+            r.parentRecordIdx = 0xFFFFFFFF;
+        }
+
+        out.checkpoint = UsnCheckpoint{journal.max.journalId, journal.size, since.journalMftIndex};
+
+        if (progressCb) progressCb(kProgressTotal, kProgressTotal);
+        std::cerr << "Change journal applied: " << db.records.size() << " entries re-read.\n";
+        return DeltaResult::Ok;
+    }
+
+    // --- End: Change journal ($UsnJrnl) ---
+
+    void NtfsDatabase::add(std::string_view name, uint64_t mftIndex, uint64_t parentMftIndex, uint64_t size, uint64_t mod, bool isDir, bool isSymlink) {
         FileRecord rec{};
         rec.size = size;
         rec.modificationTime = mod;
@@ -489,24 +1028,60 @@ namespace NtfsScannerEngine {
         rec.isSymlink = false; // unused
 
         records.push_back(rec);
-        tempParentMfts.push_back(parentMftIndex); // Store metadata in parallel vector
+        tempParentMfts.push_back(parentMftIndex); // Store metadata in parallel vectors
+        tempMftIndexes.push_back(mftIndex);
         stringPool.insert(stringPool.end(), name.begin(), name.end());
+    }
 
-        // Fill the temporary map
-        mftToRecordIdx[mftIndex] = currentIdx;
+    void NtfsDatabase::appendShard(NtfsDatabase& shard) {
+        const auto poolBase = static_cast<uint32_t>(stringPool.size());
+
+        const size_t first = records.size();
+        records.insert(records.end(), shard.records.begin(), shard.records.end());
+        for (size_t i = first; i < records.size(); ++i) {
+            records[i].nameOffset += poolBase;
+        }
+
+        stringPool.insert(stringPool.end(), shard.stringPool.begin(), shard.stringPool.end());
+        tempParentMfts.insert(tempParentMfts.end(), shard.tempParentMfts.begin(), shard.tempParentMfts.end());
+        tempMftIndexes.insert(tempMftIndexes.end(), shard.tempMftIndexes.begin(), shard.tempMftIndexes.end());
+
+        // Keep the per-file part order (shards arrive in MFT order)
+        for (auto& [baseIndex, parts] : shard.extensionRecordFileInfos) {
+            auto& dst = extensionRecordFileInfos[baseIndex];
+            dst.insert(dst.end(), std::make_move_iterator(parts.begin()), std::make_move_iterator(parts.end()));
+        }
+
+        // Keep the shard's capacity for the next batch
+        shard.records.clear();
+        shard.stringPool.clear();
+        shard.tempParentMfts.clear();
+        shard.tempMftIndexes.clear();
+        shard.extensionRecordFileInfos.clear();
     }
 
     // We call this once after the MFT scan is completely finished
     void NtfsDatabase::resolveParentPointers() {
         std::cerr << "Resolving parent pointers..." << std::endl;
 
+        // MFT index -> record index + 1 (0 = not in our DB). MFT indexes are dense (bounded by the
+        // MFT size), so a flat table does the job; with hard links the last record added wins.
+        uint64_t maxMftIndex = 0;
+        for (uint64_t mft : tempMftIndexes) {
+            maxMftIndex = std::max(maxMftIndex, mft);
+        }
+
+        std::vector<uint32_t> mftToRecordIdx(records.empty() ? 0 : maxMftIndex + 1, 0);
+        for (size_t i = 0; i < records.size(); ++i) {
+            mftToRecordIdx[tempMftIndexes[i]] = static_cast<uint32_t>(i) + 1;
+        }
+
         // Convert parent MFT index to internal index
         for (size_t i = 0; i < records.size(); ++i) {
             uint64_t parentMft = tempParentMfts[i]; // Look up from parallel vector
 
-            auto it = mftToRecordIdx.find(parentMft);
-            if (it != mftToRecordIdx.end()) {
-                records[i].parentRecordIdx = it->second;
+            if (parentMft < mftToRecordIdx.size() && mftToRecordIdx[parentMft] != 0) {
+                records[i].parentRecordIdx = mftToRecordIdx[parentMft] - 1;
             } else {
                 // If parent isn't in our DB (like MFT Index 5's parent), mark as root
                 records[i].parentRecordIdx = 0xFFFFFFFF;
@@ -515,7 +1090,8 @@ namespace NtfsScannerEngine {
 
         // Cleanup all temporary data.
         // The memory is freed, and the GUI never even sees it.
-        mftToRecordIdx.clear();
+        mftIndexes = std::move(tempMftIndexes);
+        tempMftIndexes = {};
         tempParentMfts.clear();
         tempParentMfts.shrink_to_fit();
         mftRuns.clear();
@@ -89,6 +89,42 @@ namespace NtfsScannerEngine {
         uint16_t attributeID;
     };
 
+    /**
+     * One entry of an $ATTRIBUTE_LIST (Type 0x20). Files with too many attributes for one record
+     * list where each of their attributes lives (the base record or an extension record).
+     */
+    struct AttributeListEntry {
+        uint32_t type;
+        uint16_t length; // of this entry
+        uint8_t nameLength;
+        uint8_t nameOffset;
+        uint64_t startVcn;
+        uint64_t fileReference; // record holding the attribute (bottom 48 bits: MFT index)
+        uint16_t attributeID;
+    };
+
+    /**
+     * $Extend\$UsnJrnl:$Max, the change journal's resident header stream.
+     */
+    struct UsnJournalMax {
+        uint64_t maximumSize;
+        uint64_t allocationDelta;
+        uint64_t journalId;      // new id whenever the journal is (re)created
+        uint64_t lowestValidUsn; // older records have been purged from $J
+    };
+
+    /**
+     * Start of every record in $UsnJrnl:$J (USN_RECORD_V2, V3 and V4). V3+ use 128-bit file
+     * references, of which NTFS fills the low 64 bits, so the prefix reads the same.
+     * A record's USN is its byte offset in $J.
+     */
+    struct UsnRecordHeader {
+        uint32_t recordLength; // multiple of 8; records never cross a 4 KiB page
+        uint16_t majorVersion;
+        uint16_t minorVersion;
+        uint64_t fileReference; // bottom 48 bits: MFT index of the changed file
+    };
+
     /**
      * $FILE_NAME Attribute (Type 0x30). Contains the name, parent directory
      * index, and cached size/dates. Note: Windows often creates multiple
@@ -214,10 +250,20 @@ namespace NtfsScannerEngine {
         std::vector<char> stringPool;
 
         // TEMPORARY (Only used during scan/setup)
-        // We keep this here so add() can fill it, then we clear it in resolveParentPointers()
-        std::unordered_map<uint64_t, uint32_t> mftToRecordIdx;
+        // We keep these here so add() can fill them, then we clear them in resolveParentPointers()
+        // 48-bit MFT index of each record (parallel to records)
+        std::vector<uint64_t> tempMftIndexes;
         // Temporary storage for 48-bit MFT index
         std::vector<uint64_t> tempParentMfts;
+        // Parts of files spread over several MFT records, by base record index
+        std::unordered_map<uint64_t, std::vector<ExtensionFileInfo>> extensionRecordFileInfos;
+
+        // MFT index of each record (parallel to records), kept by resolveParentPointers() so the
+        // daemon can match records against the change journal later
+        std::vector<uint64_t> mftIndexes;
+
+        // MFT index of $Extend\$UsnJrnl, or 0 if the volume has no change journal
+        uint64_t usnJournalMftIndex = 0;
 
         /**
          * Adds a file or directory record to the database.
@@ -232,6 +278,15 @@ namespace NtfsScannerEngine {
          */
         void add(std::string_view name, uint64_t mftIndex, uint64_t parentMftIndex, uint64_t size, uint64_t mod, bool isDir, bool isSymlink);
 
+        /**
+         * Appends everything a parse worker collected (records, names, extension record parts),
+         * as if its records had been processed on this database directly. Shards have to be
+         * appended in MFT order for the result to match a sequential scan.
+         *
+         * @param shard The worker's database; it is left empty.
+         */
+        void appendShard(NtfsDatabase& shard);
+
         /**
          * Resolves parent-child relationships between file records in the NTFS database.
          * This is called once after the MFT scan is completely finished
@@ -240,33 +295,101 @@ namespace NtfsScannerEngine {
          * the database entries to reflect the hierarchical relationships. Any unresolved parent
          * pointers, such as those referencing the root directory, are marked accordingly.
          * Additionally, all temporary data structures used during the setup phase are freed
-         * to optimize memory usage.
+         * to optimize memory usage (the MFT indexes move to mftIndexes).
          */
         void resolveParentPointers();
     };
 
+    /**
+     * A position in the volume's change journal ($Extend\$UsnJrnl:$J).
+     */
+    struct UsnCheckpoint {
+        uint64_t journalId = 0;       // UsnJournalID from $UsnJrnl:$Max
+        uint64_t nextUsn = 0;         // USN the next journal record will get (= size of $J)
+        uint64_t journalMftIndex = 0; // MFT index of $UsnJrnl
+    };
+
+    /**
+     * The files that changed since a checkpoint, as re-read from the MFT.
+     *
+     * db holds the current links of every changed file that still exists; its parent pointers are
+     * left unresolved (tempParentMfts / tempMftIndexes stay filled), since the parents are mostly
+     * records the delta doesn't contain.
+     */
+    struct NtfsDelta {
+        NtfsDatabase db;
+        std::vector<uint64_t> changedMftIndexes; // sorted; includes deleted files
+        UsnCheckpoint checkpoint;                // where the next delta starts
+    };
+
+    enum class DeltaResult {
+        Ok,
+        NeedsFullScan, // journal recreated, wrapped past the checkpoint, or not readable
+        Failed,        // device/volume unreadable
+    };
+
     /**
      * Progress callback: called with (done, total) to report scan progress.
      */
     using ProgressCallback = std::function<void(uint64_t done, uint64_t total)>;
 
+    /**
+     * Batch callback: called after each batch of MFT records has been processed, with the
+     * partially built database. Records and string pool only ever grow during the scan, and
+     * every field except parentRecordIdx is final once a record has been added.
+     */
+    using BatchCallback = std::function<void(const NtfsDatabase& db)>;
+
     /**
      * Parses the Master File Table (MFT) from the specified NTFS volume.
      * This method reads the boot sector to locate the MFT, calculates
      * record size, and iteratively processes records to build an
      * in-memory representation of the file system's metadata.
      *
+     * The MFT is read through AsyncBlockReader, so the next batches load
+     * (O_DIRECT, io_uring when available) while the current one is parsed.
+     * Each batch is split into shards that are parsed in parallel into their
+     * own NtfsDatabase, then appended to the result in MFT order.
+     * Records that $MFT:$BITMAP marks as free are never read.
+     *
      * @param devicePath The path to the target device or volume where
      *                   the NTFS partition is located. This should be
      *                   a valid system path.
      * @param progressCb A callback function to report progress during MFT scanning.
-     *                   The callback takes two arguments: the number of records processed
-     *                   and the total number of records.
+     *                   The callback takes two arguments: the number of in-use records processed
+     *                   and the total number of in-use records.
      *                   Can be null if progress reporting is not required.
+     * @param batchCb A callback invoked after each read batch so callers can stream out
+     *                records while the scan is still running. Can be null.
      * @return An optional NtfsDatabase containing the reconstructed
      *         metadata of the NTFS volume, or std::nullopt if parsing fails.
      */
-    std::optional<NtfsDatabase> parseMft(const std::string& devicePath, ProgressCallback progressCb = {});
+    std::optional<NtfsDatabase> parseMft(const std::string& devicePath, ProgressCallback progressCb = {}, BatchCallback batchCb = {});
+
+    /**
+     * Reads the current state of the change journal, to be stored alongside a full scan.
+     *
+     * @param devicePath The NTFS partition.
+     * @param journalMftIndex NtfsDatabase::usnJournalMftIndex of the scan.
+     * @return The checkpoint, or std::nullopt if the journal can't be read.
+     */
+    std::optional<UsnCheckpoint> readUsnCheckpoint(const std::string& devicePath, uint64_t journalMftIndex);
+
+    /**
+     * Incremental scan: reads the USN records written to $UsnJrnl:$J since `since`, and re-reads
+     * the MFT records of every file they mention (following resident attribute lists).
+     *
+     * Only changes made through the journal are seen. Windows always journals; Linux NTFS drivers
+     * don't, so changes made from Linux need a full scan (or the daemon's watch).
+     *
+     * @param devicePath The NTFS partition.
+     * @param since Checkpoint of the index being updated.
+     * @param out Receives the changed files and the new checkpoint (only meaningful for Ok).
+     * @param progressCb Reports journal bytes parsed, then changed records read. Can be null.
+     * @return Ok, or why the delta can't be produced.
+     */
+    DeltaResult parseUsnDelta(const std::string& devicePath, const UsnCheckpoint& since, NtfsDelta& out,
+                              ProgressCallback progressCb = {});
 
     /**
      * NTFS Fixups (Update Sequence Array):
@@ -298,6 +421,19 @@ namespace NtfsScannerEngine {
      */
     void parseMftRuns(char* buffer, uint32_t attrOffset);
 
+    // logicalClusterNumber of a sparse run (no clusters allocated, reads as zeros)
+    static constexpr uint64_t kSparseLcn = ~0ULL;
+
+    /**
+     * Decodes the Data Runs of any non-resident attribute (see parseMftRuns()) into out.
+     * VCNs start at the attribute's startVcn; sparse runs get kSparseLcn.
+     *
+     * @param buffer A pointer to the buffer containing the MFT record.
+     * @param attrOffset The offset of the attribute header within the buffer.
+     * @param out Receives the runs, in VCN order.
+     */
+    void parseDataRuns(char* buffer, uint32_t attrOffset, std::vector<MftRun>& out);
+
     /**
      * Calculates the physical byte offset on disk corresponding to a given MFT index.
      * This function takes into account the MFT record size, bytes per cluster, and the